@@ -1,26 +1,73 @@
 TEMPLATE = app
-CONFIG += c++11
+CONFIG += c++14
 #CONFIG -= app_bundle
 
 QT += core gui multimedia
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
+# qmake CONFIG+=opcodestats counts what the cpu executes per opcode
+opcodestats: DEFINES += OPCODE_STATS
+# qmake CONFIG+=memorystats counts reads and writes per page of memory
+memorystats: DEFINES += MEMORY_STATS
+
 
 SOURCES += \
+        src/audiostream.cpp \
         src/infowindow.cpp \
         src/mainwindow.cpp \
+        src/AudioMixer.cpp \
+        src/CallGraph.cpp \
+        src/ColorOverlay.cpp \
         src/ConditionFlags.cpp \
+        src/Coverage.cpp \
         src/Disassembler8080.cpp \
+        src/FrameBuffer.cpp \
+        src/FrameHash.cpp \
+        src/InputLatch.cpp \
+        src/MemoryHeatmap.cpp \
+        src/Movie.cpp \
+        src/OpcodeInfo.cpp \
+        src/OpcodeStats.cpp \
+        src/Profiler.cpp \
+        src/RewindBuffer.cpp \
+        src/RomLoader.cpp \
+        src/RomSet.cpp \
+        src/Snapshot.cpp \
+        src/SpaceInvaders.cpp \
         src/State8080.cpp \
+        src/Symbols.cpp \
+        src/Trace.cpp \
+        src/Traps.cpp \
         src/main.cpp \
         test/manualtest.cpp \
         test/tests.cpp
 
 HEADERS += \
+    include/AudioMixer.hpp \
+    include/CallGraph.hpp \
+    include/ColorOverlay.hpp \
     include/ConditionFlags.hpp \
+    include/Coverage.hpp \
     include/Disassembler8080.hpp \
+    include/FrameBuffer.hpp \
+    include/FrameHash.hpp \
+    include/InputLatch.hpp \
+    include/MemoryHeatmap.hpp \
+    include/Movie.hpp \
+    include/OpcodeInfo.hpp \
+    include/OpcodeStats.hpp \
+    include/Profiler.hpp \
+    include/RewindBuffer.hpp \
+    include/RomLoader.hpp \
+    include/RomSet.hpp \
+    include/Snapshot.hpp \
+    include/SpaceInvaders.hpp \
     include/State8080.hpp \
+    include/Symbols.hpp \
+    include/Trace.hpp \
+    include/Traps.hpp \
+    include/audiostream.hpp \
     include/infowindow.hpp \
     include/mainwindow.hpp \
     include/tester.h
@@ -31,15 +78,26 @@ INCLUDEPATH += \
 RESOURCES += \
     resources.qrc
 
+# Keep resources uncompressed so the rom and sounds are read in place
+QMAKE_RESOURCE_FLAGS += -no-compress
+
 FORMS += \
     forms/mainwindow.ui \
     forms/infowindow.ui
 
 
+# make bench builds the benchmarks in bench/ under the build directory and runs them, see bench/main.cpp
+bench.commands = $(MKDIR) $$OUT_PWD/bench && cd $$OUT_PWD/bench && $$QMAKE_QMAKE $$PWD/bench/bench.pro && $(MAKE) \
+                 && ./8080-bench --rsc $$PWD/rsc --json $$OUT_PWD/bench/bench.json
+QMAKE_EXTRA_TARGETS += bench
+
 # Default rules for deployment.
 #qnx: target.path = /tmp/$${TARGET}/bin
 #else: unix:!android: target.path = /opt/$${TARGET}/bin
 #!isEmpty(target.path): INSTALLS += target
 
 DISTFILES += \
+    rsc/invaders.romset \
+    rsc/overlays/midway.txt \
+    rsc/overlays/monochrome.txt \
     test/allowRunTests.py
@@ -0,0 +1,25 @@
+TEMPLATE = app
+TARGET = 8080-asm
+CONFIG += console c++14 release
+CONFIG -= app_bundle
+CONFIG -= qt
+
+SOURCES += \
+    ../src/Assembler.cpp \
+    ../src/ConditionFlags.cpp \
+    ../src/KernelGenerator.cpp \
+    ../src/RomLoader.cpp \
+    ../src/State8080.cpp \
+    ../src/Symbols.cpp \
+    main.cpp
+
+HEADERS += \
+    ../include/Assembler.hpp \
+    ../include/ConditionFlags.hpp \
+    ../include/KernelGenerator.hpp \
+    ../include/RomLoader.hpp \
+    ../include/State8080.hpp \
+    ../include/Symbols.hpp
+
+INCLUDEPATH += \
+    ../include
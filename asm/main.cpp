@@ -0,0 +1,115 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdio>
+
+#include "Assembler.hpp"
+#include "KernelGenerator.hpp"
+
+// Assembles 8080 source into a binary, or writes the source of a synthetic benchmark kernel
+
+namespace {
+
+struct Options {
+    std::string source;
+    std::string output; // the source with .COM in place of its type by default
+    std::string symbols;
+    uint16_t origin = 0x100;
+    std::string kernel;
+    unsigned length = 64;
+    uint32_t seed = 1;
+};
+
+void usage() {
+    std::cerr << "Usage: 8080-asm [options] <source>\n"
+              << "       8080-asm --kernel <mix> [--length <n>] [--seed <n>]\n"
+              << "  -o <file>            the binary, default the source with the type .COM\n"
+              << "  --origin <hex>       where code goes until the first ORG, default 100\n"
+              << "  --symbols <file>     write the labels as a symbol file for the profilers\n"
+              << "  --kernel <mix>       print the source of a generated kernel, alu, memory, branch or stack\n"
+              << "  --length <n>         instructions in the kernel's loop, default 64\n"
+              << "  --seed <n>           seed of the kernel's random instructions, default 1\n";
+}
+
+Options parseOptions(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc)
+                throw std::runtime_error(arg + " requires a value");
+            return argv[++i];
+        };
+        if (arg == "-o") options.output = value();
+        else if (arg == "--origin") {
+            const unsigned long origin = std::stoul(value(), nullptr, 16);
+            if (origin > 0xFFFF)
+                throw std::runtime_error("the origin must be 0 to FFFF");
+            options.origin = static_cast<uint16_t>(origin);
+        }
+        else if (arg == "--symbols") options.symbols = value();
+        else if (arg == "--kernel") options.kernel = value();
+        else if (arg == "--length") options.length = static_cast<unsigned>(std::stoul(value()));
+        else if (arg == "--seed") options.seed = static_cast<uint32_t>(std::stoul(value()));
+        else if (arg == "--help") {
+            usage();
+            std::exit(0);
+        }
+        else if (arg[0] == '-') throw std::runtime_error("unknown option " + arg);
+        else if (options.source.empty()) options.source = arg;
+        else throw std::runtime_error("only one source can be assembled");
+    }
+    if (options.source.empty() && options.kernel.empty())
+        throw std::runtime_error("no source to assemble");
+    if (options.output.empty()) {
+        const std::size_t dot = options.source.find_last_of('.');
+        const std::size_t slash = options.source.find_last_of("/\\");
+        const bool typed = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+        options.output = (typed ? options.source.substr(0, dot) : options.source) + ".COM";
+    }
+    return options;
+}
+
+void writeSymbols(const Assembly& assembly, const std::string& source, const std::string& fname) {
+    std::ofstream ofs(fname);
+    if (!ofs.good())
+        throw std::runtime_error("Unable to open file for writing, given path:" + fname);
+    ofs << "# labels of " << source << "\n";
+    const Symbols labels = assembly.labels();
+    for (const auto& symbol : labels.names()) {
+        char address[8];
+        std::snprintf(address, sizeof address, "0x%04X", symbol.first);
+        ofs << address << " " << symbol.second << "\n";
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        usage();
+        return 1;
+    }
+
+    try {
+        if (!options.kernel.empty()) {
+            std::cout << KernelGenerator::source(options.kernel, options.length, options.seed);
+            return 0;
+        }
+        const Assembly assembly = Assembly::fromFile(options.source, options.origin);
+        assembly.toFile(options.output);
+        if (!options.symbols.empty())
+            writeSymbols(assembly, options.source, options.symbols);
+        std::printf("%s: %zu bytes from 0x%04X, start 0x%04X\n", options.output.c_str(), assembly.bytes().size(), assembly.origin(), assembly.start());
+    } catch (std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+TEMPLATE = app
+TARGET = 8080-bench
+CONFIG += console c++14 release thread
+CONFIG -= app_bundle
+CONFIG -= qt
+
+# qmake CONFIG+=opcodestats counts what the cpu executes per opcode
+opcodestats: DEFINES += OPCODE_STATS
+# qmake CONFIG+=memorystats counts reads and writes per page of memory
+memorystats: DEFINES += MEMORY_STATS
+
+SOURCES += \
+    ../src/Assembler.cpp \
+    ../src/AudioMixer.cpp \
+    ../src/CallGraph.cpp \
+    ../src/ConditionFlags.cpp \
+    ../src/Coverage.cpp \
+    ../src/CpmBdos.cpp \
+    ../src/Disassembler8080.cpp \
+    ../src/DiskImage.cpp \
+    ../src/InputLatch.cpp \
+    ../src/KernelGenerator.cpp \
+    ../src/MachinePool.cpp \
+    ../src/MemoryHeatmap.cpp \
+    ../src/Movie.cpp \
+    ../src/OpcodeInfo.cpp \
+    ../src/OpcodeStats.cpp \
+    ../src/Profiler.cpp \
+    ../src/RomLoader.cpp \
+    ../src/Snapshot.cpp \
+    ../src/SpaceInvaders.cpp \
+    ../src/State8080.cpp \
+    ../src/Symbols.cpp \
+    ../src/Trace.cpp \
+    ../src/Traps.cpp \
+    main.cpp
+
+HEADERS += \
+    ../include/Assembler.hpp \
+    ../include/AudioMixer.hpp \
+    ../include/CallGraph.hpp \
+    ../include/ConditionFlags.hpp \
+    ../include/Coverage.hpp \
+    ../include/CpmBdos.hpp \
+    ../include/Disassembler8080.hpp \
+    ../include/DiskImage.hpp \
+    ../include/InputLatch.hpp \
+    ../include/KernelGenerator.hpp \
+    ../include/MachinePool.hpp \
+    ../include/MemoryHeatmap.hpp \
+    ../include/Movie.hpp \
+    ../include/OpcodeInfo.hpp \
+    ../include/OpcodeStats.hpp \
+    ../include/Profiler.hpp \
+    ../include/RomLoader.hpp \
+    ../include/Snapshot.hpp \
+    ../include/SpaceInvaders.hpp \
+    ../include/State8080.hpp \
+    ../include/Symbols.hpp \
+    ../include/Trace.hpp \
+    ../include/Traps.hpp
+
+INCLUDEPATH += \
+    ../include
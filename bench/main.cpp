@@ -0,0 +1,437 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <cstdlib>
+
+#if defined(__linux__)
+#define BENCH_PIN
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "State8080.hpp"
+#include "Assembler.hpp"
+#include "Disassembler8080.hpp"
+#include "SpaceInvaders.hpp"
+#include "RomLoader.hpp"
+#include "Traps.hpp"
+#include "CpmBdos.hpp"
+#include "KernelGenerator.hpp"
+#include "MachinePool.hpp"
+
+// Measures how fast the emulator runs programs, in emulated instructions and cycles a second
+
+namespace {
+
+const char* const engine = "interpreter"; // the opcode table of Disassembler8080
+
+struct Options {
+    std::string rsc = "../rsc";
+    std::string json;
+    std::string filter;
+    int repeat = 10;
+    int warmup = 1;
+    int cpu = 0; // -1 leaves the thread unpinned
+    double minTime = 0.1; // a run repeats its workload until it has taken this long
+    uint64_t frames = 600;
+    uint64_t instructions = 20000000;
+    unsigned length = 64; // of the generated kernels
+    uint32_t seed = 1;
+};
+
+// What one pass of a workload did
+struct Counts {
+    uint64_t instructions = 0;
+    uint64_t cycles = 0;
+    uint64_t frames = 0;
+};
+
+struct Workload {
+    std::string name;
+    std::function<Counts()> run;
+};
+
+struct Stats {
+    double median, p10, p90, min, max;
+};
+
+struct Result {
+    std::string name;
+    Counts counts; // of every timed run together
+    std::vector<double> seconds;
+    std::vector<double> mips, mhz, fps;
+};
+
+void usage() {
+    std::cout << "Usage: 8080-bench [options]\n"
+              << "  --rsc <dir>            where the roms are, default ../rsc\n"
+              << "  --filter <text>        only run workloads whose name contains the text\n"
+              << "  --repeat <n>           timed runs of every workload, default 10\n"
+              << "  --warmup <n>           untimed runs before them, default 1\n"
+              << "  --min-time <seconds>   a run repeats its workload until it took this long, default 0.1\n"
+              << "  --cpu <n>              core to pin the thread to, -1 to not pin, default 0\n"
+              << "  --frames <n>           frames of the invaders attract mode, default 600\n"
+              << "  --instructions <n>     instructions of the synthetic kernels, default 20000000\n"
+              << "  --length <n>           instructions in the loop of the generated mix kernels, default 64\n"
+              << "  --seed <n>             seed of the generated mix kernels, default 1\n"
+              << "  --json <file>          write the results as JSON, - for standard output\n";
+}
+
+Options parseOptions(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc)
+                throw std::runtime_error(arg + " requires a value");
+            return argv[++i];
+        };
+        if (arg == "--rsc") options.rsc = value();
+        else if (arg == "--json") options.json = value();
+        else if (arg == "--filter") options.filter = value();
+        else if (arg == "--repeat") options.repeat = std::max(1, std::stoi(value()));
+        else if (arg == "--warmup") options.warmup = std::max(0, std::stoi(value()));
+        else if (arg == "--min-time") options.minTime = std::stod(value());
+        else if (arg == "--cpu") options.cpu = std::stoi(value());
+        else if (arg == "--frames") options.frames = std::stoull(value());
+        else if (arg == "--instructions") options.instructions = std::stoull(value());
+        else if (arg == "--length") options.length = static_cast<unsigned>(std::stoul(value()));
+        else if (arg == "--seed") options.seed = static_cast<uint32_t>(std::stoul(value()));
+        else if (arg == "--help") {
+            usage();
+            std::exit(0);
+        }
+        else throw std::runtime_error("unknown option " + arg);
+    }
+    return options;
+}
+
+bool pinThread(int cpu) {
+#ifdef BENCH_PIN
+    if (cpu < 0)
+        return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof set, &set) == 0;
+#else
+    (void) cpu;
+    return false;
+#endif
+}
+
+// A CP/M program run until it goes back to CP/M, its printing is done natively by the BDOS traps
+Workload cpmProgram(const std::string& name, const std::string& fname) {
+    State8080 loaded;
+    loadRomFile(loaded, fname, CpmBdos::tpa);
+    return {name, [loaded]() {
+        State8080 state = loaded;
+        Traps traps;
+        CpmBdos bdos(traps);
+        bdos.prepare(state);
+        Disassembler8080 cpu;
+        cpu.traps = &traps;
+        Counts counts;
+        do {
+            cpu.runCycle(state);
+            ++counts.instructions;
+        } while (!bdos.finished());
+        counts.cycles = state.cycleCount;
+        return counts;
+    }};
+}
+
+// A loop of instructions assembled at 0x100, run for a number of instructions
+Workload kernel(const std::string& name, const std::string& source, uint64_t instructions) {
+    const Assembly assembly = Assembly::fromSource(source, 0x100, name);
+    State8080 loaded;
+    assembly.load(loaded);
+    loaded.programCounter = assembly.start();
+    loaded.stackPointer = 0x4000;
+    return {name, [loaded, instructions]() {
+        State8080 state = loaded;
+        Disassembler8080 cpu;
+        Counts counts;
+        for (counts.instructions = 0; counts.instructions != instructions; counts.instructions++)
+            cpu.runCycle(state);
+        counts.cycles = state.cycleCount;
+        return counts;
+    }};
+}
+
+// The game's attract mode, every step is an instruction or an interrupt being taken
+Workload attractMode(const std::string& fname, uint64_t frames) {
+    SpaceInvaders loaded;
+    loadRomFile(loaded.state, fname, 0);
+    return {"invaders-attract", [loaded, frames]() {
+        SpaceInvaders machine = loaded;
+        Counts counts;
+        while (machine.frameCount() != frames) {
+            machine.step();
+            ++counts.instructions;
+        }
+        counts.cycles = machine.state.cycleCount;
+        counts.frames = frames;
+        return counts;
+    }};
+}
+
+// Seconds of the attract mode from one snapshot, each on a machine from a pool that copies back only what it wrote
+Workload episodes(const std::string& fname, uint64_t frames) {
+    SpaceInvaders warm;
+    loadRomFile(warm.state, fname, 0);
+    for (int i = 0; i != 100; i++)
+        warm.runFrame();
+    const Snapshot baseline(warm);
+    return {"invaders-episodes", [baseline, frames]() {
+        MachinePool pool(baseline, 1);
+        Counts counts;
+        while (counts.frames < frames) {
+            SpaceInvaders* machine = pool.acquire();
+            const uint64_t end = machine->frameCount() + 60;
+            const uint64_t cycles = machine->state.cycleCount;
+            while (machine->frameCount() != end) {
+                machine->step();
+                ++counts.instructions;
+            }
+            counts.cycles += machine->state.cycleCount - cycles;
+            counts.frames += 60;
+            pool.release(machine);
+        }
+        return counts;
+    }};
+}
+
+std::vector<Workload> workloads(const Options& options) {
+    std::vector<Workload> list;
+    list.push_back(cpmProgram("8080PRE", options.rsc + "/8080PRE.COM"));
+    list.push_back(cpmProgram("TST8080", options.rsc + "/TST8080.COM"));
+    list.push_back(attractMode(options.rsc + "/invaders", options.frames));
+    list.push_back(episodes(options.rsc + "/invaders", options.frames));
+
+    // ADD ADC SUB ANA XRA ORA CMP INR DCR RLC in a loop
+    list.push_back(kernel("kernel-alu",
+        "        MVI     B,0\n"
+        "LOOP:   ADD     B\n"
+        "        ADC     C\n"
+        "        SUB     D\n"
+        "        ANA     E\n"
+        "        XRA     H\n"
+        "        ORA     L\n"
+        "        CMP     B\n"
+        "        INR     B\n"
+        "        DCR     C\n"
+        "        RLC\n"
+        "        JMP     LOOP\n", options.instructions));
+    // loads and stores through HL, DE walking 0x2000 - 0x2FFF and 0x3000 - 0x3FFF
+    list.push_back(kernel("kernel-memory",
+        "        LXI     H,2000H\n"
+        "        LXI     D,3000H\n"
+        "LOOP:   MOV     A,M\n"
+        "        STAX    D\n"
+        "        INX     H\n"
+        "        INX     D\n"
+        "        MOV     M,A\n"
+        "        LDAX    D\n"
+        "        MOV     B,M\n"
+        "        MOV     A,H\n"
+        "        ANI     2FH\n"
+        "        MOV     H,A\n"
+        "        MOV     A,D\n"
+        "        ANI     3FH\n"
+        "        ORI     30H\n"
+        "        MOV     D,A\n"
+        "        JMP     LOOP\n", options.instructions));
+    // conditional jumps taken and not taken on the bits of a counter
+    list.push_back(kernel("kernel-branch",
+        "        MVI     B,0\n"
+        "LOOP:   INR     B\n"
+        "        MOV     A,B\n"
+        "        ANI     01H\n"
+        "        JZ      ODD\n"
+        "        NOP\n"
+        "        NOP\n"
+        "ODD:    MOV     A,B\n"
+        "        ANI     02H\n"
+        "        JNZ     TWO\n"
+        "        NOP\n"
+        "        NOP\n"
+        "TWO:    MOV     A,B\n"
+        "        CPI     80H\n"
+        "        JC      LOOP\n"
+        "        JMP     LOOP\n", options.instructions));
+    // calls, returns and the stack
+    list.push_back(kernel("kernel-stack",
+        "        LXI     SP,4000H\n"
+        "LOOP:   CALL    SUB\n"
+        "        PUSH    B\n"
+        "        PUSH    D\n"
+        "        POP     D\n"
+        "        POP     B\n"
+        "        JMP     LOOP\n"
+        "        ORG     110H\n"
+        "SUB:    PUSH    H\n"
+        "        XTHL\n"
+        "        XTHL\n"
+        "        POP     H\n"
+        "        ORA     A\n"
+        "        RNC\n", options.instructions));
+    // random instruction mixes of each kind from KernelGenerator
+    for (const std::string& mix : KernelGenerator::mixes()) {
+        list.push_back(kernel("mix-" + mix, KernelGenerator::source(mix, options.length, options.seed), options.instructions));
+    }
+    return list;
+}
+
+Stats stats(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    // nearest rank
+    auto percentile = [&](double p) {
+        std::size_t rank = static_cast<std::size_t>(p * (values.size() - 1) + 0.5);
+        return values[rank];
+    };
+    return {percentile(0.5), percentile(0.1), percentile(0.9), values.front(), values.back()};
+}
+
+Result measure(const Workload& workload, const Options& options) {
+    using clock = std::chrono::steady_clock;
+    Result result;
+    result.name = workload.name;
+    for (int i = 0; i != options.warmup; i++)
+        workload.run();
+
+    for (int i = 0; i != options.repeat; i++) {
+        Counts run;
+        const clock::time_point start = clock::now();
+        double seconds = 0;
+        do {
+            Counts counts = workload.run();
+            run.instructions += counts.instructions;
+            run.cycles += counts.cycles;
+            run.frames += counts.frames;
+            seconds = std::chrono::duration<double>(clock::now() - start).count();
+        } while (seconds < options.minTime);
+
+        result.counts.instructions += run.instructions;
+        result.counts.cycles += run.cycles;
+        result.counts.frames += run.frames;
+        result.seconds.push_back(seconds);
+        result.mips.push_back(run.instructions / seconds / 1e6);
+        result.mhz.push_back(run.cycles / seconds / 1e6);
+        if (run.frames != 0)
+            result.fps.push_back(run.frames / seconds);
+    }
+    return result;
+}
+
+std::string buildFlags() {
+    std::ostringstream oss;
+#if defined(__clang__)
+    oss << "clang " << __clang_major__ << "." << __clang_minor__;
+#elif defined(__GNUC__)
+    oss << "gcc " << __GNUC__ << "." << __GNUC_MINOR__;
+#elif defined(_MSC_VER)
+    oss << "msvc " << _MSC_VER;
+#endif
+#ifdef __OPTIMIZE__
+    oss << " optimized";
+#endif
+#ifdef NDEBUG
+    oss << " NDEBUG";
+#endif
+#ifdef OPCODE_STATS
+    oss << " opcodestats";
+#endif
+#ifdef MEMORY_STATS
+    oss << " memorystats";
+#endif
+    return oss.str();
+}
+
+void writeStats(std::ostream& os, const char* name, const std::vector<double>& values) {
+    const Stats s = stats(values);
+    os << "      \"" << name << "\": {\"median\": " << s.median << ", \"p10\": " << s.p10 << ", \"p90\": " << s.p90
+       << ", \"min\": " << s.min << ", \"max\": " << s.max << "}";
+}
+
+void writeJson(std::ostream& os, const Options& options, bool pinned, const std::vector<Result>& results) {
+    os << "{\n"
+       << "  \"engine\": \"" << engine << "\",\n"
+       << "  \"build\": \"" << buildFlags() << "\",\n"
+       << "  \"repeat\": " << options.repeat << ",\n"
+       << "  \"warmup\": " << options.warmup << ",\n"
+       << "  \"minTime\": " << options.minTime << ",\n"
+       << "  \"cpu\": " << (pinned ? options.cpu : -1) << ",\n"
+       << "  \"results\": [\n";
+    for (std::size_t i = 0; i != results.size(); i++) {
+        const Result& result = results[i];
+        os << "    {\n"
+           << "      \"name\": \"" << result.name << "\",\n"
+           << "      \"instructions\": " << result.counts.instructions << ",\n"
+           << "      \"cycles\": " << result.counts.cycles << ",\n";
+        writeStats(os, "seconds", result.seconds);
+        os << ",\n";
+        writeStats(os, "mips", result.mips);
+        os << ",\n";
+        writeStats(os, "mhz", result.mhz);
+        if (!result.fps.empty()) {
+            os << ",\n";
+            writeStats(os, "fps", result.fps);
+        }
+        os << "\n    }" << (i + 1 != results.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n}" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    std::vector<Workload> list;
+    try {
+        options = parseOptions(argc, argv);
+        list = workloads(options);
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        usage();
+        return 1;
+    }
+
+    const bool pinned = pinThread(options.cpu);
+    std::cerr << "Engine " << engine << ", " << buildFlags() << ", " << (pinned ? "pinned to cpu " + std::to_string(options.cpu) : std::string("not pinned"))
+              << ", " << options.repeat << " runs of at least " << options.minTime << " s after " << options.warmup << " warmup" << std::endl;
+
+    std::vector<Result> results;
+    for (const Workload& workload : list) {
+        if (workload.name.find(options.filter) == std::string::npos)
+            continue;
+        results.push_back(measure(workload, options));
+        const Result& result = results.back();
+        const Stats mips = stats(result.mips);
+        const Stats mhz = stats(result.mhz);
+        std::cerr << result.name << ": " << mips.median << " MIPS (p10 " << mips.p10 << ", p90 " << mips.p90 << "), "
+                  << mhz.median << " MHz emulated";
+        if (!result.fps.empty())
+            std::cerr << ", " << stats(result.fps).median << " frames/s";
+        std::cerr << std::endl;
+    }
+
+    if (options.json == "-") {
+        writeJson(std::cout, options, pinned, results);
+    }
+    else if (!options.json.empty()) {
+        std::ofstream ofs(options.json);
+        writeJson(ofs, options, pinned, results);
+        if (!ofs.good()) {
+            std::cerr << "Error writing " << options.json << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
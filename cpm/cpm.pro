@@ -0,0 +1,37 @@
+TEMPLATE = app
+TARGET = 8080-cpm
+CONFIG += console c++14 release thread
+CONFIG -= app_bundle
+CONFIG -= qt
+
+# qmake CONFIG+=opcodestats counts what the cpu executes per opcode
+opcodestats: DEFINES += OPCODE_STATS
+
+SOURCES += \
+    ../src/ConditionFlags.cpp \
+    ../src/CpmBdos.cpp \
+    ../src/CpmMachine.cpp \
+    ../src/Disassembler8080.cpp \
+    ../src/DiskImage.cpp \
+    ../src/OpcodeInfo.cpp \
+    ../src/OpcodeStats.cpp \
+    ../src/RomLoader.cpp \
+    ../src/State8080.cpp \
+    ../src/Traps.cpp \
+    main.cpp
+
+HEADERS += \
+    ../include/ConditionFlags.hpp \
+    ../include/CpmBdos.hpp \
+    ../include/CpmMachine.hpp \
+    ../include/Disassembler8080.hpp \
+    ../include/DiskImage.hpp \
+    ../include/MemoryHeatmap.hpp \
+    ../include/OpcodeInfo.hpp \
+    ../include/OpcodeStats.hpp \
+    ../include/RomLoader.hpp \
+    ../include/State8080.hpp \
+    ../include/Traps.hpp
+
+INCLUDEPATH += \
+    ../include
@@ -0,0 +1,142 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+#include "CpmMachine.hpp"
+#include "DiskImage.hpp"
+#include "RomLoader.hpp"
+
+// Runs a CP/M program on disk images without a window, its console on stdin and stdout
+
+namespace {
+
+struct Options {
+    std::vector<std::string> disks; // A: first
+    std::string create; // the format of disks that do not exist yet
+    std::vector<std::string> puts;
+    std::string program;
+    std::vector<std::string> arguments;
+    uint64_t maxInstructions = 0;
+    uint64_t maxCycles = 0;
+};
+
+void usage() {
+    std::cerr << "Usage: 8080-cpm [options] <program> [arguments]\n"
+              << "  --disk <image>            mount a disk image, on A: then B: to D:\n"
+              << "  --create <format>         create the disks that do not exist, ibm-3740 (8\") or z80pack-hdb (4 MB)\n"
+              << "  --put <file>              copy a host file to A: before running\n"
+              << "  --max-instructions <n>    stop after n instructions\n"
+              << "  --max-cycles <n>          stop after n cycles\n"
+              << "The program is a host file, or a name on A: with .COM added if it has no type.\n"
+              << "How long it ran is reported on stderr.\n";
+}
+
+Options parseOptions(int argc, char* argv[]) {
+    Options options;
+    int i = 1;
+    for (; i < argc && std::strncmp(argv[i], "--", 2) == 0; i++) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc)
+                throw std::runtime_error(arg + " requires a value");
+            return argv[++i];
+        };
+        if (arg == "--disk") options.disks.push_back(value());
+        else if (arg == "--create") options.create = value();
+        else if (arg == "--put") options.puts.push_back(value());
+        else if (arg == "--max-instructions") options.maxInstructions = std::stoull(value());
+        else if (arg == "--max-cycles") options.maxCycles = std::stoull(value());
+        else if (arg == "--help") {
+            usage();
+            std::exit(0);
+        }
+        else throw std::runtime_error("unknown option " + arg);
+    }
+    if (i == argc)
+        throw std::runtime_error("no program to run");
+    if (options.disks.size() > CpmBdos::maxDrives)
+        throw std::runtime_error("at most 4 disks can be mounted");
+    options.program = argv[i++];
+    options.arguments.assign(argv + i, argv + argc);
+    return options;
+}
+
+const DiskFormat& formatNamed(const std::string& name) {
+    for (const DiskFormat& format : diskFormats) {
+        if (name == format.name)
+            return format;
+    }
+    throw std::runtime_error("unknown disk format " + name);
+}
+
+bool exists(const std::string& fname) {
+    return std::ifstream(fname).good();
+}
+
+std::string baseName(const std::string& path) {
+    const std::size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        usage();
+        return 1;
+    }
+
+    CpmMachine machine;
+    CpmMachine::Result result;
+    try {
+        for (std::size_t drive = 0; drive != options.disks.size(); drive++) {
+            const std::string& image = options.disks[drive];
+            if (!exists(image) && !options.create.empty())
+                DiskImage::create(image, formatNamed(options.create));
+            machine.mount(drive, image);
+        }
+        for (const std::string& put : options.puts) {
+            const MappedFile file(put);
+            const std::vector<uint8_t> data(file.data(), file.data() + file.size());
+            if (options.disks.empty() || !machine.bdos.writeFile(0, baseName(put), data))
+                throw std::runtime_error("Unable to put " + put + " on A:");
+        }
+
+        std::vector<uint8_t> program;
+        if (exists(options.program)) {
+            const MappedFile file(options.program);
+            program.assign(file.data(), file.data() + file.size());
+        }
+        else {
+            const std::string name = options.program.find('.') == std::string::npos ? options.program + ".COM" : options.program;
+            if (options.disks.empty() || !machine.bdos.readFile(0, name, program))
+                throw std::runtime_error("Program not found on the host or on A:, given name:" + options.program);
+        }
+        machine.load(program, options.arguments);
+
+        machine.bdos.setConsole(&std::cin, &std::cout);
+        result = machine.run(options.maxInstructions, options.maxCycles);
+    } catch (std::exception& e) {
+        machine.bdos.flush();
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    const std::ios_base::fmtflags flags = std::cerr.flags();
+    std::cerr << std::fixed << std::setprecision(2)
+              << "\n" << (result.finished ? "Finished" : machine.state.halted ? "Halted" : "Stopped at the limit")
+              << " after " << result.instructions << " instructions, " << result.cycles << " cycles in " << result.seconds << " s, "
+              << (result.seconds > 0 ? result.instructions / result.seconds / 1e6 : 0.0) << " MIPS" << std::endl;
+    std::cerr.flags(flags);
+    return 0;
+}
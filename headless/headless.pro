@@ -0,0 +1,70 @@
+TEMPLATE = app
+TARGET = 8080-headless
+CONFIG += console c++14 thread
+CONFIG -= app_bundle
+CONFIG -= qt
+
+# qmake CONFIG+=opcodestats counts what the cpu executes per opcode
+opcodestats: DEFINES += OPCODE_STATS
+# qmake CONFIG+=memorystats counts reads and writes per page of memory
+memorystats: DEFINES += MEMORY_STATS
+
+SOURCES += \
+    ../src/AudioMixer.cpp \
+    ../src/CallGraph.cpp \
+    ../src/ColorOverlay.cpp \
+    ../src/ConditionFlags.cpp \
+    ../src/ControlFlowGraph.cpp \
+    ../src/Coverage.cpp \
+    ../src/Disassembler8080.cpp \
+    ../src/FrameBuffer.cpp \
+    ../src/FrameHash.cpp \
+    ../src/InputLatch.cpp \
+    ../src/InvadersObserver.cpp \
+    ../src/MemoryHeatmap.cpp \
+    ../src/MemorySearch.cpp \
+    ../src/Movie.cpp \
+    ../src/OpcodeInfo.cpp \
+    ../src/OpcodeStats.cpp \
+    ../src/Profiler.cpp \
+    ../src/RewindBuffer.cpp \
+    ../src/RomLoader.cpp \
+    ../src/RomSet.cpp \
+    ../src/Snapshot.cpp \
+    ../src/SpaceInvaders.cpp \
+    ../src/State8080.cpp \
+    ../src/Symbols.cpp \
+    ../src/Trace.cpp \
+    ../src/Traps.cpp \
+    main.cpp
+
+HEADERS += \
+    ../include/AudioMixer.hpp \
+    ../include/CallGraph.hpp \
+    ../include/ColorOverlay.hpp \
+    ../include/ConditionFlags.hpp \
+    ../include/ControlFlowGraph.hpp \
+    ../include/Coverage.hpp \
+    ../include/Disassembler8080.hpp \
+    ../include/FrameBuffer.hpp \
+    ../include/FrameHash.hpp \
+    ../include/InputLatch.hpp \
+    ../include/InvadersObserver.hpp \
+    ../include/MemoryHeatmap.hpp \
+    ../include/MemorySearch.hpp \
+    ../include/Movie.hpp \
+    ../include/OpcodeInfo.hpp \
+    ../include/OpcodeStats.hpp \
+    ../include/Profiler.hpp \
+    ../include/RewindBuffer.hpp \
+    ../include/RomLoader.hpp \
+    ../include/RomSet.hpp \
+    ../include/Snapshot.hpp \
+    ../include/SpaceInvaders.hpp \
+    ../include/State8080.hpp \
+    ../include/Symbols.hpp \
+    ../include/Trace.hpp \
+    ../include/Traps.hpp
+
+INCLUDEPATH += \
+    ../include
@@ -0,0 +1,427 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <memory>
+
+#include "SpaceInvaders.hpp"
+#include "FrameBuffer.hpp"
+#include "ColorOverlay.hpp"
+#include "RomLoader.hpp"
+#include "RomSet.hpp"
+#include "AudioMixer.hpp"
+#include "Snapshot.hpp"
+#include "RewindBuffer.hpp"
+#include "Movie.hpp"
+#include "FrameHash.hpp"
+#include "Profiler.hpp"
+#include "CallGraph.hpp"
+#include "Trace.hpp"
+#include "MemoryHeatmap.hpp"
+#include "Coverage.hpp"
+#include "ControlFlowGraph.hpp"
+#include "Symbols.hpp"
+#include "MemorySearch.hpp"
+#include "InvadersObserver.hpp"
+
+// Runs Space Invaders without a window, for measuring and testing the emulator
+
+namespace {
+
+struct Options {
+    std::string rom = "../rsc/invaders";
+    std::string romSet;
+    std::string sounds = "../rsc/audio";
+    std::string wav;
+    std::string loadState;
+    std::string saveState;
+    std::string record;
+    std::string play;
+    std::string hashes;
+    std::string opcodes;
+    std::string symbols;
+    std::string callGraph;
+    std::string trace;
+    std::string heatmap;
+    bool heatmapBytes = false;
+    std::string coverage;
+    std::string cfg;
+    std::string search;
+    std::string observe;
+    uint64_t frames = 600;
+    bool framesGiven = false;
+    uint64_t frameSkip = 1;
+    uint64_t rewindSeconds = 0;
+    bool profile = false;
+    uint64_t profilePeriod = 0;
+    bool turbo = false;
+};
+
+void usage() {
+    std::cout << "Usage: 8080-headless [options]\n"
+              << "  --rom <file>         rom to run, default ../rsc/invaders\n"
+              << "  --romset <file>      rom set descriptor to run instead of --rom\n"
+              << "  --frames <n>         frames to run, default 600 (10 seconds) or to the end of the movie played\n"
+              << "  --turbo              run as fast as possible instead of in real time\n"
+              << "  --frameskip <n>      convert the screen every nth frame, default 1, turbo also limits it to 60 a second\n"
+              << "  --load-state <file>  start from a snapshot instead of a reset\n"
+              << "  --save-state <file>  save a snapshot after the last frame\n"
+              << "  --record <file>      record the buttons of every frame to a movie\n"
+              << "  --play <file>        play the buttons back from a movie\n"
+              << "  --hashes <file>      write a hash of work and video RAM after every frame, see test/golden\n"
+              << "  --opcodes <file>     write the executions and cycles of every opcode as csv, needs CONFIG+=opcodestats\n"
+              << "  --profile            report the routines the program spent its instructions in\n"
+              << "  --profile-every <n>  profile by sampling the instruction running every n cycles instead\n"
+              << "  --callgraph <file>   write the cycles of every chain of calls as folded stacks for a flame graph\n"
+              << "  --trace <file>       record every instruction with the registers, list it with 8080-trace\n"
+              << "  --heatmap <prefix>   count memory accesses per page, writes <prefix>.csv, -frames.csv and .ppm,\n"
+              << "                       needs CONFIG+=memorystats\n"
+              << "  --heatmap-bytes      count them per byte in <prefix>.csv\n"
+              << "  --coverage <file>    record what every address was used for, added to the file if it exists\n"
+              << "  --cfg <prefix>       write the control flow graph of the code that ran to <prefix>.dot and .json\n"
+              << "  --symbols <file>     names of the rom's routines for the profile, e.g. ../rsc/invaders.sym\n"
+              << "  --search <file>      narrow down work and video RAM to a variable, a frame and a filter per line,\n"
+              << "                       e.g. \"60 changed\", see MemorySearch for the filters\n"
+              << "  --observe <file>     write the game's score, lives, player, shots and invaders after every frame as csv\n"
+              << "  --rewind <seconds>   keep a rewind history of every frame and report its cost\n"
+              << "  --wav <file>         render the sound to a wav file\n"
+              << "  --sounds <dir>       where the sounds are, default ../rsc/audio\n";
+}
+
+Options parseOptions(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc)
+                throw std::runtime_error(arg + " requires a value");
+            return argv[++i];
+        };
+        if (arg == "--rom") options.rom = value();
+        else if (arg == "--romset") options.romSet = value();
+        else if (arg == "--sounds") options.sounds = value();
+        else if (arg == "--wav") options.wav = value();
+        else if (arg == "--load-state") options.loadState = value();
+        else if (arg == "--save-state") options.saveState = value();
+        else if (arg == "--frames") {
+            options.frames = std::stoull(value());
+            options.framesGiven = true;
+        }
+        else if (arg == "--record") options.record = value();
+        else if (arg == "--play") options.play = value();
+        else if (arg == "--hashes") options.hashes = value();
+        else if (arg == "--opcodes") options.opcodes = value();
+        else if (arg == "--profile") options.profile = true;
+        else if (arg == "--profile-every") {
+            options.profilePeriod = std::max<uint64_t>(1, std::stoull(value()));
+            options.profile = true;
+        }
+        else if (arg == "--symbols") options.symbols = value();
+        else if (arg == "--callgraph") options.callGraph = value();
+        else if (arg == "--trace") options.trace = value();
+        else if (arg == "--heatmap") options.heatmap = value();
+        else if (arg == "--heatmap-bytes") options.heatmapBytes = true;
+        else if (arg == "--coverage") options.coverage = value();
+        else if (arg == "--cfg") options.cfg = value();
+        else if (arg == "--search") options.search = value();
+        else if (arg == "--observe") options.observe = value();
+        else if (arg == "--frameskip") options.frameSkip = std::max<uint64_t>(1, std::stoull(value()));
+        else if (arg == "--rewind") options.rewindSeconds = std::stoull(value());
+        else if (arg == "--turbo") options.turbo = true;
+        else if (arg == "--help") {
+            usage();
+            std::exit(0);
+        }
+        else throw std::runtime_error("unknown option " + arg);
+    }
+    return options;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        usage();
+        return 1;
+    }
+
+    SpaceInvaders machine;
+    Movie movie;
+    Profiler profiler(options.profilePeriod);
+    CallGraph callGraph;
+    Symbols symbols;
+    std::unique_ptr<TraceRecorder> trace;
+    Coverage coverage;
+    MemorySearch search;
+    std::vector<MemorySearch::Step> searchSteps;
+    InvadersObserver observer;
+    std::ofstream observations;
+    MemoryHeatmap heatmap(options.heatmapBytes ? MemoryHeatmap::Byte : MemoryHeatmap::Page);
+    AudioMixer mixer; // offline, emulated cycles map straight to samples
+    PcmBuffer audio;
+    try {
+        if (!options.romSet.empty())
+            RomSet::fromFile(options.romSet).load(machine.state);
+        else if (loadRomFile(machine.state, options.rom, 0) == nullptr)
+            std::cerr << "Warning: " << options.rom << " is not a known rom" << std::endl;
+
+        if (!options.wav.empty()) {
+            mixer.loadSamples(options.sounds);
+            machine.mixer = &mixer;
+        }
+
+        if (!options.loadState.empty()) {
+            const Snapshot snapshot = Snapshot::fromFile(options.loadState);
+            const auto before = std::chrono::steady_clock::now();
+            snapshot.restore(machine);
+            const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - before).count();
+            std::cout << "Restored " << options.loadState << " at frame " << machine.frameCount() << " in " << us << " us" << std::endl;
+        }
+
+        if (!options.play.empty()) {
+            movie = Movie::fromFile(options.play);
+            if (!movie.matches(machine))
+                std::cerr << "Warning: " << options.play << " was recorded with a different rom" << std::endl;
+            if (machine.frameCount() != movie.startFrame())
+                std::cerr << "Warning: " << options.play << " starts at frame " << movie.startFrame() << ", not " << machine.frameCount() << std::endl;
+            if (!options.framesGiven)
+                options.frames = movie.endFrame() > machine.frameCount() ? movie.endFrame() - machine.frameCount() : 0;
+            machine.movie = &movie;
+        }
+        else if (!options.record.empty()) {
+            movie = Movie::record(machine);
+            machine.movie = &movie;
+        }
+
+        if (!options.symbols.empty())
+            symbols = Symbols::fromFile(options.symbols);
+        if (options.profile)
+            machine.profiler = &profiler;
+        if (!options.callGraph.empty())
+            machine.callGraph = &callGraph;
+#ifdef MEMORY_STATS
+        if (!options.heatmap.empty())
+            machine.state.heatmap = &heatmap;
+#else
+        if (!options.heatmap.empty())
+            std::cerr << "Memory accesses are not counted, build with qmake CONFIG+=memorystats" << std::endl;
+#endif
+        if (!options.coverage.empty() || !options.cfg.empty())
+            machine.coverage = &coverage;
+        if (!options.trace.empty()) {
+            trace.reset(new TraceRecorder(options.trace));
+            machine.trace = trace.get();
+        }
+        if (!options.search.empty()) {
+            searchSteps = MemorySearch::scriptFromFile(options.search);
+            std::stable_sort(searchSteps.begin(), searchSteps.end(), [](const MemorySearch::Step& a, const MemorySearch::Step& b) { return a.frame < b.frame; });
+            search.reset(machine.state);
+        }
+        if (!options.observe.empty()) {
+            observations.open(options.observe);
+            if (!observations.good())
+                throw std::runtime_error("unable to write " + options.observe);
+            InvadersView::writeCsvHeader(observations);
+        }
+    } catch (std::exception& e) {
+        std::cerr << "Error loading, " << e.what() << std::endl;
+        return 1;
+    }
+
+    using clock = std::chrono::steady_clock;
+    const std::chrono::duration<double> displayInterval(1.0 / 60);
+    FrameBuffer frame;
+    ColorOverlay overlay;
+    RewindBuffer rewind(options.rewindSeconds * 60);
+    std::vector<uint64_t> hashes;
+    uint64_t presented = 0;
+    const uint64_t startCycle = machine.state.cycleCount; // not 0 when started from a snapshot
+    const clock::time_point start = clock::now();
+    clock::time_point lastPresent = start - std::chrono::seconds(1);
+    std::size_t searchStep = 0;
+
+    for (uint64_t i = 0; i != options.frames; i++) {
+        machine.runFrame();
+        if (options.rewindSeconds != 0)
+            rewind.capture(machine);
+#ifdef MEMORY_STATS
+        if (!options.heatmap.empty())
+            heatmap.endFrame();
+#endif
+        if (!options.hashes.empty())
+            hashes.push_back(frameHash(machine.state));
+        if (!options.wav.empty())
+            mixer.renderUntil(machine.state.cycleCount, audio);
+        if (!options.observe.empty()) {
+            const InvadersObserver::Observation seen = observer.observe(machine);
+            seen.game.writeCsv(observations, seen.frame);
+        }
+        for (; searchStep != searchSteps.size() && searchSteps[searchStep].frame <= machine.frameCount(); searchStep++) {
+            const MemorySearch::Step& step = searchSteps[searchStep];
+            if (step.frame != machine.frameCount())
+                continue; // before the run started
+            try {
+                const std::size_t left = search.run(step.command, machine.state);
+                std::cout << "Frame " << step.frame << ", " << step.command << ": " << left << " candidates" << std::endl;
+            } catch (std::exception& e) {
+                std::cerr << "Error searching memory, " << e.what() << std::endl;
+                return 1;
+            }
+        }
+
+        const clock::time_point now = clock::now();
+        bool present = machine.frameCount() % options.frameSkip == 0;
+        if (options.turbo)
+            present = present && now - lastPresent >= displayInterval;
+        if (present) {
+            frame.convert(machine.state, overlay);
+            lastPresent = now;
+            ++presented;
+        }
+
+        // in real time the next frame waits for the emulated time to pass
+        if (!options.turbo) {
+            std::chrono::duration<double> emulated(static_cast<double>(machine.state.cycleCount - startCycle) / SpaceInvaders::cpuClock);
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<clock::duration>(emulated));
+        }
+    }
+
+    if (trace) {
+        try {
+            trace->close();
+        } catch (std::exception& e) {
+            std::cerr << "Error saving trace, " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+    const double emulatedSeconds = static_cast<double>(machine.state.cycleCount - startCycle) / SpaceInvaders::cpuClock;
+    std::cout << "Ran " << options.frames << " frames (" << emulatedSeconds << " s emulated) in " << seconds << " s, "
+              << emulatedSeconds / seconds << "x real time, presented " << presented << " frames" << std::endl;
+    if (options.rewindSeconds != 0)
+        rewind.report(std::cout);
+    if (trace)
+        std::cout << "Trace: " << trace->recorded() << " records to " << options.trace << ", the emulation waited for the writer "
+                  << trace->stalls() << " times" << std::endl;
+#ifdef MEMORY_STATS
+    if (!options.heatmap.empty()) {
+        heatmap.report(std::cout);
+        try {
+            std::ofstream totals(options.heatmap + ".csv");
+            heatmap.writeCsv(totals);
+            std::ofstream frames(options.heatmap + "-frames.csv");
+            heatmap.writeFramesCsv(frames);
+            if (!totals.good() || !frames.good())
+                throw std::runtime_error("unable to write " + options.heatmap + ".csv");
+            heatmap.writeFramesImage(options.heatmap + ".ppm");
+        } catch (std::exception& e) {
+            std::cerr << "Error saving heatmap, " << e.what() << std::endl;
+            return 1;
+        }
+    }
+#endif
+    if (!options.search.empty())
+        search.report(std::cout, machine.state, symbols);
+    if (!options.observe.empty()) {
+        observations.close();
+        if (!observations.good()) {
+            std::cerr << "Error writing " << options.observe << std::endl;
+            return 1;
+        }
+    }
+    if (options.profile)
+        profiler.report(std::cout, machine.state, symbols);
+    if (!options.callGraph.empty()) {
+        callGraph.report(std::cout, symbols, options.frames);
+        std::ofstream folded(options.callGraph);
+        callGraph.writeFolded(folded, symbols);
+        if (!folded.good()) {
+            std::cerr << "Error writing " << options.callGraph << std::endl;
+            return 1;
+        }
+    }
+    if (machine.coverage != nullptr) {
+        try {
+            // runs of several movies add up in the same file
+            if (!options.coverage.empty() && std::ifstream(options.coverage).good())
+                coverage.merge(Coverage::fromFile(options.coverage));
+            coverage.report(std::cout, symbols, 0x0000, 0x1FFF);
+            if (!options.coverage.empty())
+                coverage.toFile(options.coverage);
+            if (!options.cfg.empty()) {
+                const ControlFlowGraph graph(coverage);
+                std::cout << "Control flow: " << graph.blocks().size() << " blocks, " << graph.edges().size() << " edges" << std::endl;
+                std::ofstream dot(options.cfg + ".dot");
+                graph.writeDot(dot, symbols);
+                std::ofstream json(options.cfg + ".json");
+                graph.writeJson(json, symbols, 0x0000, 0x1FFF);
+                if (!dot.good() || !json.good())
+                    throw std::runtime_error("unable to write " + options.cfg + ".dot and .json");
+            }
+        } catch (std::exception& e) {
+            std::cerr << "Error saving coverage, " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+#ifdef OPCODE_STATS
+    machine.cpu.stats.report(std::cout);
+    if (!options.opcodes.empty()) {
+        std::ofstream csv(options.opcodes);
+        machine.cpu.stats.writeCsv(csv);
+        if (!csv.good()) {
+            std::cerr << "Error writing " << options.opcodes << std::endl;
+            return 1;
+        }
+    }
+#else
+    if (!options.opcodes.empty())
+        std::cerr << "Opcodes are not counted, build with qmake CONFIG+=opcodestats" << std::endl;
+#endif
+
+    if (!options.record.empty() && options.play.empty()) {
+        try {
+            movie.toFile(options.record);
+        } catch (std::exception& e) {
+            std::cerr << "Error saving movie, " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    if (!options.hashes.empty()) {
+        try {
+            frameHashesToFile(options.hashes, hashes, "frames " + std::to_string(machine.frameCount() - hashes.size() + 1)
+                              + " to " + std::to_string(machine.frameCount()) + (options.play.empty() ? "" : " of " + options.play));
+        } catch (std::exception& e) {
+            std::cerr << "Error saving frame hashes, " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    if (!options.saveState.empty()) {
+        try {
+            Snapshot(machine).toFile(options.saveState);
+        } catch (std::exception& e) {
+            std::cerr << "Error saving state, " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    if (!options.wav.empty()) {
+        try {
+            wavToFile(options.wav, audio);
+        } catch (std::exception& e) {
+            std::cerr << "Error writing sound, " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
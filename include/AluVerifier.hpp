@@ -0,0 +1,63 @@
+#ifndef ALUVERIFIER_HPP
+#define ALUVERIFIER_HPP
+
+#include <cstdint>
+#include <array>
+#include <functional>
+#include <ostream>
+
+#include "State8080.hpp"
+
+// Checks a cpu's 8 bit arithmetic and logic against a reference model written from Intel's manual, for every
+// value of A and the operand with every combination of carry and aux carry. The opcodes are ADD, ADC, SUB, SBB,
+// ANA, XRA, ORA and CMP of every register, memory and immediate, INR and DCR of every register and memory, DAA,
+// the rotates, CMA, STC and CMC. The 78 opcodes with an operand other than A take 256 A by 256 operands by 4
+// carries, 256 K cases each, and with the few of the rest that is 20,523,008 cases. They are split between threads
+// by opcode and A, every thread runs its own cpu, so any engine that runs an instruction on a State8080 can be
+// checked the same way.
+class AluVerifier {
+public:
+    using Step = std::function<void(State8080&)>; // runs the instruction at the program counter
+    using Engine = std::function<Step()>; // a new cpu for a thread
+    enum Field : uint8_t {A = 1, Register = 2, Sign = 4, Zero = 8, Parity = 16, Carry = 32, AuxCarry = 64};
+
+    struct Outcome {
+        uint8_t a;
+        uint8_t value; // the register or memory INR and DCR changed, A for the others
+        uint8_t psw; // the flags as PUSH PSW stores them
+    };
+    struct Mismatch {
+        uint8_t a = 0;
+        uint8_t operand = 0;
+        uint8_t psw = 0; // before
+        Outcome expected {};
+        Outcome got {};
+    };
+    struct OpcodeResult {
+        uint64_t cases = 0;
+        uint64_t mismatches = 0;
+        uint8_t fields = 0; // that differed in any case
+        Mismatch first; // the first in the order of the cases
+    };
+
+    explicit AluVerifier(const Engine& engine = interpreter());
+    static Engine interpreter(); // Disassembler8080
+
+    void run(unsigned threads = 0); // 0 uses every core
+    uint64_t cases() const noexcept;
+    uint64_t mismatches() const noexcept;
+    const std::array<OpcodeResult, 256>& results() const noexcept { return perOpcode; }
+    double seconds() const noexcept { return elapsed; }
+    // A line per opcode that failed with the outputs that differed and its first case
+    void report(std::ostream& os) const;
+
+    static bool verified(const uint8_t& opcode) noexcept; // one of the opcodes checked
+    static Outcome reference(const uint8_t& opcode, const uint8_t& a, const uint8_t& operand, const uint8_t& psw) noexcept;
+
+private:
+    Engine engine;
+    std::array<OpcodeResult, 256> perOpcode {};
+    double elapsed = 0.0;
+};
+
+#endif // ALUVERIFIER_HPP
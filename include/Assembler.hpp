@@ -0,0 +1,48 @@
+#ifndef ASSEMBLER_HPP
+#define ASSEMBLER_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "State8080.hpp"
+#include "Symbols.hpp"
+
+// A program assembled from Intel 8080 source by a two pass assembler, in the syntax of CP/M's ASM and of M80
+// that rsc/TST8080.ASM and rsc/8080PRE.MAC are written in:
+//   labels with or without a colon, upper or lower case, comments after ;
+//   ORG, EQU, SET and DEFL, DB, DW and DS (and DEFB, DEFW, DEFS), END with a start address, IF, ELSE and ENDIF,
+//   REPT and MACRO blocks closed by ENDM, & joins a macro's parameter to the text around it. TITLE, PAGE, .8080,
+//   ASEG and the like are accepted and ignored
+//   numbers in decimal or with a suffix, 0FFH 1010B 17O 17Q 99D, characters 'A' and 'AB', $ for the address
+//   + - * / MOD SHL SHR, HIGH LOW, EQ NE LT LE GT GE, NOT AND OR XOR and parentheses, on 16 bits
+// The first pass finds every label's address, the second encodes. Errors throw with the line they are on.
+class Assembly {
+public:
+    // origin is where code goes until the first ORG
+    static Assembly fromSource(const std::string& source, const uint16_t& origin = 0x100, const std::string& name = "source");
+    static Assembly fromFile(const std::string& fname, const uint16_t& origin = 0x100);
+
+    uint16_t origin() const noexcept { return first; } // the lowest address assembled
+    uint16_t start() const noexcept { return entry; } // END's address, else the origin
+    // Every byte from the origin to the last one assembled, the gaps between ORGs and DS are 0
+    const std::vector<uint8_t>& bytes() const noexcept { return image; }
+    const std::map<std::string, uint16_t>& symbols() const noexcept { return values; } // upper case
+    uint16_t symbol(const std::string& name) const; // any case, throws if it is not defined
+    Symbols labels() const; // the addresses of the labels, for the profilers
+
+    void load(State8080& state) const; // copies the bytes to the origin in memory
+    void toFile(const std::string& fname) const; // the bytes, e.g. a .COM for CP/M at 0x100
+
+private:
+    friend class Assembler;
+
+    uint16_t first = 0;
+    uint16_t entry = 0;
+    std::vector<uint8_t> image;
+    std::map<std::string, uint16_t> values;
+    std::map<std::string, uint16_t> addresses; // the labels among the symbols
+};
+
+#endif // ASSEMBLER_HPP
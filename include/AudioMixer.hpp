@@ -0,0 +1,91 @@
+#ifndef AUDIOMIXER_HPP
+#define AUDIOMIXER_HPP
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <deque>
+#include <string>
+#include <mutex>
+
+// 16 bit mono samples at the mixer's rate
+using PcmBuffer = std::vector<int16_t>;
+
+// Mixes the game's sounds into a single stream of 16 bit mono samples.
+// Sounds are decoded once up front, triggers carry the emulated cycle they happened at
+// and are converted to an exact sample position in the output.
+class AudioMixer {
+public:
+    enum Sound : uint8_t {
+        Ufo, Shot, BaseHit, InvHit,
+        Walk1, Walk2, Walk3, Walk4, UfoHit,
+        SoundCount
+    };
+    static constexpr int sampleRate = 44100;
+    static constexpr uint64_t cpuClock = 2000000; // 2 MHz
+    static const std::array<const char*, SoundCount> fileNames; // file name of each sound in rsc/audio
+
+    // latency is the amount of samples a trigger is placed ahead of the output when the stream is resynced,
+    // 0 keeps emulated time and output time locked together which is what offline rendering wants
+    explicit AudioMixer(std::size_t latency = 0);
+
+    void setSample(const Sound&, PcmBuffer pcm);
+    void loadSamples(const std::string& directory); // decode every sound from files in the directory
+
+    // The game makes sounds by setting bits on ports 3 and 5, a sound starts on the bit's rising edge
+    void portWrite(const uint8_t& port, const uint8_t& value, const uint64_t& cycle);
+    void play(const Sound&, const uint64_t& cycle);
+    void stop(const Sound&, const uint64_t& cycle);
+    void setMuted(bool muted); // silence everything and drop triggers, used when running faster than real time
+
+    // Fill out with the next frames of the stream
+    void render(int16_t* out, std::size_t frames);
+    // Render until the cycle, used when rendering offline
+    void renderUntil(const uint64_t& cycle, PcmBuffer& out);
+    uint64_t renderPosition() const noexcept { return position; }
+
+private:
+    enum class Action : uint8_t { Play, Stop };
+    struct Event {
+        uint64_t position; // sample position in the output
+        Sound sound;
+        Action action;
+    };
+    struct Voice {
+        bool active = false;
+        std::size_t offset = 0;
+    };
+    struct Channel {
+        PcmBuffer pcm;
+        int32_t volume = 256; // 256 is full volume
+        bool loops = false;
+    };
+
+    void schedule(const Sound&, const Action&, const uint64_t& cycle);
+    uint64_t cycleToSample(const uint64_t& cycle) const noexcept;
+    void mix(int16_t* out, std::size_t frames);
+
+    std::mutex mutex; // render is called from the audio device while triggers come from the emulator
+    std::array<Channel, SoundCount> channels;
+    std::array<Voice, SoundCount> voices;
+    std::deque<Event> events;
+    std::vector<int32_t> accumulator;
+    uint64_t position = 0; // samples rendered so far
+    std::size_t latency;
+
+    // emulated cycles are mapped to samples relative to an anchor
+    bool anchored = false;
+    uint64_t anchorCycle = 0;
+    uint64_t anchorSample = 0;
+
+    uint8_t lastPort3 = 0;
+    uint8_t lastPort5 = 0;
+    bool muted = false;
+};
+
+// Decodes an uncompressed 8 or 16 bit wav and resamples it to AudioMixer::sampleRate
+extern PcmBuffer decodeWav(const uint8_t* data, std::size_t size);
+extern PcmBuffer wavFromFile(const std::string& fname);
+extern void wavToFile(const std::string& fname, const PcmBuffer& pcm, int rate = AudioMixer::sampleRate);
+
+#endif // AUDIOMIXER_HPP
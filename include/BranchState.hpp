@@ -0,0 +1,84 @@
+#ifndef BRANCHSTATE_HPP
+#define BRANCHSTATE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
+#include "State8080.hpp"
+#include "SpaceInvaders.hpp"
+#include "Snapshot.hpp"
+
+// A machine state for tree search, the registers by value and memory as 256 byte pages shared copy-on-write with
+// the states it was forked from. A page is never changed once made, so forking a state copies the page pointers
+// and a step only makes new pages for what the machine wrote. Every page keeps its hash, the state's hash is made
+// from them and the registers, so telling states apart costs no more than the pages that changed.
+class BranchState {
+public:
+    struct Page {
+        std::array<uint8_t, State8080::pageSize> bytes;
+        uint64_t hash;
+    };
+    using PagePtr = std::shared_ptr<const Page>;
+
+    BranchState() = default; // empty
+    explicit BranchState(const SpaceInvaders& machine); // capture the machine, identical pages are shared
+
+    BranchState fork() const { return *this; } // a child sharing every page
+    void discard() noexcept; // drops the pages, the state is empty
+
+    bool empty() const noexcept { return pages[0] == nullptr; }
+    uint64_t hash() const noexcept { return digest; }
+    uint64_t frameCount() const noexcept { return header.frames; }
+    const SnapshotHeader& registers() const noexcept { return header; }
+    uint8_t read(const uint16_t& address) const noexcept { return pages[address / State8080::pageSize]->bytes[address % State8080::pageSize]; }
+    std::size_t sharedPages(const BranchState& other) const noexcept; // pages held by both
+    bool operator==(const BranchState& other) const noexcept; // same registers and memory
+    bool operator!=(const BranchState& other) const noexcept { return !(*this == other); }
+
+private:
+    friend class Brancher;
+    void rehash() noexcept;
+
+    SnapshotHeader header {};
+    std::array<PagePtr, State8080::pageCount> pages;
+    uint64_t digest = 0;
+};
+
+// Runs branches on one machine. Loading a state copies only the pages that differ from what the machine holds,
+// so stepping the children of a state one after the other copies little more than what each of them wrote.
+class Brancher {
+public:
+    using Advance = std::function<void(SpaceInvaders&)>; // runs the machine on, e.g. a frame with some buttons
+
+    // The state after advance runs from the given one, pages the machine wrote with the same bytes stay shared
+    BranchState step(const BranchState& from, const Advance& advance);
+    void load(const BranchState& state); // puts the machine in the state, throws if it is empty
+    SpaceInvaders& machine() noexcept { return working; }
+
+    uint64_t pagesCopied() const noexcept { return copied; } // into the machine by loads
+    uint64_t pagesMade() const noexcept { return made; } // by steps
+
+private:
+    SpaceInvaders working;
+    std::array<BranchState::PagePtr, State8080::pageCount> loaded; // what the machine's memory holds, if not dirty
+    uint64_t copied = 0;
+    uint64_t made = 0;
+};
+
+// The states a search has seen, found by hash and compared in full when hashes match
+class BranchSet {
+public:
+    bool insert(const BranchState& state); // false if an identical state is already in
+    bool contains(const BranchState& state) const;
+    std::size_t size() const noexcept { return states.size(); }
+    void clear() noexcept { states.clear(); }
+
+private:
+    std::unordered_multimap<uint64_t, BranchState> states;
+};
+
+#endif // BRANCHSTATE_HPP
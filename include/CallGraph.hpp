@@ -0,0 +1,72 @@
+#ifndef CALLGRAPH_HPP
+#define CALLGRAPH_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "State8080.hpp"
+#include "Symbols.hpp"
+
+// The emulated cycles spent in every chain of calls, for inclusive and exclusive costs per subroutine.
+// Calls, restarts and interrupts push a frame on a shadow stack that remembers the stack pointer
+// below the return address, a return pops every frame whose return address it pops or passes,
+// so routines that discard their return address and leave by a jump are still closed by the next return
+// above them. PCHL is taken as a call without a return address, how the rom dispatches its game objects,
+// and loading the stack pointer drops the frames above it. Interrupt handlers are counted under the root
+// rather than under the routine they interrupted.
+class CallGraph {
+public:
+    static constexpr std::size_t maxDepth = 256; // deeper calls are counted in the deepest frame
+
+    CallGraph();
+
+    // Called by the board after each instruction with what the cpu was before it
+    void executed(const State8080& state, const uint16_t& pc, const uint16_t& sp, const uint64_t& startCycle);
+    void interrupted(const State8080& state, const uint64_t& startCycle); // an interrupt entered its handler
+    void clear();
+
+    struct Node {
+        uint16_t entry;
+        bool interrupt; // entered by an interrupt rather than called
+        uint32_t parent;
+        uint64_t calls;
+        uint64_t selfCycles;
+        std::vector<std::pair<uint16_t, uint32_t>> children; // entry and node
+    };
+    const std::vector<Node>& nodes() const noexcept { return tree; } // the first is where profiling started
+    std::size_t depth() const noexcept { return frames.size(); }
+
+    struct Routine {
+        uint16_t entry;
+        std::string name;
+        uint64_t calls;
+        uint64_t inclusive; // cycles in it and everything it called, recursion counted once
+        uint64_t exclusive;
+    };
+    std::vector<Routine> routines(const Symbols& symbols) const; // most inclusive cycles first
+
+    // One line per chain of calls with the cycles spent in its last routine, "Reset;RunGameObjs;GameObj0 1234",
+    // the input of flamegraph.pl and speedscope
+    void writeFolded(std::ostream& os, const Symbols& symbols) const;
+    void report(std::ostream& os, const Symbols& symbols, const uint64_t& framesRun, const std::size_t& top = 15) const;
+
+private:
+    struct Frame {
+        uint32_t node;
+        uint16_t sp; // the stack pointer after the return address was pushed
+    };
+
+    void enter(const uint16_t& entry, const uint16_t& sp, bool interrupt);
+    void leave(const uint16_t& sp); // pop the frames at or below the stack pointer
+    std::string name(const Node& node, const Symbols& symbols) const;
+
+    std::vector<Node> tree;
+    std::vector<Frame> frames;
+    uint32_t current = 0;
+    bool started = false;
+};
+
+#endif // CALLGRAPH_HPP
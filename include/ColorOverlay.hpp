@@ -0,0 +1,42 @@
+#ifndef COLOROVERLAY_HPP
+#define COLOROVERLAY_HPP
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <string>
+
+// The cabinet's monitor is black and white, colour comes from gel strips placed over the screen.
+// The overlay is stored as a palette index for every byte of video RAM (8 pixels of a row share a colour),
+// indexes are laid out exactly like VRAM so the framebuffer conversion can walk both together.
+class ColorOverlay {
+public:
+    static constexpr int rows = 224; // rows in VRAM, becomes the width once the screen is rotated
+    static constexpr int columns = 32; // bytes in a row, 256 pixels
+    static constexpr std::size_t size = rows * columns;
+    static constexpr std::size_t paletteSize = 8;
+
+    ColorOverlay(); // the original Midway layout
+    static ColorOverlay midway();
+    static ColorOverlay monochrome();
+    static ColorOverlay fromFile(const std::string& fname);
+
+    // colour in 0xAARRGGBB of the byte at the offset into VRAM
+    uint32_t colorAt(const std::size_t& vramOffset) const noexcept { return colors[vramOffset]; }
+    const uint32_t* data() const noexcept { return colors.data(); }
+
+    uint8_t indexAt(const std::size_t& vramOffset) const noexcept { return indices[vramOffset]; }
+    uint32_t paletteColor(const std::size_t& index) const noexcept { return palette[index]; }
+    // The colours follow every change, throw if the offset or index is out of range
+    void setIndex(const std::size_t& vramOffset, const uint8_t& index);
+    void setPaletteColor(const std::size_t& index, const uint32_t& color);
+
+private:
+    void resolve(); // expand indices into colors, needed after any change to the indices or palette
+
+    std::array<uint8_t, size> indices;
+    std::array<uint32_t, paletteSize> palette;
+    std::vector<uint32_t> colors;
+};
+
+#endif // COLOROVERLAY_HPP
@@ -0,0 +1,60 @@
+#ifndef CONTROLFLOWGRAPH_HPP
+#define CONTROLFLOWGRAPH_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+#include "Coverage.hpp"
+#include "Symbols.hpp"
+
+// The basic blocks of the code that ran and the transfers between them, recovered from coverage.
+// A block starts where execution was entered, where a branch went or after a branch, and ends at a branch
+// or before the next block. Edges are the transfers the branches made with how often they made them, the fall
+// through from a block into the next, and from a call to the instruction after it as often as it was returned to.
+// It is the input for predecoding, choosing superinstructions and recompiling the rom.
+class ControlFlowGraph {
+public:
+    enum Kind : uint8_t { Fallthrough, Jump, Call, Return, Restart, Indirect }; // Indirect is PCHL
+
+    struct Block {
+        uint16_t start;
+        uint16_t last; // the address of its last instruction
+        uint32_t end; // one past its last byte
+        uint32_t instructions;
+        uint64_t executions; // of its first instruction
+    };
+    struct Edge {
+        uint32_t from; // blocks
+        uint32_t to;
+        Kind kind;
+        uint64_t count;
+    };
+    struct Entry {
+        uint32_t block;
+        uint64_t count;
+    };
+    static const char* kindName(const Kind& kind) noexcept;
+    static constexpr uint32_t none = 0xFFFFFFFF;
+
+    explicit ControlFlowGraph(const Coverage& coverage); // which must outlive the graph
+
+    const std::vector<Block>& blocks() const noexcept { return blockList; } // by address
+    const std::vector<Edge>& edges() const noexcept { return edgeList; } // by block they leave
+    const std::vector<Entry>& entries() const noexcept { return entryList; } // where it started, the interrupt vectors
+    uint32_t find(const uint16_t& address) const noexcept; // the block holding an address, none if no code ran there
+
+    // Graphviz, blocks are labelled with their names and runs, edges with their counts
+    void writeDot(std::ostream& os, const Symbols& symbols) const;
+    // The blocks with their instructions, edges and entries, and the use of every byte of the range in runs
+    void writeJson(std::ostream& os, const Symbols& symbols, const uint16_t& start = 0x0000, const uint16_t& end = 0xFFFF) const;
+
+private:
+    const Coverage& coverage;
+    std::vector<Block> blockList;
+    std::vector<Edge> edgeList;
+    std::vector<Entry> entryList;
+};
+
+#endif // CONTROLFLOWGRAPH_HPP
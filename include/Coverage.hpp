@@ -0,0 +1,69 @@
+#ifndef COVERAGE_HPP
+#define COVERAGE_HPP
+
+#include <cstdint>
+#include <array>
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "State8080.hpp"
+#include "Symbols.hpp"
+
+// What every address was used for while a program ran: executed as an opcode, fetched as an operand, read or
+// written as data, and every transfer of control the branches made, how often, and where execution was entered.
+// The instruction bytes are kept with it, so a coverage file is enough to rebuild the program's control flow
+// (see ControlFlowGraph), and coverage of several runs of the same program can be merged into one.
+// On disk it is a small header, the use of every address, the instruction bytes, then the executed addresses,
+// entries and transfers with their counts.
+class Coverage {
+public:
+    enum Use : uint8_t { Opcode = 1, Operand = 2, Read = 4, Write = 8 }; // flags, an address can be several
+    static constexpr uint32_t version = 1;
+
+    Coverage();
+
+    static Coverage fromFile(const std::string& fname); // throws if the file is not coverage
+    void toFile(const std::string& fname) const;
+    void merge(const Coverage& other); // throws if the other saw different instructions at the same addresses
+    void clear();
+
+    // Called by the board before each instruction runs, and before an interrupt's restart runs.
+    // A branch is only known to be taken when the next instruction or interrupt comes
+    void sample(const State8080& state);
+    void interrupted(const State8080& state, const uint8_t& opcode);
+
+    uint8_t use(const uint16_t& address) const noexcept { return uses[address]; }
+    uint8_t code(const uint16_t& address) const noexcept { return bytes[address]; } // the instruction byte fetched there
+    uint64_t executions(const uint16_t& address) const noexcept { return counts[address]; }
+    const std::map<uint16_t, uint64_t>& entries() const noexcept { return entered; } // where it started and the interrupts went
+    // Every transfer a branch made, including the branches not taken, from << 16 | to
+    const std::unordered_map<uint32_t, uint64_t>& transfers() const noexcept { return edges; }
+
+    // Bytes of the range per use, the named routines that never ran and the largest ranges nothing touched
+    void report(std::ostream& os, const Symbols& symbols, const uint16_t& start = 0x0000, const uint16_t& end = 0xFFFF) const;
+
+private:
+    void read(const uint16_t& address) noexcept { uses[address] |= Read; }
+    void write(const uint16_t& address) noexcept { uses[address] |= Write; }
+    void retire(const uint16_t& nextPC, const uint16_t& nextSP); // the last instruction's stack use and branch
+
+    std::array<uint8_t, State8080::RAM> uses;
+    std::array<uint8_t, State8080::RAM> bytes;
+    std::vector<uint64_t> counts;
+    std::map<uint16_t, uint64_t> entered;
+    std::unordered_map<uint32_t, uint64_t> edges;
+
+    struct Pending {
+        uint16_t pc;
+        uint16_t sp;
+        uint8_t opcode;
+    };
+    Pending last {0, 0, 0};
+    bool pending = false; // last holds an instruction that has not been retired
+    bool started = false;
+};
+
+#endif // COVERAGE_HPP
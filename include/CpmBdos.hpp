@@ -0,0 +1,116 @@
+#ifndef CPMBDOS_HPP
+#define CPMBDOS_HPP
+
+#include <cstdint>
+#include <array>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "State8080.hpp"
+#include "Traps.hpp"
+#include "DiskImage.hpp"
+
+// CP/M 2.2's BDOS, run natively through traps so CP/M programs such as the cpu exercisers run at the
+// interpreter's full speed. A program calls 5 with the function in C and its parameter in E or DE, and ends
+// by jumping or returning to 0. Everything it prints is kept in a buffer rather than written a character at a
+// time, and what it reads comes from text given beforehand, then from the console stream if one is set.
+// The file functions work on the directories of the mounted disk images the way CP/M's do, so programs
+// find their files where other CP/M systems and cpmtools put them. Functions:
+//   0 system reset, 1 console input, 2 console output, 6 direct console I/O, 9 print string,
+//   10 read console buffer, 11 console status, 12 version, 13 reset disks, 14 select disk,
+//   15 open, 16 close, 17 search first, 18 search next, 19 delete, 20 read sequential, 21 write sequential,
+//   22 make, 23 rename, 24 login vector, 25 current disk, 26 set DMA, 27 allocation vector,
+//   28 write protect, 29 read only vector, 30 set attributes, 31 disk parameters, 32 user code,
+//   33 read random, 34 write random, 35 file size, 36 set random record, 40 write random with zero fill
+// the others return 0xFF.
+class CpmBdos {
+public:
+    static constexpr uint16_t bootAddress = 0x0000; // warm boot, where a program ends
+    static constexpr uint16_t entryAddress = 0x0005;
+    static constexpr uint16_t tpa = 0x0100; // where programs are loaded and started
+    static constexpr uint16_t top = 0xE406; // the BDOS's own entry, given by the jump at 5, programs end below it
+    static constexpr uint16_t biosAddress = 0xF200; // the BIOS's jump table, 0 jumps to its warm boot
+    static constexpr std::size_t maxDrives = 4;
+
+    explicit CpmBdos(Traps& traps); // traps boot and the entries, until it is destroyed
+    ~CpmBdos();
+    CpmBdos(const CpmBdos&) = delete;
+    CpmBdos& operator=(const CpmBdos&) = delete;
+
+    // Page zero's jumps, a stack below the BDOS holding a return to 0 and the program counter at the TPA
+    void prepare(State8080& state);
+    bool finished() const noexcept { return done; } // the program went back to CP/M
+    void boot(State8080& state); // end the program
+
+    // A disk for drive A to D, with the addresses of its parameter block and allocation vector in memory
+    void mount(const std::size_t& drive, DiskImage* disk, const uint16_t& dpb, const uint16_t& alv);
+    // Whole files on a mounted disk, by a name like "PIP.COM", false if it is not there or does not fit
+    bool readFile(const std::size_t& drive, const std::string& name, std::vector<uint8_t>& data);
+    bool writeFile(const std::size_t& drive, const std::string& name, const std::vector<uint8_t>& data);
+    // The drive, name and type of an FCB from text like "B:*.COM", false if it is not a CP/M name
+    static bool fcbName(const std::string& text, uint8_t* fcb);
+
+    // The console, the BIOS's character functions use it too. Output is written to the stream when
+    // the buffer fills, before input is waited for and when flushed
+    void setConsole(std::istream* in, std::ostream* out) noexcept { input = in; display = out; }
+    void type(const std::string& text) { typed += text; } // console input, read after what was typed before
+    void print(const char& c);
+    bool readChar(uint8_t& c); // the next character typed, false if there is none
+    bool charReady();
+    void flush();
+    const std::string& output() const noexcept { return printed; }
+    void clearOutput() noexcept { printed.clear(); }
+
+private:
+    struct Drive {
+        DiskImage* disk;
+        uint16_t dpb;
+        uint16_t alv;
+    };
+    using Fcb = uint8_t*; // 36 bytes: drive, name, type, extent, s1, s2, records, allocation, record, random record
+
+    void call(State8080& state);
+    static void result(State8080& state, const uint16_t& value) noexcept; // in HL, and A and B as CP/M returns them
+
+    // the file system, on an FCB and a 128 byte record buffer
+    Drive* driveOf(const Fcb& fcb) noexcept; // nullptr if it is not mounted
+    uint8_t* entry(const Drive& drive, const uint32_t& index) noexcept;
+    bool matches(const Drive& drive, const uint8_t* entry, const Fcb& fcb, bool anyExtent) const noexcept;
+    int32_t find(const Drive& drive, const Fcb& fcb, bool anyExtent, const uint32_t& from = 0) noexcept; // -1 if none
+    std::vector<bool> allocation(const Drive& drive) noexcept;
+    uint8_t open(const Fcb& fcb);
+    uint8_t close(const Fcb& fcb);
+    uint8_t make(const Fcb& fcb);
+    uint8_t remove(const Fcb& fcb);
+    uint8_t rename(const Fcb& fcb);
+    uint8_t setAttributes(const Fcb& fcb);
+    uint8_t search(uint8_t* dma);
+    uint8_t readSequential(const Fcb& fcb, uint8_t* dma);
+    uint8_t writeSequential(const Fcb& fcb, const uint8_t* dma);
+    uint8_t readRandom(const Fcb& fcb, uint8_t* dma);
+    uint8_t writeRandom(const Fcb& fcb, const uint8_t* dma);
+    uint8_t seek(const Fcb& fcb, bool create); // move to the extent of the random record
+    uint8_t* block(const Drive& drive, const Fcb& fcb, const uint8_t& record, bool allocate, bool& full);
+    void fileSize(const Fcb& fcb);
+    void writeAllocation(State8080& state, const Drive& drive);
+
+    Traps& traps;
+    std::array<Drive, maxDrives> drives {};
+    uint8_t currentDrive = 0;
+    uint8_t user = 0;
+    uint16_t dma = 0x80;
+    std::array<uint8_t, 36> pattern {}; // of the last search
+    uint32_t searchNext = 0;
+    bool searchAll = false;
+
+    std::istream* input = nullptr;
+    std::ostream* display = nullptr;
+    std::string printed;
+    std::string typed;
+    std::size_t read = 0; // characters of typed that were read
+    bool done = false;
+};
+
+#endif // CPMBDOS_HPP
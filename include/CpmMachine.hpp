@@ -0,0 +1,62 @@
+#ifndef CPMMACHINE_HPP
+#define CPMMACHINE_HPP
+
+#include <cstdint>
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "State8080.hpp"
+#include "Disassembler8080.hpp"
+#include "Traps.hpp"
+#include "CpmBdos.hpp"
+#include "DiskImage.hpp"
+
+// A CP/M 2.2 machine without a screen: 64 KiB of memory, the native BDOS and a BIOS whose jump table is trapped
+// too, and up to four disk images. There is no CCP, a program is loaded with its command line and run until it
+// goes back to CP/M or a limit is reached. The BIOS's disk functions copy whole sectors between the mapped image
+// and memory, the DPH, DPB, translation table and allocation vector of every drive are in memory above the BIOS
+// as programs that read them expect.
+class CpmMachine {
+public:
+    static constexpr uint16_t biosAddress = CpmBdos::biosAddress;
+    static constexpr int biosFunctions = 17; // BOOT to SECTRAN
+
+    struct Result {
+        uint64_t instructions = 0;
+        uint64_t cycles = 0;
+        double seconds = 0.0;
+        bool finished = false; // the program went back to CP/M, rather than reaching a limit or halting
+    };
+
+    CpmMachine();
+    CpmMachine(const CpmMachine&) = delete;
+    CpmMachine& operator=(const CpmMachine&) = delete;
+
+    void mount(const std::size_t& drive, const std::string& fname); // throws if it is not a disk image
+    DiskImage& disk(const std::size_t& drive); // throws if nothing is mounted there
+    // The program at the TPA with the command tail at 0x80 and the first two arguments parsed into the FCBs at
+    // 0x5C and 0x6C, throws if it does not fit below the BDOS
+    void load(const std::vector<uint8_t>& program, const std::vector<std::string>& arguments = {});
+    // Runs until the program ends or halts, or the limits are reached, 0 is no limit
+    Result run(const uint64_t& maxInstructions = 0, const uint64_t& maxCycles = 0);
+
+    State8080 state;
+    Disassembler8080 cpu;
+    Traps traps;
+    CpmBdos bdos;
+
+private:
+    void bios(State8080& state, const int& function);
+    void writeTables(); // the jump table and every drive's parameters
+    static uint16_t tablesOf(const std::size_t& drive) noexcept; // the DPH, the DPB, the skew and the ALV follow
+
+    std::array<std::unique_ptr<DiskImage>, CpmBdos::maxDrives> disks;
+    uint8_t selected = 0;
+    uint16_t track = 0;
+    uint16_t sector = 0;
+    uint16_t dma = 0x80;
+};
+
+#endif // CPMMACHINE_HPP
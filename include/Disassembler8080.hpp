@@ -4,6 +4,8 @@
 #include <array>
 
 #include "State8080.hpp"
+#include "OpcodeStats.hpp"
+#include "Traps.hpp"
 
 class Disassembler8080 {
 public:
@@ -16,6 +18,10 @@ public:
 
     bool wasUnimplemented = false;
     bool wasTodo = false;
+#ifdef OPCODE_STATS
+    OpcodeStats stats; // what has been executed
+#endif
+    Traps* traps = nullptr; // routines run natively when a branch lands on them, when set
 
     void generateInterrupt(State8080& state, const uint8_t& interruptNum);
 
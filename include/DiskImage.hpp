@@ -0,0 +1,59 @@
+#ifndef DISKIMAGE_HPP
+#define DISKIMAGE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <string>
+
+// The geometry of a CP/M disk, as cpmtools' diskdefs describe them. Sectors are 128 bytes.
+struct DiskFormat {
+    const char* name;
+    uint16_t sectorsPerTrack;
+    uint16_t tracks;
+    uint16_t reservedTracks; // the system tracks before the directory
+    uint16_t blockSize; // bytes per allocation block
+    uint16_t directoryEntries;
+    uint8_t firstSector; // the number of a track's first physical sector
+    const uint8_t* skew; // the physical sector of every logical one, nullptr if they are in order
+
+    std::size_t size() const noexcept { return static_cast<std::size_t>(tracks) * sectorsPerTrack * 128; }
+    uint16_t blocks() const noexcept { // of the data area, DSM + 1
+        return static_cast<uint16_t>(static_cast<std::size_t>(tracks - reservedTracks) * sectorsPerTrack * 128 / blockSize);
+    }
+};
+
+// 8" single sided single density (ibm-3740) and a 4 MB hard disk (z80pack's hdb), told apart by their size
+extern const std::array<DiskFormat, 2> diskFormats;
+
+// A disk image mapped read and write where the platform allows it, so a sector is read or written by copying
+// straight between the file's pages and the emulated memory, and the file is updated as the program writes.
+// Elsewhere the image is read whole and written back when it is flushed or closed.
+class DiskImage {
+public:
+    static constexpr std::size_t sectorSize = 128;
+
+    explicit DiskImage(const std::string& fname); // throws if the file is missing or not the size of a format
+    ~DiskImage();
+    DiskImage(const DiskImage&) = delete;
+    DiskImage& operator=(const DiskImage&) = delete;
+
+    static void create(const std::string& fname, const DiskFormat& format); // an empty formatted disk
+    static const DiskFormat* formatOf(const std::size_t& size) noexcept; // nullptr if no format is that size
+
+    const DiskFormat& format() const noexcept { return *geometry; }
+    // A sector as the BIOS numbers them, nullptr if it is off the disk
+    uint8_t* sector(const uint16_t& track, const uint16_t& sector) noexcept;
+    // A record of the data area after the reserved tracks, counted in logical sectors through the skew
+    uint8_t* record(const uint32_t& index) noexcept;
+    void flush();
+
+private:
+    std::string fname;
+    const DiskFormat* geometry = nullptr;
+    uint8_t* bytes = nullptr;
+    std::size_t length = 0;
+    bool mapped = false;
+};
+
+#endif // DISKIMAGE_HPP
@@ -0,0 +1,23 @@
+#ifndef FRAMEBUFFER_HPP
+#define FRAMEBUFFER_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "State8080.hpp"
+#include "ColorOverlay.hpp"
+
+// Converts video RAM into 32 bit pixels (0xAARRGGBB) with the colour overlay applied.
+// The pixels are kept in VRAM order, 224 rows of 256 pixels, the screen is rotated when it is displayed.
+struct FrameBuffer {
+    static constexpr int width = 256;
+    static constexpr int height = 224;
+    static constexpr uint16_t vramStart = 0x2400;
+
+    FrameBuffer();
+    void convert(const State8080&, const ColorOverlay&) noexcept;
+
+    std::vector<uint32_t> pixels;
+};
+
+#endif // FRAMEBUFFER_HPP
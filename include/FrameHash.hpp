@@ -0,0 +1,23 @@
+#ifndef FRAMEHASH_HPP
+#define FRAMEHASH_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "State8080.hpp"
+
+// XXH64 by Yann Collet, a fast non-cryptographic hash, the same values as the reference implementation
+extern uint64_t xxhash64(const uint8_t* data, std::size_t size, uint64_t seed = 0) noexcept;
+
+// Everything a frame of the game can change is in work RAM and video RAM, 0x2000 - 0x3FFF
+static constexpr uint16_t frameHashStart = 0x2000;
+static constexpr std::size_t frameHashSize = 0x2000;
+extern uint64_t frameHash(const State8080& state) noexcept;
+
+// Hashes of consecutive frames as text, a hex hash per line, lines starting with # are comments
+extern std::vector<uint64_t> frameHashesFromFile(const std::string& fname);
+extern void frameHashesToFile(const std::string& fname, const std::vector<uint64_t>& hashes, const std::string& comment = "");
+
+#endif // FRAMEHASH_HPP
@@ -0,0 +1,55 @@
+#ifndef INPUTLATCH_HPP
+#define INPUTLATCH_HPP
+
+#include <cstdint>
+#include <array>
+#include <chrono>
+#include <ostream>
+
+#include "State8080.hpp"
+
+// Holds the buttons of input ports 1 and 2 as bitmasks, updated only when a button changes.
+// The bitmasks are copied into the state's ports when latched, the cpu never looks at the buttons themselves.
+class InputLatch {
+public:
+    enum Button : uint8_t {
+        Coin, P1Start, P1Shoot, P1Left, P1Right,
+        P2Start, P2Shoot, P2Left, P2Right,
+        ButtonCount
+    };
+
+    void set(const Button& button, bool pressed) noexcept;
+    void latch(State8080& state) noexcept; // copy the buttons into port 1 and 2
+    void restore(const uint8_t& port1, const uint8_t& port2) noexcept; // replace every button, e.g. from a snapshot
+
+    uint8_t port1() const noexcept { return buttons1; }
+    uint8_t port2() const noexcept { return buttons2; }
+
+    // Time from a button changing to it reaching the ports
+    uint64_t latencySamples() const noexcept { return samples; }
+    double meanLatencyMs() const noexcept;
+    double maxLatencyMs() const noexcept;
+    void reportLatency(std::ostream&) const;
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct PortBit {
+        uint8_t port; // 1 or 2
+        uint8_t mask;
+    };
+    static const std::array<PortBit, ButtonCount> portBits;
+    static constexpr uint8_t port1Mask = 0x77; // bits of port 1 that are owned by buttons
+    static constexpr uint8_t port2Mask = 0x70;
+
+    uint8_t buttons1 = 0;
+    uint8_t buttons2 = 0;
+
+    bool pending = false; // a button changed since the last latch
+    clock::time_point changedAt;
+    uint64_t samples = 0;
+    clock::duration totalLatency = clock::duration::zero();
+    clock::duration maxLatency = clock::duration::zero();
+};
+
+#endif // INPUTLATCH_HPP
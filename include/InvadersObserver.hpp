@@ -0,0 +1,126 @@
+#ifndef INVADERSOBSERVER_HPP
+#define INVADERSOBSERVER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <chrono>
+#include <ostream>
+#include <vector>
+
+#include "State8080.hpp"
+#include "SpaceInvaders.hpp"
+
+// The state of a game of Space Invaders read where the game keeps it in work RAM, the addresses are from the
+// disassembly at computerarcheology.com and were checked against the running rom. A view is a pointer to the
+// machine's memory, nothing is copied, the fields are only consistent between frames, after runFrame returns.
+// Positions are in the game's own coordinates, x from the left of the screen and y up from its bottom.
+class InvadersView {
+public:
+    static constexpr uint16_t playerAliveAddress = 0x2015; // 0xFF while alive, counts down while blowing up
+    static constexpr uint16_t playerXAddress = 0x201B;
+    static constexpr uint16_t playerShotAddress = 0x2025; // status, 0 while ready to fire, then y and x at +4 and +5
+    static constexpr uint16_t rollingShotAddress = 0x2035; // status, bit 7 while falling, then y and x at +8 and +9
+    static constexpr uint16_t plungerShotAddress = 0x2045;
+    static constexpr uint16_t squigglyShotAddress = 0x2055;
+    static constexpr uint16_t fleetYAddress = 0x2009; // of the bottom left invader, x follows
+    static constexpr uint16_t playerPageAddress = 0x2067; // 0x21 or 0x22, the page of the player up
+    static constexpr uint16_t aliensLeftAddress = 0x2082;
+    static constexpr uint16_t creditsAddress = 0x20EB; // bcd
+    static constexpr uint16_t gameModeAddress = 0x20EF; // 1 in a game, 0 in the attract mode
+    static constexpr uint16_t hiScoreAddress = 0x20F4; // bcd, low byte first, each followed by where it is drawn
+    static constexpr uint16_t player1ScoreAddress = 0x20F8;
+    static constexpr uint16_t player2ScoreAddress = 0x20FC;
+    static constexpr uint16_t shipsOffset = 0xFF; // in the player's page, ships in reserve
+    static constexpr std::size_t alienRows = 5; // from the bottom, at the start of the player's page
+    static constexpr std::size_t alienColumns = 11;
+
+    struct Shot {
+        bool active;
+        uint8_t x;
+        uint8_t y;
+    };
+
+    explicit InvadersView(const State8080& state) noexcept : memory(state.memory.data()) {}
+
+    bool playing() const noexcept { return memory[gameModeAddress] != 0; }
+    uint8_t player() const noexcept { return memory[playerPageAddress] == 0x22 ? 2 : 1; } // up
+    uint32_t score(const uint8_t& player) const noexcept { return bcd(player == 2 ? player2ScoreAddress : player1ScoreAddress); }
+    uint32_t score() const noexcept { return score(player()); }
+    uint32_t hiScore() const noexcept { return bcd(hiScoreAddress); }
+    uint8_t credits() const noexcept;
+    uint8_t ships() const noexcept { return playerPage()[shipsOffset]; }
+
+    bool playerAlive() const noexcept { return memory[playerAliveAddress] == 0xFF; }
+    uint8_t playerX() const noexcept { return memory[playerXAddress]; }
+    Shot playerShot() const noexcept { return shot(playerShotAddress, memory[playerShotAddress] != 0); }
+    std::array<Shot, 3> alienShots() const noexcept; // rolling, plunger and squiggly
+
+    uint8_t aliensLeft() const noexcept { return memory[aliensLeftAddress]; }
+    // 1 while the invader is alive, alienColumns a row from the bottom row, left to right, straight from memory
+    const uint8_t* aliens() const noexcept { return playerPage(); }
+    bool alien(const std::size_t& row, const std::size_t& column) const noexcept { return aliens()[row * alienColumns + column] != 0; }
+    uint8_t fleetX() const noexcept { return memory[fleetYAddress + 1]; }
+    uint8_t fleetY() const noexcept { return memory[fleetYAddress]; }
+
+    static void writeCsvHeader(std::ostream& os);
+    void writeCsv(std::ostream& os, const uint64_t& frame) const; // a line, the frame and every field above
+
+private:
+    const uint8_t* playerPage() const noexcept { return memory + (memory[playerPageAddress] == 0x22 ? 0x2200 : 0x2100); }
+    uint32_t bcd(const uint16_t& address) const noexcept;
+    Shot shot(const uint16_t& status, const bool& active) const noexcept {
+        const uint16_t coordinates = status == playerShotAddress ? status + 4 : status + 8;
+        return {active, memory[coordinates + 1], memory[coordinates]};
+    }
+
+    const uint8_t* memory;
+};
+
+// What an agent gets at the end of every frame: the view of the game's variables and, when asked for, the screen
+// shrunk from video RAM. The screen is kept in VRAM order like FrameBuffer, lines of pixels up from the bottom of
+// the screen, the leftmost line first. A crop takes lines [y, y + height) and pixels [x, x + width) of them, then
+// every factor by factor square becomes a byte, 1 when any of its pixels is lit. The squares are made on the packed
+// bits, 8 pixels at a time: factor lines are or-ed together in loops the compiler vectorizes, then the bits of each
+// byte and a multiply spreads its squares to a byte each, so video RAM is read once and never copied whole.
+class InvadersObserver {
+public:
+    struct Screen {
+        int x = 0; // a multiple of 8
+        int y = 0;
+        int width = 0; // 0 for no screen, else a multiple of 8 and of the factor
+        int height = 0; // a multiple of the factor
+        int factor = 1; // 1, 2, 4 or 8
+    };
+    static constexpr int vramWidth = 256;
+    static constexpr int vramHeight = 224;
+    static constexpr uint16_t vramStart = 0x2400;
+    static Screen fullScreen(const int& factor = 1) { return {0, 0, vramWidth, vramHeight, factor}; }
+
+    struct Observation {
+        uint64_t frame;
+        InvadersView game;
+        const uint8_t* screen; // screenWidth() * screenHeight() bytes of 0 or 1, nullptr when there is no screen
+    };
+
+    InvadersObserver(); // the game without the screen
+    explicit InvadersObserver(const Screen& screen); // throws if the crop does not fit the rules above
+
+    // Call at a frame boundary, after runFrame. The screen is overwritten by the next call
+    Observation observe(const SpaceInvaders& machine);
+
+    int screenWidth() const noexcept { return crop.width / crop.factor; }
+    int screenHeight() const noexcept { return crop.height / crop.factor; }
+    double meanObserveUs() const noexcept;
+
+private:
+    template <int factor>
+    void shrink(const uint8_t* vram) noexcept;
+
+    Screen crop;
+    std::vector<uint8_t> pixels;
+    uint64_t observations = 0;
+    std::chrono::steady_clock::duration observeTime = std::chrono::steady_clock::duration::zero();
+};
+
+#endif // INVADERSOBSERVER_HPP
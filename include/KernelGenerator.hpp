@@ -0,0 +1,24 @@
+#ifndef KERNELGENERATOR_HPP
+#define KERNELGENERATOR_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Synthetic instruction mixes for the benchmarks, written as 8080 source for Assembly. A kernel starts at 0x100,
+// sets up its registers and then loops forever over a body of random instructions of one kind:
+//   alu      register and immediate arithmetic, logic, rotates and moves, no memory but the code
+//   memory   loads and stores through HL, DE and direct addresses into 0x2000 - 0x37FF
+//   branch   flags tested by taken and not taken conditional jumps, short counted loops
+//   stack    balanced pushes and pops, XTHL, calls and conditional calls of subroutines after the loop
+// The stack is below 0x4000, every pass of the loop leaves SP where it was and the memory kernel sets its pointers
+// again, so a kernel runs for any number of instructions. The same mix, length and seed give the same source on
+// every platform.
+class KernelGenerator {
+public:
+    static const std::vector<std::string>& mixes();
+    // length is the number of instructions of the loop's body, 1 to 1024, throws if the mix is not one of mixes()
+    static std::string source(const std::string& mix, const unsigned& length = 64, const uint32_t& seed = 1);
+};
+
+#endif // KERNELGENERATOR_HPP
@@ -0,0 +1,40 @@
+#ifndef MACHINEPOOL_HPP
+#define MACHINEPOOL_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "SpaceInvaders.hpp"
+#include "Snapshot.hpp"
+
+// Machines ready to run episodes from one baseline snapshot. A machine is made once from the snapshot, after that
+// its dirty pages are what it wrote since it was at the baseline, so releasing it copies back only those pages,
+// usually the 8 KiB of RAM or less, instead of clearing 64 KiB and loading the roms again.
+// The dirty pages of a machine belong to the pool while it is out, a RewindBuffer must not capture it.
+// A pool is used by one thread, threads running episodes each have their own.
+class MachinePool {
+public:
+    explicit MachinePool(const Snapshot& baseline, std::size_t ready = 0); // makes ready machines up front
+
+    SpaceInvaders* acquire(); // a machine at the baseline, a new one if none is ready
+    void release(SpaceInvaders* machine); // resets it and clears its hooks, throws if it is not from this pool
+
+    const Snapshot& baseline() const noexcept { return start; }
+    std::size_t size() const noexcept { return machines.size(); } // machines made
+    std::size_t available() const noexcept { return ready.size(); }
+    uint64_t resets() const noexcept { return resetCount; }
+    double meanPagesRestored() const noexcept;
+
+private:
+    SpaceInvaders* make();
+
+    Snapshot start;
+    std::vector<std::unique_ptr<SpaceInvaders>> machines;
+    std::vector<SpaceInvaders*> ready;
+    uint64_t resetCount = 0;
+    uint64_t pagesRestored = 0;
+};
+
+#endif // MACHINEPOOL_HPP
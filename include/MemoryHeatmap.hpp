@@ -0,0 +1,64 @@
+#ifndef MEMORYHEATMAP_HPP
+#define MEMORYHEATMAP_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// How often each part of the 64 KiB is fetched, read, written and used as the stack, counted by State8080's
+// memory functions when built with MEMORY_STATS (qmake CONFIG+=memorystats) and a heatmap is set on the state.
+// Totals are kept per 256 byte page or per byte, and the page counts of every frame are kept for export.
+class MemoryHeatmap {
+public:
+    enum Access { Fetch, Read, Write, Stack }; // instruction bytes, data, data, pushes pops calls and returns
+    static constexpr std::size_t accessKinds = 4;
+    enum Granularity { Page, Byte };
+    static constexpr std::size_t pageSize = 0x100;
+    static constexpr std::size_t pageCount = 0x10000 / pageSize;
+
+    struct Region {
+        const char* name;
+        uint16_t start;
+        uint16_t end; // the last address in it
+    };
+    static const std::array<Region, 4> invadersRegions; // rom, work RAM, video RAM and the mirror above
+
+    explicit MemoryHeatmap(const Granularity& granularity = Page);
+
+    void count(const Access& access, const uint16_t& address) noexcept {
+        ++totals[access][address >> shift];
+    }
+    void count(const Access& access, const uint16_t& address, const uint8_t& size) noexcept {
+        for (uint8_t i = 0; i != size; i++) {
+            ++totals[access][static_cast<uint16_t>(address + i) >> shift];
+        }
+    }
+    void endFrame(); // keep the page counts since the last frame
+    void clear();
+
+    Granularity granularity() const noexcept { return shift == 0 ? Byte : Page; }
+    uint64_t total(const Access& access) const noexcept;
+    uint64_t total(const Access& access, const uint16_t& start, const uint16_t& end) const noexcept; // of an address range
+    std::size_t frames() const noexcept { return frameCounts.size() / (accessKinds * pageCount); }
+    uint32_t frameCount(const std::size_t& frame, const Access& access, const std::size_t& page) const noexcept {
+        return frameCounts[(frame * accessKinds + access) * pageCount + page];
+    }
+
+    // Traffic per region, and how many pages frames write at coarser dirty tracking granularities
+    void report(std::ostream& os) const;
+    void writeFramesCsv(std::ostream& os) const; // frame,page,fetch,read,write,stack for every page used in a frame
+    void writeCsv(std::ostream& os) const; // the totals per page or per byte
+    // A binary PPM a page wide a pixel, a frame high, red writes, green reads, blue fetches, stack adds to red and green
+    void writeFramesImage(const std::string& fname) const;
+
+private:
+    std::array<std::vector<uint64_t>, accessKinds> totals;
+    unsigned shift;
+    std::vector<uint64_t> lastFrame; // page totals at the end of the last frame
+    std::vector<uint32_t> frameCounts; // frames of access kinds of pages
+};
+
+#endif // MEMORYHEATMAP_HPP
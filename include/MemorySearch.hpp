@@ -0,0 +1,63 @@
+#ifndef MEMORYSEARCH_HPP
+#define MEMORYSEARCH_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "State8080.hpp"
+#include "Symbols.hpp"
+
+// Finds where a program keeps a variable, the score, the lives or a random number, by narrowing down the bytes of
+// a range of memory across frames. Every address starts as a candidate, each filter keeps those whose value passes
+// a test, against a number or against its value at the filter before. The candidates are a bit per address and the
+// tests run over the whole range in branch free loops that the compiler vectorizes, a filter of the 8 KiB of work
+// and video RAM takes a few microseconds so it can run every frame.
+class MemorySearch {
+public:
+    enum class Test : uint8_t {
+        Equal, NotEqual, Less, Greater, InRange, // against a and b
+        Changed, Unchanged, Increased, Decreased, IncreasedBy, DecreasedBy // against the value before
+    };
+    struct Step {
+        uint64_t frame;
+        std::string command;
+    };
+
+    // The range must be a whole number of 64 bytes and end in memory
+    explicit MemorySearch(const uint16_t& first = 0x2000, const std::size_t& size = 0x2000);
+
+    void reset(const State8080& state); // every address is a candidate, with its value now
+    // Keeps the candidates that pass and remembers the values, returns how many are left. Throws before a reset
+    std::size_t filter(const State8080& state, const Test& test, const uint8_t& a = 0, const uint8_t& b = 0);
+    // The same as text, "reset", "eq 3", "ne 0", "lt 10", "gt 0x80", "range 1 3", "changed", "unchanged",
+    // "inc", "dec", "inc-by 10" or "dec-by 1", numbers in decimal or 0x hex. Throws if it is not one of them
+    std::size_t run(const std::string& command, const State8080& state);
+
+    std::size_t count() const noexcept;
+    bool candidate(const uint16_t& address) const noexcept;
+    std::vector<uint16_t> candidates() const;
+    double meanFilterUs() const noexcept;
+    // The candidates with their values, at most limit of them
+    void report(std::ostream& os, const State8080& state, const Symbols& symbols, const std::size_t& limit = 32) const;
+
+    // A search run along a movie or a game, a frame and a command per line, lines starting with # are comments:
+    //   60 changed
+    static std::vector<Step> scriptFromFile(const std::string& fname);
+
+private:
+    template <typename Keep>
+    void apply(const uint8_t* now, Keep keep) noexcept;
+
+    uint16_t first;
+    std::size_t size;
+    std::vector<uint64_t> bits; // a bit per address, set while it is a candidate
+    std::vector<uint8_t> last; // the values at the last reset or filter
+    uint64_t filters = 0;
+    std::chrono::steady_clock::duration filterTime = std::chrono::steady_clock::duration::zero();
+};
+
+#endif // MEMORYSEARCH_HPP
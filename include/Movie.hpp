@@ -0,0 +1,51 @@
+#ifndef MOVIE_HPP
+#define MOVIE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "State8080.hpp"
+#include "InputLatch.hpp"
+
+class SpaceInvaders;
+
+// The buttons of every frame of a run, recorded as they are latched at vblank.
+// Latching happens at a fixed cycle of the frame, so playing the buttons back into the same starting
+// machine gives exactly the same run, however fast it is run.
+// On disk a movie is a small header followed by runs of frames with the same buttons.
+class Movie {
+public:
+    enum Mode { Recording, Playing };
+    static constexpr uint32_t version = 1;
+
+    struct Input {
+        uint8_t port1;
+        uint8_t port2;
+    };
+
+    // Start recording the machine from its current frame
+    static Movie record(const SpaceInvaders& machine);
+    static Movie fromFile(const std::string& fname); // ready to play, throws if the file is not a movie
+    void toFile(const std::string& fname) const;
+
+    // Called by the board when it latches the buttons of the frame,
+    // a recording keeps them, playing replaces them with the recorded ones
+    void latch(const uint64_t& frame, InputLatch& input);
+
+    bool matches(const SpaceInvaders& machine) const; // was recorded with the same rom
+    Mode mode() const noexcept { return current; }
+    uint64_t startFrame() const noexcept { return start; }
+    uint64_t endFrame() const noexcept { return start + inputs.size(); }
+    const std::vector<Input>& frames() const noexcept { return inputs; }
+
+private:
+    static uint32_t romChecksum(const State8080& state) noexcept;
+
+    Mode current = Recording;
+    uint32_t romCrc = 0; // of 0x0000 - 0x1FFF when recording began
+    uint64_t start = 0;
+    std::vector<Input> inputs; // one per frame from the start
+};
+
+#endif // MOVIE_HPP
@@ -0,0 +1,27 @@
+#ifndef OPCODEINFO_HPP
+#define OPCODEINFO_HPP
+
+#include <cstdint>
+#include <array>
+#include <string>
+
+#include "State8080.hpp"
+
+// What every opcode is, for reports and disassembly rather than for executing it.
+// Undocumented opcodes that behave like another are marked with a *, e.g. 0x08 is *NOP.
+struct OpcodeInfo {
+    enum Branch : uint8_t { None, Jump, Call, Return, Restart };
+
+    const char* mnemonic; // D8 and D16 are immediate data, adr an address
+    uint8_t size; // bytes including the opcode
+    Branch branch;
+    bool conditional; // the branch depends on a flag
+};
+
+extern const std::array<OpcodeInfo, 256> opcodeInfo;
+
+// An instruction with its operands filled in, e.g. "JNZ 0x1A32" or "MVI B,0x10"
+extern std::string disassemble(const uint8_t& opcode, const uint8_t& low, const uint8_t& high);
+extern std::string disassemble(const State8080& state, const uint16_t& address); // the instruction at an address
+
+#endif // OPCODEINFO_HPP
@@ -0,0 +1,37 @@
+#ifndef OPCODESTATS_HPP
+#define OPCODESTATS_HPP
+
+#include <cstdint>
+#include <array>
+#include <ostream>
+
+// How often each opcode ran and the cycles it took, kept by the cpu when built with OPCODE_STATS
+// (qmake CONFIG+=opcodestats). Without it the cpu has no counters and does no counting.
+class OpcodeStats {
+public:
+    struct Counter {
+        uint64_t executed;
+        uint64_t cycles;
+        uint64_t taken; // conditional jumps, calls and returns that went to their target
+    };
+
+    void record(const uint8_t& opcode, const uint64_t& cycles, bool taken) noexcept {
+        Counter& counter = counters[opcode];
+        ++counter.executed;
+        counter.cycles += cycles;
+        counter.taken += taken;
+    }
+    void clear() noexcept;
+
+    const Counter& operator[](const uint8_t& opcode) const noexcept { return counters[opcode]; }
+    uint64_t executed() const noexcept;
+    uint64_t cycles() const noexcept;
+
+    void report(std::ostream&) const; // opcodes that ran, the most cycles first
+    void writeCsv(std::ostream&) const; // every opcode in order
+
+private:
+    std::array<Counter, 256> counters {};
+};
+
+#endif // OPCODESTATS_HPP
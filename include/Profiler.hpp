@@ -0,0 +1,66 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "State8080.hpp"
+#include "Symbols.hpp"
+
+// Where the program spends its time, as a histogram of the program counter over all 64K addresses.
+// Either every instruction is counted, which is what an interpreter spends its time on, or the
+// instruction running every period emulated cycles is sampled, which is what the 8080 spent its time on.
+// The histogram is grouped into subroutines, found from the targets of the calls that ran and the symbols
+// given, and into basic blocks, runs of instructions only entered at the top.
+class Profiler {
+public:
+    explicit Profiler(const uint64_t& period = 0); // 0 counts every instruction
+
+    // Called by the board before each instruction
+    void sample(const State8080& state) noexcept {
+        if (period == 0) {
+            ++counts[state.programCounter];
+        }
+        else if (state.cycleCount >= nextSample) {
+            ++counts[state.programCounter];
+            nextSample = (state.cycleCount / period + 1) * period;
+        }
+    }
+    void clear() noexcept;
+
+    uint64_t samplePeriod() const noexcept { return period; }
+    uint64_t samples() const noexcept;
+    const std::vector<uint64_t>& histogram() const noexcept { return counts; }
+
+    struct Routine {
+        uint16_t entry;
+        std::string name;
+        uint64_t samples;
+    };
+    struct Block {
+        uint16_t start;
+        uint16_t end; // one past its last instruction
+        uint64_t samples;
+        uint64_t entered; // samples of its first instruction
+    };
+    // The memory is the program that was profiled, read to decode the instructions that ran
+    std::vector<Routine> routines(const State8080& state, const Symbols& symbols) const; // most samples first
+    std::vector<Block> blocks(const State8080& state, const Symbols& symbols) const; // most samples first
+
+    // The top routines and blocks, then the instructions of the top routines with their share of the samples
+    void report(std::ostream& os, const State8080& state, const Symbols& symbols, const std::size_t& top = 10) const;
+
+private:
+    std::set<uint16_t> entries(const State8080& state, const Symbols& symbols) const;
+    std::set<uint16_t> leaders(const State8080& state, const Symbols& symbols) const;
+
+    std::vector<uint64_t> counts;
+    uint64_t period;
+    uint64_t nextSample;
+};
+
+#endif // PROFILER_HPP
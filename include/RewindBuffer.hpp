@@ -0,0 +1,63 @@
+#ifndef REWINDBUFFER_HPP
+#define REWINDBUFFER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <bitset>
+#include <chrono>
+#include <deque>
+#include <ostream>
+#include <vector>
+
+#include "State8080.hpp"
+#include "SpaceInvaders.hpp"
+#include "Snapshot.hpp"
+
+// Keeps the last frames of a machine so it can be stepped back one frame at a time.
+// A frame holds the registers and only the memory pages written since the frame before it,
+// every keyframeInterval frames all of memory is kept so going back never replays many frames.
+// When the buffer is full the oldest frame is folded into the next, which then becomes a keyframe.
+class RewindBuffer {
+public:
+    explicit RewindBuffer(std::size_t capacity = 600, std::size_t keyframeInterval = 60);
+
+    void capture(SpaceInvaders& machine); // keep the machine's current frame, clears its dirty pages
+    bool stepBack(SpaceInvaders& machine); // drop the newest frame and restore the one before it, false if there is none
+    void clear() noexcept;
+
+    std::size_t size() const noexcept { return frames.size(); }
+    std::size_t capacity() const noexcept { return maxFrames; }
+
+    // Cost of the history
+    std::size_t memoryUsed() const noexcept; // bytes held by the frames
+    double bytesPerSecond() const noexcept; // memory for a second of history at 60 frames a second
+    double meanCaptureUs() const noexcept;
+    double maxCaptureUs() const noexcept;
+    void report(std::ostream&) const;
+
+private:
+    using clock = std::chrono::steady_clock;
+    using PageSet = std::bitset<State8080::pageCount>;
+
+    struct Frame {
+        SnapshotHeader registers;
+        bool keyframe;
+        PageSet pages; // pages held in data, in order of address
+        std::vector<uint8_t> data;
+    };
+
+    static void applyPages(const Frame& frame, State8080& state) noexcept;
+    void foldOldest();
+
+    std::size_t maxFrames;
+    std::size_t keyframeInterval;
+    std::size_t sinceKeyframe = 0;
+    std::deque<Frame> frames;
+    std::vector<uint8_t> spare; // storage of a dropped frame, reused by the next capture
+
+    uint64_t captures = 0;
+    clock::duration totalCapture = clock::duration::zero();
+    clock::duration maxCapture = clock::duration::zero();
+};
+
+#endif // REWINDBUFFER_HPP
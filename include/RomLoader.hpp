@@ -0,0 +1,42 @@
+#ifndef ROMLOADER_HPP
+#define ROMLOADER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+#include "State8080.hpp"
+
+// A rom that is known to work with the emulator, identified by its size and checksum
+struct RomInfo {
+    const char* name;
+    std::size_t size;
+    uint32_t crc32;
+};
+
+extern uint32_t crc32(const uint8_t* data, std::size_t size, uint32_t crc = 0) noexcept;
+extern const RomInfo* identifyRom(const uint8_t* data, std::size_t size) noexcept; // nullptr if unknown
+
+// A read only view of a whole file, mapped into memory where the platform allows it
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& fname);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const noexcept { return bytes; }
+    std::size_t size() const noexcept { return length; }
+
+private:
+    const uint8_t* bytes = nullptr;
+    std::size_t length = 0;
+    bool mapped = false;
+};
+
+// Copies the rom into memory at the offset in one operation, throws if it does not fit or is empty.
+// Returns the known rom it matched or nullptr if it is not in the table.
+extern const RomInfo* loadRom(State8080& state, const uint8_t* data, std::size_t size, const uint16_t& offset);
+extern const RomInfo* loadRomFile(State8080& state, const std::string& fname, const uint16_t& offset);
+
+#endif // ROMLOADER_HPP
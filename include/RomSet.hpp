@@ -0,0 +1,40 @@
+#ifndef ROMSET_HPP
+#define ROMSET_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "State8080.hpp"
+
+// A single rom chip of a set, loaded at its address and verified by its checksum
+struct RomChip {
+    std::string file; // relative to the descriptor
+    uint16_t address;
+    std::size_t size;
+    uint32_t crc32;
+};
+
+// A rom set is the chips a machine's program is split over, described by a text file.
+// The assembled image is cached on disk under a key made from the chips' layout and checksums,
+// so a set that has been verified once is loaded with a single mapped copy, checked against the chips' checksums.
+class RomSet {
+public:
+    static RomSet fromFile(const std::string& descriptor);
+    static std::string defaultCacheDirectory(); // $EMU8080_CACHE, otherwise ~/.cache/8080
+
+    std::string cacheKey() const; // hex string identifying the assembled image
+    uint16_t base() const noexcept; // lowest address of the chips
+    std::size_t imageSize() const noexcept;
+    std::vector<uint8_t> assemble() const; // read and verify every chip, throws if one is missing or modified
+    bool verify(const uint8_t* image, const std::size_t& size) const; // every chip's checksum, and zeros between them
+
+    // Load the image into memory at its base, returns true if it came from the cache
+    bool load(State8080& state, const std::string& cacheDirectory = defaultCacheDirectory()) const;
+
+    std::string name;
+    std::string directory; // where the chip files are
+    std::vector<RomChip> chips;
+};
+
+#endif // ROMSET_HPP
@@ -0,0 +1,80 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "State8080.hpp"
+#include "SpaceInvaders.hpp"
+#include "RomLoader.hpp"
+
+// Layout of the first page of a snapshot, naturally aligned and read in place, so every field is in the byte order
+// of the host that saved it. A snapshot from a host of the other byte order is told apart by its version and refused
+struct SnapshotHeader {
+    char magic[8]; // "8080SNAP"
+    uint32_t version;
+    uint32_t memoryOffset; // where memory starts, a whole page in
+    uint32_t memorySize;
+    uint32_t checksum; // crc32 of the header with this field as 0, then of memory
+
+    // cpu
+    uint64_t cycleCount;
+    uint16_t stackPointer;
+    uint16_t programCounter;
+    uint8_t b, c, d, e, h, l, a;
+    uint8_t flags; // as the PSW byte
+    uint8_t allowInterrupt;
+    uint8_t halted;
+
+    // board
+    uint8_t shiftLHS;
+    uint8_t shiftRHS;
+    uint8_t shiftOffset;
+    uint8_t port1, port2, port3, port5;
+    uint8_t buttons1, buttons2; // the input latch
+    uint8_t interruptNum;
+    uint8_t pendingInterrupt;
+    uint8_t reserved[7];
+    uint64_t nextInterrupt;
+    uint64_t frames;
+};
+
+// A saved machine, a header page followed by the 64 KiB of memory so the memory is page aligned in the file.
+// A snapshot is verified once when it is made or read, restoring it is then a copy of memory and the registers,
+// so one snapshot, e.g. mapped from a file, can warm start any number of machines.
+class Snapshot {
+public:
+    static constexpr uint32_t version = 1;
+    static constexpr std::size_t pageSize = 4096;
+    static constexpr std::size_t size = pageSize + State8080::RAM;
+
+    explicit Snapshot(const SpaceInvaders& machine); // capture the machine
+    static Snapshot fromData(const uint8_t* data, std::size_t size); // copies the data, throws if it is not a valid snapshot
+    static Snapshot fromFile(const std::string& fname); // maps the file, throws if it is not a valid snapshot
+
+    void restore(SpaceInvaders& machine) const;
+    // Back to the snapshot copying only the dirty pages, for a machine whose dirty pages were cleared when its memory
+    // last matched the snapshot. Clears them again and returns how many pages were copied
+    std::size_t reset(SpaceInvaders& machine) const;
+    // Everything but memory, for keeping many small snapshots
+    static SnapshotHeader captureRegisters(const SpaceInvaders& machine) noexcept;
+    static void restoreRegisters(const SnapshotHeader& header, SpaceInvaders& machine);
+    void toFile(const std::string& fname) const;
+
+    const uint8_t* data() const noexcept { return file ? file->data() : bytes.data(); }
+    const SnapshotHeader& header() const noexcept { return *reinterpret_cast<const SnapshotHeader*>(data()); }
+    uint32_t checksum() const noexcept { return header().checksum; }
+
+private:
+    Snapshot() = default;
+    static uint32_t computeChecksum(const uint8_t* data) noexcept;
+    void verify(std::size_t length) const;
+
+    std::vector<uint8_t> bytes; // a captured or copied snapshot
+    std::shared_ptr<const MappedFile> file; // a mapped snapshot, shared by copies
+};
+
+#endif // SNAPSHOT_HPP
@@ -0,0 +1,65 @@
+#ifndef SPACEINVADERS_HPP
+#define SPACEINVADERS_HPP
+
+#include <cstdint>
+
+#include "State8080.hpp"
+#include "Disassembler8080.hpp"
+#include "InputLatch.hpp"
+#include "AudioMixer.hpp"
+#include "Movie.hpp"
+#include "Profiler.hpp"
+#include "CallGraph.hpp"
+#include "Coverage.hpp"
+#include "Trace.hpp"
+
+// The Space Invaders board: the cpu, its I/O ports and the screen's interrupts.
+// Time is measured in emulated cycles, the screen interrupts the cpu twice a frame,
+// RST 1 when the beam is in the middle of the screen and RST 2 at vblank.
+class SpaceInvaders {
+public:
+    static constexpr uint64_t cpuClock = 2000000; // 2 MHz
+    static constexpr uint64_t cyclesPerFrame = cpuClock / 60;
+    static constexpr uint64_t cyclesPerHalfFrame = cyclesPerFrame / 2;
+
+    SpaceInvaders();
+
+    void step(); // run a single instruction, or take an interrupt if one is due
+    void runUntil(const uint64_t& cycle);
+    void runFrame(); // run until the next vblank
+
+    uint64_t frameCount() const noexcept { return frames; }
+    uint64_t nextInterruptCycle() const noexcept { return nextInterrupt; }
+
+    // Where the machine is in the screen's interrupt schedule, saved and restored with snapshots
+    struct Schedule {
+        uint64_t nextInterrupt;
+        uint8_t interruptNum;
+        uint8_t pendingInterrupt;
+        uint64_t frames;
+    };
+    Schedule schedule() const noexcept;
+    void setSchedule(const Schedule&) noexcept;
+
+    State8080 state;
+    Disassembler8080 cpu;
+    InputLatch input; // buttons, latched into ports 1 and 2 at vblank
+    AudioMixer* mixer = nullptr; // receives the sound ports when set
+    Movie* movie = nullptr; // records or plays back the buttons when set
+    Profiler* profiler = nullptr; // sees every instruction before it runs when set
+    CallGraph* callGraph = nullptr; // sees every instruction and interrupt after it ran when set
+    TraceRecorder* trace = nullptr; // records every instruction and interrupt before it runs when set
+    Coverage* coverage = nullptr; // sees every instruction and interrupt before it runs when set
+
+private:
+    void interrupt();
+    void OP_Input();
+    void OP_Output();
+
+    uint64_t nextInterrupt = cyclesPerHalfFrame; // cycle of the next screen interrupt
+    uint8_t interruptNum = 1; // RST of the next screen interrupt
+    uint8_t pendingInterrupt = 0; // a screen interrupt waiting for interrupts to be enabled
+    uint64_t frames = 0;
+};
+
+#endif // SPACEINVADERS_HPP
@@ -3,8 +3,10 @@
 
 #include <cstdint>
 #include <array>
+#include <bitset>
 
 #include "ConditionFlags.hpp"
+#include "MemoryHeatmap.hpp"
 
 struct State8080 {
 
@@ -21,9 +23,58 @@ struct State8080 {
     uint8_t l;
     uint8_t a; //accumulator register
 
-    static constexpr uint16_t RAM = 0xFFFF;
+    static constexpr std::size_t RAM = 0x10000; // the full 16 bit address space
     std::array<uint8_t, RAM> memory;
-    uint32_t cycleCount = 0;
+    // Memory is split into pages, a page is marked when it is written so only changed pages need saving
+    static constexpr std::size_t pageSize = 0x100;
+    static constexpr std::size_t pageCount = RAM / pageSize;
+    std::bitset<pageCount> dirtyPages;
+    // the cpu reads and writes data only through these, the address wraps around like the real bus
+    uint8_t readMemory(const uint16_t& address) const noexcept {
+#ifdef MEMORY_STATS
+        if (heatmap != nullptr)
+            heatmap->count(MemoryHeatmap::Read, address);
+#endif
+        return memory[address];
+    }
+    void writeMemory(const uint16_t& address, const uint8_t& value) noexcept {
+#ifdef MEMORY_STATS
+        if (heatmap != nullptr)
+            heatmap->count(MemoryHeatmap::Write, address);
+#endif
+        memory[address] = value;
+        dirtyPages[address / pageSize] = true;
+    }
+    // pushes, pops, calls, returns and interrupts, the same memory counted apart from other data
+    uint8_t readStack(const uint16_t& address) const noexcept {
+#ifdef MEMORY_STATS
+        if (heatmap != nullptr)
+            heatmap->count(MemoryHeatmap::Stack, address);
+#endif
+        return memory[address];
+    }
+    void writeStack(const uint16_t& address, const uint8_t& value) noexcept {
+#ifdef MEMORY_STATS
+        if (heatmap != nullptr)
+            heatmap->count(MemoryHeatmap::Stack, address);
+#endif
+        memory[address] = value;
+        dirtyPages[address / pageSize] = true;
+    }
+    // the bytes of an instruction, read by decoding it so they are only counted here
+    void fetched(const uint16_t& address, const uint8_t& size) const noexcept {
+#ifdef MEMORY_STATS
+        if (heatmap != nullptr)
+            heatmap->count(MemoryHeatmap::Fetch, address, size);
+#else
+        (void) address;
+        (void) size;
+#endif
+    }
+#ifdef MEMORY_STATS
+    MemoryHeatmap* heatmap = nullptr; // counts the accesses when set
+#endif
+    uint64_t cycleCount = 0;
     // Variables for shift registering, both LHS and RHS create a uint16_t
     uint8_t shiftLHS = 0;
     uint8_t shiftRHS = 0;
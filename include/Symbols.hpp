@@ -0,0 +1,27 @@
+#ifndef SYMBOLS_HPP
+#define SYMBOLS_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+// Names for addresses of a program, for reports that read like the program's listing.
+// A symbol file has a hex address and a name per line, lines starting with # are comments:
+//   0x1A32 BlockCopy
+class Symbols {
+public:
+    static Symbols fromFile(const std::string& fname); // throws if a line is not a symbol
+
+    void add(const uint16_t& address, const std::string& name);
+    const std::string* find(const uint16_t& address) const; // the name of exactly this address, nullptr if it has none
+    std::string describe(const uint16_t& address) const; // "BlockCopy+0x3" from the nearest name at or below, else "0x1A35"
+    std::string label(const uint16_t& address) const; // the name of a routine's entry, else "sub_1A32"
+
+    const std::map<uint16_t, std::string>& names() const noexcept { return symbols; }
+    bool empty() const noexcept { return symbols.empty(); }
+
+private:
+    std::map<uint16_t, std::string> symbols;
+};
+
+#endif // SYMBOLS_HPP
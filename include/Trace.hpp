@@ -0,0 +1,128 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "State8080.hpp"
+#include "RomLoader.hpp"
+
+// The cpu as it was before one instruction ran, or before it took an interrupt.
+// Every record has the same size so a trace is indexed by its record number.
+struct TraceRecord {
+    enum Kind : uint8_t { Instruction, Interrupt };
+
+    uint64_t cycle;
+    uint16_t programCounter;
+    uint16_t stackPointer;
+    uint8_t opcode; // for an interrupt, the RST put on the bus
+    uint8_t operands[2]; // the two bytes after the opcode, whether the instruction uses them or not
+    uint8_t a, b, c, d, e, h, l;
+    uint8_t flags; // as the PSW byte
+    Kind kind;
+};
+static_assert(sizeof(TraceRecord) == 24, "trace records are written as they are");
+
+// The start of a trace file, the records follow it at headerSize so they are page aligned
+struct TraceHeader {
+    char magic[8]; // "8080TRCE"
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t count;
+};
+
+// Writes a record per instruction to a file without holding up the emulation.
+// The emulation thread puts records in a lock free ring buffer, a writer thread drains it into the file,
+// mapped a window at a time where the platform allows it. The emulation only waits if the ring is full.
+class TraceRecorder {
+public:
+    static constexpr uint32_t version = 2;
+    // the header takes the largest page there is, 64 KiB on some aarch64 hosts, so the windows mapped after it
+    // start on a page boundary whatever the host's page size
+    static constexpr std::size_t headerSize = 65536;
+    static constexpr std::size_t ringSize = 1 << 18; // records, a power of two
+    static constexpr std::size_t windowRecords = 1 << 20; // the file grows 24 MiB at a time
+
+    explicit TraceRecorder(const std::string& fname); // throws if the file can not be created
+    ~TraceRecorder();
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    void record(const State8080& state, const uint8_t& opcode, const TraceRecord::Kind& kind) noexcept {
+        const uint64_t next = head.load(std::memory_order_relaxed);
+        if (next - tail.load(std::memory_order_acquire) == ringSize) {
+            ++stallCount;
+            do {
+                std::this_thread::yield();
+            } while (next - tail.load(std::memory_order_acquire) == ringSize);
+        }
+        TraceRecord& out = ring[next & (ringSize - 1)];
+        out.cycle = state.cycleCount;
+        out.programCounter = state.programCounter;
+        out.stackPointer = state.stackPointer;
+        out.opcode = opcode;
+        out.operands[0] = state.memory[static_cast<uint16_t>(state.programCounter + 1)];
+        out.operands[1] = state.memory[static_cast<uint16_t>(state.programCounter + 2)];
+        out.a = state.a;
+        out.b = state.b;
+        out.c = state.c;
+        out.d = state.d;
+        out.e = state.e;
+        out.h = state.h;
+        out.l = state.l;
+        out.flags = state.condFlags.makePSW();
+        out.kind = kind;
+        head.store(next + 1, std::memory_order_release);
+    }
+    void close(); // writes what is left and the header, throws if writing failed
+
+    uint64_t recorded() const noexcept { return head.load(std::memory_order_relaxed); }
+    uint64_t stalls() const noexcept { return stallCount; } // times the emulation waited for the writer
+
+private:
+    void drain(); // the writer thread
+    void write(const TraceRecord* records, std::size_t count);
+    void finish();
+
+    std::string fname;
+    std::vector<TraceRecord> ring;
+    // head and tail are a cache line apart so the two threads do not fight over one line
+    std::atomic<uint64_t> head {0}; // the next record to fill, only the emulation writes it
+    char headPadding[64 - sizeof(std::atomic<uint64_t>)];
+    std::atomic<uint64_t> tail {0}; // the next record to drain, only the writer writes it
+    char tailPadding[64 - sizeof(std::atomic<uint64_t>)];
+    std::atomic<bool> running {true};
+    uint64_t stallCount = 0;
+    std::thread writer;
+    bool closed = false;
+
+    // owned by the writer thread until it is joined
+    std::string error;
+    int fd = -1;
+    uint8_t* window = nullptr; // the mapped part of the file being filled
+    uint64_t windowStart = 0; // record number of the first record of the window
+    uint64_t written = 0;
+    std::FILE* stream = nullptr; // where the file is not mapped
+};
+
+// A trace read back, the records are only touched when they are asked for
+class TraceFile {
+public:
+    static TraceFile fromFile(const std::string& fname); // maps the file, throws if it is not a trace
+
+    std::size_t size() const noexcept { return count; }
+    const TraceRecord& operator[](const std::size_t& index) const noexcept { return records[index]; }
+
+private:
+    std::shared_ptr<const MappedFile> file;
+    const TraceRecord* records = nullptr;
+    std::size_t count = 0;
+};
+
+#endif // TRACE_HPP
@@ -0,0 +1,40 @@
+#ifndef TRAPS_HPP
+#define TRAPS_HPP
+
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "State8080.hpp"
+
+// Addresses whose routines are run natively instead of by the cpu, e.g. the entry points of an operating system.
+// The cpu only looks for a trap after a jump, call, return or restart lands, never per instruction, so a trapped
+// address must be reached by a branch, not by falling through into it. A handler does what the routine would and
+// leaves the state as it would, usually by returning to the caller with ret().
+class Traps {
+public:
+    using Handler = std::function<void(State8080&)>;
+
+    void add(const uint16_t& address, const Handler& handler); // replaces the address's handler
+    void remove(const uint16_t& address);
+    bool empty() const noexcept { return addresses.empty(); }
+
+    // Run the handler of the address the program counter is at, false if it is not trapped
+    bool run(State8080& state) const {
+        // the list is short, a handful of addresses, a binary search beats a table of 64 Ki entries in the cache
+        const auto found = std::lower_bound(addresses.begin(), addresses.end(), state.programCounter);
+        if (found == addresses.end() || *found != state.programCounter)
+            return false;
+        handlers[static_cast<std::size_t>(found - addresses.begin())](state);
+        return true;
+    }
+
+    static void ret(State8080& state) noexcept; // return from the trapped routine to its caller, like a RET
+
+private:
+    std::vector<uint16_t> addresses; // sorted
+    std::vector<Handler> handlers; // of the addresses in the same order
+};
+
+#endif // TRAPS_HPP
@@ -0,0 +1,25 @@
+#ifndef AUDIOSTREAM_HPP
+#define AUDIOSTREAM_HPP
+
+#include <QIODevice>
+
+#include "AudioMixer.hpp"
+
+// Device the audio output pulls the mixed stream from
+class AudioStream : public QIODevice {
+    Q_OBJECT
+public:
+    explicit AudioStream(AudioMixer& mixer, QObject* parent = nullptr);
+
+    bool isSequential() const override { return true; }
+    qint64 bytesAvailable() const override;
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char*, qint64) override;
+
+private:
+    AudioMixer& mixer;
+};
+
+#endif // AUDIOSTREAM_HPP
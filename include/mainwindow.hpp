@@ -2,12 +2,16 @@
 #define MAINWINDOW_HPP
 
 #include <QMainWindow>
-#include <QMap>
 #include <QTimer>
-#include <QMediaPlayer>
-#include <QSoundEffect>
-#include "Disassembler8080.hpp"
-#include "State8080.hpp"
+#include <QAudioOutput>
+#include <chrono>
+#include "SpaceInvaders.hpp"
+#include "ColorOverlay.hpp"
+#include "FrameBuffer.hpp"
+#include "RewindBuffer.hpp"
+#include "Movie.hpp"
+#include "AudioMixer.hpp"
+#include "audiostream.hpp"
 #include "infowindow.hpp"
 
 
@@ -20,6 +24,11 @@ class MainWindow : public QMainWindow {
 public:
     explicit MainWindow(QWidget *parent = nullptr);
     virtual ~MainWindow() override;
+    void setOverlay(const ColorOverlay&);
+    void loadRomSet(const std::string& descriptor);
+    void recordMovie(const std::string& fname); // saved when the window closes
+    void playMovie(const std::string& fname);
+    void setOpcodeCsv(const std::string& fname) { opcodeCsv = fname; } // written when the window closes, if opcodes are counted
 
 protected:
     void virtual keyPressEvent(QKeyEvent* key) override;
@@ -28,28 +37,42 @@ protected:
 private:
     Ui::MainWindow * ui;
     InfoWindow * infoWindow;
-    State8080 state;
-    Disassembler8080 cpu;
-    QMap<Qt::Key, bool> keyMap; // key map to determine if a specific key is on
+    SpaceInvaders machine;
     QTimer* timer; // timer used to loop running cycles
+    ColorOverlay overlay; // colour of the gel strips on the screen
+    FrameBuffer frame; // pixels of the screen, converted from VRAM every paint
 
-    uint32_t cpuSteps = 0; // the amount of times cpu has been executed
+    using clock = std::chrono::steady_clock;
+    bool turbo = false; // run as fast as possible instead of in real time
+    clock::time_point pacedTime; // when the machine was at pacedCycle, real time is measured from here
+    uint64_t pacedCycle = 0;
+    clock::time_point reportTime; // speed is reported from the cycles run since reportTime
+    uint64_t reportCycle = 0;
+    RewindBuffer rewind; // the last frames, stepped back through while rewinding
+    bool rewinding = false;
+    Movie movie;
+    std::string movieFile; // where a recording is saved
+    std::string opcodeCsv;
+    clock::time_point rewindTime; // when the last frame was stepped back
     static constexpr int width = 256;
     static constexpr int height = 224;
     static int reFac; // resize factor, 1 for 256x224...
     void loadFile(const QString& qtRscFile);
     void setKey(QKeyEvent*& key, bool toggle);
     void runCycle();
+    void setTurbo(bool on);
+    void setRewinding(bool on);
+    void quickSave();
+    void quickLoad();
+    static const char* quickSaveFile;
     void paint();
 
-    void registerInput();
-    void soundHandle();
-    void OP_Input();
-    void OP_Output(const uint8_t& value);
+    void loadSounds();
 
-    inline int64_t getTime() const noexcept;
-    QMediaPlayer* player; // sound player
-    QSoundEffect ufoSoundEffect;
+    static constexpr std::size_t audioLatency = 1024; // samples the sounds are played behind the emulation, ~23ms
+    AudioMixer mixer;
+    AudioStream* audioStream;
+    QAudioOutput* audioOutput;
 };
 
 #endif // MAINWINDOW_HPP
@@ -0,0 +1,326 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "AluVerifier.hpp"
+#include "Disassembler8080.hpp"
+#include "OpcodeInfo.hpp"
+
+namespace {
+
+constexpr uint16_t codeAddress = 0x0100;
+constexpr uint16_t dataAddress = 0x2000; // where HL points for the M forms
+
+enum Operation : uint8_t {ADD, ADC, SUB, SBB, ANA, XRA, ORA, CMP};
+
+bool binary(const uint8_t& opcode) noexcept {
+    return (opcode >= 0x80 && opcode <= 0xBF) || (opcode & 0xC7) == 0xC6;
+}
+bool increment(const uint8_t& opcode) noexcept { return (opcode & 0xC7) == 0x04; }
+bool decrement(const uint8_t& opcode) noexcept { return (opcode & 0xC7) == 0x05; }
+bool unary(const uint8_t& opcode) noexcept { // on A and the flags only
+    return (opcode & 0xC7) == 0x07;
+}
+
+// The register an opcode reads or changes, B C D E H L M A
+uint8_t sourceOf(const uint8_t& opcode) noexcept { return opcode & 0x07; }
+uint8_t targetOf(const uint8_t& opcode) noexcept { return (opcode >> 3) & 0x07; }
+
+// The operands of every A, an operand that is A itself has only the one. For the opcodes without one it is
+// only the sign, zero and parity the flags start with, to see they are kept.
+unsigned operandsOf(const uint8_t& opcode) noexcept {
+    if (unary(opcode))
+        return 8;
+    if ((opcode >= 0x80 && opcode <= 0xBF && sourceOf(opcode) == 7) || ((increment(opcode) || decrement(opcode)) && targetOf(opcode) == 7))
+        return 1;
+    return 256;
+}
+
+uint8_t operandOf(const uint8_t& opcode, const uint8_t& a, const unsigned& index) noexcept {
+    return operandsOf(opcode) == 1 ? a : static_cast<uint8_t>(index);
+}
+
+// The flags a case starts with, the low bits of the operand vary the others so changing them is seen
+uint8_t pswOf(const uint8_t& operand, const bool& carry, const bool& auxCarry) noexcept {
+    return static_cast<uint8_t>(0x02 | (carry ? 0x01 : 0) | (auxCarry ? 0x10 : 0) |
+                                ((operand & 1) << 7) | (((operand >> 1) & 1) << 6) | (((operand >> 2) & 1) << 2));
+}
+
+uint8_t& registerOf(State8080& state, const uint8_t& index) noexcept {
+    switch (index) {
+        case 0: return state.b;
+        case 1: return state.c;
+        case 2: return state.d;
+        case 3: return state.e;
+        case 4: return state.h;
+        case 5: return state.l;
+        case 6: return state.memory[dataAddress];
+        default: return state.a;
+    }
+}
+
+// Sign, zero and parity of a result, written apart from the cpu's helpers
+uint8_t szp(const uint8_t& result) noexcept {
+    bool even = true;
+    for (uint8_t bits = result; bits != 0; bits &= static_cast<uint8_t>(bits - 1)) {
+        even = !even;
+    }
+    return static_cast<uint8_t>((result & 0x80) | (result == 0 ? 0x40 : 0) | (even ? 0x04 : 0));
+}
+
+uint8_t flags(const uint8_t& result, const bool& carry, const bool& auxCarry) noexcept {
+    return static_cast<uint8_t>(szp(result) | 0x02 | (auxCarry ? 0x10 : 0) | (carry ? 0x01 : 0));
+}
+
+bool before(const AluVerifier::Mismatch& x, const AluVerifier::Mismatch& y) noexcept {
+    return std::make_tuple(x.a, x.operand, x.psw) < std::make_tuple(y.a, y.operand, y.psw);
+}
+
+std::string hex(const unsigned& value) {
+    char buffer[8];
+    std::snprintf(buffer, sizeof buffer, "%02X", value);
+    return buffer;
+}
+
+} // namespace
+
+bool AluVerifier::verified(const uint8_t& opcode) noexcept {
+    return binary(opcode) || increment(opcode) || decrement(opcode) || unary(opcode);
+}
+
+AluVerifier::Outcome AluVerifier::reference(const uint8_t& opcode, const uint8_t& a, const uint8_t& operand, const uint8_t& psw) noexcept {
+    const bool carry = (psw & 0x01) != 0;
+    const bool auxCarry = (psw & 0x10) != 0;
+    Outcome out {a, a, psw};
+    if (binary(opcode)) {
+        const uint8_t operation = targetOf(opcode);
+        uint8_t result = 0;
+        switch (operation) {
+            case ADD:
+            case ADC: {
+                const unsigned in = operation == ADC && carry ? 1 : 0;
+                const unsigned sum = a + operand + in;
+                result = static_cast<uint8_t>(sum);
+                out.psw = flags(result, sum > 0xFF, (a & 0xF) + (operand & 0xF) + in > 0xF);
+                break;
+            }
+            case SUB:
+            case SBB:
+            case CMP: {
+                // the 8080 adds the complement of the operand, aux carry is the carry out of bit 3 of that
+                // addition and carry is the borrow
+                const unsigned borrow = operation == SBB && carry ? 1 : 0;
+                result = static_cast<uint8_t>(a - operand - borrow);
+                out.psw = flags(result, a < operand + borrow, (a & 0xF) + (~operand & 0xF) + (1 - borrow) > 0xF);
+                break;
+            }
+            case ANA:
+                result = a & operand;
+                out.psw = flags(result, false, ((a | operand) & 0x08) != 0); // the 8085 sets it instead
+                break;
+            case XRA:
+                result = a ^ operand;
+                out.psw = flags(result, false, false);
+                break;
+            default:
+                result = a | operand;
+                out.psw = flags(result, false, false);
+                break;
+        }
+        if (operation != CMP)
+            out.a = out.value = result;
+    }
+    else if (increment(opcode) || decrement(opcode)) {
+        // carry is kept
+        const bool up = increment(opcode);
+        out.value = static_cast<uint8_t>(up ? operand + 1 : operand - 1);
+        out.psw = flags(out.value, carry, up ? (out.value & 0xF) == 0 : (out.value & 0xF) != 0xF);
+        if (targetOf(opcode) == 7)
+            out.a = out.value;
+    }
+    else {
+        switch (opcode) {
+            case 0x07: // RLC
+                out.a = static_cast<uint8_t>(a << 1 | a >> 7);
+                out.psw = static_cast<uint8_t>((psw & 0xFE) | a >> 7);
+                break;
+            case 0x0F: // RRC
+                out.a = static_cast<uint8_t>(a >> 1 | a << 7);
+                out.psw = static_cast<uint8_t>((psw & 0xFE) | (a & 1));
+                break;
+            case 0x17: // RAL
+                out.a = static_cast<uint8_t>(a << 1 | (carry ? 1 : 0));
+                out.psw = static_cast<uint8_t>((psw & 0xFE) | a >> 7);
+                break;
+            case 0x1F: // RAR
+                out.a = static_cast<uint8_t>(a >> 1 | (carry ? 0x80 : 0));
+                out.psw = static_cast<uint8_t>((psw & 0xFE) | (a & 1));
+                break;
+            case 0x27: { // DAA, carry is only ever set
+                uint8_t correction = 0;
+                bool carryOut = carry;
+                if ((a & 0xF) > 9 || auxCarry)
+                    correction |= 0x06;
+                if (a > 0x99 || carry) {
+                    correction |= 0x60;
+                    carryOut = true;
+                }
+                out.a = static_cast<uint8_t>(a + correction);
+                out.psw = flags(out.a, carryOut, (a & 0xF) + (correction & 0xF) > 0xF);
+                break;
+            }
+            case 0x2F: // CMA
+                out.a = static_cast<uint8_t>(~a);
+                break;
+            case 0x37: // STC
+                out.psw = psw | 0x01;
+                break;
+            default: // CMC
+                out.psw = psw ^ 0x01;
+                break;
+        }
+        out.value = out.a;
+    }
+    return out;
+}
+
+AluVerifier::Engine AluVerifier::interpreter() {
+    return []() {
+        const std::shared_ptr<Disassembler8080> cpu = std::make_shared<Disassembler8080>();
+        return Step([cpu](State8080& state) { cpu->runCycle(state); });
+    };
+}
+
+AluVerifier::AluVerifier(const Engine& engine) : engine(engine) {
+}
+
+void AluVerifier::run(unsigned threads) {
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<uint8_t> opcodes;
+    for (unsigned opcode = 0; opcode != 256; opcode++) {
+        if (verified(static_cast<uint8_t>(opcode)))
+            opcodes.push_back(static_cast<uint8_t>(opcode));
+    }
+    // a piece of work is an opcode with one value of A, a few thousand cases at most
+    const std::size_t work = opcodes.size() * 256;
+    std::atomic<std::size_t> next(0);
+    std::vector<std::array<OpcodeResult, 256>> partial(threads);
+
+    const auto start = std::chrono::steady_clock::now();
+    auto check = [&](std::array<OpcodeResult, 256>& results) {
+        const Step step = engine();
+        std::unique_ptr<State8080> state(new State8080());
+        for (std::size_t item = next++; item < work; item = next++) {
+            const uint8_t opcode = opcodes[item / 256];
+            const uint8_t a = static_cast<uint8_t>(item % 256);
+            OpcodeResult& result = results[opcode];
+            const unsigned operands = operandsOf(opcode);
+            for (unsigned index = 0; index != operands; index++) {
+                const uint8_t operand = operandOf(opcode, a, index);
+                for (int carry = 0; carry != 2; carry++) {
+                    for (int auxCarry = 0; auxCarry != 2; auxCarry++) {
+                        const uint8_t psw = pswOf(operand, carry != 0, auxCarry != 0);
+                        state->b = state->c = state->d = state->e = 0;
+                        state->h = dataAddress >> 8;
+                        state->l = dataAddress & 0xFF;
+                        state->a = a;
+                        state->programCounter = codeAddress;
+                        state->memory[codeAddress] = opcode;
+                        state->memory[codeAddress + 1] = operand; // the immediates'
+                        state->condFlags.fromPSW(psw);
+                        if (opcode >= 0x80 && opcode <= 0xBF)
+                            registerOf(*state, sourceOf(opcode)) = operand;
+                        else if (increment(opcode) || decrement(opcode))
+                            registerOf(*state, targetOf(opcode)) = operand;
+                        step(*state);
+
+                        const Outcome expected = reference(opcode, a, operand, psw);
+                        Outcome got {state->a, state->a, state->condFlags.makePSW()};
+                        if (increment(opcode) || decrement(opcode))
+                            got.value = registerOf(*state, targetOf(opcode));
+                        ++result.cases;
+                        uint8_t fields = 0;
+                        if (got.a != expected.a)
+                            fields |= A;
+                        if (got.value != expected.value)
+                            fields |= Register;
+                        const uint8_t differ = got.psw ^ expected.psw;
+                        fields |= (differ & 0x80 ? Sign : 0) | (differ & 0x40 ? Zero : 0) | (differ & 0x04 ? Parity : 0) |
+                                  (differ & 0x01 ? Carry : 0) | (differ & 0x10 ? AuxCarry : 0);
+                        if (fields == 0)
+                            continue;
+                        const Mismatch mismatch {a, operand, psw, expected, got};
+                        if (result.mismatches++ == 0 || before(mismatch, result.first))
+                            result.first = mismatch;
+                        result.fields |= fields;
+                    }
+                }
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; i++) {
+        pool.emplace_back(check, std::ref(partial[i]));
+    }
+    check(partial[0]);
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    perOpcode = {};
+    for (const std::array<OpcodeResult, 256>& results : partial) {
+        for (std::size_t opcode = 0; opcode != perOpcode.size(); opcode++) {
+            OpcodeResult& total = perOpcode[opcode];
+            const OpcodeResult& part = results[opcode];
+            if (part.mismatches != 0 && (total.mismatches == 0 || before(part.first, total.first)))
+                total.first = part.first;
+            total.cases += part.cases;
+            total.mismatches += part.mismatches;
+            total.fields |= part.fields;
+        }
+    }
+}
+
+uint64_t AluVerifier::cases() const noexcept {
+    uint64_t total = 0;
+    for (const OpcodeResult& result : perOpcode) {
+        total += result.cases;
+    }
+    return total;
+}
+
+uint64_t AluVerifier::mismatches() const noexcept {
+    uint64_t total = 0;
+    for (const OpcodeResult& result : perOpcode) {
+        total += result.mismatches;
+    }
+    return total;
+}
+
+void AluVerifier::report(std::ostream& os) const {
+    static const char* const names[] = {"A", "register", "S", "Z", "P", "CY", "AC"};
+    for (std::size_t opcode = 0; opcode != perOpcode.size(); opcode++) {
+        const OpcodeResult& result = perOpcode[opcode];
+        if (result.mismatches == 0)
+            continue;
+        std::string wrong;
+        for (int i = 0; i != 7; i++) {
+            if (result.fields & (1 << i))
+                wrong += (wrong.empty() ? "" : " ") + std::string(names[i]);
+        }
+        const Mismatch& m = result.first;
+        os << hex(static_cast<unsigned>(opcode)) << ' ' << opcodeInfo[opcode].mnemonic << ": " << result.mismatches << " of " << result.cases
+           << " wrong in " << wrong << ", first A=" << hex(m.a) << " operand=" << hex(m.operand) << " flags=" << hex(m.psw)
+           << " gave A=" << hex(m.got.a) << " value=" << hex(m.got.value) << " flags=" << hex(m.got.psw)
+           << ", expected A=" << hex(m.expected.a) << " value=" << hex(m.expected.value) << " flags=" << hex(m.expected.psw) << '\n';
+    }
+    os << mismatches() << " mismatches in " << cases() << " cases\n";
+}
@@ -0,0 +1,884 @@
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <functional>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#include "Assembler.hpp"
+
+namespace {
+
+std::string upper(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](char c) { return static_cast<char>(std::toupper(static_cast<unsigned char>(c))); });
+    return text;
+}
+
+std::string trim(const std::string& text) {
+    const std::size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos)
+        return "";
+    return text.substr(begin, text.find_last_not_of(" \t\r") - begin + 1);
+}
+
+bool symbolStart(const char& c) {
+    return std::isalpha(static_cast<unsigned char>(c)) || c == '_' || c == '?' || c == '@' || c == '.';
+}
+
+bool symbolChar(const char& c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '?' || c == '@' || c == '.' || c == '$';
+}
+
+bool quote(const char& c) {
+    return c == '\'' || c == '"';
+}
+
+// The end of the string starting at begin, a doubled quote is a quote inside it
+std::size_t stringEnd(const std::string& text, std::size_t begin) {
+    const char delimiter = text[begin];
+    for (std::size_t i = begin + 1; i < text.size(); i++) {
+        if (text[i] != delimiter)
+            continue;
+        if (i + 1 < text.size() && text[i + 1] == delimiter)
+            ++i;
+        else
+            return i + 1;
+    }
+    throw std::runtime_error("unterminated string");
+}
+
+std::string stripComment(const std::string& line) {
+    for (std::size_t i = 0; i < line.size(); i++) {
+        if (quote(line[i]))
+            i = stringEnd(line, i) - 1;
+        else if (line[i] == ';')
+            return line.substr(0, i);
+    }
+    return line;
+}
+
+// Operands split at the commas outside strings and parentheses
+std::vector<std::string> splitOperands(const std::string& text) {
+    std::vector<std::string> operands;
+    if (trim(text).empty())
+        return operands;
+    int depth = 0;
+    std::size_t begin = 0;
+    for (std::size_t i = 0; i < text.size(); i++) {
+        if (quote(text[i]))
+            i = stringEnd(text, i) - 1;
+        else if (text[i] == '(')
+            ++depth;
+        else if (text[i] == ')')
+            --depth;
+        else if (text[i] == ',' && depth == 0) {
+            operands.push_back(trim(text.substr(begin, i - begin)));
+            begin = i + 1;
+        }
+    }
+    operands.push_back(trim(text.substr(begin)));
+    return operands;
+}
+
+// The text of a string operand, false if the operand is not just a string
+bool stringOperand(const std::string& operand, std::string& text) {
+    if (operand.size() < 2 || !quote(operand[0]) || stringEnd(operand, 0) != operand.size())
+        return false;
+    text.clear();
+    for (std::size_t i = 1; i + 1 < operand.size(); i++) {
+        text += operand[i];
+        if (operand[i] == operand[0])
+            ++i; // the doubled quote
+    }
+    return true;
+}
+
+struct Line {
+    std::string label;
+    std::string mnemonic; // upper case
+    std::string operands;
+};
+
+const std::set<std::string> namingDirectives = {"EQU", "SET", "DEFL", "MACRO"};
+
+// A label starts in the first column or ends with a colon, the name of an EQU or a macro may also be indented
+Line split(const std::string& text) {
+    Line line;
+    std::size_t pos = 0;
+    auto token = [&]() {
+        const std::size_t begin = text.find_first_not_of(" \t\r", pos);
+        if (begin == std::string::npos) {
+            pos = text.size();
+            return std::string();
+        }
+        std::size_t end = begin;
+        while (end < text.size() && !std::isspace(static_cast<unsigned char>(text[end])))
+            ++end;
+        pos = end;
+        return text.substr(begin, end - begin);
+    };
+    const bool firstColumn = !text.empty() && !std::isspace(static_cast<unsigned char>(text[0]));
+    std::string first = token();
+    if (first.empty())
+        return line;
+    // a colon may also be followed by the mnemonic without a space
+    const std::size_t colon = first.find(':');
+    if (colon != std::string::npos && colon != 0 && !quote(first[0])) {
+        line.label = first.substr(0, colon);
+        const std::size_t rest = first.find_first_not_of(':', colon);
+        if (rest == std::string::npos)
+            first = token();
+        else
+            first = first.substr(rest);
+    }
+    else {
+        const std::size_t afterFirst = pos;
+        const std::string second = token();
+        if (firstColumn || namingDirectives.count(upper(second)) != 0) {
+            line.label = first;
+            first = second;
+        }
+        else {
+            pos = afterFirst;
+        }
+    }
+    line.mnemonic = upper(first);
+    line.operands = trim(text.substr(std::min(pos, text.size())));
+    return line;
+}
+
+// An expression on 16 bits, symbols are looked up as they are met
+class Expression {
+public:
+    using Lookup = std::function<uint16_t(const std::string&)>;
+
+    Expression(const std::string& text, const uint16_t& here, const Lookup& lookup) : text(text), here(here), lookup(lookup) {}
+
+    uint16_t evaluate() {
+        const uint16_t value = logical();
+        skipSpace();
+        if (pos != text.size())
+            throw std::runtime_error("unexpected '" + text.substr(pos) + "' in expression " + text);
+        return value;
+    }
+
+private:
+    void skipSpace() {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos])))
+            ++pos;
+    }
+
+    // The word operator at pos, consumed if it is the one wanted
+    bool word(const char* name) {
+        skipSpace();
+        std::size_t end = pos;
+        while (end < text.size() && symbolChar(text[end]))
+            ++end;
+        if (end == pos || upper(text.substr(pos, end - pos)) != name)
+            return false;
+        pos = end;
+        return true;
+    }
+
+    bool symbol(const char* op) {
+        skipSpace();
+        const std::string wanted(op);
+        if (text.compare(pos, wanted.size(), wanted) != 0)
+            return false;
+        pos += wanted.size();
+        return true;
+    }
+
+    uint16_t logical() {
+        uint16_t value = conjunction();
+        while (true) {
+            if (word("OR"))
+                value |= conjunction();
+            else if (word("XOR"))
+                value ^= conjunction();
+            else
+                return value;
+        }
+    }
+
+    uint16_t conjunction() {
+        uint16_t value = negation();
+        while (word("AND"))
+            value &= negation();
+        return value;
+    }
+
+    uint16_t negation() {
+        if (word("NOT"))
+            return static_cast<uint16_t>(~negation());
+        return relation();
+    }
+
+    uint16_t relation() {
+        const uint16_t left = sum();
+        auto compare = [&](const bool& result) { return static_cast<uint16_t>(result ? 0xFFFF : 0); };
+        if (word("EQ") || symbol("=")) return compare(left == sum());
+        if (word("NE") || symbol("<>")) return compare(left != sum());
+        if (word("LE") || symbol("<=")) return compare(left <= sum());
+        if (word("GE") || symbol(">=")) return compare(left >= sum());
+        if (word("LT") || symbol("<")) return compare(left < sum());
+        if (word("GT") || symbol(">")) return compare(left > sum());
+        return left;
+    }
+
+    uint16_t sum() {
+        uint16_t value = product();
+        while (true) {
+            if (symbol("+"))
+                value = static_cast<uint16_t>(value + product());
+            else if (symbol("-"))
+                value = static_cast<uint16_t>(value - product());
+            else
+                return value;
+        }
+    }
+
+    uint16_t product() {
+        uint16_t value = unary();
+        while (true) {
+            if (symbol("*")) {
+                value = static_cast<uint16_t>(value * unary());
+            }
+            else if (symbol("/") || word("MOD")) {
+                const bool division = text[pos - 1] == '/';
+                const uint16_t divisor = unary();
+                if (divisor == 0)
+                    throw std::runtime_error("division by zero in " + text);
+                value = division ? value / divisor : value % divisor;
+            }
+            else if (word("SHL")) {
+                value = static_cast<uint16_t>(value << std::min<uint16_t>(unary(), 16));
+            }
+            else if (word("SHR")) {
+                value = static_cast<uint16_t>(value >> std::min<uint16_t>(unary(), 16));
+            }
+            else {
+                return value;
+            }
+        }
+    }
+
+    uint16_t unary() {
+        if (symbol("-"))
+            return static_cast<uint16_t>(-unary());
+        if (symbol("+"))
+            return unary();
+        if (word("HIGH"))
+            return unary() >> 8;
+        if (word("LOW"))
+            return unary() & 0xFF;
+        return atom();
+    }
+
+    uint16_t atom() {
+        skipSpace();
+        if (pos == text.size())
+            throw std::runtime_error("missing operand in expression " + text);
+        const char c = text[pos];
+        if (c == '(') {
+            ++pos;
+            const uint16_t value = logical();
+            if (!symbol(")"))
+                throw std::runtime_error("missing ) in expression " + text);
+            return value;
+        }
+        if (quote(c)) {
+            const std::size_t end = stringEnd(text, pos);
+            std::string characters;
+            stringOperand(text.substr(pos, end - pos), characters);
+            pos = end;
+            if (characters.empty() || characters.size() > 2)
+                throw std::runtime_error("a string in an expression must be 1 or 2 characters, " + text);
+            uint16_t value = 0;
+            for (const char& character : characters) {
+                value = static_cast<uint16_t>(value << 8 | static_cast<uint8_t>(character));
+            }
+            return value;
+        }
+        if (std::isdigit(static_cast<unsigned char>(c)))
+            return number();
+        if (c == '$' && (pos + 1 == text.size() || !symbolChar(text[pos + 1]))) {
+            ++pos;
+            return here;
+        }
+        if (symbolStart(c)) {
+            const std::size_t begin = pos;
+            while (pos < text.size() && symbolChar(text[pos]))
+                ++pos;
+            return lookup(upper(text.substr(begin, pos - begin)));
+        }
+        throw std::runtime_error(std::string("unexpected '") + c + "' in expression " + text);
+    }
+
+    uint16_t number() {
+        const std::size_t begin = pos;
+        while (pos < text.size() && std::isalnum(static_cast<unsigned char>(text[pos])))
+            ++pos;
+        std::string digits = upper(text.substr(begin, pos - begin));
+        int base = 10;
+        switch (digits.back()) {
+            case 'H': base = 16; break;
+            case 'B': base = 2; break;
+            case 'O': case 'Q': base = 8; break;
+            case 'D': base = 10; break;
+            default: digits += ' '; break; // no suffix to remove
+        }
+        digits.pop_back();
+        uint32_t value = 0;
+        for (const char& digit : digits) {
+            const int d = std::isdigit(static_cast<unsigned char>(digit)) ? digit - '0' : digit - 'A' + 10;
+            if (d >= base)
+                throw std::runtime_error("bad number " + text.substr(begin, pos - begin));
+            value = (value * static_cast<uint32_t>(base) + static_cast<uint32_t>(d)) & 0xFFFF;
+        }
+        return static_cast<uint16_t>(value);
+    }
+
+    const std::string& text;
+    const uint16_t here;
+    const Lookup& lookup;
+    std::size_t pos = 0;
+};
+
+// How the operands of an instruction are encoded into its opcode and the bytes after it
+enum class Form {
+    Implied, // NOP
+    Move, // MOV r,r
+    MoveImmediate, // MVI r,d8
+    Source, // ADD r, the register in the low bits
+    Destination, // INR r, the register in bits 3 to 5
+    Immediate, // ADI d8
+    LoadPair, // LXI rp,d16
+    Pair, // DAD rp, with SP
+    StackPair, // PUSH rp, with PSW
+    IndirectPair, // STAX B or D
+    Address, // JMP a16
+    Restart // RST n
+};
+
+struct Instruction {
+    Form form;
+    uint8_t opcode;
+};
+
+const std::map<std::string, Instruction> instructions = {
+    {"NOP", {Form::Implied, 0x00}}, {"RLC", {Form::Implied, 0x07}}, {"RRC", {Form::Implied, 0x0F}},
+    {"RAL", {Form::Implied, 0x17}}, {"RAR", {Form::Implied, 0x1F}}, {"DAA", {Form::Implied, 0x27}},
+    {"CMA", {Form::Implied, 0x2F}}, {"STC", {Form::Implied, 0x37}}, {"CMC", {Form::Implied, 0x3F}},
+    {"HLT", {Form::Implied, 0x76}}, {"RET", {Form::Implied, 0xC9}}, {"XCHG", {Form::Implied, 0xEB}},
+    {"XTHL", {Form::Implied, 0xE3}}, {"SPHL", {Form::Implied, 0xF9}}, {"PCHL", {Form::Implied, 0xE9}},
+    {"DI", {Form::Implied, 0xF3}}, {"EI", {Form::Implied, 0xFB}},
+    {"RNZ", {Form::Implied, 0xC0}}, {"RZ", {Form::Implied, 0xC8}}, {"RNC", {Form::Implied, 0xD0}},
+    {"RC", {Form::Implied, 0xD8}}, {"RPO", {Form::Implied, 0xE0}}, {"RPE", {Form::Implied, 0xE8}},
+    {"RP", {Form::Implied, 0xF0}}, {"RM", {Form::Implied, 0xF8}},
+    {"MOV", {Form::Move, 0x40}}, {"MVI", {Form::MoveImmediate, 0x06}},
+    {"ADD", {Form::Source, 0x80}}, {"ADC", {Form::Source, 0x88}}, {"SUB", {Form::Source, 0x90}},
+    {"SBB", {Form::Source, 0x98}}, {"ANA", {Form::Source, 0xA0}}, {"XRA", {Form::Source, 0xA8}},
+    {"ORA", {Form::Source, 0xB0}}, {"CMP", {Form::Source, 0xB8}},
+    {"INR", {Form::Destination, 0x04}}, {"DCR", {Form::Destination, 0x05}},
+    {"ADI", {Form::Immediate, 0xC6}}, {"ACI", {Form::Immediate, 0xCE}}, {"SUI", {Form::Immediate, 0xD6}},
+    {"SBI", {Form::Immediate, 0xDE}}, {"ANI", {Form::Immediate, 0xE6}}, {"XRI", {Form::Immediate, 0xEE}},
+    {"ORI", {Form::Immediate, 0xF6}}, {"CPI", {Form::Immediate, 0xFE}},
+    {"IN", {Form::Immediate, 0xDB}}, {"OUT", {Form::Immediate, 0xD3}},
+    {"LXI", {Form::LoadPair, 0x01}}, {"DAD", {Form::Pair, 0x09}}, {"INX", {Form::Pair, 0x03}},
+    {"DCX", {Form::Pair, 0x0B}}, {"PUSH", {Form::StackPair, 0xC5}}, {"POP", {Form::StackPair, 0xC1}},
+    {"STAX", {Form::IndirectPair, 0x02}}, {"LDAX", {Form::IndirectPair, 0x0A}},
+    {"JMP", {Form::Address, 0xC3}}, {"CALL", {Form::Address, 0xCD}},
+    {"LDA", {Form::Address, 0x3A}}, {"STA", {Form::Address, 0x32}},
+    {"LHLD", {Form::Address, 0x2A}}, {"SHLD", {Form::Address, 0x22}},
+    {"JNZ", {Form::Address, 0xC2}}, {"JZ", {Form::Address, 0xCA}}, {"JNC", {Form::Address, 0xD2}},
+    {"JC", {Form::Address, 0xDA}}, {"JPO", {Form::Address, 0xE2}}, {"JPE", {Form::Address, 0xEA}},
+    {"JP", {Form::Address, 0xF2}}, {"JM", {Form::Address, 0xFA}},
+    {"CNZ", {Form::Address, 0xC4}}, {"CZ", {Form::Address, 0xCC}}, {"CNC", {Form::Address, 0xD4}},
+    {"CC", {Form::Address, 0xDC}}, {"CPO", {Form::Address, 0xE4}}, {"CPE", {Form::Address, 0xEC}},
+    {"CP", {Form::Address, 0xF4}}, {"CM", {Form::Address, 0xFC}},
+    {"RST", {Form::Restart, 0xC7}}
+};
+
+uint16_t sizeOf(const Form& form) {
+    switch (form) {
+        case Form::MoveImmediate:
+        case Form::Immediate:
+            return 2;
+        case Form::LoadPair:
+        case Form::Address:
+            return 3;
+        default:
+            return 1;
+    }
+}
+
+// Listing directives and the like that change nothing here
+const std::set<std::string> ignored = {"TITLE", "SUBTTL", "PAGE", "EJECT", "NAME", ".8080", "ASEG", "CSEG", ".LIST", ".XLIST", ".COMMENT"};
+
+struct Macro {
+    std::vector<std::string> parameters; // upper case
+    std::vector<std::string> body;
+};
+
+} // namespace
+
+// The passes over the source, each one runs every line in order so SET symbols, REPT and macros expand the
+// same way in both
+class Assembler {
+public:
+    Assembler(const uint16_t& origin, const std::string& name) : origin(origin), name(name) {}
+
+    Assembly assemble(const std::vector<std::string>& lines) {
+        for (pass = 1; pass <= 2; pass++) {
+            pc = origin;
+            ended = false;
+            conditions.clear();
+            defined.clear();
+            macros.clear();
+            entry = -1;
+            block(lines, true);
+            if (!conditions.empty())
+                fail("IF without ENDIF");
+        }
+        Assembly assembly;
+        if (lowest <= highest) {
+            assembly.first = static_cast<uint16_t>(lowest);
+            assembly.image.assign(memory.begin() + lowest, memory.begin() + highest + 1);
+        }
+        else {
+            assembly.first = origin;
+        }
+        assembly.entry = entry >= 0 ? static_cast<uint16_t>(entry) : assembly.first;
+        for (const auto& symbol : symbols) {
+            assembly.values[symbol.first] = symbol.second.value;
+            if (symbol.second.label)
+                assembly.addresses[symbol.first] = symbol.second.value;
+        }
+        return assembly;
+    }
+
+private:
+    struct Symbol {
+        uint16_t value;
+        bool redefinable; // SET and DEFL
+        bool label;
+        bool known; // false for an EQU of a label further on in the first pass
+    };
+
+    [[noreturn]] void fail(const std::string& message) const {
+        throw std::runtime_error(name + ":" + std::to_string(lineNumber) + ": " + message);
+    }
+
+    // The value of an expression, symbols that are not defined yet are 0 in the first pass
+    uint16_t value(const std::string& text, const bool& now = false) {
+        if (trim(text).empty())
+            fail("missing operand");
+        resolved = true;
+        const Expression::Lookup lookup = [&](const std::string& symbol) -> uint16_t {
+            const auto found = symbols.find(symbol);
+            if (found != symbols.end() && (pass == 2 || (defined.count(symbol) != 0 && found->second.known)))
+                return found->second.value;
+            if (pass == 2)
+                throw std::runtime_error("undefined symbol " + symbol);
+            resolved = false;
+            return 0;
+        };
+        uint16_t result = 0;
+        try {
+            result = Expression(text, pc, lookup).evaluate();
+        } catch (std::runtime_error& e) {
+            fail(e.what());
+        }
+        if (now && !resolved)
+            fail("symbols in " + text + " must be defined before it");
+        return result;
+    }
+
+    uint8_t byte(const std::string& text) {
+        const uint16_t result = value(text);
+        if (result > 0xFF && result < 0xFF80) // -128 to 255
+            fail("value " + text + " does not fit in a byte");
+        return result & 0xFF;
+    }
+
+    void define(const std::string& symbol, const uint16_t& result, const bool& redefinable, const bool& label, const bool& known = true) {
+        const std::string key = upper(symbol);
+        const auto found = symbols.find(key);
+        if (defined.count(key) != 0 && !(redefinable && found->second.redefinable))
+            fail("duplicate symbol " + symbol);
+        if (pass == 2 && label && found != symbols.end() && found->second.value != result)
+            fail("the address of " + symbol + " changed between passes");
+        symbols[key] = {result, redefinable, label, known};
+        defined.insert(key);
+    }
+
+    void emit(const uint8_t& data) {
+        if (pass == 2) {
+            memory[pc] = data;
+            lowest = std::min<long>(lowest, pc);
+            highest = std::max<long>(highest, pc);
+        }
+        pc = static_cast<uint16_t>(pc + 1);
+    }
+
+    void word(const uint16_t& data) {
+        emit(data & 0xFF);
+        emit(data >> 8);
+    }
+
+    uint8_t registerOf(const std::string& text) {
+        static const std::string names = "BCDEHLMA";
+        const std::string name = upper(trim(text));
+        if (name.size() == 1 && names.find(name) != std::string::npos)
+            return static_cast<uint8_t>(names.find(name));
+        const uint16_t number = value(text);
+        if (number > 7)
+            fail("expected a register, given " + text);
+        return static_cast<uint8_t>(number);
+    }
+
+    uint8_t pairOf(const std::string& text, const bool& psw) {
+        const std::string name = upper(trim(text));
+        if (name == "B" || name == "BC") return 0;
+        if (name == "D" || name == "DE") return 1;
+        if (name == "H" || name == "HL") return 2;
+        if (name == (psw ? "PSW" : "SP")) return 3;
+        fail("expected a register pair, given " + text);
+    }
+
+    void operands(const std::vector<std::string>& given, const std::size_t& count, const std::string& mnemonic) {
+        if (given.size() != count)
+            fail(mnemonic + " takes " + std::to_string(count) + " operands");
+    }
+
+    void instruction(const Instruction& op, const std::string& mnemonic, const std::vector<std::string>& args) {
+        switch (op.form) {
+            case Form::Implied:
+                operands(args, 0, mnemonic);
+                emit(op.opcode);
+                break;
+            case Form::Move: {
+                operands(args, 2, mnemonic);
+                const uint8_t destination = registerOf(args[0]);
+                const uint8_t source = registerOf(args[1]);
+                if (destination == 6 && source == 6)
+                    fail("MOV M,M is HLT");
+                emit(static_cast<uint8_t>(op.opcode | destination << 3 | source));
+                break;
+            }
+            case Form::MoveImmediate:
+                operands(args, 2, mnemonic);
+                emit(static_cast<uint8_t>(op.opcode | registerOf(args[0]) << 3));
+                emit(byte(args[1]));
+                break;
+            case Form::Source:
+                operands(args, 1, mnemonic);
+                emit(static_cast<uint8_t>(op.opcode | registerOf(args[0])));
+                break;
+            case Form::Destination:
+                operands(args, 1, mnemonic);
+                emit(static_cast<uint8_t>(op.opcode | registerOf(args[0]) << 3));
+                break;
+            case Form::Immediate:
+                operands(args, 1, mnemonic);
+                emit(op.opcode);
+                emit(byte(args[0]));
+                break;
+            case Form::LoadPair:
+                operands(args, 2, mnemonic);
+                emit(static_cast<uint8_t>(op.opcode | pairOf(args[0], false) << 4));
+                word(value(args[1]));
+                break;
+            case Form::Pair:
+            case Form::StackPair:
+                operands(args, 1, mnemonic);
+                emit(static_cast<uint8_t>(op.opcode | pairOf(args[0], op.form == Form::StackPair) << 4));
+                break;
+            case Form::IndirectPair: {
+                operands(args, 1, mnemonic);
+                const uint8_t pair = pairOf(args[0], false);
+                if (pair > 1)
+                    fail(mnemonic + " only takes B or D");
+                emit(static_cast<uint8_t>(op.opcode | pair << 4));
+                break;
+            }
+            case Form::Address:
+                operands(args, 1, mnemonic);
+                emit(op.opcode);
+                word(value(args[0]));
+                break;
+            case Form::Restart: {
+                operands(args, 1, mnemonic);
+                const uint16_t number = value(args[0]);
+                if (number > 7)
+                    fail("RST takes 0 to 7");
+                emit(static_cast<uint8_t>(op.opcode | number << 3));
+                break;
+            }
+        }
+    }
+
+    // The lines from index to the ENDM closing the block that starts before it, index is left after the ENDM
+    std::vector<std::string> body(const std::vector<std::string>& lines, std::size_t& index) {
+        std::vector<std::string> collected;
+        int depth = 1;
+        for (++index; index < lines.size(); index++) {
+            const std::string mnemonic = split(stripComment(lines[index])).mnemonic;
+            if (mnemonic == "MACRO" || mnemonic == "REPT" || mnemonic == "IRP" || mnemonic == "IRPC")
+                ++depth;
+            else if (mnemonic == "ENDM" && --depth == 0)
+                return collected;
+            collected.push_back(lines[index]);
+        }
+        fail("missing ENDM");
+    }
+
+    // A macro's body with the arguments in place of its parameters, & only separates a parameter from the text
+    std::vector<std::string> expand(const Macro& macro, const std::vector<std::string>& args) {
+        std::vector<std::string> expanded;
+        for (const std::string& line : macro.body) {
+            std::string out;
+            for (std::size_t i = 0; i < line.size();) {
+                const char c = line[i];
+                if (quote(c)) {
+                    std::size_t end = line.size();
+                    try {
+                        end = stringEnd(line, i);
+                    } catch (std::runtime_error&) {
+                        // a lone quote in a comment
+                    }
+                    out += line.substr(i, end - i);
+                    i = end;
+                }
+                else if (c == ';') {
+                    break;
+                }
+                else if (std::isdigit(static_cast<unsigned char>(c))) {
+                    const std::size_t begin = i;
+                    while (i < line.size() && std::isalnum(static_cast<unsigned char>(line[i])))
+                        ++i;
+                    out += line.substr(begin, i - begin);
+                }
+                else if (symbolStart(c)) {
+                    const std::size_t begin = i;
+                    while (i < line.size() && symbolChar(line[i]) && line[i] != '$')
+                        ++i;
+                    const std::string word = line.substr(begin, i - begin);
+                    const auto parameter = std::find(macro.parameters.begin(), macro.parameters.end(), upper(word));
+                    if (parameter == macro.parameters.end())
+                        out += word;
+                    else if (static_cast<std::size_t>(parameter - macro.parameters.begin()) < args.size())
+                        out += args[static_cast<std::size_t>(parameter - macro.parameters.begin())];
+                }
+                else {
+                    if (c != '&')
+                        out += c;
+                    ++i;
+                }
+            }
+            expanded.push_back(out);
+        }
+        return expanded;
+    }
+
+    void block(const std::vector<std::string>& lines, const bool& source) {
+        for (std::size_t index = 0; index < lines.size() && !ended; index++) {
+            if (source)
+                lineNumber = index + 1;
+            Line line;
+            try {
+                line = split(stripComment(lines[index]));
+            } catch (std::runtime_error& e) {
+                fail(e.what());
+            }
+            const std::string& mnemonic = line.mnemonic;
+
+            // conditional assembly, lines are only looked at for nested IFs while skipping
+            const bool active = std::find(conditions.begin(), conditions.end(), false) == conditions.end();
+            if (mnemonic == "IF" || mnemonic == "IFT") {
+                conditions.push_back(active && value(line.operands, true) != 0);
+                continue;
+            }
+            if (mnemonic == "ELSE") {
+                if (conditions.empty())
+                    fail("ELSE without IF");
+                const bool outer = std::find(conditions.begin(), conditions.end() - 1, false) == conditions.end() - 1;
+                conditions.back() = outer && !conditions.back();
+                continue;
+            }
+            if (mnemonic == "ENDIF") {
+                if (conditions.empty())
+                    fail("ENDIF without IF");
+                conditions.pop_back();
+                continue;
+            }
+            if (!active)
+                continue;
+
+            if (mnemonic == "MACRO") {
+                if (line.label.empty())
+                    fail("a macro needs a name");
+                Macro macro;
+                for (const std::string& parameter : splitOperands(line.operands)) {
+                    macro.parameters.push_back(upper(parameter));
+                }
+                macro.body = body(lines, index);
+                macros[upper(line.label)] = macro;
+                continue;
+            }
+            if (mnemonic == "REPT") {
+                if (!line.label.empty())
+                    define(line.label, pc, false, true);
+                const uint16_t count = value(line.operands, true);
+                const std::vector<std::string> repeated = body(lines, index);
+                for (uint16_t i = 0; i != count && !ended; i++) {
+                    block(repeated, false);
+                }
+                continue;
+            }
+            if (mnemonic == "ENDM")
+                fail("ENDM without MACRO or REPT");
+
+            // names that are not addresses
+            if (mnemonic == "EQU" || mnemonic == "SET" || mnemonic == "DEFL") {
+                if (line.label.empty())
+                    fail(mnemonic + " needs a name");
+                const uint16_t result = value(line.operands);
+                define(line.label, result, mnemonic != "EQU", false, resolved);
+                continue;
+            }
+            if (!line.label.empty())
+                define(line.label, pc, false, true);
+            if (mnemonic.empty() || ignored.count(mnemonic) != 0)
+                continue;
+
+            const auto macro = macros.find(mnemonic);
+            if (macro != macros.end()) {
+                block(expand(macro->second, splitOperands(line.operands)), false);
+                continue;
+            }
+            std::vector<std::string> args;
+            try {
+                args = splitOperands(line.operands);
+            } catch (std::runtime_error& e) {
+                fail(e.what());
+            }
+            if (mnemonic == "ORG") {
+                operands(args, 1, mnemonic);
+                pc = value(args[0], true);
+            }
+            else if (mnemonic == "END") {
+                if (!args.empty())
+                    entry = value(args[0]);
+                ended = true;
+            }
+            else if (mnemonic == "DB" || mnemonic == "DEFB" || mnemonic == "DEFM") {
+                if (args.empty())
+                    fail(mnemonic + " needs data");
+                for (const std::string& arg : args) {
+                    std::string text;
+                    if (stringOperand(arg, text) && text.size() != 1) {
+                        for (const char& c : text) {
+                            emit(static_cast<uint8_t>(c));
+                        }
+                    }
+                    else {
+                        emit(byte(arg));
+                    }
+                }
+            }
+            else if (mnemonic == "DW" || mnemonic == "DEFW") {
+                if (args.empty())
+                    fail(mnemonic + " needs data");
+                for (const std::string& arg : args) {
+                    word(value(arg));
+                }
+            }
+            else if (mnemonic == "DS" || mnemonic == "DEFS") {
+                if (args.empty() || args.size() > 2)
+                    fail(mnemonic + " takes a size and a fill");
+                const uint16_t size = value(args[0], true);
+                const uint8_t fill = args.size() == 2 ? byte(args[1]) : 0;
+                for (uint16_t i = 0; i != size; i++) {
+                    emit(fill);
+                }
+            }
+            else {
+                const auto found = instructions.find(mnemonic);
+                if (found == instructions.end())
+                    fail("unknown instruction " + mnemonic);
+                const uint16_t before = pc;
+                instruction(found->second, mnemonic, args);
+                if (static_cast<uint16_t>(pc - before) != sizeOf(found->second.form))
+                    fail("internal error, " + mnemonic + " has the wrong size");
+            }
+        }
+    }
+
+    const uint16_t origin;
+    const std::string name;
+    int pass = 1;
+    uint16_t pc = 0;
+    bool ended = false;
+    std::size_t lineNumber = 0;
+    long entry = -1;
+    bool resolved = true; // every symbol of the last expression had its value
+    std::map<std::string, Symbol> symbols;
+    std::set<std::string> defined; // in this pass
+    std::map<std::string, Macro> macros;
+    std::vector<bool> conditions; // of the IFs around the line
+    std::vector<uint8_t> memory = std::vector<uint8_t>(0x10000, 0);
+    long lowest = 0x10000;
+    long highest = -1;
+};
+
+Assembly Assembly::fromSource(const std::string& source, const uint16_t& origin, const std::string& name) {
+    std::vector<std::string> lines;
+    std::istringstream iss(source);
+    for (std::string line; std::getline(iss, line);) {
+        lines.push_back(line);
+    }
+    return Assembler(origin, name).assemble(lines);
+}
+
+Assembly Assembly::fromFile(const std::string& fname, const uint16_t& origin) {
+    std::ifstream ifs(fname);
+    if (!ifs.good())
+        throw std::runtime_error("Source file not found, given path:" + fname);
+    std::ostringstream source;
+    source << ifs.rdbuf();
+    return fromSource(source.str(), origin, fname);
+}
+
+uint16_t Assembly::symbol(const std::string& name) const {
+    const auto found = values.find(upper(name));
+    if (found == values.end())
+        throw std::runtime_error("Symbol not defined, given name:" + name);
+    return found->second;
+}
+
+Symbols Assembly::labels() const {
+    Symbols labels;
+    for (const auto& label : addresses) {
+        labels.add(label.second, label.first);
+    }
+    return labels;
+}
+
+void Assembly::load(State8080& state) const {
+    for (std::size_t i = 0; i != image.size(); i++) {
+        state.memory[static_cast<uint16_t>(first + i)] = image[i];
+    }
+}
+
+void Assembly::toFile(const std::string& fname) const {
+    std::ofstream ofs(fname, std::ios_base::binary);
+    if (!ofs.good())
+        throw std::runtime_error("Unable to open file for writing, given path:" + fname);
+    ofs.write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(image.size()));
+    ofs.close();
+    if (!ofs.good())
+        throw std::runtime_error("Unable to write the program, given path:" + fname);
+}
@@ -0,0 +1,266 @@
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+#include "AudioMixer.hpp"
+
+constexpr int AudioMixer::sampleRate;
+constexpr uint64_t AudioMixer::cpuClock;
+
+const std::array<const char*, AudioMixer::SoundCount> AudioMixer::fileNames = {{
+    "Ufo.wav", "Shot.wav", "BaseHit.wav", "InvHit.wav",
+    "Walk1.wav", "Walk2.wav", "Walk3.wav", "Walk4.wav", "UfoHit.wav"
+}};
+
+AudioMixer::AudioMixer(std::size_t latency_) : latency(latency_) {
+    // offline rendering keeps cycle 0 at sample 0 so triggers land where they were emulated
+    anchored = latency == 0;
+    // the ufo constantly loops until it is stopped, it is also quieter than the other sounds
+    channels[Ufo].loops = true;
+    channels[Ufo].volume = 84;
+}
+
+void AudioMixer::setSample(const Sound& sound, PcmBuffer pcm) {
+    std::lock_guard<std::mutex> lock(mutex);
+    channels[sound].pcm = std::move(pcm);
+    voices[sound] = Voice();
+}
+
+void AudioMixer::loadSamples(const std::string& directory) {
+    for (std::size_t i = 0; i != SoundCount; i++) {
+        setSample(static_cast<Sound>(i), wavFromFile(directory + "/" + fileNames[i]));
+    }
+}
+
+void AudioMixer::portWrite(const uint8_t& port, const uint8_t& value, const uint64_t& cycle) {
+    auto rising = [&](const uint8_t& last, const uint8_t& bit) {
+        return (value & bit) && !(last & bit);
+    };
+    if (port == 3 && value != lastPort3) {
+        // UFO sounds, they constantly loop, all other sounds are different in that they only play once
+        if (rising(lastPort3, 0x1))
+            play(Ufo, cycle);
+        else if (!(value & 0x1) && (lastPort3 & 0x1))
+            stop(Ufo, cycle);
+
+        if (rising(lastPort3, 0x2)) play(Shot, cycle);
+        if (rising(lastPort3, 0x4)) play(BaseHit, cycle);
+        if (rising(lastPort3, 0x8)) play(InvHit, cycle);
+        lastPort3 = value;
+    }
+    else if (port == 5 && value != lastPort5) {
+        if (rising(lastPort5, 0x1)) play(Walk1, cycle);
+        if (rising(lastPort5, 0x2)) play(Walk2, cycle);
+        if (rising(lastPort5, 0x4)) play(Walk3, cycle);
+        if (rising(lastPort5, 0x8)) play(Walk4, cycle);
+        if (rising(lastPort5, 0x10)) play(UfoHit, cycle);
+        lastPort5 = value;
+    }
+}
+
+void AudioMixer::play(const Sound& sound, const uint64_t& cycle) {
+    schedule(sound, Action::Play, cycle);
+}
+
+void AudioMixer::stop(const Sound& sound, const uint64_t& cycle) {
+    schedule(sound, Action::Stop, cycle);
+}
+
+void AudioMixer::setMuted(bool muted_) {
+    std::lock_guard<std::mutex> lock(mutex);
+    muted = muted_;
+    if (muted) {
+        events.clear();
+        voices.fill(Voice());
+    }
+}
+
+uint64_t AudioMixer::cycleToSample(const uint64_t& cycle) const noexcept {
+    return anchorSample + (cycle - anchorCycle) * sampleRate / cpuClock;
+}
+
+void AudioMixer::schedule(const Sound& sound, const Action& action, const uint64_t& cycle) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (muted)
+        return;
+    uint64_t target = cycleToSample(cycle);
+    // When playing live the emulator and the audio device drift apart, when a trigger would land
+    // in the past or too far ahead, emulated time is resynced so it lands after the fixed latency
+    if (latency != 0 && (!anchored || cycle < anchorCycle || target < position || target > position + 4 * latency)) {
+        anchored = true;
+        anchorCycle = cycle;
+        anchorSample = position + latency;
+        target = anchorSample;
+    }
+    // triggers normally arrive in order, keep the queue sorted when they don't
+    Event event {target, sound, action};
+    auto it = std::upper_bound(events.begin(), events.end(), event, [](const Event& lhs, const Event& rhs) {
+        return lhs.position < rhs.position;
+    });
+    events.insert(it, event);
+}
+
+void AudioMixer::render(int16_t* out, std::size_t frames) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::size_t done = 0;
+    while (done != frames) {
+        const uint64_t now = position + done;
+        // start or stop the voices whose events are due, late events are applied immediately
+        while (!events.empty() && events.front().position <= now) {
+            const Event& event = events.front();
+            Voice& voice = voices[event.sound];
+            voice.active = event.action == Action::Play && !channels[event.sound].pcm.empty();
+            voice.offset = 0;
+            events.pop_front();
+        }
+        // mix up to the next event so it starts on its exact sample
+        std::size_t next = frames;
+        if (!events.empty())
+            next = static_cast<std::size_t>(std::min<uint64_t>(frames, done + (events.front().position - now)));
+        mix(out + done, next - done);
+        done = next;
+    }
+    position += frames;
+}
+
+void AudioMixer::renderUntil(const uint64_t& cycle, PcmBuffer& out) {
+    uint64_t target = cycleToSample(cycle);
+    if (target <= position)
+        return;
+    std::size_t frames = static_cast<std::size_t>(target - position);
+    std::size_t start = out.size();
+    out.resize(start + frames);
+    render(out.data() + start, frames);
+}
+
+void AudioMixer::mix(int16_t* out, std::size_t frames) {
+    accumulator.assign(frames, 0);
+    for (std::size_t i = 0; i != SoundCount; i++) {
+        Voice& voice = voices[i];
+        const Channel& channel = channels[i];
+        std::size_t done = 0;
+        while (voice.active && done != frames) {
+            std::size_t count = std::min(frames - done, channel.pcm.size() - voice.offset);
+            const int16_t* pcm = channel.pcm.data() + voice.offset;
+            int32_t* acc = accumulator.data() + done;
+            for (std::size_t j = 0; j != count; j++) {
+                acc[j] += (pcm[j] * channel.volume) >> 8;
+            }
+            done += count;
+            voice.offset += count;
+            if (voice.offset == channel.pcm.size()) {
+                voice.offset = 0;
+                voice.active = channel.loops;
+            }
+        }
+    }
+    for (std::size_t j = 0; j != frames; j++) {
+        out[j] = static_cast<int16_t>(std::max(-32768, std::min(32767, accumulator[j])));
+    }
+}
+
+
+/// WAV FILES
+
+
+namespace {
+
+uint32_t readLE(const uint8_t* data, int bytes) {
+    uint32_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+void writeLE(std::ostream& os, uint32_t value, int bytes) {
+    for (int i = 0; i != bytes; i++) {
+        os.put(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+} // namespace
+
+PcmBuffer decodeWav(const uint8_t* data, std::size_t size) {
+    if (size < 12 || std::memcmp(data, "RIFF", 4) != 0 || std::memcmp(data + 8, "WAVE", 4) != 0)
+        throw std::runtime_error("Not a wav file");
+
+    uint32_t channels = 0, rate = 0, bits = 0;
+    const uint8_t* samples = nullptr;
+    std::size_t sampleBytes = 0;
+    // walk the chunks, only fmt and data are needed
+    for (std::size_t i = 12; i + 8 <= size;) {
+        uint32_t chunkSize = readLE(data + i + 4, 4);
+        const uint8_t* chunk = data + i + 8;
+        if (chunkSize > size - i - 8)
+            chunkSize = static_cast<uint32_t>(size - i - 8);
+        if (std::memcmp(data + i, "fmt ", 4) == 0 && chunkSize >= 16) {
+            if (readLE(chunk, 2) != 1)
+                throw std::runtime_error("Only uncompressed wav files are supported");
+            channels = readLE(chunk + 2, 2);
+            rate = readLE(chunk + 4, 4);
+            bits = readLE(chunk + 14, 2);
+        }
+        else if (std::memcmp(data + i, "data", 4) == 0) {
+            samples = chunk;
+            sampleBytes = chunkSize;
+        }
+        i += 8 + chunkSize + (chunkSize & 1);
+    }
+    if (samples == nullptr || channels == 0 || rate == 0 || (bits != 8 && bits != 16))
+        throw std::runtime_error("Wav file is missing its format or data");
+
+    // convert to 16 bit mono, only the first channel is kept
+    const std::size_t frameBytes = channels * bits / 8;
+    const std::size_t inFrames = sampleBytes / frameBytes;
+    std::vector<int32_t> mono(inFrames);
+    for (std::size_t i = 0; i != inFrames; i++) {
+        const uint8_t* frame = samples + i * frameBytes;
+        mono[i] = bits == 8 ? (static_cast<int32_t>(frame[0]) - 128) * 256 : static_cast<int16_t>(readLE(frame, 2));
+    }
+
+    // linear resample to the mixer's rate
+    const std::size_t outFrames = static_cast<std::size_t>(static_cast<uint64_t>(inFrames) * AudioMixer::sampleRate / rate);
+    PcmBuffer pcm(outFrames);
+    for (std::size_t i = 0; i != outFrames; i++) {
+        uint64_t fixed = (static_cast<uint64_t>(i) * rate << 16) / AudioMixer::sampleRate; // 16.16 position in the input
+        std::size_t index = static_cast<std::size_t>(fixed >> 16);
+        int64_t fraction = static_cast<int64_t>(fixed & 0xFFFF);
+        int64_t a = mono[index];
+        int64_t b = index + 1 < inFrames ? mono[index + 1] : a;
+        pcm[i] = static_cast<int16_t>(a + (((b - a) * fraction) >> 16)); // b - a times the fraction can pass 32 bits
+    }
+    return pcm;
+}
+
+PcmBuffer wavFromFile(const std::string& fname) {
+    std::ifstream ifs(fname, std::ios_base::binary);
+    if (!ifs.good())
+        throw std::runtime_error("File not found, given path:" + fname);
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    return decodeWav(bytes.data(), bytes.size());
+}
+
+void wavToFile(const std::string& fname, const PcmBuffer& pcm, int rate) {
+    std::ofstream ofs(fname, std::ios_base::binary);
+    if (!ofs.good())
+        throw std::runtime_error("Unable to open file for writing, given path:" + fname);
+    const uint32_t dataBytes = static_cast<uint32_t>(pcm.size() * sizeof(int16_t));
+    ofs.write("RIFF", 4);
+    writeLE(ofs, 36 + dataBytes, 4);
+    ofs.write("WAVEfmt ", 8);
+    writeLE(ofs, 16, 4);
+    writeLE(ofs, 1, 2); // PCM
+    writeLE(ofs, 1, 2); // mono
+    writeLE(ofs, static_cast<uint32_t>(rate), 4);
+    writeLE(ofs, static_cast<uint32_t>(rate) * 2, 4); // bytes per second
+    writeLE(ofs, 2, 2); // bytes per frame
+    writeLE(ofs, 16, 2);
+    ofs.write("data", 4);
+    writeLE(ofs, dataBytes, 4);
+    for (const int16_t& sample : pcm) {
+        writeLE(ofs, static_cast<uint16_t>(sample), 2);
+    }
+}
@@ -0,0 +1,128 @@
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "BranchState.hpp"
+#include "FrameHash.hpp"
+
+namespace {
+
+BranchState::PagePtr makePage(const uint8_t* bytes) {
+    std::shared_ptr<BranchState::Page> page = std::make_shared<BranchState::Page>();
+    std::memcpy(page->bytes.data(), bytes, State8080::pageSize);
+    page->hash = xxhash64(bytes, State8080::pageSize);
+    return page;
+}
+
+} // namespace
+
+BranchState::BranchState(const SpaceInvaders& machine) : header(Snapshot::captureRegisters(machine)) {
+    // most of the address space is the same few pages, zeros and mirrors
+    std::unordered_multimap<uint64_t, PagePtr> made;
+    for (std::size_t page = 0; page != State8080::pageCount; page++) {
+        const uint8_t* bytes = machine.state.memory.data() + page * State8080::pageSize;
+        const uint64_t hash = xxhash64(bytes, State8080::pageSize);
+        const auto range = made.equal_range(hash);
+        for (auto it = range.first; it != range.second && pages[page] == nullptr; ++it) {
+            if (std::memcmp(it->second->bytes.data(), bytes, State8080::pageSize) == 0)
+                pages[page] = it->second;
+        }
+        if (pages[page] == nullptr) {
+            pages[page] = makePage(bytes);
+            made.emplace(hash, pages[page]);
+        }
+    }
+    rehash();
+}
+
+void BranchState::discard() noexcept {
+    for (PagePtr& page : pages) {
+        page.reset();
+    }
+    header = {};
+    digest = 0;
+}
+
+std::size_t BranchState::sharedPages(const BranchState& other) const noexcept {
+    std::size_t shared = 0;
+    for (std::size_t page = 0; page != State8080::pageCount; page++) {
+        if (pages[page] != nullptr && pages[page] == other.pages[page])
+            ++shared;
+    }
+    return shared;
+}
+
+bool BranchState::operator==(const BranchState& other) const noexcept {
+    if (digest != other.digest || std::memcmp(&header, &other.header, sizeof header) != 0 || empty() != other.empty())
+        return false;
+    for (std::size_t page = 0; page != State8080::pageCount && !empty(); page++) {
+        const Page* mine = pages[page].get();
+        const Page* theirs = other.pages[page].get();
+        if (mine != theirs && (mine->hash != theirs->hash || mine->bytes != theirs->bytes))
+            return false;
+    }
+    return true;
+}
+
+void BranchState::rehash() noexcept {
+    std::array<uint64_t, State8080::pageCount + 1> hashes;
+    for (std::size_t page = 0; page != State8080::pageCount; page++) {
+        hashes[page] = pages[page]->hash;
+    }
+    hashes.back() = xxhash64(reinterpret_cast<const uint8_t*>(&header), sizeof header);
+    digest = xxhash64(reinterpret_cast<const uint8_t*>(hashes.data()), sizeof hashes);
+}
+
+void Brancher::load(const BranchState& state) {
+    if (state.empty())
+        throw std::runtime_error("Unable to load an empty branch state");
+    State8080& memory = working.state;
+    for (std::size_t page = 0; page != State8080::pageCount; page++) {
+        if (loaded[page] != state.pages[page] || memory.dirtyPages[page]) {
+            std::memcpy(memory.memory.data() + page * State8080::pageSize, state.pages[page]->bytes.data(), State8080::pageSize);
+            ++copied;
+        }
+    }
+    loaded = state.pages;
+    memory.dirtyPages.reset();
+    Snapshot::restoreRegisters(state.header, working);
+}
+
+BranchState Brancher::step(const BranchState& from, const Advance& advance) {
+    load(from);
+    advance(working);
+
+    const State8080& state = working.state;
+    BranchState next;
+    next.header = Snapshot::captureRegisters(working);
+    for (std::size_t page = 0; page != State8080::pageCount; page++) {
+        const uint8_t* bytes = state.memory.data() + page * State8080::pageSize;
+        if (!state.dirtyPages[page] || std::memcmp(bytes, from.pages[page]->bytes.data(), State8080::pageSize) == 0) {
+            next.pages[page] = from.pages[page];
+        }
+        else {
+            next.pages[page] = makePage(bytes);
+            ++made;
+        }
+    }
+    next.rehash();
+    loaded = next.pages;
+    working.state.dirtyPages.reset();
+    return next;
+}
+
+bool BranchSet::insert(const BranchState& state) {
+    if (contains(state))
+        return false;
+    states.emplace(state.hash(), state);
+    return true;
+}
+
+bool BranchSet::contains(const BranchState& state) const {
+    const auto range = states.equal_range(state.hash());
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == state)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <cstdio>
+
+#include "CallGraph.hpp"
+#include "OpcodeInfo.hpp"
+
+constexpr std::size_t CallGraph::maxDepth;
+
+CallGraph::CallGraph() {
+    clear();
+}
+
+void CallGraph::clear() {
+    tree.assign(1, Node {0, false, 0, 0, 0, {}});
+    frames.clear();
+    current = 0;
+    started = false;
+}
+
+void CallGraph::executed(const State8080& state, const uint16_t& pc, const uint16_t& sp, const uint64_t& startCycle) {
+    if (!started) { // the root is whatever was running when profiling started
+        tree[0].entry = pc;
+        started = true;
+    }
+    tree[current].selfCycles += state.cycleCount - startCycle;
+
+    const uint8_t opcode = state.memory[pc];
+    switch (opcodeInfo[opcode].branch) {
+        case OpcodeInfo::Call: case OpcodeInfo::Restart:
+            if (state.stackPointer != sp) // conditional calls that are not taken push nothing
+                enter(state.programCounter, state.stackPointer, false);
+            break;
+        case OpcodeInfo::Return:
+            if (state.stackPointer != sp)
+                leave(sp);
+            break;
+        case OpcodeInfo::Jump:
+            if (opcode == 0xE9) // PCHL
+                enter(state.programCounter, state.stackPointer, false);
+            break;
+        default:
+            // LXI SP and SPHL abandon the frames above the new stack
+            if (opcode == 0x31 || opcode == 0xF9) {
+                while (!frames.empty() && frames.back().sp < state.stackPointer)
+                    frames.pop_back();
+                current = frames.empty() ? 0 : frames.back().node;
+            }
+            break;
+    }
+}
+
+void CallGraph::interrupted(const State8080& state, const uint64_t& startCycle) {
+    if (!started) {
+        tree[0].entry = state.programCounter;
+        started = true;
+    }
+    enter(state.programCounter, state.stackPointer, true);
+    tree[current].selfCycles += state.cycleCount - startCycle;
+}
+
+void CallGraph::enter(const uint16_t& entry, const uint16_t& sp, bool interrupt) {
+    if (frames.size() == maxDepth)
+        return;
+    // a handler's cycles are its own, not the cost of whatever routine it interrupted
+    const uint32_t parent = interrupt ? 0 : current;
+    uint32_t child = 0;
+    auto& children = tree[parent].children;
+    const auto found = std::find_if(children.begin(), children.end(), [&](const std::pair<uint16_t, uint32_t>& pair) {
+        return pair.first == entry;
+    });
+    if (found != children.end()) {
+        child = found->second;
+    }
+    else {
+        child = static_cast<uint32_t>(tree.size());
+        children.emplace_back(entry, child);
+        tree.push_back(Node {entry, interrupt, parent, 0, 0, {}}); // may move the nodes, children is not used after
+    }
+    ++tree[child].calls;
+    frames.push_back({child, sp});
+    current = child;
+}
+
+void CallGraph::leave(const uint16_t& sp) {
+    while (!frames.empty() && frames.back().sp <= sp)
+        frames.pop_back();
+    current = frames.empty() ? 0 : frames.back().node;
+}
+
+std::string CallGraph::name(const Node& node, const Symbols& symbols) const {
+    if (node.interrupt && symbols.find(node.entry) == nullptr) {
+        char text[16];
+        std::snprintf(text, sizeof text, "int_%04X", node.entry);
+        return text;
+    }
+    return symbols.label(node.entry);
+}
+
+std::vector<CallGraph::Routine> CallGraph::routines(const Symbols& symbols) const {
+    // children always come after their parent, so one pass from the back sums the inclusive cycles
+    std::vector<uint64_t> inclusive(tree.size());
+    for (std::size_t i = tree.size(); i-- != 0;) {
+        inclusive[i] += tree[i].selfCycles;
+        if (i != 0)
+            inclusive[tree[i].parent] += inclusive[i];
+    }
+
+    std::map<uint16_t, Routine> perEntry;
+    for (std::size_t i = 0; i != tree.size(); i++) {
+        const Node& node = tree[i];
+        auto inserted = perEntry.emplace(node.entry, Routine {node.entry, name(node, symbols), 0, 0, 0});
+        Routine& routine = inserted.first->second;
+        routine.calls += node.calls;
+        routine.exclusive += node.selfCycles;
+        // a routine that calls itself is already counted in its outermost call
+        bool recursive = false;
+        for (std::size_t ancestor = i; ancestor != 0 && !recursive;) {
+            ancestor = tree[ancestor].parent;
+            recursive = tree[ancestor].entry == node.entry;
+        }
+        if (!recursive)
+            routine.inclusive += inclusive[i];
+    }
+
+    std::vector<Routine> result;
+    for (const auto& entry : perEntry) {
+        result.push_back(entry.second);
+    }
+    std::stable_sort(result.begin(), result.end(), [](const Routine& lhs, const Routine& rhs) {
+        return lhs.inclusive > rhs.inclusive;
+    });
+    return result;
+}
+
+void CallGraph::writeFolded(std::ostream& os, const Symbols& symbols) const {
+    std::vector<std::string> names(tree.size());
+    std::vector<std::string> paths(tree.size());
+    for (std::size_t i = 0; i != tree.size(); i++) {
+        names[i] = name(tree[i], symbols);
+        paths[i] = i == 0 ? names[i] : paths[tree[i].parent] + ';' + names[i];
+        if (tree[i].selfCycles != 0)
+            os << paths[i] << ' ' << tree[i].selfCycles << '\n';
+    }
+    os << std::flush;
+}
+
+void CallGraph::report(std::ostream& os, const Symbols& symbols, const uint64_t& framesRun, const std::size_t& top) const {
+    const std::vector<Routine> routineList = routines(symbols);
+    uint64_t total = 0;
+    for (const Node& node : tree) {
+        total += node.selfCycles;
+    }
+    os << "Call graph: " << total << " cycles over " << framesRun << " frames, " << routineList.size() << " routines, "
+       << tree.size() << " call chains\n";
+    if (total == 0) {
+        os << std::flush;
+        return;
+    }
+    const uint64_t perFrame = std::max<uint64_t>(framesRun, 1);
+    const std::ios_base::fmtflags flags = os.flags();
+    os << std::fixed << std::setprecision(2)
+       << "   inclusive   per frame       %   exclusive       %       calls  routine\n";
+    for (std::size_t i = 0; i != std::min(top, routineList.size()); i++) {
+        const Routine& routine = routineList[i];
+        os << std::setw(12) << routine.inclusive << std::setw(12) << routine.inclusive / perFrame << std::setw(8) << 100.0 * routine.inclusive / total
+           << std::setw(12) << routine.exclusive << std::setw(8) << 100.0 * routine.exclusive / total
+           << std::setw(12) << routine.calls << "  " << routine.name << '\n';
+    }
+    os.flags(flags);
+    os << std::flush;
+}
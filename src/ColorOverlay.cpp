@@ -0,0 +1,152 @@
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+
+#include "ColorOverlay.hpp"
+
+constexpr int ColorOverlay::rows;
+constexpr int ColorOverlay::columns;
+constexpr std::size_t ColorOverlay::size;
+constexpr std::size_t ColorOverlay::paletteSize;
+
+namespace {
+
+// Plain array so the table can be filled in a constexpr function
+struct OverlayTable {
+    uint8_t index[ColorOverlay::size];
+};
+
+enum : uint8_t { White = 0, Red = 1, Green = 2 };
+
+// Recall that the screen is rotated, x runs along a row of VRAM (bottom to top of the cabinet) and y is the row
+constexpr uint8_t midwayColor(const int x, const int y) {
+    if (x >= 256 - 64 && x <= 256 - 40) // the band the UFO travels in
+        return Red;
+    if (x <= 14) // lower strip, the two subdivisions that show the lives and credits are white instead of green
+        return (y >= 16 && y <= 134) ? Green : White;
+    if (x <= 72) // the bases and the player
+        return Green;
+    return White;
+}
+
+constexpr OverlayTable makeMidwayTable() {
+    OverlayTable table {};
+    for (int y = 0; y != ColorOverlay::rows; y++) {
+        for (int column = 0; column != ColorOverlay::columns; column++) {
+            table.index[y * ColorOverlay::columns + column] = midwayColor(column * 8, y);
+        }
+    }
+    return table;
+}
+
+constexpr OverlayTable midwayTable = makeMidwayTable();
+
+constexpr uint32_t opaque = 0xFF000000;
+
+uint32_t parseColor(const std::string& text) {
+    if (text.size() != 7 || text[0] != '#')
+        throw std::runtime_error("Overlay colour must be in the form #RRGGBB, given: " + text);
+    return opaque | static_cast<uint32_t>(std::stoul(text.substr(1), nullptr, 16));
+}
+
+} // namespace
+
+ColorOverlay::ColorOverlay() {
+    std::copy(std::begin(midwayTable.index), std::end(midwayTable.index), indices.begin());
+    palette.fill(opaque | 0xFFFFFF);
+    palette[Red] = opaque | 0xFF0000;
+    palette[Green] = opaque | 0x00FF00;
+    resolve();
+}
+
+ColorOverlay ColorOverlay::midway() {
+    return ColorOverlay();
+}
+
+ColorOverlay ColorOverlay::monochrome() {
+    ColorOverlay overlay;
+    overlay.indices.fill(White);
+    overlay.palette.fill(opaque | 0xFFFFFF);
+    overlay.resolve();
+    return overlay;
+}
+
+// Overlay files are plain text, one command per line, lines starting with # are comments:
+//   color <index> #RRGGBB                 set a palette entry, there are 8 entries all starting as white
+//   fill <index>                          set every byte to the palette entry
+//   rect <index> <x0> <x1> <y0> <y1>      set the bytes in the inclusive region, x is the pixel along the row
+//                                         and is taken at byte granularity, y is the row in VRAM
+// Later commands draw over earlier ones.
+ColorOverlay ColorOverlay::fromFile(const std::string& fname) {
+    std::ifstream ifs(fname);
+    if (!ifs.good())
+        throw std::runtime_error("Overlay file not found, given path:" + fname);
+
+    ColorOverlay overlay = monochrome();
+    std::string line;
+    for (std::size_t lineNum = 1; std::getline(ifs, line); lineNum++) {
+        std::istringstream iss(line);
+        std::string command;
+        if (!(iss >> command) || command[0] == '#')
+            continue;
+
+        auto fail = [&](const std::string& why) {
+            throw std::runtime_error(fname + ":" + std::to_string(lineNum) + ", " + why);
+        };
+        int index = 0;
+        if (!(iss >> index) || index < 0 || index >= static_cast<int>(paletteSize))
+            fail("palette index must be in [0, 7]");
+
+        if (command == "color") {
+            std::string color;
+            iss >> color;
+            overlay.palette[static_cast<std::size_t>(index)] = parseColor(color);
+        }
+        else if (command == "fill") {
+            overlay.indices.fill(static_cast<uint8_t>(index));
+        }
+        else if (command == "rect") {
+            int x0, x1, y0, y1;
+            if (!(iss >> x0 >> x1 >> y0 >> y1))
+                fail("rect requires x0 x1 y0 y1");
+            y0 = std::max(y0, 0);
+            y1 = std::min(y1, rows - 1);
+            for (int y = y0; y <= y1; y++) {
+                for (int column = 0; column != columns; column++) {
+                    if (column * 8 >= x0 && column * 8 <= x1)
+                        overlay.indices[static_cast<std::size_t>(y * columns + column)] = static_cast<uint8_t>(index);
+                }
+            }
+        }
+        else {
+            fail("unknown command " + command);
+        }
+    }
+    overlay.resolve();
+    return overlay;
+}
+
+void ColorOverlay::setIndex(const std::size_t& vramOffset, const uint8_t& index) {
+    if (vramOffset >= size || index >= paletteSize)
+        throw std::runtime_error("Overlay index out of range, given offset:" + std::to_string(vramOffset) + " index:" + std::to_string(index));
+    indices[vramOffset] = index;
+    colors[vramOffset] = palette[index];
+}
+
+void ColorOverlay::setPaletteColor(const std::size_t& index, const uint32_t& color) {
+    if (index >= paletteSize)
+        throw std::runtime_error("Overlay palette has 8 entries, given index:" + std::to_string(index));
+    palette[index] = color;
+    for (std::size_t i = 0; i != size; i++) {
+        if (indices[i] == index)
+            colors[i] = color;
+    }
+}
+
+void ColorOverlay::resolve() {
+    colors.resize(size);
+    for (std::size_t i = 0; i != size; i++) {
+        colors[i] = palette[indices[i]];
+    }
+}
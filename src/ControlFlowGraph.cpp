@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <map>
+#include <set>
+#include <tuple>
+#include <cstdio>
+
+#include "ControlFlowGraph.hpp"
+#include "OpcodeInfo.hpp"
+
+constexpr uint32_t ControlFlowGraph::none;
+
+namespace {
+
+std::string hex(const uint32_t& value, const int& digits) {
+    char text[8];
+    std::snprintf(text, sizeof text, "%0*X", digits, value);
+    return text;
+}
+
+// Names come from symbol files, quotes and backslashes are escaped the same way in dot and json
+std::string escaped(const std::string& text) {
+    std::string result;
+    for (const char& c : text) {
+        if (c == '"' || c == '\\')
+            result += '\\';
+        result += c;
+    }
+    return result;
+}
+
+std::string quoted(const std::string& text) {
+    return '"' + escaped(text) + '"';
+}
+
+std::string blockName(const ControlFlowGraph::Block& block, const Symbols& symbols) {
+    const std::string* name = symbols.find(block.start);
+    return name != nullptr ? *name : symbols.describe(block.start);
+}
+
+} // namespace
+
+const char* ControlFlowGraph::kindName(const Kind& kind) noexcept {
+    switch (kind) {
+        case Fallthrough: return "fallthrough";
+        case Jump: return "jump";
+        case Call: return "call";
+        case Return: return "return";
+        case Restart: return "restart";
+        case Indirect: return "indirect";
+    }
+    return "";
+}
+
+ControlFlowGraph::ControlFlowGraph(const Coverage& coverage) : coverage(coverage) {
+    std::set<uint16_t> leaders;
+    for (const auto& entry : coverage.entries()) {
+        leaders.insert(entry.first);
+    }
+    for (const auto& transfer : coverage.transfers()) {
+        const uint16_t from = static_cast<uint16_t>(transfer.first >> 16);
+        leaders.insert(static_cast<uint16_t>(transfer.first));
+        leaders.insert(static_cast<uint16_t>(from + opcodeInfo[coverage.code(from)].size));
+    }
+
+    bool open = false; // the last instruction falls through into the next address
+    uint32_t next = 0;
+    for (uint32_t address = 0; address != State8080::RAM; address++) {
+        if ((coverage.use(static_cast<uint16_t>(address)) & Coverage::Opcode) == 0)
+            continue;
+        if (!open || address != next || leaders.count(static_cast<uint16_t>(address)) != 0)
+            blockList.push_back({static_cast<uint16_t>(address), 0, 0, 0, coverage.executions(static_cast<uint16_t>(address))});
+        const OpcodeInfo& info = opcodeInfo[coverage.code(static_cast<uint16_t>(address))];
+        Block& block = blockList.back();
+        block.last = static_cast<uint16_t>(address);
+        ++block.instructions;
+        next = address + info.size;
+        block.end = next;
+        open = info.branch == OpcodeInfo::None;
+    }
+
+    std::map<std::tuple<uint32_t, uint32_t, Kind>, uint64_t> counts;
+    std::map<uint16_t, uint64_t> returnsTo;
+    for (const auto& transfer : coverage.transfers()) {
+        const uint16_t from = static_cast<uint16_t>(transfer.first >> 16);
+        const uint16_t to = static_cast<uint16_t>(transfer.first);
+        const uint8_t opcode = coverage.code(from);
+        const OpcodeInfo& info = opcodeInfo[opcode];
+        Kind kind = Jump;
+        if (info.conditional && to == static_cast<uint16_t>(from + info.size))
+            kind = Fallthrough; // not taken
+        else if (info.branch == OpcodeInfo::Call)
+            kind = Call;
+        else if (info.branch == OpcodeInfo::Restart)
+            kind = Restart;
+        else if (info.branch == OpcodeInfo::Return)
+            kind = Return;
+        else if (opcode == 0xE9)
+            kind = Indirect;
+        if (kind == Return)
+            returnsTo[to] += transfer.second;
+        const uint32_t fromBlock = find(from);
+        const uint32_t toBlock = find(to);
+        if (fromBlock != none && toBlock != none)
+            counts[std::make_tuple(fromBlock, toBlock, kind)] += transfer.second;
+    }
+    // a block falls into the next one unless it ends with a jump or a return, after a call when it returns
+    for (std::size_t i = 0; i + 1 < blockList.size(); i++) {
+        const Block& block = blockList[i];
+        if (block.end != blockList[i + 1].start)
+            continue;
+        const OpcodeInfo& info = opcodeInfo[coverage.code(block.last)];
+        uint64_t count = 0;
+        if (info.branch == OpcodeInfo::None)
+            count = coverage.executions(block.last);
+        else if (info.branch == OpcodeInfo::Call || info.branch == OpcodeInfo::Restart)
+            count = returnsTo[blockList[i + 1].start];
+        if (count != 0)
+            counts[std::make_tuple(static_cast<uint32_t>(i), static_cast<uint32_t>(i + 1), Fallthrough)] += count;
+    }
+    for (const auto& edge : counts) {
+        edgeList.push_back({std::get<0>(edge.first), std::get<1>(edge.first), std::get<2>(edge.first), edge.second});
+    }
+
+    for (const auto& entry : coverage.entries()) {
+        const uint32_t block = find(entry.first);
+        if (block != none)
+            entryList.push_back({block, entry.second});
+    }
+}
+
+uint32_t ControlFlowGraph::find(const uint16_t& address) const noexcept {
+    const auto after = std::upper_bound(blockList.begin(), blockList.end(), address, [](const uint16_t& value, const Block& block) {
+        return value < block.start;
+    });
+    if (after == blockList.begin() || address >= std::prev(after)->end)
+        return none;
+    return static_cast<uint32_t>(std::prev(after) - blockList.begin());
+}
+
+void ControlFlowGraph::writeDot(std::ostream& os, const Symbols& symbols) const {
+    os << "digraph cfg {\n"
+       << "    node [shape=box, fontname=\"monospace\", fontsize=10];\n"
+       << "    edge [fontname=\"monospace\", fontsize=9];\n";
+    for (const Block& block : blockList) {
+        os << "    b" << hex(block.start, 4) << " [label=\"" << escaped(blockName(block, symbols)) << "\\l0x" << hex(block.start, 4)
+           << "-0x" << hex(block.end - 1, 4) << ", " << block.instructions << " instructions\\lran " << block.executions << "\\l\"];\n";
+    }
+    for (const Entry& entry : entryList) {
+        const uint16_t start = blockList[entry.block].start;
+        os << "    e" << hex(start, 4) << " [shape=oval, label=\"entered " << entry.count << "\"];\n"
+           << "    e" << hex(start, 4) << " -> b" << hex(start, 4) << ";\n";
+    }
+    for (const Edge& edge : edgeList) {
+        os << "    b" << hex(blockList[edge.from].start, 4) << " -> b" << hex(blockList[edge.to].start, 4)
+           << " [label=\"" << edge.count << "\"";
+        switch (edge.kind) {
+            case Call: os << ", color=blue"; break;
+            case Return: os << ", color=gray, style=dashed"; break;
+            case Restart: os << ", color=purple"; break;
+            case Indirect: os << ", color=orange, style=dashed"; break;
+            default: break;
+        }
+        os << "];\n";
+    }
+    os << "}\n" << std::flush;
+}
+
+void ControlFlowGraph::writeJson(std::ostream& os, const Symbols& symbols, const uint16_t& start, const uint16_t& end) const {
+    os << "{\n  \"blocks\": [\n";
+    for (std::size_t i = 0; i != blockList.size(); i++) {
+        const Block& block = blockList[i];
+        std::string code;
+        std::string instructions;
+        for (uint32_t address = block.start; address < block.end; ) {
+            const uint8_t opcode = coverage.code(static_cast<uint16_t>(address));
+            const uint8_t low = coverage.code(static_cast<uint16_t>(address + 1));
+            const uint8_t high = coverage.code(static_cast<uint16_t>(address + 2));
+            const uint8_t size = opcodeInfo[opcode].size;
+            for (uint8_t j = 0; j != size; j++) {
+                code += hex(coverage.code(static_cast<uint16_t>(address + j)), 2);
+            }
+            instructions += (instructions.empty() ? "" : ", ") + quoted(disassemble(opcode, low, high));
+            address += size;
+        }
+        os << "    {\"id\": " << i << ", \"start\": " << block.start << ", \"end\": " << block.end
+           << ", \"name\": " << quoted(blockName(block, symbols)) << ", \"executions\": " << block.executions
+           << ", \"code\": \"" << code << "\", \"instructions\": [" << instructions << "]}"
+           << (i + 1 != blockList.size() ? ",\n" : "\n");
+    }
+    os << "  ],\n  \"edges\": [\n";
+    for (std::size_t i = 0; i != edgeList.size(); i++) {
+        const Edge& edge = edgeList[i];
+        os << "    {\"from\": " << edge.from << ", \"to\": " << edge.to << ", \"kind\": \"" << kindName(edge.kind)
+           << "\", \"count\": " << edge.count << "}" << (i + 1 != edgeList.size() ? ",\n" : "\n");
+    }
+    os << "  ],\n  \"entries\": [\n";
+    for (std::size_t i = 0; i != entryList.size(); i++) {
+        os << "    {\"block\": " << entryList[i].block << ", \"count\": " << entryList[i].count << "}"
+           << (i + 1 != entryList.size() ? ",\n" : "\n");
+    }
+    // runs of bytes used the same way
+    const char* useNames[4] = {"opcode", "operand", "read", "write"};
+    os << "  ],\n  \"map\": [\n";
+    for (uint32_t address = start; address <= end; ) {
+        const uint8_t use = coverage.use(static_cast<uint16_t>(address));
+        uint32_t last = address;
+        while (last < end && coverage.use(static_cast<uint16_t>(last + 1)) == use)
+            ++last;
+        std::string uses;
+        for (int i = 0; i != 4; i++) {
+            if ((use & (1 << i)) != 0)
+                uses += std::string(uses.empty() ? "" : ", ") + '"' + useNames[i] + '"';
+        }
+        os << "    {\"start\": " << address << ", \"end\": " << last << ", \"use\": [" << uses << "]}"
+           << (last != end ? ",\n" : "\n");
+        address = last + 1;
+    }
+    os << "  ]\n}\n" << std::flush;
+}
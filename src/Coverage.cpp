@@ -0,0 +1,298 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+
+#include "Coverage.hpp"
+#include "OpcodeInfo.hpp"
+
+constexpr uint32_t Coverage::version;
+
+namespace {
+
+const char coverageMagic[8] = {'8', '0', '8', '0', 'C', 'O', 'V', 'R'};
+constexpr std::size_t headerSize = 24;
+
+uint64_t readLE(const uint8_t* data, int bytes) {
+    uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+void writeLE(std::ostream& os, uint64_t value, int bytes) {
+    for (int i = 0; i != bytes; i++) {
+        os.put(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+std::string hex(const uint32_t& value, const int& digits) {
+    char text[8];
+    std::snprintf(text, sizeof text, "%0*X", digits, value);
+    return text;
+}
+
+} // namespace
+
+Coverage::Coverage() : counts(State8080::RAM) {
+    clear();
+}
+
+void Coverage::clear() {
+    uses.fill(0);
+    bytes.fill(0);
+    std::fill(counts.begin(), counts.end(), 0);
+    entered.clear();
+    edges.clear();
+    pending = false;
+    started = false;
+}
+
+void Coverage::sample(const State8080& state) {
+    const uint16_t pc = state.programCounter;
+    if (pending)
+        retire(pc, state.stackPointer);
+    else if (!started)
+        ++entered[pc];
+    started = true;
+
+    const uint8_t opcode = state.memory[pc];
+    const uint8_t size = opcodeInfo[opcode].size;
+    uses[pc] |= Opcode;
+    bytes[pc] = opcode;
+    for (uint8_t i = 1; i != size; i++) {
+        const uint16_t operand = static_cast<uint16_t>(pc + i);
+        uses[operand] |= Operand;
+        bytes[operand] = state.memory[operand];
+    }
+    ++counts[pc];
+
+    // the data the instruction reads and writes, from the registers before it runs
+    const uint16_t hl = static_cast<uint16_t>(state.h << 8 | state.l);
+    const uint16_t sp = state.stackPointer;
+    const uint16_t adr = static_cast<uint16_t>(state.memory[static_cast<uint16_t>(pc + 2)] << 8 | state.memory[static_cast<uint16_t>(pc + 1)]);
+    switch (opcode) {
+        case 0x0A: read(static_cast<uint16_t>(state.b << 8 | state.c)); break; // LDAX B
+        case 0x1A: read(static_cast<uint16_t>(state.d << 8 | state.e)); break; // LDAX D
+        case 0x02: write(static_cast<uint16_t>(state.b << 8 | state.c)); break; // STAX B
+        case 0x12: write(static_cast<uint16_t>(state.d << 8 | state.e)); break; // STAX D
+        case 0x2A: read(adr); read(static_cast<uint16_t>(adr + 1)); break; // LHLD
+        case 0x22: write(adr); write(static_cast<uint16_t>(adr + 1)); break; // SHLD
+        case 0x3A: read(adr); break; // LDA
+        case 0x32: write(adr); break; // STA
+        case 0x34: case 0x35: read(hl); write(hl); break; // INR M, DCR M
+        case 0x36: write(hl); break; // MVI M
+        case 0xE3: // XTHL
+            read(sp); read(static_cast<uint16_t>(sp + 1));
+            write(sp); write(static_cast<uint16_t>(sp + 1));
+            break;
+        case 0xC5: case 0xD5: case 0xE5: case 0xF5: // PUSH
+            write(static_cast<uint16_t>(sp - 1)); write(static_cast<uint16_t>(sp - 2));
+            break;
+        case 0xC1: case 0xD1: case 0xE1: case 0xF1: // POP
+            read(sp); read(static_cast<uint16_t>(sp + 1));
+            break;
+        default:
+            if ((opcode & 0xC0) == 0x40 && opcode != 0x76) { // MOV, HLT sits where MOV M,M would
+                if ((opcode & 0x07) == 0x06)
+                    read(hl);
+                if ((opcode & 0x38) == 0x30)
+                    write(hl);
+            }
+            else if ((opcode & 0xC7) == 0x86) { // ADD M to CMP M
+                read(hl);
+            }
+            break;
+    }
+
+    last = {pc, sp, opcode};
+    pending = true;
+}
+
+void Coverage::interrupted(const State8080& state, const uint8_t& opcode) {
+    if (pending)
+        retire(state.programCounter, state.stackPointer);
+    pending = false;
+    started = true;
+    write(static_cast<uint16_t>(state.stackPointer - 1));
+    write(static_cast<uint16_t>(state.stackPointer - 2));
+    ++entered[opcode & 0x38];
+}
+
+// Calls and returns only use the stack when they are taken, which shows in the stack pointer afterwards
+void Coverage::retire(const uint16_t& nextPC, const uint16_t& nextSP) {
+    pending = false;
+    const OpcodeInfo& info = opcodeInfo[last.opcode];
+    switch (info.branch) {
+        case OpcodeInfo::None:
+            return;
+        case OpcodeInfo::Call: case OpcodeInfo::Restart:
+            if (nextSP == static_cast<uint16_t>(last.sp - 2)) {
+                write(static_cast<uint16_t>(last.sp - 1));
+                write(static_cast<uint16_t>(last.sp - 2));
+            }
+            break;
+        case OpcodeInfo::Return:
+            if (nextSP == static_cast<uint16_t>(last.sp + 2)) {
+                read(last.sp);
+                read(static_cast<uint16_t>(last.sp + 1));
+            }
+            break;
+        case OpcodeInfo::Jump:
+            break;
+    }
+    ++edges[static_cast<uint32_t>(last.pc) << 16 | nextPC];
+}
+
+void Coverage::merge(const Coverage& other) {
+    const uint8_t instruction = Opcode | Operand;
+    for (uint32_t address = 0; address != State8080::RAM; address++) {
+        if ((uses[address] & instruction) != 0 && (other.uses[address] & instruction) != 0 && bytes[address] != other.bytes[address])
+            throw std::runtime_error("Coverage of a different program, the instructions at 0x" + hex(address, 4) + " differ");
+    }
+    for (uint32_t address = 0; address != State8080::RAM; address++) {
+        if ((uses[address] & instruction) == 0)
+            bytes[address] = other.bytes[address];
+        uses[address] |= other.uses[address];
+        counts[address] += other.counts[address];
+    }
+    for (const auto& entry : other.entered) {
+        entered[entry.first] += entry.second;
+    }
+    for (const auto& edge : other.edges) {
+        edges[edge.first] += edge.second;
+    }
+}
+
+// Layout, little endian:
+//   magic "8080COVR", version (4), executed address count (4), entry count (4), transfer count (4)
+//   the use flags of the 64 KiB, the instruction bytes of the 64 KiB
+//   executed addresses: address (2), count (8)
+//   entries: address (2), count (8)
+//   transfers: from (2), to (2), count (8)
+Coverage Coverage::fromFile(const std::string& fname) {
+    std::ifstream ifs(fname, std::ios_base::binary);
+    if (!ifs.good())
+        throw std::runtime_error("Coverage not found, given path:" + fname);
+    const std::vector<uint8_t> data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    if (data.size() < headerSize || std::memcmp(data.data(), coverageMagic, sizeof coverageMagic) != 0)
+        throw std::runtime_error(fname + " is not coverage");
+    if (readLE(data.data() + 8, 4) != version)
+        throw std::runtime_error(fname + " is a coverage version that is not supported");
+    const uint64_t executed = readLE(data.data() + 12, 4);
+    const uint64_t entries = readLE(data.data() + 16, 4);
+    const uint64_t transfers = readLE(data.data() + 20, 4);
+    if (data.size() != headerSize + 2 * State8080::RAM + executed * 10 + entries * 10 + transfers * 12)
+        throw std::runtime_error(fname + " is not the size its header gives");
+
+    Coverage coverage;
+    const uint8_t* p = data.data() + headerSize;
+    std::copy(p, p + State8080::RAM, coverage.uses.begin());
+    p += State8080::RAM;
+    std::copy(p, p + State8080::RAM, coverage.bytes.begin());
+    p += State8080::RAM;
+    for (uint64_t i = 0; i != executed; i++, p += 10) {
+        coverage.counts[readLE(p, 2)] = readLE(p + 2, 8);
+    }
+    for (uint64_t i = 0; i != entries; i++, p += 10) {
+        coverage.entered[static_cast<uint16_t>(readLE(p, 2))] = readLE(p + 2, 8);
+    }
+    for (uint64_t i = 0; i != transfers; i++, p += 12) {
+        coverage.edges[static_cast<uint32_t>(readLE(p, 4))] = readLE(p + 4, 8);
+    }
+    coverage.started = true;
+    return coverage;
+}
+
+void Coverage::toFile(const std::string& fname) const {
+    std::ofstream ofs(fname, std::ios_base::binary);
+    if (!ofs.good())
+        throw std::runtime_error("Unable to open file for writing, given path:" + fname);
+    const uint64_t executed = static_cast<uint64_t>(std::count_if(counts.begin(), counts.end(), [](const uint64_t& count) {
+        return count != 0;
+    }));
+    ofs.write(coverageMagic, sizeof coverageMagic);
+    writeLE(ofs, version, 4);
+    writeLE(ofs, executed, 4);
+    writeLE(ofs, entered.size(), 4);
+    writeLE(ofs, edges.size(), 4);
+    ofs.write(reinterpret_cast<const char*>(uses.data()), uses.size());
+    ofs.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    for (uint32_t address = 0; address != State8080::RAM; address++) {
+        if (counts[address] != 0) {
+            writeLE(ofs, address, 2);
+            writeLE(ofs, counts[address], 8);
+        }
+    }
+    for (const auto& entry : entered) {
+        writeLE(ofs, entry.first, 2);
+        writeLE(ofs, entry.second, 8);
+    }
+    // sorted so the same coverage always gives the same file
+    std::vector<std::pair<uint32_t, uint64_t>> sorted(edges.begin(), edges.end());
+    std::sort(sorted.begin(), sorted.end());
+    for (const auto& edge : sorted) {
+        writeLE(ofs, edge.first, 4);
+        writeLE(ofs, edge.second, 8);
+    }
+    ofs.close();
+    if (!ofs.good())
+        throw std::runtime_error("Unable to write coverage, given path:" + fname);
+}
+
+void Coverage::report(std::ostream& os, const Symbols& symbols, const uint16_t& start, const uint16_t& end) const {
+    const uint32_t size = static_cast<uint32_t>(end) - start + 1;
+    uint32_t perUse[4] = {0, 0, 0, 0};
+    uint32_t untouched = 0;
+    uint64_t instructions = 0;
+    std::vector<std::pair<uint32_t, uint32_t>> gaps; // length and start of the ranges nothing touched
+    for (uint32_t address = start; address <= end; address++) {
+        for (int i = 0; i != 4; i++) {
+            if ((uses[address] & (1 << i)) != 0)
+                ++perUse[i];
+        }
+        instructions += counts[address];
+        if (uses[address] != 0)
+            continue;
+        ++untouched;
+        if (address != start && uses[address - 1] == 0)
+            ++gaps.back().first;
+        else
+            gaps.push_back({1, address});
+    }
+
+    const std::ios_base::fmtflags flags = os.flags();
+    os << std::fixed << std::setprecision(2);
+    os << "Coverage of 0x" << hex(start, 4) << "-0x" << hex(end, 4) << ", " << instructions << " instructions run\n";
+    const char* names[5] = {"executed as opcodes", "fetched as operands", "read as data", "written as data", "never touched"};
+    const uint32_t values[5] = {perUse[0], perUse[1], perUse[2], perUse[3], untouched};
+    for (int i = 0; i != 5; i++) {
+        os << std::setw(10) << values[i] << " bytes " << std::setw(7) << 100.0 * values[i] / size << "%  " << names[i] << '\n';
+    }
+
+    std::string neverRan;
+    for (const auto& symbol : symbols.names()) {
+        if (symbol.first >= start && symbol.first <= end && (uses[symbol.first] & Opcode) == 0)
+            neverRan += ' ' + symbol.second;
+    }
+    if (!neverRan.empty())
+        os << "Routines never entered:" << neverRan << '\n';
+
+    std::stable_sort(gaps.begin(), gaps.end(), [](const std::pair<uint32_t, uint32_t>& lhs, const std::pair<uint32_t, uint32_t>& rhs) {
+        return lhs.first > rhs.first;
+    });
+    if (!gaps.empty())
+        os << "Largest ranges never touched:";
+    for (std::size_t i = 0; i != std::min<std::size_t>(8, gaps.size()); i++) {
+        os << " 0x" << hex(gaps[i].second, 4) << "-0x" << hex(gaps[i].second + gaps[i].first - 1, 4)
+           << " (" << symbols.describe(static_cast<uint16_t>(gaps[i].second)) << ", " << gaps[i].first << ")";
+    }
+    if (!gaps.empty())
+        os << '\n';
+    os.flags(flags);
+    os << std::flush;
+}
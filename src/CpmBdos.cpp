@@ -0,0 +1,657 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include "CpmBdos.hpp"
+
+constexpr uint16_t CpmBdos::bootAddress;
+constexpr uint16_t CpmBdos::entryAddress;
+constexpr uint16_t CpmBdos::tpa;
+constexpr uint16_t CpmBdos::top;
+constexpr uint16_t CpmBdos::biosAddress;
+constexpr std::size_t CpmBdos::maxDrives;
+
+namespace {
+
+constexpr uint8_t unused = 0xE5; // a directory entry that is free
+constexpr uint8_t recordsPerExtent = 128; // a logical extent is 16 KiB
+constexpr std::size_t fcbBytes = 36;
+constexpr std::size_t recordBytes = 128;
+
+// What CP/M derives from a disk's parameters
+struct Layout {
+    uint16_t recordsPerBlock;
+    bool bigBlocks; // more than 256 blocks, an entry holds 8 two byte block numbers instead of 16 bytes
+    uint8_t extentMask; // logical extents an entry holds, less one
+    uint16_t directoryBlocks;
+    uint16_t blocks;
+    uint16_t entries;
+};
+
+Layout layout(const DiskFormat& format) noexcept {
+    Layout result;
+    result.recordsPerBlock = format.blockSize / 128;
+    result.blocks = format.blocks();
+    result.bigBlocks = result.blocks > 256;
+    const uint32_t entryBytes = (result.bigBlocks ? 8u : 16u) * format.blockSize;
+    result.extentMask = static_cast<uint8_t>(entryBytes / (recordsPerExtent * 128) - 1);
+    result.entries = format.directoryEntries;
+    result.directoryBlocks = static_cast<uint16_t>((format.directoryEntries * 32 + format.blockSize - 1) / format.blockSize);
+    return result;
+}
+
+// The allocation of an entry or an FCB, from byte 16
+uint16_t blockNumber(const uint8_t* entry, const Layout& l, const uint32_t& index) noexcept {
+    return l.bigBlocks ? static_cast<uint16_t>(entry[16 + 2 * index] | entry[17 + 2 * index] << 8) : entry[16 + index];
+}
+
+void setBlockNumber(uint8_t* entry, const Layout& l, const uint32_t& index, const uint16_t& block) noexcept {
+    if (l.bigBlocks) {
+        entry[16 + 2 * index] = block & 0xFF;
+        entry[17 + 2 * index] = block >> 8;
+    }
+    else {
+        entry[16 + index] = static_cast<uint8_t>(block);
+    }
+}
+
+uint8_t extentOf(const uint8_t* fcb) noexcept {
+    return fcb[12] & 0x1F;
+}
+
+} // namespace
+
+CpmBdos::CpmBdos(Traps& traps) : traps(traps) {
+    traps.add(bootAddress, [this](State8080& state) { boot(state); });
+    traps.add(entryAddress, [this](State8080& state) { call(state); });
+    traps.add(top, [this](State8080& state) { call(state); });
+}
+
+CpmBdos::~CpmBdos() {
+    traps.remove(bootAddress);
+    traps.remove(entryAddress);
+    traps.remove(top);
+}
+
+void CpmBdos::prepare(State8080& state) {
+    // JMP to the BIOS's warm boot and JMP to the BDOS, programs read where their memory ends from 6
+    const uint16_t wboot = biosAddress + 3;
+    const uint8_t pageZero[8] = {0xC3, static_cast<uint8_t>(wboot & 0xFF), static_cast<uint8_t>(wboot >> 8), 0x00, 0x00,
+                                 0xC3, static_cast<uint8_t>(top & 0xFF), static_cast<uint8_t>(top >> 8)};
+    for (uint16_t i = 0; i != sizeof pageZero; i++) {
+        state.memory[i] = pageZero[i];
+    }
+    state.memory[top] = 0xC9; // trapped, a RET if it ever runs
+    state.stackPointer = top - 8;
+    state.writeStack(state.stackPointer, 0x00);
+    state.writeStack(static_cast<uint16_t>(state.stackPointer + 1), 0x00);
+    state.programCounter = tpa;
+    state.halted = false;
+    currentDrive = 0;
+    user = 0;
+    dma = 0x80;
+    done = false;
+}
+
+void CpmBdos::boot(State8080& state) {
+    done = true;
+    state.halted = true;
+}
+
+void CpmBdos::mount(const std::size_t& drive, DiskImage* disk, const uint16_t& dpb, const uint16_t& alv) {
+    drives.at(drive) = {disk, dpb, alv};
+}
+
+bool CpmBdos::fcbName(const std::string& text, uint8_t* fcb) {
+    std::string name = text;
+    fcb[0] = 0;
+    if (name.size() >= 2 && name[1] == ':') {
+        const char letter = static_cast<char>(std::toupper(static_cast<unsigned char>(name[0])));
+        if (letter < 'A' || letter >= static_cast<char>('A' + maxDrives))
+            return false;
+        fcb[0] = static_cast<uint8_t>(letter - 'A' + 1);
+        name = name.substr(2);
+    }
+    const std::size_t dot = name.find('.');
+    const std::string base = name.substr(0, dot);
+    const std::string type = dot == std::string::npos ? "" : name.substr(dot + 1);
+    if (base.size() > 8 || type.size() > 3)
+        return false;
+    // * fills the rest of the field with ?
+    auto fill = [](const std::string& field, uint8_t* to, const std::size_t& size) {
+        bool wild = false;
+        for (std::size_t i = 0; i != size; i++) {
+            wild = wild || (i < field.size() && field[i] == '*');
+            to[i] = wild ? '?' : i < field.size() ? static_cast<uint8_t>(std::toupper(static_cast<unsigned char>(field[i]))) : ' ';
+        }
+    };
+    fill(base, fcb + 1, 8);
+    fill(type, fcb + 9, 3);
+    return true;
+}
+
+bool CpmBdos::readFile(const std::size_t& drive, const std::string& name, std::vector<uint8_t>& data) {
+    std::array<uint8_t, 36> fcb {};
+    if (drive >= maxDrives || !fcbName(name, fcb.data()))
+        return false;
+    fcb[0] = static_cast<uint8_t>(drive + 1);
+    if (open(fcb.data()) == 0xFF)
+        return false;
+    data.clear();
+    std::array<uint8_t, 128> record;
+    while (readSequential(fcb.data(), record.data()) == 0) {
+        data.insert(data.end(), record.begin(), record.end());
+    }
+    return true;
+}
+
+bool CpmBdos::writeFile(const std::size_t& drive, const std::string& name, const std::vector<uint8_t>& data) {
+    std::array<uint8_t, 36> fcb {};
+    if (drive >= maxDrives || !fcbName(name, fcb.data()))
+        return false;
+    fcb[0] = static_cast<uint8_t>(drive + 1);
+    remove(fcb.data());
+    if (make(fcb.data()) == 0xFF)
+        return false;
+    for (std::size_t i = 0; i < data.size(); i += 128) {
+        std::array<uint8_t, 128> record;
+        record.fill(0x1A); // text files end with ^Z
+        std::copy(data.begin() + static_cast<std::ptrdiff_t>(i), data.begin() + static_cast<std::ptrdiff_t>(std::min(i + 128, data.size())), record.begin());
+        if (writeSequential(fcb.data(), record.data()) != 0)
+            return false;
+    }
+    return close(fcb.data()) != 0xFF;
+}
+
+void CpmBdos::print(const char& c) {
+    printed.push_back(c);
+    if (display != nullptr && printed.size() >= 4096)
+        flush();
+}
+
+void CpmBdos::flush() {
+    if (display == nullptr)
+        return;
+    display->write(printed.data(), static_cast<std::streamsize>(printed.size()));
+    display->flush();
+    printed.clear();
+}
+
+bool CpmBdos::readChar(uint8_t& c) {
+    if (read != typed.size()) {
+        c = static_cast<uint8_t>(typed[read++]);
+        return true;
+    }
+    if (input == nullptr)
+        return false;
+    flush(); // the prompt has to be seen before waiting
+    const int got = input->get();
+    if (got == std::char_traits<char>::eof())
+        return false;
+    c = got == '\n' ? '\r' : static_cast<uint8_t>(got); // CP/M ends lines with a carriage return
+    return true;
+}
+
+bool CpmBdos::charReady() {
+    return read != typed.size() || (input != nullptr && input->rdbuf()->in_avail() > 0);
+}
+
+void CpmBdos::result(State8080& state, const uint16_t& value) noexcept {
+    state.l = state.a = value & 0xFF;
+    state.h = state.b = value >> 8;
+}
+
+void CpmBdos::call(State8080& state) {
+    const uint16_t de = static_cast<uint16_t>(state.d << 8 | state.e);
+    const Fcb fcb = &state.memory[de];
+    uint8_t* const buffer = &state.memory[dma];
+    // an FCB or a record that runs off the end of memory would be read or written past it, the call fails instead
+    const bool fcbFits = de <= State8080::RAM - fcbBytes;
+    const bool bufferFits = dma <= State8080::RAM - recordBytes;
+    bool fits = true;
+    switch (state.c) {
+        case 15: case 16: case 19: case 22: case 23: case 30: case 35: case 36: fits = fcbFits; break;
+        case 17: case 20: case 21: case 33: case 34: case 40: fits = fcbFits && bufferFits; break;
+        case 18: fits = bufferFits; break;
+        default: break;
+    }
+    if (!fits) {
+        result(state, 0x00FF);
+        Traps::ret(state);
+        return;
+    }
+    uint8_t c = 0;
+    switch (state.c) {
+        case 0: // system reset
+            boot(state);
+            return;
+        case 1: // console input, echoed, ^Z at the end of the input
+            if (!readChar(c))
+                c = 0x1A;
+            else
+                print(static_cast<char>(c));
+            result(state, c);
+            break;
+        case 2: // console output
+            print(static_cast<char>(state.e));
+            break;
+        case 6: // direct console I/O, FF reads without waiting, FE is the status, anything else is printed
+            if (state.e == 0xFF)
+                result(state, charReady() && readChar(c) ? c : 0);
+            else if (state.e == 0xFE)
+                result(state, charReady() ? 0xFF : 0x00);
+            else
+                print(static_cast<char>(state.e));
+            break;
+        case 9: // print string up to a $
+            for (uint16_t address = de; state.memory[address] != '$'; address++) {
+                print(static_cast<char>(state.memory[address]));
+                if (static_cast<uint16_t>(address + 1) == de)
+                    break; // no $ anywhere
+            }
+            break;
+        case 10: { // read console buffer, the size at DE, the length read at DE+1 and the line after it
+            const uint8_t size = state.memory[de];
+            uint8_t length = 0;
+            while (length != size && readChar(c) && c != '\n' && c != '\r') {
+                state.memory[static_cast<uint16_t>(de + 2 + length++)] = c;
+                print(static_cast<char>(c));
+            }
+            state.memory[static_cast<uint16_t>(de + 1)] = length;
+            print('\n');
+            break;
+        }
+        case 11: // console status
+            result(state, charReady() ? 0xFF : 0x00);
+            break;
+        case 12: // version, CP/M 2.2
+            result(state, 0x0022);
+            break;
+        case 13: // reset disks
+            currentDrive = 0;
+            dma = 0x80;
+            result(state, 0x00);
+            break;
+        case 14: // select disk
+            if (state.e < maxDrives && drives[state.e].disk != nullptr) {
+                currentDrive = state.e;
+                result(state, 0x00);
+            }
+            else {
+                result(state, 0xFF);
+            }
+            break;
+        case 15: result(state, open(fcb)); break;
+        case 16: result(state, close(fcb)); break;
+        case 17: // search first, a ? drive lists every entry
+            std::copy(fcb, fcb + pattern.size(), pattern.begin());
+            searchAll = pattern[0] == '?';
+            searchNext = 0;
+            result(state, search(buffer));
+            break;
+        case 18: result(state, search(buffer)); break;
+        case 19: result(state, remove(fcb)); break;
+        case 20: result(state, readSequential(fcb, buffer)); break;
+        case 21: result(state, writeSequential(fcb, buffer)); break;
+        case 22: result(state, make(fcb)); break;
+        case 23: result(state, rename(fcb)); break;
+        case 24: { // login vector, the mounted drives
+            uint16_t vector = 0;
+            for (std::size_t i = 0; i != maxDrives; i++) {
+                if (drives[i].disk != nullptr)
+                    vector |= static_cast<uint16_t>(1 << i);
+            }
+            result(state, vector);
+            break;
+        }
+        case 25: result(state, currentDrive); break;
+        case 26: dma = de; break;
+        case 27: // allocation vector, built from the directory when asked for
+            if (drives[currentDrive].disk != nullptr) {
+                writeAllocation(state, drives[currentDrive]);
+                result(state, drives[currentDrive].alv);
+            }
+            else {
+                result(state, 0x0000);
+            }
+            break;
+        case 28: // write protect, disks stay writable
+        case 29: // read only vector
+            result(state, 0x0000);
+            break;
+        case 30: result(state, setAttributes(fcb)); break;
+        case 31: result(state, drives[currentDrive].disk != nullptr ? drives[currentDrive].dpb : 0x0000); break;
+        case 32: // get or set the user code
+            if (state.e == 0xFF)
+                result(state, user);
+            else
+                user = state.e & 0x0F;
+            break;
+        case 33: result(state, readRandom(fcb, buffer)); break;
+        case 34: case 40: result(state, writeRandom(fcb, buffer)); break; // new blocks are always zeroed
+        case 35: fileSize(fcb); result(state, 0x00); break;
+        case 36: { // set the random record from the sequential position
+            const uint32_t record = ((static_cast<uint32_t>(fcb[14]) * 32 + extentOf(fcb)) * recordsPerExtent) + fcb[32];
+            fcb[33] = record & 0xFF;
+            fcb[34] = (record >> 8) & 0xFF;
+            fcb[35] = static_cast<uint8_t>(record >> 16);
+            break;
+        }
+        default:
+            result(state, 0x00FF);
+            break;
+    }
+    Traps::ret(state);
+}
+
+CpmBdos::Drive* CpmBdos::driveOf(const Fcb& fcb) noexcept {
+    const std::size_t index = fcb[0] == 0 || fcb[0] == '?' ? currentDrive : fcb[0] - 1u;
+    if (index >= maxDrives || drives[index].disk == nullptr)
+        return nullptr;
+    return &drives[index];
+}
+
+uint8_t* CpmBdos::entry(const Drive& drive, const uint32_t& index) noexcept {
+    return drive.disk->record(index / 4) + (index % 4) * 32;
+}
+
+// The name and type match ignoring the attribute bits, ? matches anything, extents match within
+// the logical extents an entry holds
+bool CpmBdos::matches(const Drive& drive, const uint8_t* entry, const Fcb& fcb, bool anyExtent) const noexcept {
+    if (entry[0] != user)
+        return false;
+    for (int i = 1; i != 12; i++) {
+        if (fcb[i] != '?' && ((entry[i] ^ fcb[i]) & 0x7F) != 0)
+            return false;
+    }
+    if (anyExtent || fcb[12] == '?')
+        return true;
+    const uint8_t mask = static_cast<uint8_t>(~layout(drive.disk->format()).extentMask);
+    return ((extentOf(entry) ^ extentOf(fcb)) & mask) == 0 && entry[14] == fcb[14];
+}
+
+int32_t CpmBdos::find(const Drive& drive, const Fcb& fcb, bool anyExtent, const uint32_t& from) noexcept {
+    const uint32_t entries = drive.disk->format().directoryEntries;
+    for (uint32_t i = from; i < entries; i++) {
+        if (matches(drive, entry(drive, i), fcb, anyExtent))
+            return static_cast<int32_t>(i);
+    }
+    return -1;
+}
+
+std::vector<bool> CpmBdos::allocation(const Drive& drive) noexcept {
+    const Layout l = layout(drive.disk->format());
+    std::vector<bool> used(l.blocks, false);
+    std::fill(used.begin(), used.begin() + l.directoryBlocks, true);
+    const uint32_t perEntry = l.bigBlocks ? 8 : 16;
+    for (uint32_t i = 0; i != l.entries; i++) {
+        const uint8_t* e = entry(drive, i);
+        if (e[0] > 15)
+            continue;
+        for (uint32_t k = 0; k != perEntry; k++) {
+            const uint16_t block = blockNumber(e, l, k);
+            if (block != 0 && block < l.blocks)
+                used[block] = true;
+        }
+    }
+    return used;
+}
+
+void CpmBdos::writeAllocation(State8080& state, const Drive& drive) {
+    const std::vector<bool> used = allocation(drive);
+    for (std::size_t block = 0; block < used.size(); block += 8) {
+        uint8_t bits = 0;
+        for (std::size_t i = 0; i != 8; i++) {
+            if (block + i < used.size() && used[block + i])
+                bits |= static_cast<uint8_t>(0x80 >> i);
+        }
+        state.memory[static_cast<uint16_t>(drive.alv + block / 8)] = bits;
+    }
+}
+
+uint8_t CpmBdos::open(const Fcb& fcb) {
+    const Drive* drive = driveOf(fcb);
+    if (drive == nullptr)
+        return 0xFF;
+    const int32_t index = find(*drive, fcb, false);
+    if (index < 0)
+        return 0xFF;
+    const uint8_t* e = entry(*drive, static_cast<uint32_t>(index));
+    std::copy(e + 13, e + 32, fcb + 13);
+    // the entry's extent is the last one it holds, an earlier one is full and a later one empty
+    const uint8_t mask = layout(drive->disk->format()).extentMask;
+    const uint8_t wanted = extentOf(fcb) & mask;
+    const uint8_t last = extentOf(e) & mask;
+    fcb[15] = wanted < last ? recordsPerExtent : wanted > last ? 0 : e[15];
+    return static_cast<uint8_t>(index % 4);
+}
+
+uint8_t CpmBdos::close(const Fcb& fcb) {
+    const Drive* drive = driveOf(fcb);
+    if (drive == nullptr)
+        return 0xFF;
+    const int32_t index = find(*drive, fcb, false);
+    if (index < 0)
+        return 0xFF;
+    uint8_t* e = entry(*drive, static_cast<uint32_t>(index));
+    std::copy(fcb + 16, fcb + 32, e + 16);
+    if (extentOf(fcb) >= extentOf(e)) {
+        e[12] = extentOf(fcb);
+        e[15] = fcb[15];
+    }
+    return static_cast<uint8_t>(index % 4);
+}
+
+uint8_t CpmBdos::make(const Fcb& fcb) {
+    const Drive* drive = driveOf(fcb);
+    if (drive == nullptr)
+        return 0xFF;
+    const uint32_t entries = drive->disk->format().directoryEntries;
+    for (uint32_t i = 0; i != entries; i++) {
+        uint8_t* e = entry(*drive, i);
+        if (e[0] != unused)
+            continue;
+        e[0] = user;
+        std::copy(fcb + 1, fcb + 12, e + 1);
+        e[12] = extentOf(fcb);
+        e[13] = 0;
+        e[14] = fcb[14];
+        std::fill(e + 15, e + 32, 0);
+        fcb[13] = 0;
+        std::fill(fcb + 15, fcb + 32, 0);
+        return static_cast<uint8_t>(i % 4);
+    }
+    return 0xFF;
+}
+
+uint8_t CpmBdos::remove(const Fcb& fcb) {
+    const Drive* drive = driveOf(fcb);
+    if (drive == nullptr)
+        return 0xFF;
+    uint8_t code = 0xFF;
+    for (int32_t i = find(*drive, fcb, true); i >= 0; i = find(*drive, fcb, true, static_cast<uint32_t>(i) + 1)) {
+        entry(*drive, static_cast<uint32_t>(i))[0] = unused;
+        code = 0;
+    }
+    return code;
+}
+
+uint8_t CpmBdos::rename(const Fcb& fcb) {
+    const Drive* drive = driveOf(fcb);
+    if (drive == nullptr)
+        return 0xFF;
+    uint8_t code = 0xFF;
+    for (int32_t i = find(*drive, fcb, true); i >= 0; i = find(*drive, fcb, true, static_cast<uint32_t>(i) + 1)) {
+        std::copy(fcb + 17, fcb + 28, entry(*drive, static_cast<uint32_t>(i)) + 1); // the new name follows at 16
+        code = 0;
+    }
+    return code;
+}
+
+uint8_t CpmBdos::setAttributes(const Fcb& fcb) {
+    const Drive* drive = driveOf(fcb);
+    if (drive == nullptr)
+        return 0xFF;
+    uint8_t code = 0xFF;
+    for (int32_t i = find(*drive, fcb, true); i >= 0; i = find(*drive, fcb, true, static_cast<uint32_t>(i) + 1)) {
+        std::copy(fcb + 1, fcb + 12, entry(*drive, static_cast<uint32_t>(i)) + 1);
+        code = 0;
+    }
+    return code;
+}
+
+// The directory record of the next match goes to the DMA, the result is the match's place in it
+uint8_t CpmBdos::search(uint8_t* buffer) {
+    const Drive* drive = driveOf(pattern.data());
+    if (drive == nullptr)
+        return 0xFF;
+    const uint32_t entries = drive->disk->format().directoryEntries;
+    for (uint32_t i = searchNext; i < entries; i++) {
+        const uint8_t* e = entry(*drive, i);
+        if (searchAll || matches(*drive, e, pattern.data(), false)) {
+            std::memcpy(buffer, drive->disk->record(i / 4), DiskImage::sectorSize);
+            searchNext = i + 1;
+            return static_cast<uint8_t>(i % 4);
+        }
+    }
+    searchNext = entries;
+    return 0xFF;
+}
+
+// The record of the FCB's current extent, a new zeroed block is allocated for it when asked and it has none.
+// The directory is updated with every new block, so it never hands out a block an open file already has
+uint8_t* CpmBdos::block(const Drive& drive, const Fcb& fcb, const uint8_t& record, bool allocate, bool& full) {
+    const Layout l = layout(drive.disk->format());
+    const uint32_t inEntry = (extentOf(fcb) & l.extentMask) * recordsPerExtent + record;
+    const uint32_t index = inEntry / l.recordsPerBlock;
+    uint16_t number = blockNumber(fcb, l, index);
+    if (number == 0 || number >= l.blocks) {
+        if (!allocate)
+            return nullptr;
+        const std::vector<bool> used = allocation(drive);
+        const auto free = std::find(used.begin(), used.end(), false);
+        if (free == used.end()) {
+            full = true;
+            return nullptr;
+        }
+        number = static_cast<uint16_t>(free - used.begin());
+        for (uint32_t i = 0; i != l.recordsPerBlock; i++) {
+            std::memset(drive.disk->record(static_cast<uint32_t>(number) * l.recordsPerBlock + i), 0, DiskImage::sectorSize);
+        }
+        setBlockNumber(fcb, l, index, number);
+        close(fcb);
+    }
+    return drive.disk->record(static_cast<uint32_t>(number) * l.recordsPerBlock + inEntry % l.recordsPerBlock);
+}
+
+uint8_t CpmBdos::readSequential(const Fcb& fcb, uint8_t* buffer) {
+    const Drive* drive = driveOf(fcb);
+    if (drive == nullptr)
+        return 0xFF;
+    if (fcb[32] >= recordsPerExtent) { // on to the next extent
+        fcb[12] = (extentOf(fcb) + 1) & 0x1F;
+        if (fcb[12] == 0)
+            ++fcb[14];
+        fcb[32] = 0;
+        if (open(fcb) == 0xFF)
+            return 1;
+    }
+    bool full = false;
+    const uint8_t* record = fcb[32] < fcb[15] ? block(*drive, fcb, fcb[32], false, full) : nullptr;
+    if (record == nullptr)
+        return 1; // end of file
+    std::memcpy(buffer, record, DiskImage::sectorSize);
+    ++fcb[32];
+    return 0;
+}
+
+uint8_t CpmBdos::writeSequential(const Fcb& fcb, const uint8_t* buffer) {
+    const Drive* drive = driveOf(fcb);
+    if (drive == nullptr)
+        return 0xFF;
+    if (fcb[32] >= recordsPerExtent) {
+        close(fcb);
+        fcb[12] = (extentOf(fcb) + 1) & 0x1F;
+        if (fcb[12] == 0)
+            ++fcb[14];
+        fcb[32] = 0;
+        if (open(fcb) == 0xFF && make(fcb) == 0xFF)
+            return 1; // directory full
+    }
+    bool full = false;
+    uint8_t* record = block(*drive, fcb, fcb[32], true, full);
+    if (record == nullptr)
+        return 2; // disk full
+    std::memcpy(record, buffer, DiskImage::sectorSize);
+    ++fcb[32];
+    fcb[15] = std::max(fcb[15], fcb[32]);
+    return 0;
+}
+
+// Random access moves the FCB to the extent of record r0 r1, closing the one it was in
+uint8_t CpmBdos::seek(const Fcb& fcb, bool create) {
+    if (fcb[35] != 0)
+        return 6; // past the end of the disk
+    const uint32_t record = static_cast<uint32_t>(fcb[33] | fcb[34] << 8);
+    const uint8_t extent = static_cast<uint8_t>((record / recordsPerExtent) & 0x1F);
+    const uint8_t module = static_cast<uint8_t>(record / recordsPerExtent >> 5);
+    if (extentOf(fcb) != extent || fcb[14] != module) {
+        close(fcb);
+        fcb[12] = extent;
+        fcb[14] = module;
+        if (open(fcb) == 0xFF) {
+            if (!create)
+                return 4; // an extent that was never written
+            if (make(fcb) == 0xFF)
+                return 5; // directory full
+        }
+    }
+    fcb[32] = static_cast<uint8_t>(record % recordsPerExtent);
+    return 0;
+}
+
+uint8_t CpmBdos::readRandom(const Fcb& fcb, uint8_t* buffer) {
+    const Drive* drive = driveOf(fcb);
+    if (drive == nullptr)
+        return 0xFF;
+    const uint8_t code = seek(fcb, false);
+    if (code != 0)
+        return code;
+    bool full = false;
+    const uint8_t* record = fcb[32] < fcb[15] ? block(*drive, fcb, fcb[32], false, full) : nullptr;
+    if (record == nullptr)
+        return 1; // a record that was never written
+    std::memcpy(buffer, record, DiskImage::sectorSize);
+    return 0;
+}
+
+uint8_t CpmBdos::writeRandom(const Fcb& fcb, const uint8_t* buffer) {
+    const Drive* drive = driveOf(fcb);
+    if (drive == nullptr)
+        return 0xFF;
+    const uint8_t code = seek(fcb, true);
+    if (code != 0)
+        return code;
+    bool full = false;
+    uint8_t* record = block(*drive, fcb, fcb[32], true, full);
+    if (record == nullptr)
+        return 2;
+    std::memcpy(record, buffer, DiskImage::sectorSize);
+    fcb[15] = std::max<uint8_t>(fcb[15], static_cast<uint8_t>(fcb[32] + 1));
+    return 0;
+}
+
+// The record after the last one of the file, in r0 r1 r2
+void CpmBdos::fileSize(const Fcb& fcb) {
+    uint32_t size = 0;
+    const Drive* drive = driveOf(fcb);
+    if (drive != nullptr) {
+        for (int32_t i = find(*drive, fcb, true); i >= 0; i = find(*drive, fcb, true, static_cast<uint32_t>(i) + 1)) {
+            const uint8_t* e = entry(*drive, static_cast<uint32_t>(i));
+            size = std::max(size, (static_cast<uint32_t>(e[14]) * 32 + extentOf(e)) * recordsPerExtent + e[15]);
+        }
+    }
+    fcb[33] = size & 0xFF;
+    fcb[34] = (size >> 8) & 0xFF;
+    fcb[35] = static_cast<uint8_t>(size >> 16);
+}
@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "CpmMachine.hpp"
+
+constexpr uint16_t CpmMachine::biosAddress;
+constexpr int CpmMachine::biosFunctions;
+
+namespace {
+
+constexpr uint16_t dirbuf = CpmMachine::biosAddress + 0x40; // the BDOS's directory buffer, 128 bytes
+constexpr uint16_t tableStart = dirbuf + 0x80;
+constexpr uint16_t tableSize = 0x140; // DPH 16, DPB 15, skew 26 and an ALV of up to 2048 blocks
+
+void writeWord(State8080& state, const uint16_t& address, const uint16_t& value) noexcept {
+    state.memory[address] = value & 0xFF;
+    state.memory[static_cast<uint16_t>(address + 1)] = value >> 8;
+}
+
+} // namespace
+
+CpmMachine::CpmMachine() : bdos(traps) {
+    cpu.traps = &traps;
+    for (int i = 0; i != biosFunctions; i++) {
+        traps.add(static_cast<uint16_t>(biosAddress + 3 * i), [this, i](State8080& state) { bios(state, i); });
+    }
+}
+
+uint16_t CpmMachine::tablesOf(const std::size_t& drive) noexcept {
+    return static_cast<uint16_t>(tableStart + drive * tableSize);
+}
+
+void CpmMachine::mount(const std::size_t& drive, const std::string& fname) {
+    if (drive >= disks.size())
+        throw std::runtime_error("Only drives A to D can be mounted, given drive:" + std::to_string(drive));
+    disks[drive].reset(new DiskImage(fname));
+    const uint16_t tables = tablesOf(drive);
+    bdos.mount(drive, disks[drive].get(), tables + 0x10, tables + 0x40);
+    writeTables();
+}
+
+DiskImage& CpmMachine::disk(const std::size_t& drive) {
+    if (drive >= disks.size() || !disks[drive])
+        throw std::runtime_error("No disk is mounted on drive " + std::string(1, static_cast<char>('A' + drive)));
+    return *disks[drive];
+}
+
+void CpmMachine::writeTables() {
+    for (int i = 0; i != biosFunctions; i++) {
+        // trapped, each entry is a RET should it ever run
+        const uint16_t entry = static_cast<uint16_t>(biosAddress + 3 * i);
+        state.memory[entry] = 0xC9;
+        state.memory[entry + 1] = 0x00;
+        state.memory[entry + 2] = 0x00;
+    }
+    for (std::size_t drive = 0; drive != disks.size(); drive++) {
+        if (!disks[drive])
+            continue;
+        const DiskFormat& format = disks[drive]->format();
+        const uint16_t dph = tablesOf(drive);
+        const uint16_t dpb = dph + 0x10;
+        const uint16_t xlt = dph + 0x20;
+        const uint16_t alv = dph + 0x40;
+
+        const uint16_t blocks = format.blocks();
+        const uint16_t recordsPerBlock = format.blockSize / 128;
+        uint8_t shift = 0;
+        while ((1u << shift) < recordsPerBlock)
+            ++shift;
+        const uint16_t directoryBlocks = static_cast<uint16_t>((format.directoryEntries * 32 + format.blockSize - 1) / format.blockSize);
+        const uint16_t reserved = static_cast<uint16_t>(0xFFFF << (16 - directoryBlocks));
+        writeWord(state, dpb, format.sectorsPerTrack);                                    // SPT
+        state.memory[dpb + 2] = shift;                                                     // BSH
+        state.memory[dpb + 3] = static_cast<uint8_t>(recordsPerBlock - 1);                 // BLM
+        state.memory[dpb + 4] = static_cast<uint8_t>(format.blockSize / (blocks > 256 ? 2048 : 1024) - 1); // EXM
+        writeWord(state, dpb + 5, blocks - 1);                                             // DSM
+        writeWord(state, dpb + 7, format.directoryEntries - 1);                            // DRM
+        state.memory[dpb + 9] = reserved >> 8;                                             // AL0
+        state.memory[dpb + 10] = reserved & 0xFF;                                          // AL1
+        writeWord(state, dpb + 11, 0);                                                     // CKS, the disks are fixed
+        writeWord(state, dpb + 13, format.reservedTracks);                                 // OFF
+
+        if (format.skew != nullptr)
+            std::copy(format.skew, format.skew + format.sectorsPerTrack, state.memory.begin() + xlt);
+        writeWord(state, dph, format.skew != nullptr ? xlt : 0);
+        writeWord(state, dph + 2, 0);
+        writeWord(state, dph + 4, 0);
+        writeWord(state, dph + 6, 0);
+        writeWord(state, dph + 8, dirbuf);
+        writeWord(state, dph + 10, dpb);
+        writeWord(state, dph + 12, 0);                                                     // CSV, nothing to check
+        writeWord(state, dph + 14, alv);
+    }
+}
+
+void CpmMachine::load(const std::vector<uint8_t>& program, const std::vector<std::string>& arguments) {
+    // the stack the BDOS prepares is just below it, leave it a page
+    const std::size_t room = CpmBdos::top - 0x100u - CpmBdos::tpa;
+    if (program.empty() || program.size() > room)
+        throw std::runtime_error("Program is empty or too big for the TPA, size:" + std::to_string(program.size()));
+    std::fill(state.memory.begin(), state.memory.begin() + CpmBdos::top, 0);
+    std::copy(program.begin(), program.end(), state.memory.begin() + CpmBdos::tpa);
+
+    // the default FCBs, blank names unless the arguments are file names
+    std::fill(state.memory.begin() + 0x5C + 1, state.memory.begin() + 0x5C + 12, ' ');
+    std::fill(state.memory.begin() + 0x6C + 1, state.memory.begin() + 0x6C + 12, ' ');
+    for (std::size_t i = 0; i != std::min<std::size_t>(arguments.size(), 2); i++) {
+        std::array<uint8_t, 12> name {};
+        if (CpmBdos::fcbName(arguments[i], name.data()))
+            std::copy(name.begin(), name.end(), state.memory.begin() + (i == 0 ? 0x5C : 0x6C));
+    }
+    // the command tail as the CCP leaves it, upper case after a space
+    std::string tail;
+    for (const std::string& argument : arguments) {
+        tail += ' ' + argument;
+    }
+    tail = tail.substr(0, 127);
+    std::transform(tail.begin(), tail.end(), tail.begin(), [](char c) { return static_cast<char>(std::toupper(static_cast<unsigned char>(c))); });
+    state.memory[0x80] = static_cast<uint8_t>(tail.size());
+    std::copy(tail.begin(), tail.end(), state.memory.begin() + 0x81);
+
+    writeTables();
+    bdos.prepare(state);
+    selected = 0;
+    track = sector = 0;
+    dma = 0x80;
+}
+
+CpmMachine::Result CpmMachine::run(const uint64_t& maxInstructions, const uint64_t& maxCycles) {
+    const uint64_t instructionLimit = maxInstructions == 0 ? std::numeric_limits<uint64_t>::max() : maxInstructions;
+    const uint64_t cycleLimit = maxCycles == 0 ? std::numeric_limits<uint64_t>::max() : state.cycleCount + maxCycles;
+    const uint64_t startCycles = state.cycleCount;
+    Result result;
+    const auto start = std::chrono::steady_clock::now();
+    // nothing interrupts the cpu here, a halt is the end of the program too
+    while (!bdos.finished() && !state.halted && result.instructions != instructionLimit && state.cycleCount < cycleLimit) {
+        cpu.runCycle(state);
+        ++result.instructions;
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.cycles = state.cycleCount - startCycles;
+    result.finished = bdos.finished();
+    bdos.flush();
+    for (const std::unique_ptr<DiskImage>& disk : disks) {
+        if (disk)
+            disk->flush();
+    }
+    return result;
+}
+
+void CpmMachine::bios(State8080& state, const int& function) {
+    const uint16_t bc = static_cast<uint16_t>(state.b << 8 | state.c);
+    uint8_t c = 0;
+    switch (function) {
+        case 0: // BOOT
+        case 1: // WBOOT
+            bdos.boot(state);
+            return;
+        case 2: // CONST
+            state.a = bdos.charReady() ? 0xFF : 0x00;
+            break;
+        case 3: // CONIN
+            state.a = bdos.readChar(c) ? c : 0x1A;
+            break;
+        case 4: // CONOUT
+            bdos.print(static_cast<char>(state.c));
+            break;
+        case 5: // LIST
+        case 6: // PUNCH
+            break;
+        case 7: // READER, always at the end
+            state.a = 0x1A;
+            break;
+        case 8: // HOME
+            track = 0;
+            break;
+        case 9: { // SELDSK, the DPH or 0 if there is no such drive
+            const uint16_t dph = state.c < disks.size() && disks[state.c] ? tablesOf(state.c) : 0;
+            if (dph != 0)
+                selected = state.c;
+            state.h = dph >> 8;
+            state.l = dph & 0xFF;
+            break;
+        }
+        case 10: track = bc; break; // SETTRK
+        case 11: sector = bc; break; // SETSEC
+        case 12: dma = bc; break; // SETDMA
+        case 13: // READ
+        case 14: { // WRITE
+            uint8_t* found = disks[selected] && dma <= State8080::RAM - DiskImage::sectorSize ? disks[selected]->sector(track, sector) : nullptr;
+            if (found == nullptr) {
+                state.a = 1;
+                break;
+            }
+            if (function == 13)
+                std::memcpy(&state.memory[dma], found, DiskImage::sectorSize);
+            else
+                std::memcpy(found, &state.memory[dma], DiskImage::sectorSize);
+            state.a = 0;
+            break;
+        }
+        case 15: // LISTST, ready
+            state.a = 0xFF;
+            break;
+        case 16: { // SECTRAN, through the table at DE if there is one
+            const uint16_t xlt = static_cast<uint16_t>(state.d << 8 | state.e);
+            const uint16_t translated = xlt != 0 ? state.memory[static_cast<uint16_t>(xlt + bc)] : bc;
+            state.h = translated >> 8;
+            state.l = translated & 0xFF;
+            break;
+        }
+        default:
+            break;
+    }
+    Traps::ret(state);
+}
@@ -6,6 +6,7 @@
 #include <algorithm>
 
 #include "Disassembler8080.hpp"
+#include "OpcodeInfo.hpp"
 #include "tester.h"
 
 #define EXECOPCODE(obj, ptr, state) ((obj).*(ptr))(state) // executes a pointer to a function member with the object
@@ -224,6 +225,11 @@ Disassembler8080::Disassembler8080() {
 
 void Disassembler8080::runCycle(State8080& state) {
     uint8_t opcode = state.memory[state.programCounter];
+#ifdef OPCODE_STATS
+    const uint64_t startCycle = state.cycleCount;
+    const uint16_t fallThrough = static_cast<uint16_t>(state.programCounter + opcodeInfo[opcode].size);
+#endif
+    state.fetched(state.programCounter, opcodeInfo[opcode].size);
     opcodePtr opcodeFunc = opcodeTable[opcode];
     EXECOPCODE(*this, opcodeFunc, state);
     state.cycleCount += opCycles[opcode];
@@ -232,13 +238,19 @@ void Disassembler8080::runCycle(State8080& state) {
     if (opcodeFunc == &Disassembler8080::OP_IND8 || opcodeFunc == &Disassembler8080::OP_OUTD8)
         state.programCounter++;
     state.programCounter++;
+#ifdef OPCODE_STATS
+    // a branch was taken if the next instruction is not the one after it
+    stats.record(opcode, state.cycleCount - startCycle, state.programCounter != fallThrough);
+#endif
+    if (traps != nullptr && opcodeInfo[opcode].branch != OpcodeInfo::None)
+        traps->run(state);
 }
 
 void Disassembler8080::generateInterrupt(State8080& state, const uint8_t& interruptNum) {
     // push PC onto the stack
     uint16_t returnAddress = state.programCounter; // -5 works for ~42476
-    state.memory[state.stackPointer - 1] = (returnAddress >> 8) & 0xFF; // store high bit
-    state.memory[state.stackPointer - 2] = returnAddress & 0xFF; // store low bit
+    state.writeStack(state.stackPointer - 1, (returnAddress >> 8) & 0xFF); // store high bit
+    state.writeStack(state.stackPointer - 2, returnAddress & 0xFF); // store low bit
     state.stackPointer -= 2;
     // while there are 8 different numbers other than 2 for RST,
     // space invaders only uses number 2.
@@ -293,7 +305,7 @@ inline void Disassembler8080::INR(State8080& state, uint8_t& reg) const noexcept
     setZero(state, reg);
     setSign(state, reg);
     setParity(state, reg);
-    state.condFlags.auxCarry = (reg & 0xF) == 0xF; // aux only set if least 4 bits are all 1s
+    state.condFlags.auxCarry = (reg & 0xF) == 0; // aux only set if the least 4 bits carried into the next
 }
 
 
@@ -338,68 +350,73 @@ inline void Disassembler8080::MOV(uint8_t& dst, uint8_t& src) const noexcept {
     dst = src;
 }
 inline void Disassembler8080::MOV_SRC(State8080& state, uint8_t& src) const noexcept {
-    state.memory[static_cast<uint16_t>((static_cast<uint16_t>(state.h) << 8) | state.l  )] = src;
+    state.writeMemory(static_cast<uint16_t>((static_cast<uint16_t>(state.h) << 8) | state.l  ), src);
 }
 inline void Disassembler8080::MOV_DST(State8080& state, uint8_t& dst) const noexcept {
-    dst = state.memory[static_cast<uint16_t>((static_cast<uint16_t>(state.h) << 8) | state.l  )];
+    dst = state.readMemory(static_cast<uint16_t>((static_cast<uint16_t>(state.h) << 8) | state.l  ));
 }
 
 // Pop memory in the stack to the register pair regPair1 & regPair2
 inline void Disassembler8080::POP(State8080& state, uint8_t& regPair1, uint8_t& regPair2) const noexcept {
-    regPair2 = state.memory[state.stackPointer];
-    regPair1 = state.memory[state.stackPointer + 1];
+    regPair2 = state.readStack(state.stackPointer);
+    regPair1 = state.readStack(state.stackPointer + 1);
     state.stackPointer += 2;
 }
 
 // Push the register pair into the stack
 inline void Disassembler8080::PUSH(State8080& state, uint8_t& regPair1, uint8_t& regPair2) const noexcept {
-    state.memory[state.stackPointer - 1] = regPair1;
-    state.memory[state.stackPointer - 2] = regPair2;
+    state.writeStack(state.stackPointer - 1, regPair1);
+    state.writeStack(state.stackPointer - 2, regPair2);
     state.stackPointer -= 2;
 }
 
 // Add a register to the accumulator with the carry flag
 inline void Disassembler8080::ADC(State8080& state, const uint8_t& reg) const noexcept {
-    uint16_t sum = state.a + reg + state.condFlags.carry;
+    const uint8_t carry = state.condFlags.carry;
+    uint16_t sum = state.a + reg + carry;
+    // consider only the 4 bits and check if they carried into the upper 4
+    state.condFlags.auxCarry = ((state.a & 0xF) + (reg & 0xF) + carry) > 0xF;
     state.a = sum & 0xFF;
     setSign(state, sum);
     setParity(state, sum & 0xFF);
     setZero(state, sum);
     setCarry(state,sum, 0xFF);
-    // consider only the 4 bits and check if the upper 4 were modified
-    state.condFlags.auxCarry = ((state.a & 0xF) + reg + state.condFlags.carry) >> 4 != 0;
 }
 
 // Add a register to the accumulator
 inline void Disassembler8080::ADD(State8080& state, const uint8_t& reg) const noexcept {
     uint16_t sum = state.a + reg;
+    state.condFlags.auxCarry = ((state.a & 0xF) + (reg & 0xF)) > 0xF;
     state.a = sum & 0xFF;
     setSign(state, sum);
     setParity(state, sum & 0xFF);
     setZero(state, sum);
     setCarry(state,sum, 0xFF);
-    state.condFlags.auxCarry = ((state.a & 0xF) + reg) >> 4 != 0;
 }
 
 // Subtract register from accumulator
 inline void Disassembler8080::SUB(State8080& state, const uint8_t& reg) const noexcept {
-    uint8_t regComp = ~reg + 1; // produce two's complement using reg
-    uint16_t sum = state.a + regComp;
+    // the 8080 adds the one's complement of reg and a carry in of 1, the carry flag is the borrow
+    uint16_t sum = state.a + static_cast<uint8_t>(~reg) + 1;
+    state.condFlags.auxCarry = ((state.a & 0xF) + (~reg & 0xF) + 1) > 0xF;
     state.a = sum & 0xFF;
-    // setting of carry is inversed here because the numbers differ in sign
     state.condFlags.carry = sum > 0xFF ? 0 : 1;
     setParity(state, state.a);
     setZero(state, state.a);
     setSign(state, state.a);
-    // from https://github.com/omerjerk/i8080-emu
-    state.condFlags.auxCarry = ((state.a & 0xF) + (-state.b & 0xF)) > 0xF;
 }
 
 // Subtract register from accumulator but with borrow
 inline void Disassembler8080::SBB(State8080& state, const uint8_t& reg) const noexcept {
-    // Same thing as sub, but + carry bit is added to the reg first
-    uint8_t newReg = reg + state.condFlags.carry;
-    SUB(state, newReg);
+    // Same thing as sub, but the carry in is 0 when there is a borrow
+    const uint8_t carryIn = !state.condFlags.carry;
+    uint16_t sum = state.a + static_cast<uint8_t>(~reg) + carryIn;
+    state.condFlags.auxCarry = ((state.a & 0xF) + (~reg & 0xF) + carryIn) > 0xF;
+    state.a = sum & 0xFF;
+    state.condFlags.carry = sum > 0xFF ? 0 : 1;
+    setParity(state, state.a);
+    setZero(state, state.a);
+    setSign(state, state.a);
 }
 
 // Binary XOR the register with the accumulator
@@ -414,12 +431,13 @@ inline void Disassembler8080::XRA(State8080& state, const uint8_t& reg) const no
 
 // Binary AND the register with the accumulator
 inline void Disassembler8080::ANA(State8080& state, const uint8_t& reg) const noexcept {
+    // aux is bit 3 of either operand on the 8080
+    state.condFlags.auxCarry = ((state.a | reg) & 0x8) != 0;
     state.a &= reg;
     setParity(state, state.a);
     setZero(state, state.a);
     setSign(state, state.a);
     state.condFlags.carry = 0;
-    state.condFlags.auxCarry = ((state.a | reg) & 0x8) != 0;
 }
 
 // Binary OR the register with the accumulator
@@ -435,15 +453,10 @@ inline void Disassembler8080::ORA(State8080& state, const uint8_t& reg) const no
 // Subtract the register from the accumulator BUT do not modify the registers,
 // only modification of the flags
 inline void Disassembler8080::CMP(State8080& state, const uint8_t& reg) const noexcept {
-    uint8_t regComp = ~reg + 1; // two's complement
-    uint16_t sum = state.a + regComp;
-    // carry is inversed
     // sum is compared not the registers
-    state.condFlags.carry = sum > 0xFF ? 0 : 1;
-    setParity(state, sum & 0xFF);
-    setZero(state, sum);
-    setSign(state, sum);
-    state.condFlags.auxCarry = ~(state.a ^ sum ^ reg) & 0x10;
+    const uint8_t a = state.a;
+    SUB(state, reg);
+    state.a = a;
 }
 
 
@@ -469,8 +482,8 @@ inline void Disassembler8080::CALL(State8080& state, bool canJump) const noexcep
         uint16_t newAddress = static_cast<uint16_t>((state.memory[state.programCounter + 2] << 8) | state.memory[state.programCounter + 1]);
         // store the old address to the stack, it's pushed onto the stack
         uint16_t returnAddress = state.programCounter + 3; // skip to the next instruction after this one
-        state.memory[state.stackPointer - 1] = (returnAddress >> 8) & 0xFF; // store high bit
-        state.memory[state.stackPointer - 2] = returnAddress & 0xFF; // store low bit
+        state.writeStack(state.stackPointer - 1, (returnAddress >> 8) & 0xFF); // store high bit
+        state.writeStack(state.stackPointer - 2, returnAddress & 0xFF); // store low bit
         state.stackPointer -= 2;
         state.programCounter = newAddress;
         --state.programCounter; // inverse the increment of the program counter
@@ -485,7 +498,7 @@ inline void Disassembler8080::CALL(State8080& state, bool canJump) const noexcep
 inline void Disassembler8080::RET(State8080& state, bool canRet) const noexcept {
     if (canRet) {
         // pop the old address from the stack
-        state.programCounter = static_cast<uint16_t>(state.memory[state.stackPointer] | (state.memory[state.stackPointer + 1] << 8) );
+        state.programCounter = static_cast<uint16_t>(state.readStack(state.stackPointer) | (state.readStack(state.stackPointer + 1) << 8) );
         state.stackPointer += 2;
         --state.programCounter;
         state.cycleCount += 6;
@@ -496,8 +509,8 @@ inline void Disassembler8080::RET(State8080& state, bool canRet) const noexcept
 inline void Disassembler8080::RST(State8080& state, const uint8_t& resLoc) const noexcept {
     uint16_t newAddress = 8 * resLoc;
     uint16_t returnAddress = state.programCounter + 3; // skip to the next instruction after this one
-    state.memory[state.stackPointer - 1] = (returnAddress >> 8) & 0xFF; // store high bit
-    state.memory[state.stackPointer - 2] = returnAddress & 0xFF; // store low bit
+    state.writeStack(state.stackPointer - 1, (returnAddress >> 8) & 0xFF); // store high bit
+    state.writeStack(state.stackPointer - 2, returnAddress & 0xFF); // store low bit
     state.stackPointer -= 2;
     state.programCounter = newAddress;
     --state.programCounter; // inverse the increment of the program counter
@@ -575,7 +588,7 @@ void Disassembler8080::OP_MVIL_D8(State8080& state) {
 void Disassembler8080::OP_MVIM_D8(State8080& state) {
     // function won't work for this, store the byte into some location denoted by H & l pair
     uint16_t address = static_cast<uint16_t>( (static_cast<uint16_t>(state.h) << 8) | state.l);
-    state.memory[address] = state.memory[state.programCounter + 1];
+    state.writeMemory(address, state.memory[state.programCounter + 1]);
     ++state.programCounter;
 }
 
@@ -602,103 +615,50 @@ void Disassembler8080::OP_LXISP_D16(State8080& state) {
 
 // Adds the next byte to the accumulator
 void Disassembler8080::OP_ADI_D8(State8080& state) {
-    uint16_t sum = state.a + state.memory[state.programCounter + 1];
-    setZero(state, sum);
-    setParity(state, sum & 0xFF);
-    setSign(state, sum);
-    setCarry(state, sum, 0xFF);
-    state.condFlags.auxCarry = ((state.a & 0xF) + sum) >> 4 != 0;
-    state.a = 0xFF & sum;
+    ADD(state, state.memory[state.programCounter + 1]);
     ++state.programCounter;
 }
 
 // Adds the next byte to the accumulator, but with carry.
 void Disassembler8080::OP_ACI_D8(State8080& state) {
-    uint16_t sum = state.a + state.memory[state.programCounter + 1] + state.condFlags.carry;
-    setZero(state, sum);
-    setParity(state, sum & 0xFF);
-    setSign(state, sum);
-    setCarry(state, sum, 0xFF);
-    state.condFlags.auxCarry = ((state.a & 0xF) + sum + state.condFlags.carry) >> 4 != 0;
-    state.a = 0xFF & sum;
+    ADC(state, state.memory[state.programCounter + 1]);
     ++state.programCounter;
 }
 
-// state.condFlags.auxCarry = ((state.a & 0xF) + (-state.b & 0xF)) > 0xF;
 // Subtract the next byte from the accumulator
 void Disassembler8080::OP_SUI_D8(State8080& state) {
-    // this is needed to know if there was a carry
-    uint8_t subByte = ~state.memory[state.programCounter + 1] + 1; // subtracted byte using two's complement
-    uint16_t sum = state.a + subByte;
-    setZero(state, sum);
-    setParity(state, sum & 0xFF);
-    setSign(state, sum);
-    // carry is inversed here, set to 1 if no carry
-    state.condFlags.carry = sum > 0xFF ? 0 : 1;
-    state.condFlags.auxCarry = ((state.a & 0xF) + (~state.memory[state.programCounter + 1] & 0xF)) > 0xF;
-    state.a = sum & 0xFF;
+    SUB(state, state.memory[state.programCounter + 1]);
     ++state.programCounter;
 }
 
 // Subtract the next byte added with the carry bit from the accumulator
 void Disassembler8080::OP_SBI_D8(State8080& state) {
-    uint8_t subByte = ~(state.memory[state.programCounter + 1] + state.condFlags.carry) + 1; // subtracted byte using two's complement
-    uint16_t sum = state.a + subByte;
-    setZero(state, sum);
-    setParity(state, sum & 0xFF);
-    setSign(state, sum);
-    // carry is inversed here, set to 1 if no carry
-    state.condFlags.carry = sum > 0xFF ? 0 : 1;
-    state.condFlags.auxCarry =
-            ((state.a & 0xF) + (~(state.memory[state.programCounter + 1] + state.condFlags.carry) & 0xF)) > 0xF;
-    state.a = sum & 0xFF;
+    SBB(state, state.memory[state.programCounter + 1]);
     ++state.programCounter;
 }
 
 // perform binary AND with next byte with the accumulator
 void Disassembler8080::OP_ANI_D8(State8080& state) {
-    state.condFlags.auxCarry =
-            ((state.a | (state.a & state.memory[state.programCounter + 1])) & 0x8) != 0;
-    state.a &= state.memory[state.programCounter + 1];
-    state.condFlags.carry = 0;
-    setParity(state, state.a);
-    setZero(state, state.a);
-    setSign(state, state.a);
+    ANA(state, state.memory[state.programCounter + 1]);
     ++state.programCounter;
 }
 
 // Perform binary XOR with next byte with the accumulator
 void Disassembler8080::OP_XRI_D8(State8080& state) {
-    state.a ^= state.memory[state.programCounter + 1];
-    state.condFlags.carry = 0;
-    state.condFlags.auxCarry = 0;
-    setParity(state, state.a);
-    setZero(state, state.a);
-    setSign(state, state.a);
+    XRA(state, state.memory[state.programCounter + 1]);
     ++state.programCounter;
 }
 
 // Perform binary OR with next byte with the accumulator
 void Disassembler8080::OP_ORI_D8(State8080& state) {
-    state.a  |= state.memory[state.programCounter + 1];
-    state.condFlags.carry = 0;
-    state.condFlags.auxCarry = 0;
-    setParity(state, state.a);
-    setZero(state, state.a);
-    setSign(state, state.a);
+    ORA(state, state.memory[state.programCounter + 1]);
     ++state.programCounter;
 }
 
 
 // compare next byte with accumulator by subtracting, note that nothing is set.
 void Disassembler8080::OP_CPI_D8(State8080& state) {
-    uint8_t byte = state.memory[state.programCounter + 1];
-    uint16_t sum = state.a - byte;
-    setZero(state, sum);
-    setParity(state, sum & 0xFF);
-    setSign(state, sum);
-    setCarry(state, sum, 0xFF); // technically wrong due to text indicating its inversed, but pasts the test
-    state.condFlags.auxCarry = ~(state.a ^ sum ^ byte) & 0x10;
+    CMP(state, state.memory[state.programCounter + 1]);
     ++state.programCounter;
 }
 
@@ -711,7 +671,7 @@ void Disassembler8080::OP_STA_ADR(State8080& state) {
     uint8_t lowByte = state.memory[state.programCounter + 1];
     uint8_t highByte = state.memory[state.programCounter + 2];
     uint16_t address = static_cast<uint16_t>( (static_cast<uint16_t>(highByte) << 8) | lowByte);
-    state.memory[address] = state.a;
+    state.writeMemory(address, state.a);
     state.programCounter += 2;
 }
 // Set accumulator to the memory stored by the address of the next two bytes
@@ -719,7 +679,7 @@ void Disassembler8080::OP_LDA_ADR(State8080& state) {
     uint8_t lowByte = state.memory[state.programCounter + 1];
     uint8_t highByte = state.memory[state.programCounter + 2];
     uint16_t address = static_cast<uint16_t>( (static_cast<uint16_t>(highByte) << 8) | lowByte);
-    state.a = state.memory[address];
+    state.a = state.readMemory(address);
     state.programCounter += 2;
 }
 
@@ -729,8 +689,8 @@ void Disassembler8080::OP_SHLD(State8080& state){
     uint8_t lowByte = state.memory[state.programCounter + 1];
     uint8_t highByte = state.memory[state.programCounter + 2];
     uint16_t address = static_cast<uint16_t>( (static_cast<uint16_t>(highByte) << 8) | lowByte);
-    state.memory[address] = state.l;
-    state.memory[address + 1] = state.h;
+    state.writeMemory(address, state.l);
+    state.writeMemory(address + 1, state.h);
     state.programCounter += 2;
 }
 
@@ -740,8 +700,8 @@ void Disassembler8080::OP_LHLD(State8080& state){
     uint8_t lowByte = state.memory[state.programCounter + 1];
     uint8_t highByte = state.memory[state.programCounter + 2];
     uint16_t address = static_cast<uint16_t>( (static_cast<uint16_t>(highByte) << 8) | lowByte);
-    state.l = state.memory[address];
-    state.h = state.memory[address + 1];
+    state.l = state.readMemory(address);
+    state.h = state.readMemory(address + 1);
     state.programCounter += 2;
 }
 
@@ -866,23 +826,22 @@ void Disassembler8080::OP_CMA(State8080& state) {
 void Disassembler8080::OP_DAA(State8080& state) {
     uint8_t add = 0;
     uint8_t leastBits = state.a & 0xF;
-    uint8_t greatestBits = (state.a & 0xF0) >> 4;
     // if the 4 least sig bits are > 9
     if (leastBits > 9 || state.condFlags.auxCarry == 1) {
         add += 6;
     }
-    // if the 4 great sig bits are > 9
-    if (greatestBits > 9 || state.condFlags.carry == 1 ||
-            (greatestBits >= 9 && leastBits > 9)) {
+    // if the whole is over 99, the 4 great sig bits will be once the least are corrected.
+    // carry is only ever set, never cleared
+    if (state.a > 0x99 || state.condFlags.carry == 1) {
         add += 0x60;
+        state.condFlags.carry = 1;
     }
     uint16_t sum = state.a + add;
-    state.condFlags.auxCarry = ((state.a & 0xF) + sum) >> 4 != 0;
+    state.condFlags.auxCarry = (leastBits + (add & 0xF)) > 0xF;
     state.a = sum & 0xFF;
     setParity(state, state.a);
     setZero(state, state.a);
     setSign(state, state.a);
-    setCarry(state, sum, 0xFF);
 
 }
 
@@ -906,8 +865,9 @@ void Disassembler8080::OP_INRL(State8080& state) { // 0x2C
 }
 void Disassembler8080::OP_INRM(State8080& state) { // 0x34
     uint16_t address = static_cast<uint16_t>((static_cast<uint16_t>(state.h) << 8) | state.l);
-    uint8_t& byte = state.memory[address];
+    uint8_t byte = state.readMemory(address);
     INR(state, byte);
+    state.writeMemory(address, byte);
 }
 void Disassembler8080::OP_INRA(State8080& state) { // 0x3C
     INR(state, state.a);
@@ -935,8 +895,9 @@ void Disassembler8080::OP_DCRL(State8080& state) {
 
 void Disassembler8080::OP_DCRM(State8080& state) {
     uint16_t HL = static_cast<uint16_t>((static_cast<uint16_t>(state.h) << 8) | state.l);
-    uint8_t& byte = state.memory[HL];
+    uint8_t byte = state.readMemory(HL);
     DCR(state, byte);
+    state.writeMemory(HL, byte);
 }
 void Disassembler8080::OP_DCRA(State8080& state) {
     DCR(state, state.a);
@@ -957,11 +918,11 @@ void Disassembler8080::OP_NOP(State8080&) {
 // Contents of the accumulator is replaced by the location in memory denoted by the register pair
 void Disassembler8080::OP_LDAXD(State8080& state) {
     uint16_t location = static_cast<uint16_t>( (static_cast<uint16_t>(state.d) << 8) | state.e);
-    state.a = state.memory[location];
+    state.a = state.readMemory(location);
 }
 void Disassembler8080::OP_LDAXB(State8080& state) {
     uint16_t location = static_cast<uint16_t>( (static_cast<uint16_t>(state.b) << 8) | state.c);
-    state.a = state.memory[location];
+    state.a = state.readMemory(location);
 }
 
 // use a jump table for each move instruction
@@ -1014,12 +975,12 @@ void Disassembler8080::OP_MOV(State8080& state) {
 // Contents of accumulator is placed into memory location denoted by register pair
 void Disassembler8080::OP_STAXB(State8080& state) {
     uint16_t address = static_cast<uint16_t>((static_cast<uint16_t>(state.b) << 8) | state.c);
-    state.memory[address] = state.a;
+    state.writeMemory(address, state.a);
 
 }
 void Disassembler8080::OP_STAXD(State8080& state) {
     uint16_t address = static_cast<uint16_t>((static_cast<uint16_t>(state.d) << 8) | state.e);
-    state.memory[address] = state.a;
+    state.writeMemory(address, state.a);
 }
 
 
@@ -1039,7 +1000,7 @@ void Disassembler8080::OP_STAXD(State8080& state) {
     case numSrc + 3: func(state, state.e); break; \
     case numSrc + 4: func(state, state.h); break; \
     case numSrc + 5: func(state, state.l); break; \
-    case numSrc + 6: func(state, state.memory[static_cast<uint16_t>((static_cast<uint16_t>(state.h) << 8) | state.l)]); break; \
+    case numSrc + 6: func(state, state.readMemory(static_cast<uint16_t>((static_cast<uint16_t>(state.h) << 8) | state.l))); break; \
     case numSrc + 7: func(state, state.a); break; \
 
 
@@ -1086,7 +1047,7 @@ void Disassembler8080::OP_RLC(State8080& state) {
 void Disassembler8080::OP_RAL(State8080& state) {
     uint8_t highestOrderBit = (state.a & 0x80) >> 7;
     state.a <<= 1;
-    state.a |= (state.condFlags.carry << 7); // put carry into highest order bit
+    state.a |= state.condFlags.carry; // put carry into lowest order bit
     state.condFlags.carry = highestOrderBit; // put hob into carry;
 }
 
@@ -1208,10 +1169,12 @@ void Disassembler8080::OP_XCHG(State8080& state) {
 // H and the byte by SP + 1 are swapped
 // SP does not change
 void Disassembler8080::OP_XTHL(State8080& state) {
-    uint8_t& byteSP = state.memory[state.stackPointer];
-    uint8_t& byteSP1 = state.memory[state.stackPointer + 1];
-    std::swap(byteSP, state.l);
-    std::swap(byteSP1, state.h);
+    uint8_t byteSP = state.readStack(state.stackPointer);
+    uint8_t byteSP1 = state.readStack(state.stackPointer + 1);
+    state.writeStack(state.stackPointer, state.l);
+    state.writeStack(state.stackPointer + 1, state.h);
+    state.l = byteSP;
+    state.h = byteSP1;
 }
 
 // SP now points to the address by the H & L registers
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define DISKIMAGE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "DiskImage.hpp"
+
+constexpr std::size_t DiskImage::sectorSize;
+
+namespace {
+
+// skew 6, the standard 8" interleave
+const uint8_t ibm3740Skew[26] = {
+    1, 7, 13, 19, 25, 5, 11, 17, 23, 3, 9, 15, 21, 2, 8, 14, 20, 26, 6, 12, 18, 24, 4, 10, 16, 22
+};
+
+} // namespace
+
+const std::array<DiskFormat, 2> diskFormats = {{
+    {"ibm-3740", 26, 77, 2, 1024, 64, 1, ibm3740Skew},
+    {"z80pack-hdb", 128, 255, 0, 2048, 1024, 0, nullptr}
+}};
+
+const DiskFormat* DiskImage::formatOf(const std::size_t& size) noexcept {
+    for (const DiskFormat& format : diskFormats) {
+        if (format.size() == size)
+            return &format;
+    }
+    return nullptr;
+}
+
+void DiskImage::create(const std::string& fname, const DiskFormat& format) {
+    std::ofstream ofs(fname, std::ios_base::binary);
+    if (!ofs.good())
+        throw std::runtime_error("Unable to open file for writing, given path:" + fname);
+    // a formatted disk is all E5, which is also an empty directory
+    const std::vector<char> track(static_cast<std::size_t>(format.sectorsPerTrack) * sectorSize, static_cast<char>(0xE5));
+    for (uint16_t i = 0; i != format.tracks; i++) {
+        ofs.write(track.data(), static_cast<std::streamsize>(track.size()));
+    }
+    ofs.close();
+    if (!ofs.good())
+        throw std::runtime_error("Unable to write disk image, given path:" + fname);
+}
+
+DiskImage::DiskImage(const std::string& fname) : fname(fname) {
+#ifdef DISKIMAGE_MMAP
+    int fd = ::open(fname.c_str(), O_RDWR);
+    if (fd == -1)
+        throw std::runtime_error("Disk image not found or not writable, given path:" + fname);
+    struct stat info;
+    if (::fstat(fd, &info) == -1) {
+        ::close(fd);
+        throw std::runtime_error("Unable to read file size, given path:" + fname);
+    }
+    length = static_cast<std::size_t>(info.st_size);
+    geometry = formatOf(length);
+    if (geometry == nullptr) {
+        ::close(fd);
+        throw std::runtime_error(fname + " is not the size of a known disk format");
+    }
+    void* addr = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd); // the mapping stays valid after the descriptor is closed
+    if (addr == MAP_FAILED)
+        throw std::runtime_error("Unable to map disk image, given path:" + fname);
+    bytes = static_cast<uint8_t*>(addr);
+    mapped = true;
+#else
+    std::ifstream ifs(fname, std::ios_base::binary);
+    if (!ifs.good())
+        throw std::runtime_error("Disk image not found, given path:" + fname);
+    std::vector<char> contents((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    length = contents.size();
+    geometry = formatOf(length);
+    if (geometry == nullptr)
+        throw std::runtime_error(fname + " is not the size of a known disk format");
+    bytes = new uint8_t[length];
+    std::copy(contents.begin(), contents.end(), bytes);
+#endif
+}
+
+DiskImage::~DiskImage() {
+#ifdef DISKIMAGE_MMAP
+    if (mapped)
+        ::munmap(bytes, length);
+#else
+    try {
+        flush();
+    } catch (std::exception&) {
+        // nothing can be done about it while closing
+    }
+    delete[] bytes;
+#endif
+}
+
+void DiskImage::flush() {
+#ifdef DISKIMAGE_MMAP
+    if (mapped && ::msync(bytes, length, MS_SYNC) == -1)
+        throw std::runtime_error("Unable to write disk image, given path:" + fname);
+#else
+    std::ofstream ofs(fname, std::ios_base::binary);
+    ofs.write(reinterpret_cast<const char*>(bytes), static_cast<std::streamsize>(length));
+    ofs.close();
+    if (!ofs.good())
+        throw std::runtime_error("Unable to write disk image, given path:" + fname);
+#endif
+}
+
+uint8_t* DiskImage::sector(const uint16_t& track, const uint16_t& sector) noexcept {
+    if (track >= geometry->tracks || sector < geometry->firstSector || sector - geometry->firstSector >= geometry->sectorsPerTrack)
+        return nullptr;
+    return bytes + (static_cast<std::size_t>(track) * geometry->sectorsPerTrack + sector - geometry->firstSector) * sectorSize;
+}
+
+uint8_t* DiskImage::record(const uint32_t& index) noexcept {
+    const uint32_t track = geometry->reservedTracks + index / geometry->sectorsPerTrack;
+    const uint32_t logical = index % geometry->sectorsPerTrack;
+    const uint32_t physical = geometry->skew != nullptr ? geometry->skew[logical] : logical + geometry->firstSector;
+    if (track >= geometry->tracks)
+        return nullptr;
+    return sector(static_cast<uint16_t>(track), static_cast<uint16_t>(physical));
+}
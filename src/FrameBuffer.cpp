@@ -0,0 +1,27 @@
+#include "FrameBuffer.hpp"
+
+constexpr int FrameBuffer::width;
+constexpr int FrameBuffer::height;
+constexpr uint16_t FrameBuffer::vramStart;
+
+FrameBuffer::FrameBuffer() : pixels(static_cast<std::size_t>(width * height), 0xFF000000) {
+
+}
+
+void FrameBuffer::convert(const State8080& state, const ColorOverlay& overlay) noexcept {
+    static constexpr uint32_t black = 0xFF000000;
+    const uint8_t* vram = state.memory.data() + vramStart;
+    const uint32_t* colors = overlay.data();
+    uint32_t* out = pixels.data();
+
+    // a single byte determines the next 8 pixels, the least significant bit being the first
+    // a lit pixel takes the overlay's colour, the bit is turned into a mask of all 0s or all 1s
+    // and multiplied into the colour so there is no branch and the inner loop vectorizes
+    for (std::size_t i = 0; i != ColorOverlay::size; i++, out += 8) {
+        const uint32_t byte = vram[i];
+        const uint32_t color = colors[i];
+        for (uint32_t bit = 0; bit != 8; bit++) {
+            out[bit] = black | (color & (0u - ((byte >> bit) & 1u)));
+        }
+    }
+}
@@ -0,0 +1,132 @@
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+
+#include "FrameHash.hpp"
+
+namespace {
+
+constexpr uint64_t prime1 = 11400714785074694791ULL;
+constexpr uint64_t prime2 = 14029467366897019727ULL;
+constexpr uint64_t prime3 = 1609587929392839161ULL;
+constexpr uint64_t prime4 = 9650029242287828579ULL;
+constexpr uint64_t prime5 = 2870177450012600261ULL;
+
+inline uint64_t rotl(uint64_t value, int bits) noexcept {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// input is read in the host's order, the hash matches the reference on little endian machines
+inline uint64_t read64(const uint8_t* data) noexcept {
+    uint64_t value;
+    std::memcpy(&value, data, sizeof value);
+    return value;
+}
+
+inline uint32_t read32(const uint8_t* data) noexcept {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof value);
+    return value;
+}
+
+inline uint64_t round(uint64_t acc, uint64_t input) noexcept {
+    acc += input * prime2;
+    acc = rotl(acc, 31);
+    return acc * prime1;
+}
+
+inline uint64_t merge(uint64_t acc, uint64_t value) noexcept {
+    acc ^= round(0, value);
+    return acc * prime1 + prime4;
+}
+
+} // namespace
+
+uint64_t xxhash64(const uint8_t* data, std::size_t size, uint64_t seed) noexcept {
+    const uint8_t* const end = data + size;
+    uint64_t hash;
+    if (size >= 32) {
+        // four independent lanes of 8 bytes
+        uint64_t v1 = seed + prime1 + prime2;
+        uint64_t v2 = seed + prime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - prime1;
+        const uint8_t* const limit = end - 32;
+        do {
+            v1 = round(v1, read64(data));
+            v2 = round(v2, read64(data + 8));
+            v3 = round(v3, read64(data + 16));
+            v4 = round(v4, read64(data + 24));
+            data += 32;
+        } while (data <= limit);
+        hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        hash = merge(hash, v1);
+        hash = merge(hash, v2);
+        hash = merge(hash, v3);
+        hash = merge(hash, v4);
+    }
+    else {
+        hash = seed + prime5;
+    }
+    hash += size;
+
+    for (; data + 8 <= end; data += 8) {
+        hash ^= round(0, read64(data));
+        hash = rotl(hash, 27) * prime1 + prime4;
+    }
+    if (data + 4 <= end) {
+        hash ^= read32(data) * prime1;
+        hash = rotl(hash, 23) * prime2 + prime3;
+        data += 4;
+    }
+    for (; data != end; data++) {
+        hash ^= *data * prime5;
+        hash = rotl(hash, 11) * prime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t frameHash(const State8080& state) noexcept {
+    return xxhash64(state.memory.data() + frameHashStart, frameHashSize);
+}
+
+std::vector<uint64_t> frameHashesFromFile(const std::string& fname) {
+    std::ifstream ifs(fname);
+    if (!ifs.good())
+        throw std::runtime_error("Frame hashes not found, given path:" + fname);
+    std::vector<uint64_t> hashes;
+    std::string line;
+    for (std::size_t lineNum = 1; std::getline(ifs, line); lineNum++) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        try {
+            hashes.push_back(std::stoull(line, nullptr, 16));
+        } catch (std::logic_error&) {
+            throw std::runtime_error(fname + ":" + std::to_string(lineNum) + ", not a hash");
+        }
+    }
+    return hashes;
+}
+
+void frameHashesToFile(const std::string& fname, const std::vector<uint64_t>& hashes, const std::string& comment) {
+    std::ofstream ofs(fname);
+    if (!ofs.good())
+        throw std::runtime_error("Unable to open file for writing, given path:" + fname);
+    if (!comment.empty())
+        ofs << "# " << comment << '\n';
+    ofs << std::hex << std::setfill('0');
+    for (const uint64_t& hash : hashes) {
+        ofs << std::setw(16) << hash << '\n';
+    }
+    ofs.close();
+    if (!ofs.good())
+        throw std::runtime_error("Unable to write frame hashes, given path:" + fname);
+}
@@ -0,0 +1,69 @@
+#include "InputLatch.hpp"
+
+constexpr uint8_t InputLatch::port1Mask;
+constexpr uint8_t InputLatch::port2Mask;
+
+// Where each button lives in the ports
+const std::array<InputLatch::PortBit, InputLatch::ButtonCount> InputLatch::portBits = {{
+    {1, 1 << 0}, // coin
+    {1, 1 << 2}, // p1 start
+    {1, 1 << 4}, // p1 shoot
+    {1, 1 << 5}, // p1 joystick left
+    {1, 1 << 6}, // p1 joystick right
+    {1, 1 << 1}, // p2 start
+    {2, 1 << 4}, // p2 shoot
+    {2, 1 << 5}, // p2 joystick left
+    {2, 1 << 6}  // p2 joystick right
+}};
+
+void InputLatch::set(const Button& button, bool pressed) noexcept {
+    const PortBit& portBit = portBits[button];
+    uint8_t& buttons = portBit.port == 1 ? buttons1 : buttons2;
+    uint8_t old = buttons;
+    if (pressed)
+        buttons |= portBit.mask;
+    else
+        buttons &= ~portBit.mask;
+
+    // only the first change before a latch is timed, that is the one that waits the longest
+    if (buttons != old && !pending) {
+        pending = true;
+        changedAt = clock::now();
+    }
+}
+
+void InputLatch::restore(const uint8_t& port1, const uint8_t& port2) noexcept {
+    buttons1 = port1 & port1Mask;
+    buttons2 = port2 & port2Mask;
+    pending = false; // nothing was pressed, so there is no latency to time
+}
+
+void InputLatch::latch(State8080& state) noexcept {
+    // bits of the ports that are not buttons are left alone
+    state.port1 = static_cast<uint8_t>((state.port1 & ~port1Mask) | buttons1);
+    state.port2 = static_cast<uint8_t>((state.port2 & ~port2Mask) | buttons2);
+
+    if (pending) {
+        clock::duration latency = clock::now() - changedAt;
+        totalLatency += latency;
+        if (latency > maxLatency)
+            maxLatency = latency;
+        ++samples;
+        pending = false;
+    }
+}
+
+double InputLatch::meanLatencyMs() const noexcept {
+    if (samples == 0)
+        return 0;
+    return std::chrono::duration<double, std::milli>(totalLatency).count() / samples;
+}
+
+double InputLatch::maxLatencyMs() const noexcept {
+    return std::chrono::duration<double, std::milli>(maxLatency).count();
+}
+
+void InputLatch::reportLatency(std::ostream& os) const {
+    os << "Input to port latency: " << samples << " samples, mean " << meanLatencyMs()
+       << " ms, max " << maxLatencyMs() << " ms" << std::endl;
+}
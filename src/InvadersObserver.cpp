@@ -0,0 +1,146 @@
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "InvadersObserver.hpp"
+
+constexpr uint16_t InvadersView::playerAliveAddress;
+constexpr uint16_t InvadersView::playerXAddress;
+constexpr uint16_t InvadersView::playerShotAddress;
+constexpr uint16_t InvadersView::rollingShotAddress;
+constexpr uint16_t InvadersView::plungerShotAddress;
+constexpr uint16_t InvadersView::squigglyShotAddress;
+constexpr uint16_t InvadersView::fleetYAddress;
+constexpr uint16_t InvadersView::playerPageAddress;
+constexpr uint16_t InvadersView::aliensLeftAddress;
+constexpr uint16_t InvadersView::creditsAddress;
+constexpr uint16_t InvadersView::gameModeAddress;
+constexpr uint16_t InvadersView::hiScoreAddress;
+constexpr uint16_t InvadersView::player1ScoreAddress;
+constexpr uint16_t InvadersView::player2ScoreAddress;
+constexpr uint16_t InvadersView::shipsOffset;
+constexpr std::size_t InvadersView::alienRows;
+constexpr std::size_t InvadersView::alienColumns;
+
+constexpr int InvadersObserver::vramWidth;
+constexpr int InvadersObserver::vramHeight;
+constexpr uint16_t InvadersObserver::vramStart;
+
+namespace {
+
+constexpr int lineBytes = InvadersObserver::vramWidth / 8;
+
+uint32_t bcdByte(const uint8_t& byte) noexcept {
+    return (byte >> 4) * 10u + (byte & 0x0F);
+}
+
+} // namespace
+
+uint8_t InvadersView::credits() const noexcept {
+    return static_cast<uint8_t>(bcdByte(memory[creditsAddress]));
+}
+
+uint32_t InvadersView::bcd(const uint16_t& address) const noexcept {
+    return bcdByte(memory[address + 1]) * 100 + bcdByte(memory[address]);
+}
+
+std::array<InvadersView::Shot, 3> InvadersView::alienShots() const noexcept {
+    return {{
+        shot(rollingShotAddress, (memory[rollingShotAddress] & 0x80) != 0),
+        shot(plungerShotAddress, (memory[plungerShotAddress] & 0x80) != 0),
+        shot(squigglyShotAddress, (memory[squigglyShotAddress] & 0x80) != 0)
+    }};
+}
+
+void InvadersView::writeCsvHeader(std::ostream& os) {
+    os << "frame,playing,player,score,hi_score,credits,ships,player_alive,player_x,player_shot,player_shot_x,player_shot_y,"
+       << "rolling_shot,rolling_shot_x,rolling_shot_y,plunger_shot,plunger_shot_x,plunger_shot_y,"
+       << "squiggly_shot,squiggly_shot_x,squiggly_shot_y,aliens_left,fleet_x,fleet_y\n";
+}
+
+void InvadersView::writeCsv(std::ostream& os, const uint64_t& frame) const {
+    auto writeShot = [&os](const Shot& shot) {
+        os << ',' << shot.active << ',' << int(shot.x) << ',' << int(shot.y);
+    };
+    os << frame << ',' << playing() << ',' << int(player()) << ',' << score() << ',' << hiScore() << ',' << int(credits())
+       << ',' << int(ships()) << ',' << playerAlive() << ',' << int(playerX());
+    writeShot(playerShot());
+    for (const Shot& shot : alienShots()) {
+        writeShot(shot);
+    }
+    os << ',' << int(aliensLeft()) << ',' << int(fleetX()) << ',' << int(fleetY()) << '\n';
+}
+
+InvadersObserver::InvadersObserver() : InvadersObserver(Screen()) {
+
+}
+
+InvadersObserver::InvadersObserver(const Screen& screen) : crop(screen) {
+    const bool factorOk = crop.factor == 1 || crop.factor == 2 || crop.factor == 4 || crop.factor == 8;
+    if (crop.width != 0 && (!factorOk || crop.x < 0 || crop.y < 0 || crop.height <= 0 || crop.x % 8 != 0 || crop.width % 8 != 0
+                            || crop.height % crop.factor != 0 || crop.x + crop.width > vramWidth || crop.y + crop.height > vramHeight))
+        throw std::runtime_error("A screen crop must fit in video RAM, start and end on whole bytes and shrink by 1, 2, 4 or 8, given crop:"
+                                 + std::to_string(crop.x) + "," + std::to_string(crop.y) + " " + std::to_string(crop.width) + "x"
+                                 + std::to_string(crop.height) + "/" + std::to_string(crop.factor));
+    if (crop.width != 0)
+        pixels.resize(static_cast<std::size_t>(screenWidth() * screenHeight()));
+}
+
+template <int factor>
+void InvadersObserver::shrink(const uint8_t* vram) noexcept {
+    // the squares of a byte, one every factor bits, are spread to a byte each of a little endian word by a multiply
+    // that shifts square p up by p * (8 - factor), the shifted copies never carry into the bytes kept
+    constexpr int perByte = 8 / factor;
+    constexpr uint64_t spread = factor == 1 ? 0x0002040810204081ull : factor == 2 ? 0x41041ull : factor == 4 ? 0x11ull : 0x1ull;
+    constexpr uint64_t ones = 0x0101010101010101ull >> (64 - 8 * perByte);
+    constexpr unsigned squares = factor == 1 ? 0xFF : factor == 2 ? 0x55 : factor == 4 ? 0x11 : 0x01;
+    const int bytes = crop.width / 8;
+    const int skipped = crop.x / 8;
+    const int last = crop.y + crop.height;
+    uint8_t* out = pixels.data();
+    for (int line = crop.y; line != last; line += factor) {
+        // the factor lines of a row of squares or-ed together, whole lines so the loops have a fixed length
+        const uint8_t* first = vram + line * lineBytes;
+        uint8_t lit[lineBytes];
+        for (int i = 0; i != lineBytes; i++) {
+            lit[i] = first[i];
+        }
+        for (int next = 1; next != factor; next++) {
+            for (int i = 0; i != lineBytes; i++) {
+                lit[i] |= first[next * lineBytes + i];
+            }
+        }
+        // then the bits of each square, the least significant bit being the first pixel,
+        // with a single factor the top bit would carry so it goes on its own
+        for (int i = skipped; i != skipped + bytes; i++, out += perByte) {
+            uint64_t byte = lit[i];
+            for (int shift = 1; shift != factor; shift <<= 1) {
+                byte |= byte >> shift;
+            }
+            byte &= squares;
+            const uint64_t spreaded = factor == 1 ? (((byte & 0x7F) * spread) & ones) | (byte >> 7 << 56) : (byte * spread) & ones;
+            std::memcpy(out, &spreaded, perByte);
+        }
+    }
+}
+
+InvadersObserver::Observation InvadersObserver::observe(const SpaceInvaders& machine) {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const uint8_t* vram = machine.state.memory.data() + vramStart;
+    switch (crop.width == 0 ? 0 : crop.factor) {
+        case 0: break;
+        case 1: shrink<1>(vram); break;
+        case 2: shrink<2>(vram); break;
+        case 4: shrink<4>(vram); break;
+        case 8: shrink<8>(vram); break;
+    }
+    observeTime += std::chrono::steady_clock::now() - start;
+    ++observations;
+    return {machine.frameCount(), InvadersView(machine.state), pixels.empty() ? nullptr : pixels.data()};
+}
+
+double InvadersObserver::meanObserveUs() const noexcept {
+    if (observations == 0)
+        return 0;
+    return std::chrono::duration<double, std::micro>(observeTime).count() / observations;
+}
@@ -0,0 +1,247 @@
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+#include "KernelGenerator.hpp"
+
+namespace {
+
+const char* const aluOps[] = {"ADD", "ADC", "SUB", "SBB", "ANA", "XRA", "ORA", "CMP"};
+const char* const immediateOps[] = {"ADI", "ACI", "SUI", "SBI", "ANI", "XRI", "ORI", "CPI"};
+const char* const conditions[] = {"NZ", "Z", "NC", "C", "PO", "PE", "P", "M"};
+const char* const registers = "BCDEHLA";
+
+constexpr unsigned maxLength = 1024;
+constexpr unsigned subroutines = 4;
+constexpr unsigned maxDepth = 8; // of the pushes in the stack kernel
+
+// The source of one kernel, the random numbers come from mt19937 taken modulo so they do not depend on the library
+class Writer {
+public:
+    explicit Writer(const uint32_t& seed) : rng(seed) {}
+
+    uint32_t pick(const uint32_t& count) {
+        return rng() % count;
+    }
+
+    std::string byte() {
+        return hex(pick(256), "%03XH");
+    }
+
+    std::string reg() {
+        return std::string(1, registers[pick(7)]);
+    }
+
+    static std::string hex(const uint32_t& value, const char* format) {
+        char text[16];
+        std::snprintf(text, sizeof text, format, value);
+        return text;
+    }
+
+    std::string label() {
+        return "L" + std::to_string(++labels);
+    }
+
+    void line(const std::string& mnemonic, const std::string& operands = "") {
+        os << "        " << mnemonic;
+        if (!operands.empty())
+            os << std::string(8 - mnemonic.size(), ' ') << operands;
+        os << "\n";
+        ++count;
+    }
+
+    void labelLine(const std::string& name) {
+        os << name << ":\n";
+    }
+
+    // An instruction that changes A and the flags or a register, B only if withB
+    void alu(const bool& withB) {
+        const std::string r = withB ? reg() : std::string(1, registers[1 + pick(6)]);
+        switch (pick(10)) {
+            case 0: case 1: case 2: case 3:
+                line(aluOps[pick(8)], reg());
+                break;
+            case 4: case 5:
+                line(immediateOps[pick(8)], byte());
+                break;
+            case 6:
+                line(pick(2) == 0 ? "INR" : "DCR", r);
+                break;
+            case 7:
+                line("MOV", r + "," + reg());
+                break;
+            case 8:
+                line("MVI", r + "," + byte());
+                break;
+            default: {
+                const char* const misc[] = {"RLC", "RRC", "RAL", "RAR", "CMA", "STC", "CMC", "DAA"};
+                line(misc[pick(8)]);
+                break;
+            }
+        }
+    }
+
+    std::ostringstream os;
+    unsigned count = 0; // instructions written
+    unsigned labels = 0;
+
+private:
+    std::mt19937 rng;
+};
+
+void alu(Writer& writer, const unsigned& length) {
+    while (writer.count < length) {
+        writer.alu(true);
+    }
+}
+
+void memory(Writer& writer, const unsigned& length) {
+    const char* const data = "ABC";
+    auto address = [&]() { return Writer::hex(0x2000 + writer.pick(0x17FF), "%05XH"); }; // SHLD writes two bytes
+    writer.line("LXI", "H,DATA1");
+    writer.line("LXI", "D,DATA2");
+    writer.count = 0;
+    while (writer.count < length) {
+        const std::string r(1, data[writer.pick(3)]);
+        switch (writer.pick(12)) {
+            case 0: case 1: writer.line("MOV", r + ",M"); break;
+            case 2: case 3: writer.line("MOV", "M," + r); break;
+            case 4: writer.line("MVI", "M," + writer.byte()); break;
+            case 5: writer.line("LDAX", "D"); break;
+            case 6: writer.line("STAX", "D"); break;
+            case 7: writer.line("INX", writer.pick(2) == 0 ? "H" : "D"); break;
+            case 8: writer.line(writer.pick(2) == 0 ? "LDA" : "STA", address()); break;
+            case 9: writer.line(writer.pick(2) == 0 ? "INR" : "DCR", "M"); break;
+            case 10: writer.line(aluOps[writer.pick(8)], "M"); break;
+            default: writer.line("SHLD", address()); break;
+        }
+    }
+}
+
+void branch(Writer& writer, const unsigned& length) {
+    while (writer.count < length) {
+        const uint32_t kind = writer.pick(6);
+        const std::string target = kind != 0 ? writer.label() : "";
+        switch (kind) {
+            case 0:
+                writer.line("INR", "B");
+                break;
+            case 1: case 2: case 3:
+                // B counts the passes, so the branch is taken on some of them and not on others
+                writer.line("MOV", "A,B");
+                switch (writer.pick(3)) {
+                    case 0: writer.line("ANI", Writer::hex(1u << writer.pick(8), "%03XH")); break;
+                    case 1: writer.line("CPI", writer.byte()); break;
+                    default: writer.line("ORA", "A"); break;
+                }
+                writer.line(std::string("J") + conditions[writer.pick(8)], target);
+                writer.alu(false);
+                writer.labelLine(target);
+                break;
+            case 4:
+                writer.line("MVI", "C," + std::to_string(2 + writer.pick(3)));
+                writer.labelLine(target);
+                writer.line("DCR", "C");
+                writer.line("JNZ", target);
+                break;
+            default:
+                writer.line("JMP", target);
+                writer.alu(false);
+                writer.labelLine(target);
+                break;
+        }
+    }
+}
+
+void stack(Writer& writer, const unsigned& length) {
+    const char* const pairs[] = {"B", "D", "H", "PSW"};
+    auto subroutine = [&]() { return "SUB" + std::to_string(writer.pick(subroutines)); };
+    unsigned depth = 0;
+    while (writer.count < length) {
+        switch (writer.pick(8)) {
+            case 0: case 1:
+                if (depth < maxDepth) {
+                    writer.line("PUSH", pairs[writer.pick(4)]);
+                    ++depth;
+                }
+                break;
+            case 2: case 3:
+                if (depth > 0) {
+                    writer.line("POP", pairs[writer.pick(4)]);
+                    --depth;
+                }
+                break;
+            case 4:
+                if (depth > 0)
+                    writer.line("XTHL");
+                break;
+            case 5:
+                writer.line("CALL", subroutine());
+                break;
+            case 6:
+                writer.line("ORA", "A");
+                writer.line(std::string("C") + conditions[writer.pick(8)], subroutine());
+                break;
+            default:
+                writer.alu(true);
+                break;
+        }
+    }
+    for (; depth > 0; depth--) {
+        writer.line("POP", pairs[writer.pick(4)]);
+    }
+}
+
+// The subroutines the stack kernel calls, they return early on some of their calls
+void subroutinesOf(Writer& writer) {
+    for (unsigned i = 0; i != subroutines; i++) {
+        writer.labelLine("SUB" + std::to_string(i));
+        writer.alu(true);
+        writer.line("PUSH", "H");
+        writer.alu(true);
+        writer.line("POP", "H");
+        writer.line(std::string("R") + conditions[writer.pick(8)]);
+        writer.alu(true);
+        writer.line("RET");
+    }
+}
+
+} // namespace
+
+const std::vector<std::string>& KernelGenerator::mixes() {
+    static const std::vector<std::string> names = {"alu", "memory", "branch", "stack"};
+    return names;
+}
+
+std::string KernelGenerator::source(const std::string& mix, const unsigned& length, const uint32_t& seed) {
+    if (length == 0 || length > maxLength)
+        throw std::runtime_error("A kernel has 1 to " + std::to_string(maxLength) + " instructions, given length:" + std::to_string(length));
+    void (*body)(Writer&, const unsigned&) = nullptr;
+    if (mix == "alu") body = alu;
+    else if (mix == "memory") body = memory;
+    else if (mix == "branch") body = branch;
+    else if (mix == "stack") body = stack;
+    else throw std::runtime_error("Unknown kernel mix, given name:" + mix);
+
+    Writer writer(seed);
+    writer.os << "; " << mix << " kernel of " << length << " instructions, seed " << seed << "\n"
+              << "DATA1   EQU     2000H\n"
+              << "DATA2   EQU     3000H\n"
+              << "STACK   EQU     4000H\n"
+              << "        ORG     100H\n"
+              << "START:\n";
+    writer.line("LXI", "SP,STACK");
+    writer.line("LXI", "B," + Writer::hex(writer.pick(0x10000), "%05XH"));
+    writer.line("LXI", "D,DATA2");
+    writer.line("LXI", "H,DATA1");
+    writer.line("MVI", "A," + writer.byte());
+    writer.labelLine("LOOP");
+    writer.count = 0;
+    body(writer, length);
+    writer.line("JMP", "LOOP");
+    if (mix == "stack")
+        subroutinesOf(writer);
+    writer.os << "        END     START\n";
+    return writer.os.str();
+}
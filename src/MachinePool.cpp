@@ -0,0 +1,53 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "MachinePool.hpp"
+
+MachinePool::MachinePool(const Snapshot& baseline, std::size_t count) : start(baseline) {
+    machines.reserve(count);
+    ready.reserve(count);
+    for (std::size_t i = 0; i != count; i++) {
+        ready.push_back(make());
+    }
+}
+
+SpaceInvaders* MachinePool::acquire() {
+    if (ready.empty())
+        return make();
+    SpaceInvaders* machine = ready.back();
+    ready.pop_back();
+    return machine;
+}
+
+void MachinePool::release(SpaceInvaders* machine) {
+    const auto owned = std::find_if(machines.begin(), machines.end(), [&](const std::unique_ptr<SpaceInvaders>& m) { return m.get() == machine; });
+    if (owned == machines.end() || std::find(ready.begin(), ready.end(), machine) != ready.end())
+        throw std::runtime_error("Released a machine that is not out of this pool");
+
+    machine->mixer = nullptr;
+    machine->movie = nullptr;
+    machine->profiler = nullptr;
+    machine->callGraph = nullptr;
+    machine->trace = nullptr;
+    machine->coverage = nullptr;
+    machine->cpu.traps = nullptr;
+#ifdef MEMORY_STATS
+    machine->state.heatmap = nullptr;
+#endif
+    pagesRestored += start.reset(*machine);
+    ++resetCount;
+    ready.push_back(machine);
+}
+
+double MachinePool::meanPagesRestored() const noexcept {
+    return resetCount != 0 ? static_cast<double>(pagesRestored) / resetCount : 0.0;
+}
+
+// The only full copy of memory a machine gets, from then on its dirty pages are relative to the baseline
+SpaceInvaders* MachinePool::make() {
+    machines.push_back(std::unique_ptr<SpaceInvaders>(new SpaceInvaders));
+    SpaceInvaders* machine = machines.back().get();
+    start.restore(*machine);
+    machine->state.dirtyPages.reset();
+    return machine;
+}
@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <stdexcept>
+
+#include "MemoryHeatmap.hpp"
+
+constexpr std::size_t MemoryHeatmap::accessKinds;
+constexpr std::size_t MemoryHeatmap::pageSize;
+constexpr std::size_t MemoryHeatmap::pageCount;
+
+const std::array<MemoryHeatmap::Region, 4> MemoryHeatmap::invadersRegions = {{
+    {"rom", 0x0000, 0x1FFF},
+    {"work RAM", 0x2000, 0x23FF},
+    {"video RAM", 0x2400, 0x3FFF},
+    {"mirror", 0x4000, 0xFFFF}
+}};
+
+namespace {
+
+const char* const accessNames[MemoryHeatmap::accessKinds] = {"fetch", "read", "write", "stack"};
+
+} // namespace
+
+MemoryHeatmap::MemoryHeatmap(const Granularity& granularity) : shift(granularity == Byte ? 0 : 8) {
+    clear();
+}
+
+void MemoryHeatmap::clear() {
+    for (std::vector<uint64_t>& counts : totals) {
+        counts.assign(0x10000 >> shift, 0);
+    }
+    lastFrame.assign(accessKinds * pageCount, 0);
+    frameCounts.clear();
+}
+
+void MemoryHeatmap::endFrame() {
+    const std::size_t perPage = pageSize >> shift;
+    for (std::size_t access = 0; access != accessKinds; access++) {
+        for (std::size_t page = 0; page != pageCount; page++) {
+            const auto begin = totals[access].begin() + page * perPage;
+            const uint64_t now = std::accumulate(begin, begin + perPage, uint64_t(0));
+            uint64_t& last = lastFrame[access * pageCount + page];
+            frameCounts.push_back(static_cast<uint32_t>(now - last));
+            last = now;
+        }
+    }
+}
+
+uint64_t MemoryHeatmap::total(const Access& access) const noexcept {
+    return std::accumulate(totals[access].begin(), totals[access].end(), uint64_t(0));
+}
+
+uint64_t MemoryHeatmap::total(const Access& access, const uint16_t& start, const uint16_t& end) const noexcept {
+    return std::accumulate(totals[access].begin() + (start >> shift), totals[access].begin() + (end >> shift) + 1, uint64_t(0));
+}
+
+void MemoryHeatmap::report(std::ostream& os) const {
+    std::array<uint64_t, accessKinds> all;
+    for (std::size_t access = 0; access != accessKinds; access++) {
+        all[access] = total(static_cast<Access>(access));
+    }
+    os << "Memory: " << all[Fetch] << " bytes fetched, " << all[Read] << " read, " << all[Write] << " written, "
+       << all[Stack] << " through the stack, over " << frames() << " frames\n"
+       << "region            start     end       fetch       %        read       %       write       %       stack       %\n";
+    const std::ios_base::fmtflags flags = os.flags();
+    os << std::fixed << std::setprecision(2);
+    for (const Region& region : invadersRegions) {
+        os << "  " << std::left << std::setw(12) << region.name << std::right << std::hex << std::uppercase << std::setfill('0')
+           << "  0x" << std::setw(4) << region.start << "  0x" << std::setw(4) << region.end << std::dec << std::setfill(' ');
+        for (std::size_t access = 0; access != accessKinds; access++) {
+            const uint64_t count = total(static_cast<Access>(access), region.start, region.end);
+            os << std::setw(12) << count << std::setw(8) << (all[access] != 0 ? 100.0 * count / all[access] : 0.0);
+        }
+        os << '\n';
+    }
+
+    // where data goes, the candidates for a fast path
+    std::vector<uint64_t> data(pageCount);
+    const std::size_t perPage = pageSize >> shift;
+    for (std::size_t unit = 0; unit != totals[Read].size(); unit++) {
+        data[unit / perPage] += totals[Read][unit] + totals[Write][unit] + totals[Stack][unit];
+    }
+    const uint64_t allData = all[Read] + all[Write] + all[Stack];
+    std::vector<std::size_t> pages(pageCount);
+    std::iota(pages.begin(), pages.end(), 0);
+    std::stable_sort(pages.begin(), pages.end(), [&](std::size_t lhs, std::size_t rhs) { return data[lhs] > data[rhs]; });
+    os << "Busiest pages of data:";
+    uint64_t covered = 0;
+    for (std::size_t i = 0; i != 8 && data[pages[i]] != 0; i++) {
+        covered += data[pages[i]];
+        os << std::hex << std::uppercase << " 0x" << std::setfill('0') << std::setw(2) << pages[i] << std::dec << std::setfill(' ');
+    }
+    os << ", " << (allData != 0 ? 100.0 * covered / allData : 0.0) << "% of data accesses\n";
+
+    // what dirty tracking would copy a frame at coarser pages
+    if (frames() != 0) {
+        os << "Written a frame:";
+        for (std::size_t pagesPerUnit = 1; pagesPerUnit <= 16; pagesPerUnit *= 4) {
+            uint64_t units = 0;
+            for (std::size_t frame = 0; frame != frames(); frame++) {
+                for (std::size_t unit = 0; unit != pageCount / pagesPerUnit; unit++) {
+                    bool written = false;
+                    for (std::size_t page = unit * pagesPerUnit; page != (unit + 1) * pagesPerUnit && !written; page++) {
+                        written = frameCount(frame, Write, page) != 0 || frameCount(frame, Stack, page) != 0;
+                    }
+                    units += written;
+                }
+            }
+            const double mean = static_cast<double>(units) / frames();
+            os << (pagesPerUnit == 1 ? " " : ", ") << mean << " pages of " << pagesPerUnit * pageSize << " bytes ("
+               << mean * pagesPerUnit * pageSize / 1024 << " KiB)";
+        }
+        os << '\n';
+    }
+    os.flags(flags);
+    os << std::flush;
+}
+
+void MemoryHeatmap::writeFramesCsv(std::ostream& os) const {
+    os << "frame,page";
+    for (const char* name : accessNames) {
+        os << ',' << name;
+    }
+    os << '\n';
+    for (std::size_t frame = 0; frame != frames(); frame++) {
+        for (std::size_t page = 0; page != pageCount; page++) {
+            bool used = false;
+            for (std::size_t access = 0; access != accessKinds; access++) {
+                used = used || frameCount(frame, static_cast<Access>(access), page) != 0;
+            }
+            if (!used)
+                continue;
+            os << frame << ',' << page;
+            for (std::size_t access = 0; access != accessKinds; access++) {
+                os << ',' << frameCount(frame, static_cast<Access>(access), page);
+            }
+            os << '\n';
+        }
+    }
+}
+
+void MemoryHeatmap::writeCsv(std::ostream& os) const {
+    os << (shift == 0 ? "address" : "page");
+    for (const char* name : accessNames) {
+        os << ',' << name;
+    }
+    os << '\n';
+    for (std::size_t unit = 0; unit != totals[Fetch].size(); unit++) {
+        os << unit;
+        for (const std::vector<uint64_t>& counts : totals) {
+            os << ',' << counts[unit];
+        }
+        os << '\n';
+    }
+}
+
+// Counts are shown on a log scale against the busiest page of any frame, so quiet pages still show
+void MemoryHeatmap::writeFramesImage(const std::string& fname) const {
+    std::ofstream ofs(fname, std::ios_base::binary);
+    if (!ofs.good())
+        throw std::runtime_error("Unable to open file for writing, given path:" + fname);
+    const uint32_t most = frameCounts.empty() ? 0 : *std::max_element(frameCounts.begin(), frameCounts.end());
+    const double scale = 255.0 / std::log2(1.0 + std::max<uint32_t>(most, 1));
+    auto level = [&](const uint64_t& count) {
+        return static_cast<char>(std::min(255.0, std::round(std::log2(1.0 + count) * scale)));
+    };
+    ofs << "P6\n" << pageCount << ' ' << frames() << "\n255\n";
+    for (std::size_t frame = 0; frame != frames(); frame++) {
+        for (std::size_t page = 0; page != pageCount; page++) {
+            const uint32_t stack = frameCount(frame, Stack, page);
+            ofs.put(level(frameCount(frame, Write, page) + stack));
+            ofs.put(level(frameCount(frame, Read, page) + stack));
+            ofs.put(level(frameCount(frame, Fetch, page)));
+        }
+    }
+    ofs.close();
+    if (!ofs.good())
+        throw std::runtime_error("Unable to write heatmap, given path:" + fname);
+}
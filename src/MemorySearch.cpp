@@ -0,0 +1,199 @@
+#include <bitset>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "MemorySearch.hpp"
+
+namespace {
+
+constexpr std::size_t wordBits = 64;
+
+uint8_t byteOf(const std::string& text) {
+    std::size_t used = 0;
+    unsigned long value = 0;
+    try {
+        value = std::stoul(text, &used, 0);
+    } catch (std::logic_error&) {
+        used = 0;
+    }
+    if (used != text.size() || value > 0xFF)
+        throw std::runtime_error("expected a byte, given " + text);
+    return static_cast<uint8_t>(value);
+}
+
+} // namespace
+
+MemorySearch::MemorySearch(const uint16_t& start, const std::size_t& length) : first(start), size(length) {
+    if (size == 0 || size % wordBits != 0 || first + size > State8080::RAM)
+        throw std::runtime_error("A memory search covers whole 64 byte blocks of memory, given size:" + std::to_string(size));
+    bits.resize(size / wordBits);
+}
+
+void MemorySearch::reset(const State8080& state) {
+    std::fill(bits.begin(), bits.end(), ~uint64_t(0));
+    last.assign(state.memory.begin() + first, state.memory.begin() + first + size);
+}
+
+template <typename Keep>
+void MemorySearch::apply(const uint8_t* now, Keep keep) noexcept {
+    const uint8_t* before = last.data();
+    uint64_t* candidates = bits.data();
+    for (std::size_t word = 0; word != bits.size(); word++) {
+        if (candidates[word] == 0)
+            continue; // nothing left to test, as for most of memory after a few filters
+        // the results go to a local array the inputs cannot overlap, so the test loop vectorizes without checks
+        const std::size_t offset = word * wordBits;
+        uint8_t passed[wordBits];
+        for (std::size_t i = 0; i != wordBits; i++) {
+            passed[i] = keep(before[offset + i], now[offset + i]) ? 1 : 0;
+        }
+        // 8 results of 0 or 1 read as a little endian word, the multiply gathers byte i into bit i of the top byte
+        uint64_t mask = 0;
+        for (std::size_t byte = 0; byte != wordBits / 8; byte++) {
+            uint64_t eight;
+            std::memcpy(&eight, passed + byte * 8, sizeof eight);
+            mask |= (eight * 0x0102040810204080ull) >> 56 << (byte * 8);
+        }
+        candidates[word] &= mask;
+    }
+    std::memcpy(last.data(), now, size);
+}
+
+std::size_t MemorySearch::filter(const State8080& state, const Test& test, const uint8_t& a, const uint8_t& b) {
+    if (last.empty())
+        throw std::runtime_error("A memory search must be reset before it is filtered");
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const uint8_t* now = state.memory.data() + first;
+    switch (test) {
+        case Test::Equal: apply(now, [a](uint8_t, uint8_t value) { return value == a; }); break;
+        case Test::NotEqual: apply(now, [a](uint8_t, uint8_t value) { return value != a; }); break;
+        case Test::Less: apply(now, [a](uint8_t, uint8_t value) { return value < a; }); break;
+        case Test::Greater: apply(now, [a](uint8_t, uint8_t value) { return value > a; }); break;
+        case Test::InRange: apply(now, [a, b](uint8_t, uint8_t value) { return value >= a && value <= b; }); break;
+        case Test::Changed: apply(now, [](uint8_t before, uint8_t value) { return value != before; }); break;
+        case Test::Unchanged: apply(now, [](uint8_t before, uint8_t value) { return value == before; }); break;
+        case Test::Increased: apply(now, [](uint8_t before, uint8_t value) { return value > before; }); break;
+        case Test::Decreased: apply(now, [](uint8_t before, uint8_t value) { return value < before; }); break;
+        case Test::IncreasedBy: apply(now, [a](uint8_t before, uint8_t value) { return static_cast<uint8_t>(value - before) == a; }); break;
+        case Test::DecreasedBy: apply(now, [a](uint8_t before, uint8_t value) { return static_cast<uint8_t>(before - value) == a; }); break;
+    }
+    filterTime += std::chrono::steady_clock::now() - start;
+    ++filters;
+    return count();
+}
+
+std::size_t MemorySearch::run(const std::string& command, const State8080& state) {
+    std::istringstream iss(command);
+    std::string name;
+    std::vector<std::string> args;
+    iss >> name;
+    for (std::string arg; iss >> arg;) {
+        args.push_back(arg);
+    }
+    auto expect = [&](const std::size_t& given) {
+        if (args.size() != given)
+            throw std::runtime_error(name + " takes " + std::to_string(given) + " numbers, given command:" + command);
+    };
+    struct Named {
+        const char* name;
+        Test test;
+        std::size_t numbers;
+    };
+    static const Named tests[] = {
+        {"eq", Test::Equal, 1}, {"ne", Test::NotEqual, 1}, {"lt", Test::Less, 1}, {"gt", Test::Greater, 1},
+        {"range", Test::InRange, 2}, {"changed", Test::Changed, 0}, {"unchanged", Test::Unchanged, 0},
+        {"inc", Test::Increased, 0}, {"dec", Test::Decreased, 0}, {"inc-by", Test::IncreasedBy, 1}, {"dec-by", Test::DecreasedBy, 1}
+    };
+    if (name == "reset") {
+        expect(0);
+        reset(state);
+        return count();
+    }
+    for (const Named& named : tests) {
+        if (name == named.name) {
+            expect(named.numbers);
+            const uint8_t a = args.size() > 0 ? byteOf(args[0]) : 0;
+            const uint8_t b = args.size() > 1 ? byteOf(args[1]) : 0;
+            return filter(state, named.test, a, b);
+        }
+    }
+    throw std::runtime_error("Unknown memory search command, given command:" + command);
+}
+
+std::size_t MemorySearch::count() const noexcept {
+    std::size_t total = 0;
+    for (const uint64_t& word : bits) {
+        total += std::bitset<wordBits>(word).count();
+    }
+    return total;
+}
+
+bool MemorySearch::candidate(const uint16_t& address) const noexcept {
+    if (address < first || address >= first + size)
+        return false;
+    const std::size_t offset = address - first;
+    return (bits[offset / wordBits] >> (offset % wordBits) & 1) != 0;
+}
+
+std::vector<uint16_t> MemorySearch::candidates() const {
+    std::vector<uint16_t> found;
+    for (std::size_t word = 0; word != bits.size(); word++) {
+        for (uint64_t rest = bits[word]; rest != 0; rest &= rest - 1) {
+            const std::size_t bit = std::bitset<wordBits>((rest & (0 - rest)) - 1).count(); // the lowest set bit
+            found.push_back(static_cast<uint16_t>(first + word * wordBits + bit));
+        }
+    }
+    return found;
+}
+
+double MemorySearch::meanFilterUs() const noexcept {
+    if (filters == 0)
+        return 0;
+    return std::chrono::duration<double, std::micro>(filterTime).count() / filters;
+}
+
+void MemorySearch::report(std::ostream& os, const State8080& state, const Symbols& symbols, const std::size_t& limit) const {
+    const std::vector<uint16_t> found = candidates();
+    os << "Memory search: " << found.size() << " candidates after " << filters << " filters, " << meanFilterUs() << " us a filter" << std::endl;
+    for (std::size_t i = 0; i != found.size() && i != limit; i++) {
+        char line[32];
+        std::snprintf(line, sizeof line, "  0x%04X = 0x%02X", found[i], state.memory[found[i]]);
+        os << line;
+        if (!symbols.empty())
+            os << " " << symbols.describe(found[i]);
+        os << "\n";
+    }
+    if (found.size() > limit)
+        os << "  and " << found.size() - limit << " more\n";
+}
+
+std::vector<MemorySearch::Step> MemorySearch::scriptFromFile(const std::string& fname) {
+    std::ifstream ifs(fname);
+    if (!ifs.good())
+        throw std::runtime_error("Search script not found, given path:" + fname);
+    std::vector<Step> steps;
+    std::string line;
+    for (std::size_t lineNum = 1; std::getline(ifs, line); lineNum++) {
+        std::istringstream iss(line);
+        std::string frame;
+        if (!(iss >> frame) || frame[0] == '#')
+            continue;
+        Step step;
+        std::getline(iss >> std::ws, step.command);
+        try {
+            std::size_t used = 0;
+            step.frame = std::stoull(frame, &used);
+            if (used != frame.size())
+                throw std::invalid_argument(frame);
+        } catch (std::logic_error&) {
+            throw std::runtime_error(fname + ":" + std::to_string(lineNum) + ", expected a frame and a command");
+        }
+        if (step.command.empty())
+            throw std::runtime_error(fname + ":" + std::to_string(lineNum) + ", expected a frame and a command");
+        steps.push_back(step);
+    }
+    return steps;
+}
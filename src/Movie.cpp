@@ -0,0 +1,118 @@
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <cstring>
+
+#include "Movie.hpp"
+#include "SpaceInvaders.hpp"
+#include "RomLoader.hpp"
+
+constexpr uint32_t Movie::version;
+
+namespace {
+
+const char movieMagic[8] = {'8', '0', '8', '0', 'M', 'O', 'V', 'I'};
+constexpr std::size_t headerSize = 24;
+constexpr std::size_t runSize = 4;
+constexpr uint32_t maxRun = 0xFFFF;
+
+uint32_t readLE(const uint8_t* data, int bytes) {
+    uint32_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+void writeLE(std::ostream& os, uint32_t value, int bytes) {
+    for (int i = 0; i != bytes; i++) {
+        os.put(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+} // namespace
+
+uint32_t Movie::romChecksum(const State8080& state) noexcept {
+    return crc32(state.memory.data(), 0x2000);
+}
+
+Movie Movie::record(const SpaceInvaders& machine) {
+    Movie movie;
+    movie.current = Recording;
+    movie.romCrc = romChecksum(machine.state);
+    movie.start = machine.frameCount();
+    return movie;
+}
+
+// Layout, little endian:
+//   magic "8080MOVI", version (4), rom crc32 (4), start frame (4), frame count (4)
+//   runs of frames until the count is reached: length (2), port 1 buttons, port 2 buttons
+Movie Movie::fromFile(const std::string& fname) {
+    std::ifstream ifs(fname, std::ios_base::binary);
+    if (!ifs.good())
+        throw std::runtime_error("Movie not found, given path:" + fname);
+    const std::vector<uint8_t> data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    if (data.size() < headerSize || std::memcmp(data.data(), movieMagic, sizeof movieMagic) != 0)
+        throw std::runtime_error(fname + " is not a movie");
+    if (readLE(data.data() + 8, 4) != version)
+        throw std::runtime_error(fname + " is a movie version that is not supported");
+
+    Movie movie;
+    movie.current = Playing;
+    movie.romCrc = readLE(data.data() + 12, 4);
+    movie.start = readLE(data.data() + 16, 4);
+    const uint32_t count = readLE(data.data() + 20, 4);
+    movie.inputs.reserve(count);
+    for (std::size_t i = headerSize; movie.inputs.size() < count; i += runSize) {
+        if (i + runSize > data.size())
+            throw std::runtime_error(fname + " ends before its last frame");
+        const uint32_t length = readLE(data.data() + i, 2);
+        if (length == 0 || movie.inputs.size() + length > count)
+            throw std::runtime_error(fname + " has a run of frames that is not valid");
+        movie.inputs.insert(movie.inputs.end(), length, Input {data[i + 2], data[i + 3]});
+    }
+    return movie;
+}
+
+void Movie::toFile(const std::string& fname) const {
+    std::ofstream ofs(fname, std::ios_base::binary);
+    if (!ofs.good())
+        throw std::runtime_error("Unable to open file for writing, given path:" + fname);
+    ofs.write(movieMagic, sizeof movieMagic);
+    writeLE(ofs, version, 4);
+    writeLE(ofs, romCrc, 4);
+    writeLE(ofs, static_cast<uint32_t>(start), 4);
+    writeLE(ofs, static_cast<uint32_t>(inputs.size()), 4);
+    for (std::size_t i = 0; i != inputs.size(); ) {
+        std::size_t end = i + 1;
+        while (end != inputs.size() && end - i != maxRun && inputs[end].port1 == inputs[i].port1 && inputs[end].port2 == inputs[i].port2)
+            ++end;
+        writeLE(ofs, static_cast<uint32_t>(end - i), 2);
+        ofs.put(static_cast<char>(inputs[i].port1));
+        ofs.put(static_cast<char>(inputs[i].port2));
+        i = end;
+    }
+    ofs.close();
+    if (!ofs.good())
+        throw std::runtime_error("Unable to write movie, given path:" + fname);
+}
+
+void Movie::latch(const uint64_t& frame, InputLatch& input) {
+    if (frame < start)
+        return;
+    const uint64_t index = frame - start;
+    if (current == Recording) {
+        // after rewinding the frames that came after are recorded over, a frame that was skipped has nothing pressed
+        inputs.resize(index);
+        inputs.push_back({input.port1(), input.port2()});
+    }
+    else {
+        // after the last frame nothing is pressed
+        const Input recorded = index < inputs.size() ? inputs[index] : Input {0, 0};
+        input.restore(recorded.port1, recorded.port2);
+    }
+}
+
+bool Movie::matches(const SpaceInvaders& machine) const {
+    return romChecksum(machine.state) == romCrc;
+}
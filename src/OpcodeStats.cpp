@@ -0,0 +1,70 @@
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <iomanip>
+
+#include "OpcodeStats.hpp"
+#include "OpcodeInfo.hpp"
+
+void OpcodeStats::clear() noexcept {
+    counters.fill(Counter {0, 0, 0});
+}
+
+uint64_t OpcodeStats::executed() const noexcept {
+    uint64_t total = 0;
+    for (const Counter& counter : counters) {
+        total += counter.executed;
+    }
+    return total;
+}
+
+uint64_t OpcodeStats::cycles() const noexcept {
+    uint64_t total = 0;
+    for (const Counter& counter : counters) {
+        total += counter.cycles;
+    }
+    return total;
+}
+
+void OpcodeStats::report(std::ostream& os) const {
+    std::vector<uint8_t> order(256);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint8_t lhs, uint8_t rhs) {
+        return counters[lhs].cycles > counters[rhs].cycles;
+    });
+
+    const uint64_t totalExecuted = executed();
+    const uint64_t totalCycles = cycles();
+    os << "Opcodes: " << totalExecuted << " executed, " << totalCycles << " cycles\n"
+       << "opcode  mnemonic        executed       %          cycles       %    taken  not taken\n";
+    const std::ios_base::fmtflags flags = os.flags();
+    os << std::fixed << std::setprecision(2);
+    for (uint8_t opcode : order) {
+        const Counter& counter = counters[opcode];
+        if (counter.executed == 0)
+            break;
+        os << "  0x" << std::hex << std::uppercase << std::setw(2) << std::setfill('0') << static_cast<int>(opcode)
+           << std::dec << std::setfill(' ') << "  " << std::left << std::setw(12) << opcodeInfo[opcode].mnemonic << std::right
+           << std::setw(12) << counter.executed << std::setw(8) << 100.0 * counter.executed / totalExecuted
+           << std::setw(16) << counter.cycles << std::setw(8) << 100.0 * counter.cycles / totalCycles;
+        if (opcodeInfo[opcode].conditional)
+            os << std::setw(9) << counter.taken << std::setw(11) << counter.executed - counter.taken;
+        os << '\n';
+    }
+    os.flags(flags);
+    os << std::flush;
+}
+
+// taken and not taken are left empty for opcodes that are not conditional
+void OpcodeStats::writeCsv(std::ostream& os) const {
+    os << "opcode,mnemonic,executed,cycles,taken,not_taken\n";
+    for (std::size_t opcode = 0; opcode != counters.size(); opcode++) {
+        const Counter& counter = counters[opcode];
+        os << opcode << ",\"" << opcodeInfo[opcode].mnemonic << "\"," << counter.executed << ',' << counter.cycles << ',';
+        if (opcodeInfo[opcode].conditional)
+            os << counter.taken << ',' << counter.executed - counter.taken;
+        else
+            os << ',';
+        os << '\n';
+    }
+}
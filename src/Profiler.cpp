@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <iomanip>
+#include <iterator>
+#include <map>
+#include <cstdio>
+
+#include "Profiler.hpp"
+#include "OpcodeInfo.hpp"
+
+namespace {
+
+std::string hex(const uint32_t& value, const int& digits) {
+    char text[8];
+    std::snprintf(text, sizeof text, "%0*X", digits, value);
+    return text;
+}
+
+// The address a call or jump goes to, the 3 byte forms only
+uint16_t target(const State8080& state, const uint16_t& address) noexcept {
+    return static_cast<uint16_t>(state.memory[static_cast<uint16_t>(address + 2)] << 8 | state.memory[static_cast<uint16_t>(address + 1)]);
+}
+
+} // namespace
+
+Profiler::Profiler(const uint64_t& period) : counts(State8080::RAM), period(period), nextSample(period) {
+
+}
+
+void Profiler::clear() noexcept {
+    std::fill(counts.begin(), counts.end(), 0);
+    nextSample = period;
+}
+
+uint64_t Profiler::samples() const noexcept {
+    uint64_t total = 0;
+    for (const uint64_t& count : counts) {
+        total += count;
+    }
+    return total;
+}
+
+// Subroutines start at the reset address, the named addresses, the targets of calls and restarts that
+// ran and the restart vectors the interrupts entered
+std::set<uint16_t> Profiler::entries(const State8080& state, const Symbols& symbols) const {
+    std::set<uint16_t> result {0x0000};
+    for (const auto& symbol : symbols.names()) {
+        result.insert(symbol.first);
+    }
+    for (uint32_t address = 0; address != State8080::RAM; address++) {
+        if (counts[address] == 0)
+            continue;
+        const uint8_t opcode = state.memory[address];
+        if (opcodeInfo[opcode].branch == OpcodeInfo::Call)
+            result.insert(target(state, static_cast<uint16_t>(address)));
+        else if (opcodeInfo[opcode].branch == OpcodeInfo::Restart)
+            result.insert(opcode & 0x38);
+    }
+    for (uint16_t vector = 0x00; vector != 0x40; vector += 0x08) {
+        if (counts[vector] != 0)
+            result.insert(vector);
+    }
+    return result;
+}
+
+// Basic blocks also start where jumps go and after every branch, where a call returns to
+std::set<uint16_t> Profiler::leaders(const State8080& state, const Symbols& symbols) const {
+    std::set<uint16_t> result = entries(state, symbols);
+    for (uint32_t address = 0; address != State8080::RAM; address++) {
+        if (counts[address] == 0)
+            continue;
+        const OpcodeInfo& info = opcodeInfo[state.memory[address]];
+        if (info.branch == OpcodeInfo::None)
+            continue;
+        if (info.branch == OpcodeInfo::Jump && info.size == 3)
+            result.insert(target(state, static_cast<uint16_t>(address)));
+        result.insert(static_cast<uint16_t>(address + info.size));
+    }
+    return result;
+}
+
+std::vector<Profiler::Routine> Profiler::routines(const State8080& state, const Symbols& symbols) const {
+    const std::set<uint16_t> starts = entries(state, symbols);
+    std::map<uint16_t, uint64_t> perEntry;
+    for (uint32_t address = 0; address != State8080::RAM; address++) {
+        if (counts[address] != 0)
+            perEntry[*std::prev(starts.upper_bound(static_cast<uint16_t>(address)))] += counts[address];
+    }
+
+    std::vector<Routine> result;
+    for (const auto& entry : perEntry) {
+        result.push_back({entry.first, symbols.label(entry.first), entry.second});
+    }
+    std::stable_sort(result.begin(), result.end(), [](const Routine& lhs, const Routine& rhs) {
+        return lhs.samples > rhs.samples;
+    });
+    return result;
+}
+
+std::vector<Profiler::Block> Profiler::blocks(const State8080& state, const Symbols& symbols) const {
+    const std::set<uint16_t> starts = leaders(state, symbols);
+    std::vector<Block> result;
+    bool open = false; // the last instruction falls through into the next address
+    uint32_t next = 0;
+    for (uint32_t address = 0; address != State8080::RAM; address++) {
+        if (counts[address] == 0)
+            continue;
+        if (!open || address != next || starts.count(static_cast<uint16_t>(address)) != 0)
+            result.push_back({static_cast<uint16_t>(address), static_cast<uint16_t>(address), 0, counts[address]});
+        const OpcodeInfo& info = opcodeInfo[state.memory[address]];
+        Block& block = result.back();
+        block.samples += counts[address];
+        next = address + info.size;
+        block.end = static_cast<uint16_t>(next);
+        open = info.branch == OpcodeInfo::None;
+    }
+    std::stable_sort(result.begin(), result.end(), [](const Block& lhs, const Block& rhs) {
+        return lhs.samples > rhs.samples;
+    });
+    return result;
+}
+
+void Profiler::report(std::ostream& os, const State8080& state, const Symbols& symbols, const std::size_t& top) const {
+    const uint64_t total = samples();
+    os << "Profile: " << total;
+    if (period == 0)
+        os << " instructions\n";
+    else
+        os << " samples, one every " << period << " cycles\n";
+    if (total == 0) {
+        os << std::flush;
+        return;
+    }
+
+    const std::set<uint16_t> starts = entries(state, symbols);
+    // an address as its routine and the offset into it
+    auto where = [&](const uint16_t& address) {
+        const uint16_t entry = *std::prev(starts.upper_bound(address));
+        const std::string name = symbols.label(entry);
+        return address == entry ? name : name + "+0x" + hex(address - entry, 1);
+    };
+    const std::ios_base::fmtflags flags = os.flags();
+    os << std::fixed << std::setprecision(2);
+
+    const std::vector<Routine> routineList = routines(state, symbols);
+    os << "Routines\n"
+       << "     samples       %  address  routine\n";
+    for (std::size_t i = 0; i != std::min(top, routineList.size()); i++) {
+        const Routine& routine = routineList[i];
+        os << std::setw(12) << routine.samples << std::setw(8) << 100.0 * routine.samples / total
+           << "   0x" << hex(routine.entry, 4) << "  " << routine.name << '\n';
+    }
+
+    const std::vector<Block> blockList = blocks(state, symbols);
+    os << "Basic blocks\n"
+       << "     samples       %     entered  block\n";
+    for (std::size_t i = 0; i != std::min(top, blockList.size()); i++) {
+        const Block& block = blockList[i];
+        os << std::setw(12) << block.samples << std::setw(8) << 100.0 * block.samples / total << std::setw(12) << block.entered
+           << "  0x" << hex(block.start, 4) << "-0x" << hex(static_cast<uint16_t>(block.end - 1), 4) << "  " << where(block.start) << '\n';
+    }
+
+    // the instructions of the hottest routines that ran, like an annotated listing
+    const std::size_t annotated = std::min<std::size_t>(3, std::min(top, routineList.size()));
+    for (std::size_t i = 0; i != annotated; i++) {
+        const Routine& routine = routineList[i];
+        const auto after = starts.upper_bound(routine.entry);
+        const uint32_t end = after != starts.end() ? *after : State8080::RAM;
+        os << '\n' << routine.name << " 0x" << hex(routine.entry, 4) << ", " << 100.0 * routine.samples / total << "% of samples\n";
+        bool gap = false;
+        for (uint32_t address = routine.entry; address < end; address++) {
+            if (counts[address] == 0) {
+                gap = true;
+                continue;
+            }
+            if (gap)
+                os << "              ...\n";
+            gap = false;
+            const OpcodeInfo& info = opcodeInfo[state.memory[address]];
+            std::string bytes;
+            for (uint8_t j = 0; j != info.size; j++) {
+                bytes += hex(state.memory[static_cast<uint16_t>(address + j)], 2) + ' ';
+            }
+            os << std::setw(8) << 100.0 * counts[address] / total << "  " << hex(address, 4) << "  "
+               << std::left << std::setw(10) << bytes;
+            if (info.size == 3 && (info.branch == OpcodeInfo::Jump || info.branch == OpcodeInfo::Call))
+                os << std::setw(16) << disassemble(state, static_cast<uint16_t>(address)) << '<' << where(target(state, static_cast<uint16_t>(address))) << '>';
+            else
+                os << disassemble(state, static_cast<uint16_t>(address));
+            os << std::right;
+            address += info.size - 1;
+            os << '\n';
+        }
+    }
+    os.flags(flags);
+    os << std::flush;
+}
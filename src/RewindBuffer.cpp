@@ -0,0 +1,137 @@
+#include <cstring>
+#include <algorithm>
+
+#include "RewindBuffer.hpp"
+
+RewindBuffer::RewindBuffer(std::size_t capacity, std::size_t interval)
+    : maxFrames(std::max<std::size_t>(capacity, 2)), keyframeInterval(std::max<std::size_t>(interval, 1)) {
+
+}
+
+void RewindBuffer::capture(SpaceInvaders& machine) {
+    const clock::time_point start = clock::now();
+    State8080& state = machine.state;
+    if (frames.size() == maxFrames)
+        foldOldest();
+
+    Frame frame;
+    frame.registers = Snapshot::captureRegisters(machine);
+    frame.keyframe = frames.empty() || sinceKeyframe + 1 >= keyframeInterval;
+    sinceKeyframe = frame.keyframe ? 0 : sinceKeyframe + 1;
+    frame.data = std::move(spare);
+    if (frame.keyframe) {
+        frame.pages.set();
+        frame.data.assign(state.memory.begin(), state.memory.end());
+    }
+    else {
+        frame.pages = state.dirtyPages;
+        frame.data.resize(frame.pages.count() * State8080::pageSize);
+        if (frame.data.capacity() > 2 * frame.data.size()) // the spare storage was a keyframe's
+            frame.data.shrink_to_fit();
+        uint8_t* out = frame.data.data();
+        for (std::size_t page = 0; page != State8080::pageCount; page++) {
+            if (frame.pages[page]) {
+                std::memcpy(out, state.memory.data() + page * State8080::pageSize, State8080::pageSize);
+                out += State8080::pageSize;
+            }
+        }
+    }
+    state.dirtyPages.reset();
+    frames.push_back(std::move(frame));
+    spare.clear();
+
+    const clock::duration took = clock::now() - start;
+    totalCapture += took;
+    maxCapture = std::max(maxCapture, took);
+    ++captures;
+}
+
+bool RewindBuffer::stepBack(SpaceInvaders& machine) {
+    if (frames.size() < 2)
+        return false;
+    spare = std::move(frames.back().data);
+    frames.pop_back();
+
+    // memory of the frame is its keyframe with every frame after the keyframe laid on top
+    std::size_t keyframe = frames.size() - 1;
+    while (!frames[keyframe].keyframe)
+        --keyframe;
+    for (std::size_t i = keyframe; i != frames.size(); i++)
+        applyPages(frames[i], machine.state);
+    Snapshot::restoreRegisters(frames.back().registers, machine);
+    machine.state.dirtyPages.reset();
+    sinceKeyframe = frames.size() - 1 - keyframe;
+    return true;
+}
+
+void RewindBuffer::clear() noexcept {
+    frames.clear();
+    sinceKeyframe = 0;
+}
+
+void RewindBuffer::applyPages(const Frame& frame, State8080& state) noexcept {
+    if (frame.keyframe) {
+        std::memcpy(state.memory.data(), frame.data.data(), State8080::RAM);
+        return;
+    }
+    const uint8_t* in = frame.data.data();
+    for (std::size_t page = 0; page != State8080::pageCount; page++) {
+        if (frame.pages[page]) {
+            std::memcpy(state.memory.data() + page * State8080::pageSize, in, State8080::pageSize);
+            in += State8080::pageSize;
+        }
+    }
+}
+
+// The oldest frame is always a keyframe, with the next frame's pages copied over it it is the next frame's memory
+void RewindBuffer::foldOldest() {
+    Frame oldest = std::move(frames.front());
+    frames.pop_front();
+    if (frames.empty() || frames.front().keyframe) {
+        spare = std::move(oldest.data);
+        return;
+    }
+    Frame& next = frames.front();
+    const uint8_t* in = next.data.data();
+    for (std::size_t page = 0; page != State8080::pageCount; page++) {
+        if (next.pages[page]) {
+            std::memcpy(oldest.data.data() + page * State8080::pageSize, in, State8080::pageSize);
+            in += State8080::pageSize;
+        }
+    }
+    spare = std::move(next.data);
+    next.data = std::move(oldest.data);
+    next.pages.set();
+    next.keyframe = true;
+}
+
+std::size_t RewindBuffer::memoryUsed() const noexcept {
+    std::size_t bytes = spare.capacity();
+    for (const Frame& frame : frames) {
+        bytes += sizeof(Frame) + frame.data.capacity();
+    }
+    return bytes;
+}
+
+double RewindBuffer::bytesPerSecond() const noexcept {
+    if (frames.empty())
+        return 0;
+    const double framesPerSecond = static_cast<double>(SpaceInvaders::cpuClock) / SpaceInvaders::cyclesPerFrame;
+    return static_cast<double>(memoryUsed()) / frames.size() * framesPerSecond;
+}
+
+double RewindBuffer::meanCaptureUs() const noexcept {
+    if (captures == 0)
+        return 0;
+    return std::chrono::duration<double, std::micro>(totalCapture).count() / captures;
+}
+
+double RewindBuffer::maxCaptureUs() const noexcept {
+    return std::chrono::duration<double, std::micro>(maxCapture).count();
+}
+
+void RewindBuffer::report(std::ostream& os) const {
+    os << "Rewind buffer: " << frames.size() << " frames, " << memoryUsed() / 1024 << " KiB, "
+       << bytesPerSecond() / 1024 << " KiB per second of history, capture mean " << meanCaptureUs()
+       << " us, max " << maxCaptureUs() << " us over " << captures << " frames" << std::endl;
+}
@@ -0,0 +1,118 @@
+#include <array>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <algorithm>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ROMLOADER_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "RomLoader.hpp"
+
+namespace {
+
+const std::array<RomInfo, 3> knownRoms = {{
+    {"Space Invaders (invaders.h, g, f, e)", 0x2000, 0xB64CA815},
+    {"8080 Preliminary Exerciser (8080PRE.COM)", 0x400, 0x295CAF8F},
+    {"Microcosm 8080 CPU Diagnostic (TST8080.COM)", 0x600, 0xD7637779}
+}};
+
+// Table for the reflected IEEE polynomial used by zip and png
+std::array<uint32_t, 256> makeCrcTable() noexcept {
+    std::array<uint32_t, 256> table {};
+    for (uint32_t i = 0; i != 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit != 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+} // namespace
+
+uint32_t crc32(const uint8_t* data, std::size_t size, uint32_t crc) noexcept {
+    static const std::array<uint32_t, 256> table = makeCrcTable();
+    crc = ~crc;
+    for (std::size_t i = 0; i != size; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+const RomInfo* identifyRom(const uint8_t* data, std::size_t size) noexcept {
+    uint32_t crc = crc32(data, size);
+    for (const RomInfo& rom : knownRoms) {
+        if (rom.size == size && rom.crc32 == crc)
+            return &rom;
+    }
+    return nullptr;
+}
+
+
+MappedFile::MappedFile(const std::string& fname) {
+#ifdef ROMLOADER_MMAP
+    int fd = ::open(fname.c_str(), O_RDONLY);
+    if (fd == -1)
+        throw std::runtime_error("File not found, given path:" + fname);
+    struct stat info;
+    if (::fstat(fd, &info) == -1) {
+        ::close(fd);
+        throw std::runtime_error("Unable to read file size, given path:" + fname);
+    }
+    length = static_cast<std::size_t>(info.st_size);
+    if (length != 0) {
+        void* addr = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Unable to map file, given path:" + fname);
+        }
+        bytes = static_cast<const uint8_t*>(addr);
+        mapped = true;
+    }
+    ::close(fd); // the mapping stays valid after the descriptor is closed
+#else
+    std::ifstream ifs(fname, std::ios_base::binary);
+    if (!ifs.good())
+        throw std::runtime_error("File not found, given path:" + fname);
+    std::vector<char> contents((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    length = contents.size();
+    uint8_t* copy = new uint8_t[length];
+    std::copy(contents.begin(), contents.end(), copy);
+    bytes = copy;
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef ROMLOADER_MMAP
+    if (mapped)
+        ::munmap(const_cast<uint8_t*>(bytes), length);
+#else
+    delete[] bytes;
+#endif
+}
+
+
+const RomInfo* loadRom(State8080& state, const uint8_t* data, std::size_t size, const uint16_t& offset) {
+    if (size == 0)
+        throw std::runtime_error("Unable to load an empty rom into memory");
+    // Make sure there is enough room for the rom
+    if (State8080::RAM - offset < size)
+        throw std::runtime_error("start of selection of memory is too large or the file itself is too large");
+    std::copy(data, data + size, state.memory.begin() + offset);
+    for (std::size_t page = offset / State8080::pageSize; page <= (offset + size - 1) / State8080::pageSize; page++)
+        state.dirtyPages[page] = true;
+    return identifyRom(data, size);
+}
+
+const RomInfo* loadRomFile(State8080& state, const std::string& fname, const uint16_t& offset) {
+    MappedFile file(fname);
+    return loadRom(state, file.data(), file.size(), offset);
+}
@@ -0,0 +1,208 @@
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ROMSET_CACHE
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "RomSet.hpp"
+#include "RomLoader.hpp"
+
+namespace {
+
+std::string hex(const uint32_t& value) {
+    std::ostringstream oss;
+    oss << std::hex << std::uppercase << std::setw(8) << std::setfill('0') << value;
+    return oss.str();
+}
+
+// mkdir -p
+bool makeDirectories(const std::string& path) {
+#ifdef ROMSET_CACHE
+    for (std::size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1)) {
+        std::string part = path.substr(0, slash);
+        if (::mkdir(part.c_str(), 0755) == -1 && errno != EEXIST)
+            return false;
+        if (slash == std::string::npos)
+            return true;
+    }
+#else
+    (void) path;
+    return false;
+#endif
+}
+
+long processId() {
+#ifdef ROMSET_CACHE
+    return static_cast<long>(::getpid());
+#else
+    return 0;
+#endif
+}
+
+bool fileExists(const std::string& fname) {
+    std::ifstream ifs(fname);
+    return ifs.good();
+}
+
+} // namespace
+
+// Descriptors are plain text, one command per line, lines starting with # are comments:
+//   name <text>                                  name of the set
+//   chip <file> <address> <size> <crc32>         a chip, the file is relative to the descriptor,
+//                                                address and size are in C notation (0x for hex), crc32 is hex
+RomSet RomSet::fromFile(const std::string& descriptor) {
+    std::ifstream ifs(descriptor);
+    if (!ifs.good())
+        throw std::runtime_error("Rom set not found, given path:" + descriptor);
+
+    RomSet set;
+    auto slash = descriptor.find_last_of('/');
+    set.directory = slash == std::string::npos ? "." : descriptor.substr(0, slash);
+
+    std::string line;
+    for (std::size_t lineNum = 1; std::getline(ifs, line); lineNum++) {
+        std::istringstream iss(line);
+        std::string command;
+        if (!(iss >> command) || command[0] == '#')
+            continue;
+
+        auto fail = [&](const std::string& why) {
+            throw std::runtime_error(descriptor + ":" + std::to_string(lineNum) + ", " + why);
+        };
+        if (command == "name") {
+            std::getline(iss >> std::ws, set.name);
+        }
+        else if (command == "chip") {
+            std::string file, address, size, crc;
+            if (!(iss >> file >> address >> size >> crc))
+                fail("chip requires file address size crc32");
+            try {
+                unsigned long addr = std::stoul(address, nullptr, 0);
+                unsigned long bytes = std::stoul(size, nullptr, 0);
+                if (addr + bytes > State8080::RAM)
+                    fail("chip does not fit in memory");
+                set.chips.push_back({file, static_cast<uint16_t>(addr), bytes, static_cast<uint32_t>(std::stoul(crc, nullptr, 16))});
+            } catch (std::logic_error&) {
+                fail("chip has an invalid number");
+            }
+        }
+        else {
+            fail("unknown command " + command);
+        }
+    }
+    if (set.chips.empty())
+        throw std::runtime_error(descriptor + ", rom set has no chips");
+    return set;
+}
+
+std::string RomSet::defaultCacheDirectory() {
+    if (const char* dir = std::getenv("EMU8080_CACHE"))
+        return dir;
+    if (const char* dir = std::getenv("XDG_CACHE_HOME"))
+        return std::string(dir) + "/8080";
+    if (const char* home = std::getenv("HOME"))
+        return std::string(home) + "/.cache/8080";
+    return ".cache";
+}
+
+// The key only depends on where the chips go and what they contain, not on file names,
+// so any descriptor of the same chips shares the cached image
+std::string RomSet::cacheKey() const {
+    std::ostringstream layout;
+    for (const RomChip& chip : chips) {
+        layout << chip.address << ':' << chip.size << ':' << chip.crc32 << ';';
+    }
+    const std::string text = layout.str();
+    return hex(crc32(reinterpret_cast<const uint8_t*>(text.data()), text.size())) + "-" + std::to_string(imageSize());
+}
+
+uint16_t RomSet::base() const noexcept {
+    uint16_t low = chips.front().address;
+    for (const RomChip& chip : chips) {
+        low = std::min(low, chip.address);
+    }
+    return low;
+}
+
+std::size_t RomSet::imageSize() const noexcept {
+    std::size_t high = 0;
+    for (const RomChip& chip : chips) {
+        high = std::max(high, chip.address + chip.size);
+    }
+    return high - base();
+}
+
+std::vector<uint8_t> RomSet::assemble() const {
+    std::vector<uint8_t> image(imageSize(), 0);
+    for (const RomChip& chip : chips) {
+        MappedFile file(directory + "/" + chip.file);
+        if (file.size() != chip.size)
+            throw std::runtime_error(chip.file + " is " + std::to_string(file.size()) + " bytes, expected " + std::to_string(chip.size));
+        uint32_t crc = crc32(file.data(), file.size());
+        if (crc != chip.crc32)
+            throw std::runtime_error(chip.file + " has checksum " + hex(crc) + ", expected " + hex(chip.crc32));
+        std::copy(file.data(), file.data() + file.size(), image.begin() + (chip.address - base()));
+    }
+    return image;
+}
+
+bool RomSet::verify(const uint8_t* image, const std::size_t& size) const {
+    if (size != imageSize())
+        return false;
+    std::vector<bool> covered(size, false);
+    for (const RomChip& chip : chips) {
+        const std::size_t offset = chip.address - base();
+        if (crc32(image + offset, chip.size) != chip.crc32)
+            return false;
+        std::fill(covered.begin() + static_cast<std::ptrdiff_t>(offset), covered.begin() + static_cast<std::ptrdiff_t>(offset + chip.size), true);
+    }
+    for (std::size_t i = 0; i != size; i++) {
+        if (!covered[i] && image[i] != 0)
+            return false;
+    }
+    return true;
+}
+
+bool RomSet::load(State8080& state, const std::string& cacheDirectory) const {
+    const std::string cached = cacheDirectory + "/" + cacheKey() + ".rom";
+    // The name of a cached image is derived from the verified chips, the file is checked against their checksums
+    // in case it was damaged since, and assembled again if it does not match
+    if (fileExists(cached)) {
+        try {
+            MappedFile file(cached);
+            if (verify(file.data(), file.size())) {
+                loadRom(state, file.data(), file.size(), base());
+                return true;
+            }
+            std::cerr << "Ignoring rom cache " << cached << ", it does not match the chips' checksums" << std::endl;
+        } catch (std::exception& e) {
+            std::cerr << "Ignoring rom cache " << cached << ", " << e.what() << std::endl;
+        }
+    }
+
+    std::vector<uint8_t> image = assemble();
+    loadRom(state, image.data(), image.size(), base());
+
+    // Store the image, written to a temporary first so other instances never see a partial file
+    if (makeDirectories(cacheDirectory)) {
+        const std::string temp = cached + ".tmp" + std::to_string(processId());
+        std::ofstream ofs(temp, std::ios_base::binary);
+        ofs.write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(image.size()));
+        ofs.close();
+        if (!ofs.good() || std::rename(temp.c_str(), cached.c_str()) != 0) {
+            std::remove(temp.c_str());
+            std::cerr << "Unable to write rom cache " << cached << std::endl;
+        }
+    }
+    return false;
+}
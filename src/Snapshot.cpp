@@ -0,0 +1,180 @@
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include "Snapshot.hpp"
+
+constexpr uint32_t Snapshot::version;
+constexpr std::size_t Snapshot::pageSize;
+constexpr std::size_t Snapshot::size;
+
+static_assert(sizeof(SnapshotHeader) == 80, "snapshot header must have no hidden padding");
+static_assert(offsetof(SnapshotHeader, nextInterrupt) == 64, "snapshot header must have no hidden padding");
+static_assert(offsetof(SnapshotHeader, frames) == 72, "snapshot header must have no hidden padding");
+static_assert(sizeof(SnapshotHeader) <= Snapshot::pageSize, "snapshot header must fit in its page");
+
+namespace {
+
+const char snapshotMagic[8] = {'8', '0', '8', '0', 'S', 'N', 'A', 'P'};
+
+} // namespace
+
+SnapshotHeader Snapshot::captureRegisters(const SpaceInvaders& machine) noexcept {
+    const State8080& state = machine.state;
+    const SpaceInvaders::Schedule schedule = machine.schedule();
+
+    SnapshotHeader header {};
+    std::memcpy(header.magic, snapshotMagic, sizeof header.magic);
+    header.version = version;
+    header.memoryOffset = pageSize;
+    header.memorySize = State8080::RAM;
+
+    header.cycleCount = state.cycleCount;
+    header.stackPointer = state.stackPointer;
+    header.programCounter = state.programCounter;
+    header.b = state.b;
+    header.c = state.c;
+    header.d = state.d;
+    header.e = state.e;
+    header.h = state.h;
+    header.l = state.l;
+    header.a = state.a;
+    header.flags = state.condFlags.makePSW();
+    header.allowInterrupt = state.allowInterrupt;
+    header.halted = state.halted;
+
+    header.shiftLHS = state.shiftLHS;
+    header.shiftRHS = state.shiftRHS;
+    header.shiftOffset = static_cast<uint8_t>(state.shiftOffset);
+    header.port1 = state.port1;
+    header.port2 = state.port2;
+    header.port3 = state.port3;
+    header.port5 = state.port5;
+    header.buttons1 = machine.input.port1();
+    header.buttons2 = machine.input.port2();
+    header.interruptNum = schedule.interruptNum;
+    header.pendingInterrupt = schedule.pendingInterrupt;
+    header.nextInterrupt = schedule.nextInterrupt;
+    header.frames = schedule.frames;
+    return header;
+}
+
+Snapshot::Snapshot(const SpaceInvaders& machine) : bytes(size, 0) {
+    const SnapshotHeader header = captureRegisters(machine);
+    std::memcpy(bytes.data(), &header, sizeof header);
+    std::memcpy(bytes.data() + pageSize, machine.state.memory.data(), State8080::RAM);
+    const uint32_t crc = computeChecksum(bytes.data());
+    std::memcpy(bytes.data() + offsetof(SnapshotHeader, checksum), &crc, sizeof crc);
+}
+
+Snapshot Snapshot::fromData(const uint8_t* data, std::size_t length) {
+    Snapshot snapshot;
+    snapshot.bytes.assign(data, data + std::min(length, size));
+    snapshot.verify(length);
+    return snapshot;
+}
+
+Snapshot Snapshot::fromFile(const std::string& fname) {
+    Snapshot snapshot;
+    snapshot.file = std::make_shared<const MappedFile>(fname);
+    try {
+        snapshot.verify(snapshot.file->size());
+    } catch (std::runtime_error& e) {
+        throw std::runtime_error(fname + ", " + e.what());
+    }
+    return snapshot;
+}
+
+// The checksum skips its own field, the rest of the header page is always zeros
+uint32_t Snapshot::computeChecksum(const uint8_t* data) noexcept {
+    const std::size_t field = offsetof(SnapshotHeader, checksum);
+    const uint8_t zeros[sizeof(uint32_t)] = {};
+    uint32_t crc = crc32(data, field);
+    crc = crc32(zeros, sizeof zeros, crc);
+    crc = crc32(data + field + sizeof zeros, sizeof(SnapshotHeader) - field - sizeof zeros, crc);
+    return crc32(data + pageSize, State8080::RAM, crc);
+}
+
+void Snapshot::verify(std::size_t length) const {
+    if (length < sizeof(SnapshotHeader) || std::memcmp(data(), snapshotMagic, sizeof snapshotMagic) != 0)
+        throw std::runtime_error("not a snapshot");
+    const SnapshotHeader& head = header();
+    uint32_t swapped = 0;
+    for (std::size_t i = 0; i != sizeof version; i++) {
+        swapped = swapped << 8 | ((version >> (8 * i)) & 0xFF);
+    }
+    if (head.version == swapped)
+        throw std::runtime_error("snapshot was saved on a host of the other byte order");
+    if (head.version != version)
+        throw std::runtime_error("snapshot version " + std::to_string(head.version) + " is not supported, expected " + std::to_string(version));
+    if (head.memoryOffset != pageSize || head.memorySize != State8080::RAM || length != size)
+        throw std::runtime_error("snapshot has an unexpected layout");
+    if (computeChecksum(data()) != head.checksum)
+        throw std::runtime_error("snapshot is corrupt, checksum does not match");
+}
+
+// Nothing is checked here, the snapshot was verified when it was made
+void Snapshot::restore(SpaceInvaders& machine) const {
+    restoreRegisters(header(), machine);
+    std::memcpy(machine.state.memory.data(), data() + pageSize, State8080::RAM);
+    machine.state.dirtyPages.set(); // all of memory was replaced
+}
+
+std::size_t Snapshot::reset(SpaceInvaders& machine) const {
+    restoreRegisters(header(), machine);
+    State8080& state = machine.state;
+    const uint8_t* memory = data() + pageSize;
+    std::size_t pages = 0;
+    for (std::size_t page = 0; page != State8080::pageCount; page++) {
+        if (state.dirtyPages[page]) {
+            std::memcpy(state.memory.data() + page * State8080::pageSize, memory + page * State8080::pageSize, State8080::pageSize);
+            ++pages;
+        }
+    }
+    state.dirtyPages.reset();
+    return pages;
+}
+
+void Snapshot::restoreRegisters(const SnapshotHeader& head, SpaceInvaders& machine) {
+    State8080& state = machine.state;
+
+    state.cycleCount = head.cycleCount;
+    state.stackPointer = head.stackPointer;
+    state.programCounter = head.programCounter;
+    state.b = head.b;
+    state.c = head.c;
+    state.d = head.d;
+    state.e = head.e;
+    state.h = head.h;
+    state.l = head.l;
+    state.a = head.a;
+    state.condFlags.fromPSW(head.flags);
+    state.allowInterrupt = head.allowInterrupt != 0;
+    state.halted = head.halted != 0;
+
+    state.shiftLHS = head.shiftLHS;
+    state.shiftRHS = head.shiftRHS;
+    state.shiftOffset = head.shiftOffset;
+    state.port1 = head.port1;
+    state.port2 = head.port2;
+    state.port3 = head.port3;
+    state.port5 = head.port5;
+    machine.input.restore(head.buttons1, head.buttons2);
+    machine.setSchedule({head.nextInterrupt, head.interruptNum, head.pendingInterrupt, head.frames});
+
+    // the sound ports are sent again so sounds that loop, like the ufo, carry on
+    if (machine.mixer != nullptr) {
+        machine.mixer->portWrite(3, state.port3, state.cycleCount);
+        machine.mixer->portWrite(5, state.port5, state.cycleCount);
+    }
+}
+
+void Snapshot::toFile(const std::string& fname) const {
+    std::ofstream ofs(fname, std::ios_base::binary);
+    ofs.write(reinterpret_cast<const char*>(data()), static_cast<std::streamsize>(size));
+    ofs.close();
+    if (!ofs.good())
+        throw std::runtime_error("Unable to write snapshot, given path:" + fname);
+}
@@ -0,0 +1,166 @@
+#include <iostream>
+
+#include "SpaceInvaders.hpp"
+
+constexpr uint64_t SpaceInvaders::cpuClock;
+constexpr uint64_t SpaceInvaders::cyclesPerFrame;
+constexpr uint64_t SpaceInvaders::cyclesPerHalfFrame;
+
+SpaceInvaders::SpaceInvaders() {
+
+}
+
+void SpaceInvaders::step() {
+    // the schedule is kept in absolute cycles so it never drifts, however long instructions take
+    if (state.cycleCount >= nextInterrupt)
+        interrupt();
+
+    const uint16_t pc = state.programCounter;
+    const uint16_t sp = state.stackPointer;
+    const uint64_t startCycle = state.cycleCount;
+
+    if (pendingInterrupt != 0 && state.allowInterrupt) {
+        if (trace != nullptr)
+            trace->record(state, static_cast<uint8_t>(0xC7 | (pendingInterrupt << 3)), TraceRecord::Interrupt);
+        if (coverage != nullptr)
+            coverage->interrupted(state, static_cast<uint8_t>(0xC7 | (pendingInterrupt << 3)));
+        cpu.generateInterrupt(state, pendingInterrupt);
+        state.cycleCount += Disassembler8080::opCycles[0xC7]; // same as an RST
+#ifdef OPCODE_STATS
+        cpu.stats.record(static_cast<uint8_t>(0xC7 | (pendingInterrupt << 3)), Disassembler8080::opCycles[0xC7], true); // the RST put on the bus
+#endif
+        if (callGraph != nullptr)
+            callGraph->interrupted(state, startCycle);
+        state.halted = false;
+        pendingInterrupt = 0;
+        return;
+    }
+    // a halted cpu does nothing until it is interrupted
+    if (state.halted) {
+        state.cycleCount = nextInterrupt;
+        return;
+    }
+
+    if (profiler != nullptr)
+        profiler->sample(state);
+    if (coverage != nullptr)
+        coverage->sample(state);
+
+    uint8_t opcode = state.memory[state.programCounter];
+    if (trace != nullptr)
+        trace->record(state, opcode, TraceRecord::Instruction);
+    // I/O is board specific, so it is done here rather than by the cpu
+    if (opcode == 0xDB) { // Input
+        // next byte is read from input device number and replaces accumulator
+        OP_Input();
+        state.cycleCount += Disassembler8080::opCycles[opcode];
+#ifdef OPCODE_STATS
+        cpu.stats.record(opcode, Disassembler8080::opCycles[opcode], false);
+#endif
+    }
+    else if (opcode == 0xD3) { // Output
+        // The contents of accumulator are sent to output device number
+        OP_Output();
+        state.cycleCount += Disassembler8080::opCycles[opcode];
+#ifdef OPCODE_STATS
+        cpu.stats.record(opcode, Disassembler8080::opCycles[opcode], false);
+#endif
+    }
+    else {
+        cpu.runCycle(state);
+    }
+
+    if (callGraph != nullptr)
+        callGraph->executed(state, pc, sp, startCycle);
+}
+
+void SpaceInvaders::runUntil(const uint64_t& cycle) {
+    while (state.cycleCount < cycle)
+        step();
+}
+
+void SpaceInvaders::runFrame() {
+    const uint64_t frame = frames + 1;
+    while (frames != frame)
+        step();
+}
+
+SpaceInvaders::Schedule SpaceInvaders::schedule() const noexcept {
+    return {nextInterrupt, interruptNum, pendingInterrupt, frames};
+}
+
+void SpaceInvaders::setSchedule(const Schedule& schedule) noexcept {
+    nextInterrupt = schedule.nextInterrupt;
+    interruptNum = schedule.interruptNum;
+    pendingInterrupt = schedule.pendingInterrupt;
+    frames = schedule.frames;
+}
+
+void SpaceInvaders::interrupt() {
+    // buttons reach the ports at vblank, the game reads them once a frame
+    if (interruptNum == 2) {
+        if (movie != nullptr)
+            movie->latch(frames, input);
+        input.latch(state);
+        ++frames;
+    }
+    // the interrupt waits if interrupts are disabled, a newer one replaces it
+    pendingInterrupt = interruptNum;
+    interruptNum = interruptNum == 1 ? 2 : 1;
+    nextInterrupt += cyclesPerHalfFrame;
+}
+
+void SpaceInvaders::OP_Input() {
+    // Sets values to the accumualtor
+    state.fetched(state.programCounter, 2);
+    uint8_t portNum = state.memory[static_cast<uint16_t>(state.programCounter + 1)];
+    state.programCounter += 2;
+    switch(portNum) {
+        case 0:
+            state.a = 0xF;
+            break;
+        case 1:
+            state.a = state.port1;
+            break;
+        case 2:
+            state.a = state.port2;
+            break;
+        case 3:  {// Returns the result of the shift into accumulator
+            uint16_t fullByte = static_cast<uint16_t>((static_cast<uint16_t>(state.shiftLHS) << 8) | state.shiftRHS);
+            uint8_t result = static_cast<uint8_t>(fullByte >> (8 - state.shiftOffset) );
+            state.a = result;
+        }
+        break;
+        default:
+            std::cerr << "Possible Input Error at 0x" << std::hex << state.programCounter << ", port=" << static_cast<int>(portNum) << std::dec << std::endl;
+    }
+}
+
+void SpaceInvaders::OP_Output() {
+    const uint8_t& value = state.a;
+    state.fetched(state.programCounter, 2);
+    uint8_t port = state.memory[static_cast<uint16_t>(state.programCounter + 1)];
+    state.programCounter += 2;
+    switch(port) {
+        case 1:
+            state.port1 = value;
+            break;
+        case 2:
+            state.shiftOffset = value & 0x7;
+            break;
+        case 3:
+            state.port3 = value;
+            if (mixer != nullptr)
+                mixer->portWrite(port, value, state.cycleCount);
+            break;
+        case 4: // value acts as the new lhs
+            state.shiftRHS = state.shiftLHS;
+            state.shiftLHS = value;
+            break;
+        case 5:
+            state.port5 = value;
+            if (mixer != nullptr)
+                mixer->portWrite(port, value, state.cycleCount);
+            break;
+    }
+}
@@ -1,8 +1,11 @@
-#include <fstream>
 #include <iostream>
-#include <numeric>
 
 #include "State8080.hpp"
+#include "RomLoader.hpp"
+
+constexpr std::size_t State8080::RAM;
+constexpr std::size_t State8080::pageSize;
+constexpr std::size_t State8080::pageCount;
 
 State8080::State8080() {
     clearAll();
@@ -10,6 +13,7 @@ State8080::State8080() {
 
 void State8080::clearMemory() {
     std::fill(memory.begin(), memory.end(), 0);
+    dirtyPages.set();
 }
 void State8080::clearRegisters() {
     a = 0;
@@ -42,32 +46,8 @@ void State8080::clearAll() {
 State8080 stateFromFile(const std::string& fname, const uint16_t& offset = 0){
 
     State8080 state;
-
-    std::ifstream ifs(fname, std::ios_base::binary | std::ios_base::in | std::ios_base::ate);
-    if (!ifs.good()) {
-        std::cerr << "File not found" << std::endl;
-        throw std::runtime_error("File not found, given path:" + fname);
-    }
-
-    // Make sure there is enough room for the file
-    auto size = ifs.tellg();
-    ifs.seekg(std::ios_base::beg);
-    if (State8080::RAM - offset < size)
-        throw std::runtime_error("start of selection of memory is too large or the file itself is too large");
-
-    // load memory to position memoryStart
-    uint8_t byte;
-    for (size_t i = offset; ifs.read(reinterpret_cast<char*>(&byte), sizeof(uint8_t)) ;i++) {
-        state.memory[i] = byte;
-    }
-
-    // make sure atleast some data was read, doesn't check the integrity of the file itself.
-    if (std::accumulate(state.memory.cbegin() + offset, state.memory.cend(), 0) != 0){
-        ;
-    }
-    else {
-        std::cout << "Failed write into memory" << std::endl;
-        throw std::runtime_error("Unable to load file contents into memory state");
-    }
+    // the file is mapped and copied into memory in one go, see RomLoader
+    if (loadRomFile(state, fname, offset) == nullptr)
+        std::cerr << "Warning: " << fname << " is not a known rom" << std::endl;
     return state;
 }
@@ -0,0 +1,62 @@
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <stdexcept>
+
+#include "Symbols.hpp"
+
+Symbols Symbols::fromFile(const std::string& fname) {
+    std::ifstream ifs(fname);
+    if (!ifs.good())
+        throw std::runtime_error("Symbol file not found, given path:" + fname);
+    Symbols symbols;
+    std::string line;
+    for (std::size_t lineNum = 1; std::getline(ifs, line); lineNum++) {
+        std::istringstream iss(line);
+        std::string address, name;
+        if (!(iss >> address) || address[0] == '#')
+            continue;
+        unsigned long value;
+        try {
+            value = std::stoul(address, nullptr, 16);
+        } catch (std::logic_error&) {
+            value = 0x10000;
+        }
+        if (value > 0xFFFF || !(iss >> name))
+            throw std::runtime_error(fname + ":" + std::to_string(lineNum) + ", expected an address and a name");
+        symbols.add(static_cast<uint16_t>(value), name);
+    }
+    return symbols;
+}
+
+void Symbols::add(const uint16_t& address, const std::string& name) {
+    symbols[address] = name;
+}
+
+const std::string* Symbols::find(const uint16_t& address) const {
+    const auto it = symbols.find(address);
+    return it != symbols.end() ? &it->second : nullptr;
+}
+
+std::string Symbols::label(const uint16_t& address) const {
+    const std::string* name = find(address);
+    if (name != nullptr)
+        return *name;
+    char text[16];
+    std::snprintf(text, sizeof text, "sub_%04X", address);
+    return text;
+}
+
+std::string Symbols::describe(const uint16_t& address) const {
+    char text[16];
+    auto it = symbols.upper_bound(address);
+    if (it == symbols.begin()) {
+        std::snprintf(text, sizeof text, "0x%04X", address);
+        return text;
+    }
+    --it;
+    if (it->first == address)
+        return it->second;
+    std::snprintf(text, sizeof text, "+0x%X", address - it->first);
+    return it->second + text;
+}
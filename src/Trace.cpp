@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TRACE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "Trace.hpp"
+
+constexpr uint32_t TraceRecorder::version;
+constexpr std::size_t TraceRecorder::headerSize;
+constexpr std::size_t TraceRecorder::ringSize;
+constexpr std::size_t TraceRecorder::windowRecords;
+
+namespace {
+
+const char traceMagic[8] = {'8', '0', '8', '0', 'T', 'R', 'C', 'E'};
+constexpr std::size_t windowBytes = TraceRecorder::windowRecords * sizeof(TraceRecord);
+static_assert(windowBytes % TraceRecorder::headerSize == 0, "windows are mapped at page boundaries");
+
+} // namespace
+
+TraceRecorder::TraceRecorder(const std::string& fname) : fname(fname), ring(ringSize) {
+#ifdef TRACE_MMAP
+    fd = ::open(fname.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+        throw std::runtime_error("Unable to open file for writing, given path:" + fname);
+#else
+    stream = std::fopen(fname.c_str(), "wb");
+    if (stream == nullptr)
+        throw std::runtime_error("Unable to open file for writing, given path:" + fname);
+    const std::vector<uint8_t> page(headerSize); // the header is written over it when the trace is closed
+    std::fwrite(page.data(), 1, page.size(), stream);
+#endif
+    writer = std::thread(&TraceRecorder::drain, this);
+}
+
+TraceRecorder::~TraceRecorder() {
+    try {
+        close();
+    } catch (std::exception&) {
+        // nothing can be reported from here, call close() to know
+    }
+}
+
+void TraceRecorder::close() {
+    if (closed)
+        return;
+    closed = true;
+    running.store(false, std::memory_order_release);
+    writer.join();
+    finish();
+    if (!error.empty())
+        throw std::runtime_error(error);
+}
+
+void TraceRecorder::drain() {
+    while (true) {
+        // records put in before stopping are seen by the load of head after it
+        const bool stopping = !running.load(std::memory_order_acquire);
+        const uint64_t end = head.load(std::memory_order_acquire);
+        uint64_t begin = tail.load(std::memory_order_relaxed);
+        if (begin == end) {
+            if (stopping)
+                return;
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            continue;
+        }
+        while (begin != end) {
+            const std::size_t offset = begin & (ringSize - 1);
+            const std::size_t count = static_cast<std::size_t>(std::min<uint64_t>(end - begin, ringSize - offset));
+            write(&ring[offset], count);
+            begin += count;
+        }
+        tail.store(end, std::memory_order_release);
+    }
+}
+
+// After a failure the records are still drained, so the emulation never waits, but not written
+void TraceRecorder::write(const TraceRecord* records, std::size_t count) {
+    if (!error.empty())
+        return;
+#ifdef TRACE_MMAP
+    while (count != 0) {
+        if (window == nullptr || written == windowStart + windowRecords) {
+            if (window != nullptr)
+                ::munmap(window, windowBytes);
+            window = nullptr;
+            windowStart = written;
+            const off_t offset = static_cast<off_t>(headerSize + windowStart * sizeof(TraceRecord));
+            if (::ftruncate(fd, offset + static_cast<off_t>(windowBytes)) == -1) {
+                error = "Unable to grow trace, given path:" + fname;
+                return;
+            }
+            void* addr = ::mmap(nullptr, windowBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset);
+            if (addr == MAP_FAILED) {
+                error = "Unable to map trace, given path:" + fname;
+                return;
+            }
+            window = static_cast<uint8_t*>(addr);
+        }
+        const std::size_t room = static_cast<std::size_t>(windowStart + windowRecords - written);
+        const std::size_t part = std::min(count, room);
+        std::memcpy(window + (written - windowStart) * sizeof(TraceRecord), records, part * sizeof(TraceRecord));
+        written += part;
+        records += part;
+        count -= part;
+    }
+#else
+    if (std::fwrite(records, sizeof(TraceRecord), count, stream) != count)
+        error = "Unable to write trace, given path:" + fname;
+    written += count;
+#endif
+}
+
+// The file is cut to the records written and the header goes at its start
+void TraceRecorder::finish() {
+    std::vector<uint8_t> page(headerSize);
+    TraceHeader header;
+    std::memcpy(header.magic, traceMagic, sizeof traceMagic);
+    header.version = version;
+    header.recordSize = sizeof(TraceRecord);
+    header.count = written;
+    std::memcpy(page.data(), &header, sizeof header);
+#ifdef TRACE_MMAP
+    if (window != nullptr)
+        ::munmap(window, windowBytes);
+    window = nullptr;
+    const off_t size = static_cast<off_t>(headerSize + written * sizeof(TraceRecord));
+    if ((::ftruncate(fd, size) == -1 || ::pwrite(fd, page.data(), page.size(), 0) != static_cast<ssize_t>(page.size())) && error.empty())
+        error = "Unable to write trace, given path:" + fname;
+    ::close(fd);
+    fd = -1;
+#else
+    if ((std::fseek(stream, 0, SEEK_SET) != 0 || std::fwrite(page.data(), 1, page.size(), stream) != page.size()) && error.empty())
+        error = "Unable to write trace, given path:" + fname;
+    if (std::fclose(stream) != 0 && error.empty())
+        error = "Unable to write trace, given path:" + fname;
+    stream = nullptr;
+#endif
+}
+
+TraceFile TraceFile::fromFile(const std::string& fname) {
+    TraceFile trace;
+    trace.file = std::make_shared<const MappedFile>(fname);
+    const uint8_t* data = trace.file->data();
+    const std::size_t size = trace.file->size();
+    TraceHeader header;
+    if (size < TraceRecorder::headerSize || std::memcmp(data, traceMagic, sizeof traceMagic) != 0)
+        throw std::runtime_error(fname + " is not a trace");
+    std::memcpy(&header, data, sizeof header);
+    if (header.version != TraceRecorder::version || header.recordSize != sizeof(TraceRecord))
+        throw std::runtime_error(fname + " is a trace version that is not supported");
+    if ((size - TraceRecorder::headerSize) / sizeof(TraceRecord) < header.count)
+        throw std::runtime_error(fname + " is shorter than its header says, it was not closed");
+    trace.records = reinterpret_cast<const TraceRecord*>(data + TraceRecorder::headerSize);
+    trace.count = static_cast<std::size_t>(header.count);
+    return trace;
+}
@@ -0,0 +1,25 @@
+#include "Traps.hpp"
+
+void Traps::add(const uint16_t& address, const Handler& handler) {
+    const auto found = std::lower_bound(addresses.begin(), addresses.end(), address);
+    const std::size_t index = static_cast<std::size_t>(found - addresses.begin());
+    if (found != addresses.end() && *found == address) {
+        handlers[index] = handler;
+        return;
+    }
+    addresses.insert(found, address);
+    handlers.insert(handlers.begin() + static_cast<std::ptrdiff_t>(index), handler);
+}
+
+void Traps::remove(const uint16_t& address) {
+    const auto found = std::lower_bound(addresses.begin(), addresses.end(), address);
+    if (found == addresses.end() || *found != address)
+        return;
+    handlers.erase(handlers.begin() + (found - addresses.begin()));
+    addresses.erase(found);
+}
+
+void Traps::ret(State8080& state) noexcept {
+    state.programCounter = static_cast<uint16_t>(state.readStack(state.stackPointer) | (state.readStack(static_cast<uint16_t>(state.stackPointer + 1)) << 8));
+    state.stackPointer += 2;
+}
@@ -0,0 +1,24 @@
+#include <limits>
+
+#include "audiostream.hpp"
+
+AudioStream::AudioStream(AudioMixer& mixer_, QObject* parent) :
+    QIODevice(parent), mixer(mixer_) {
+
+    open(QIODevice::ReadOnly);
+}
+
+// The stream never ends, silence is mixed when there is nothing playing
+qint64 AudioStream::bytesAvailable() const {
+    return std::numeric_limits<int32_t>::max() + QIODevice::bytesAvailable();
+}
+
+qint64 AudioStream::readData(char* data, qint64 maxSize) {
+    qint64 frames = maxSize / static_cast<qint64>(sizeof(int16_t));
+    mixer.render(reinterpret_cast<int16_t*>(data), static_cast<std::size_t>(frames));
+    return frames * static_cast<qint64>(sizeof(int16_t));
+}
+
+qint64 AudioStream::writeData(const char*, qint64) {
+    return -1;
+}
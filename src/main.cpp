@@ -5,10 +5,37 @@
 
 #include "mainwindow.hpp"
 #include <QApplication>
+#include <iostream>
 
 int main(int argc, char *argv[]) {
     QApplication a (argc, argv);
     MainWindow window;
+
+    // --overlay <file> selects a colour overlay, see rsc/overlays
+    const QStringList args = a.arguments();
+    int overlayArg = args.indexOf("--overlay");
+    if (overlayArg != -1 && overlayArg + 1 < args.size()) {
+        try {
+            window.setOverlay(ColorOverlay::fromFile(args[overlayArg + 1].toStdString()));
+        } catch (std::exception& e) {
+            std::cerr << "Error loading overlay, " << e.what() << std::endl;
+        }
+    }
+    // --romset <file> loads the program from its chips instead of the embedded rom, see rsc/invaders.romset
+    int romSetArg = args.indexOf("--romset");
+    if (romSetArg != -1 && romSetArg + 1 < args.size())
+        window.loadRomSet(args[romSetArg + 1].toStdString());
+    // --record <file> saves the buttons of every frame to a movie, --play <file> plays them back
+    int recordArg = args.indexOf("--record");
+    if (recordArg != -1 && recordArg + 1 < args.size())
+        window.recordMovie(args[recordArg + 1].toStdString());
+    int playArg = args.indexOf("--play");
+    if (playArg != -1 && playArg + 1 < args.size())
+        window.playMovie(args[playArg + 1].toStdString());
+    // --opcodes <file> writes what the cpu executed as csv when built with CONFIG+=opcodestats
+    int opcodesArg = args.indexOf("--opcodes");
+    if (opcodesArg != -1 && opcodesArg + 1 < args.size())
+        window.setOpcodeCsv(args[opcodesArg + 1].toStdString());
     window.show();
 
     return a.exec();
@@ -1,27 +1,33 @@
-#include <QTemporaryDir>
+#include <QResource>
 #include <QKeyEvent>
 #include <QPainter>
-#include <QMediaPlayer>
-#include <QSoundEffect>
-#include <QSound>
-#include <QUrl>
+#include <QImage>
+#include <QFile>
+#include <QAudioFormat>
 #include <iostream>
 #include <chrono>
+#include <fstream>
 #include "mainwindow.hpp"
+#include "RomLoader.hpp"
+#include "RomSet.hpp"
+#include "Snapshot.hpp"
 #include "ui_mainwindow.h"
 
 
 
 int MainWindow::reFac = 2; // The resize factor
+const char* MainWindow::quickSaveFile = "quicksave.snap";
 
 MainWindow::MainWindow(QWidget *parent) :
-    QMainWindow(parent), ui(new Ui::MainWindow) {
+    QMainWindow(parent), ui(new Ui::MainWindow), mixer(audioLatency) {
     ui->setupUi(this);
     this->setWindowTitle("Intel 8080 Space Invaders Emulator");
     // Every time timer goes off, runcycle will run
     timer = new QTimer(this);
     connect(timer, &QTimer::timeout, this, &MainWindow::runCycle);
-    timer->start(0);
+    timer->start(1);
+    machine.mixer = &mixer;
+    setTurbo(false);
 
 
     infoWindow = new InfoWindow();
@@ -31,14 +37,27 @@ MainWindow::MainWindow(QWidget *parent) :
 
 
     loadFile(":/roms/rsc/invaders");
-    player = new QMediaPlayer(this);
-
-    ufoSoundEffect.setSource(QUrl("qrc:/media/rsc/audio/Ufo.wav"));
-    ufoSoundEffect.setVolume(0.33);
-    ufoSoundEffect.setLoopCount(QSoundEffect::Infinite);
+    loadSounds();
 }
 
 MainWindow::~MainWindow() {
+    audioOutput->stop(); // the mixer is destroyed before the output
+    machine.input.reportLatency(std::cout);
+    rewind.report(std::cout);
+#ifdef OPCODE_STATS
+    machine.cpu.stats.report(std::cout);
+    if (!opcodeCsv.empty()) {
+        std::ofstream csv(opcodeCsv);
+        machine.cpu.stats.writeCsv(csv);
+    }
+#endif
+    if (machine.movie != nullptr && movie.mode() == Movie::Recording) {
+        try {
+            movie.toFile(movieFile);
+        } catch (std::exception& e) {
+            std::cerr << "Error saving movie, " << e.what() << std::endl;
+        }
+    }
     delete ui;
     delete infoWindow;
 }
@@ -53,303 +72,231 @@ void MainWindow::keyReleaseEvent(QKeyEvent* key) {
 }
 
 void MainWindow::setKey(QKeyEvent*& key, bool toggle) {
-    // Set the key on or off onto the map
-    auto registerKey = [&](const Qt::Key& key_t){
-      if (key->key() == key_t)
-          keyMap[key_t] = toggle;
-    };
-    registerKey(Qt::Key_C); // coin key
-    // player 1 keys
-    registerKey(Qt::Key_W);
-    registerKey(Qt::Key_A);
-    registerKey(Qt::Key_D);
-    registerKey(Qt::Key_S);
-    // player 2 keys
-    registerKey(Qt::Key_I);
-    registerKey(Qt::Key_J);
-    registerKey(Qt::Key_L);
-    registerKey(Qt::Key_K);
-
-}
-void MainWindow::registerInput() {
-    auto setKeyToPort = [&](uint8_t& port, const uint8_t& bit, const Qt::Key& key) {
-        // Ensure key exists
-        if (keyMap.find(key) == keyMap.end())
-            return;
-        // if the key is on set the bit, otherwise clear the bit
-        if (keyMap[key]) {
-            port |= (1 << bit);
-        }
-        else {
-            port &= ~(1 << bit);
-        }
-    };
-
-    setKeyToPort(state.port1, 0, Qt::Key_C); // coin
-    setKeyToPort(state.port1, 2, Qt::Key_S); // p1 start
-    setKeyToPort(state.port1, 4, Qt::Key_W); // shoot
-    setKeyToPort(state.port1, 5, Qt::Key_A); // p1 joystick left
-    setKeyToPort(state.port1, 6, Qt::Key_D); // p1 jotstick right
-
-    setKeyToPort(state.port1, 1, Qt::Key_K); // p2 start
-    setKeyToPort(state.port2, 4, Qt::Key_I); // p2 shoot
-    setKeyToPort(state.port2, 5, Qt::Key_J); // p2 joystick left
-    setKeyToPort(state.port2, 6, Qt::Key_L); // p2 joystick right
-
+    // Only a change of a button touches the latch, repeats from holding a key are ignored
+    if (key->isAutoRepeat())
+        return;
+    InputLatch& input = machine.input;
+    switch (key->key()) {
+        case Qt::Key_T: if (toggle) setTurbo(!turbo); break; // turbo on/off
+        case Qt::Key_Backspace: setRewinding(toggle); break; // rewind while held
+        case Qt::Key_F5: if (toggle) quickSave(); break;
+        case Qt::Key_F9: if (toggle) quickLoad(); break;
+        case Qt::Key_C: input.set(InputLatch::Coin, toggle); break; // coin key
+        // player 1 keys
+        case Qt::Key_W: input.set(InputLatch::P1Shoot, toggle); break;
+        case Qt::Key_A: input.set(InputLatch::P1Left, toggle); break;
+        case Qt::Key_D: input.set(InputLatch::P1Right, toggle); break;
+        case Qt::Key_S: input.set(InputLatch::P1Start, toggle); break;
+        // player 2 keys
+        case Qt::Key_I: input.set(InputLatch::P2Shoot, toggle); break;
+        case Qt::Key_J: input.set(InputLatch::P2Left, toggle); break;
+        case Qt::Key_L: input.set(InputLatch::P2Right, toggle); break;
+        case Qt::Key_K: input.set(InputLatch::P2Start, toggle); break;
+        default: break;
+    }
 }
 
-void MainWindow::OP_Input() {
-    // Sets values to the accumualtor
-    uint8_t portNum = state.memory[state.programCounter + 1];
-    state.programCounter += 2;
-    switch(portNum) {
-        case 0:
-            state.a = 0xF;
-            break;
-        case 1:
-            state.a = state.port1;
-            break;
-        case 2:
-            state.a = state.port2;
-            break;
-        case 3:  {// Returns the result of the shift into accumulator
-            uint16_t fullByte = static_cast<uint16_t>((static_cast<uint16_t>(state.shiftLHS) << 8) | state.shiftRHS);
-            uint8_t result = static_cast<uint8_t>(fullByte >> (8 - state.shiftOffset) );
-            state.a = result;
+// Decodes every sound once and starts the output stream the mixer is pulled from
+void MainWindow::loadSounds() {
+    for (std::size_t i = 0; i != AudioMixer::SoundCount; i++) {
+        QFile file(QString(":/media/rsc/audio/") + AudioMixer::fileNames[i]);
+        try {
+            if (!file.open(QIODevice::ReadOnly))
+                throw std::runtime_error("Unable to open resource");
+            QByteArray bytes = file.readAll();
+            mixer.setSample(static_cast<AudioMixer::Sound>(i),
+                            decodeWav(reinterpret_cast<const uint8_t*>(bytes.constData()), static_cast<std::size_t>(bytes.size())));
+        } catch (std::exception& e) {
+            std::cerr << "Error loading sound " << AudioMixer::fileNames[i] << ", " << e.what() << std::endl;
         }
-        break;
-        default:
-            std::cerr << "Possible Input Error at 0x" << std::hex << state.programCounter << ", port=" << static_cast<int>(portNum) << std::endl;
     }
-}
 
-void MainWindow::OP_Output(const uint8_t& value) { // note that value is always the accumulator anyways
-    uint8_t port = state.memory[state.programCounter + 1];
-    state.programCounter += 2;
-    switch(port) {
-        case 1:
-            state.port1 = value;
-            break;
-        case 2:
-            state.shiftOffset = value & 0x7;
-            break;
-        case 3:
-            state.port3 = value;
-            soundHandle();
-            break;
-        case 4: // value acts as the new lhs
-            state.shiftRHS = state.shiftLHS;
-            state.shiftLHS = value;
-            break;
-        case 5:
-            state.port5 = value;
-            soundHandle();
-            break;
-    }
+    QAudioFormat format;
+    format.setSampleRate(AudioMixer::sampleRate);
+    format.setChannelCount(1);
+    format.setSampleSize(16);
+    format.setSampleType(QAudioFormat::SignedInt);
+    format.setByteOrder(QAudioFormat::LittleEndian);
+    format.setCodec("audio/pcm");
+
+    audioOutput = new QAudioOutput(format, this);
+    audioOutput->setBufferSize(static_cast<int>(audioLatency * sizeof(int16_t)));
+    audioStream = new AudioStream(mixer, this);
+    audioOutput->start(audioStream);
 }
 
-
-
-void MainWindow::soundHandle() {
-    static uint8_t lastPort3 = 0;
-    static uint8_t lastPort5 = 0;
-
-    // Function plays a sound if the condition is met with both state ports
-    static auto playSoundIf = [&](const uint8_t& statePort, const uint8_t& lastPort, const uint8_t& expr, const QString& soundFName){
-        if ( (statePort & expr) && !(lastPort & expr) ) {
-            std::string f = soundFName.toStdString();
-            auto slash = std::find(f.rbegin(), f.rend(), '/').base();
-            std::string walk(slash, slash + 4);
-            // If the sound is one of the walks, QSound cannot play it, use qmediaplayer instead
-            if (walk == "Walk") {
-                player->setMedia(QUrl(soundFName));
-                player->play();
-            }
-            else
-                QSound::play(soundFName);
+// Runs the machine up to where it should be in real time, or flat out for a slice of time in turbo mode.
+// The screen is presented at most once a call, frames finished in between are skipped.
+void MainWindow::runCycle() {
+    const clock::time_point now = clock::now();
+    const uint64_t startFrame = machine.frameCount();
+
+    if (rewinding) {
+        // step back a frame every frame's worth of time, the machine does not run
+        if (now - rewindTime >= std::chrono::microseconds(1000000 / 60)) {
+            rewindTime = now;
+            if (rewind.stepBack(machine))
+                repaint();
         }
-    };
-
-    static const QString pathPrefix("qrc:/media/rsc/audio/");
-
-    static auto soundPlayP3 = [&](const uint8_t& expr, const QString& soundFName) {
-      playSoundIf(state.port3, lastPort3, expr, pathPrefix + soundFName);
-    };
-    static auto soundPlayP5 = [&](const uint8_t& expr, const QString& soundFName) {
-      playSoundIf(state.port5, lastPort5, expr, pathPrefix + soundFName);
-    };
-
-    // Check for a change in the ports, if there is a new sound is generated
-    if (lastPort3 != state.port3) {
-        // UFO sounds, they constantly loop, all other sounds are different in that they only play once
-        if ( (state.port3 & 0x1) && !(lastPort3 & 0x1) ) {
-            ufoSoundEffect.play();
+        return;
+    }
+
+    if (turbo) {
+        // come back to the event loop often enough to present at the display's rate
+        const clock::time_point sliceEnd = now + std::chrono::milliseconds(15);
+        while (clock::now() < sliceEnd) {
+            machine.runFrame();
+            rewind.capture(machine);
         }
-        else if ( !(state.port3 & 0x1) && (lastPort3 & 0x1) ) {
-            ufoSoundEffect.stop();
+    }
+    else {
+        const double elapsed = std::chrono::duration<double>(now - pacedTime).count();
+        uint64_t target = pacedCycle + static_cast<uint64_t>(elapsed * SpaceInvaders::cpuClock);
+        // when far behind, e.g. the window was being dragged, continue from now instead of catching up
+        if (target > machine.state.cycleCount + 4 * SpaceInvaders::cyclesPerFrame) {
+            pacedTime = now;
+            pacedCycle = machine.state.cycleCount;
+            target = pacedCycle + SpaceInvaders::cyclesPerFrame;
         }
-
-        soundPlayP3(0x2, "Shot.wav");
-        soundPlayP3(0x4, "BaseHit.wav");
-        soundPlayP3(0x8, "InvHit.wav");
-
-        lastPort3 = state.port3;
+        machine.runUntil(target);
+        // frames are kept as of the tick they finished in, a millisecond or so after vblank
+        if (machine.frameCount() != startFrame)
+            rewind.capture(machine);
     }
 
+    if (machine.frameCount() != startFrame)
+        repaint();
 
-    if (lastPort5 != state.port5) {
-        soundPlayP5(0x1, "Walk1.wav");
-        soundPlayP5(0x2, "Walk2.wav");
-        soundPlayP5(0x4, "Walk3.wav");
-        soundPlayP5(0x8, "Walk4.wav");
-        soundPlayP5(0x10, "UfoHit.wav");
-
-        lastPort5 = state.port5;
+    // report how fast the machine is running once a second
+    const double reportElapsed = std::chrono::duration<double>(clock::now() - reportTime).count();
+    if (reportElapsed >= 1) {
+        double multiple = static_cast<double>(machine.state.cycleCount - reportCycle) / SpaceInvaders::cpuClock / reportElapsed;
+        QString title("Intel 8080 Space Invaders Emulator");
+        if (turbo)
+            title += QString(" - %1x real time").arg(multiple, 0, 'f', 1);
+        this->setWindowTitle(title);
+        reportTime = clock::now();
+        reportCycle = machine.state.cycleCount;
     }
-
-
 }
 
-void MainWindow::runCycle() {
-    static uint8_t interruptNum = 1;
-
-    // this time is in miliseconds
-    static constexpr uint8_t next60Hz = 120 / 9;
-    static int64_t nextInterrupt = 0;
-    static int64_t nextDraw = 0;
+// Turbo runs the machine as fast as possible with the sound muted.
+// The interrupt schedule is in emulated cycles, so going back to real time only has to restart the pacing from now.
+void MainWindow::setTurbo(bool on) {
+    turbo = on;
+    mixer.setMuted(on);
+    pacedTime = reportTime = clock::now();
+    pacedCycle = reportCycle = machine.state.cycleCount;
+    if (!turbo)
+        this->setWindowTitle("Intel 8080 Space Invaders Emulator");
+}
+// Recording and playing start from the current frame, before the window is shown it is power on
+void MainWindow::recordMovie(const std::string& fname) {
+    movie = Movie::record(machine);
+    movieFile = fname;
+    machine.movie = &movie;
+}
 
-    // Initalize if needed
-    if (nextInterrupt == 0) {
-        nextInterrupt = getTime() + next60Hz;
-        nextDraw = getTime() + next60Hz;
+void MainWindow::playMovie(const std::string& fname) {
+    try {
+        movie = Movie::fromFile(fname);
+        if (!movie.matches(machine))
+            std::cerr << "Warning: " << fname << " was recorded with a different rom" << std::endl;
+        machine.movie = &movie;
+    } catch (std::exception& e) {
+        std::cerr << "Error loading movie, " << e.what() << std::endl;
     }
+}
 
-    // Generate interrupt/draw if its past to the next 60 hz
-    if (state.allowInterrupt && getTime() >= nextInterrupt) {
-        cpu.generateInterrupt(state, interruptNum);
-        interruptNum =  interruptNum == 1 ? 2 : 1;
-        nextInterrupt = getTime() + next60Hz;
-    }
+// The sound is muted while rewinding, letting go carries on from the frame rewound to
+void MainWindow::setRewinding(bool on) {
+    rewinding = on;
+    rewindTime = clock::now();
+    if (rewinding)
+        mixer.setMuted(true);
+    else
+        setTurbo(turbo);
+}
 
-    uint8_t opcode = state.memory[state.programCounter];
-    // For now emulation will occur in two places
-    if (opcode == 0xDB) {// Input
-        // next byte is read from input device number and replaces accumulator
-        OP_Input();
-    }
-    else if (opcode == 0xD3) {// Output
-        // The contents of accumulator are sent to output device number
-        OP_Output(state.a);
-    }
-    else {
-        registerInput();
-        cpu.runCycle(state);
-    }
-    if (getTime() >= nextDraw) {
-        repaint();
-        nextDraw = getTime() + next60Hz;
+void MainWindow::quickSave() {
+    try {
+        Snapshot(machine).toFile(quickSaveFile);
+        std::cout << "Saved " << quickSaveFile << std::endl;
+    } catch (std::exception& e) {
+        std::cerr << "Error saving state, " << e.what() << std::endl;
     }
-    ++cpuSteps;
 }
 
-
-void changePainterColor(const int& x, const int& y, QPainter& painter) {
-    // Recall that x and y swaps, so for height we're looking at x and width at y
-    if (x >= 256 - 64 && x <= 256 - 40 ) { // Red
-        painter.setPen(Qt::red);
-        painter.setBrush(Qt::red);
-    }
-    else if (x >= 0  && x <= 72) { // Green, there are two subdivisions of this
-
-        if (x >= 0 && x <= 14) { // The lower half that has the subdivisons
-
-            if (y >= 16 && y <= 134) {
-                painter.setPen(Qt::green);
-                painter.setBrush(Qt::green);
-            }
-            else {
-                // The two subdivisions that are white instead of green.
-                painter.setPen(Qt::white);
-                painter.setBrush(Qt::white);
-            }
-        } // Upper half non subdivision, always green
-        else {
-            painter.setPen(Qt::green);
-            painter.setBrush(Qt::green);
-        }
-    }
-    else {
-        painter.setPen(Qt::white);
-        painter.setBrush(Qt::white);
+void MainWindow::quickLoad() {
+    try {
+        Snapshot::fromFile(quickSaveFile).restore(machine);
+        rewind.clear(); // the history is of a different game
+        setTurbo(turbo); // the machine's cycle count jumped, pacing starts again from it
+        repaint();
+    } catch (std::exception& e) {
+        std::cerr << "Error loading state, " << e.what() << std::endl;
     }
 }
 
+
 void MainWindow::paint() {
     static constexpr int yOffset = 40; // the amount the window is displayed by y for the screen to be visible
     QPainter painter(this);
-    painter.setPen(Qt::black);
-    painter.setBrush(Qt::black);
-    painter.drawRect(0,0, 256 * reFac, 256 * reFac + yOffset);
-    painter.setPen(Qt::white);
-    painter.setBrush(Qt::white);
-    auto& memory = state.memory;
-
-    painter.rotate(-90);
-
-    for (int y = 0; y != 224; y++) {
-        for (int x = 0; x != 256; x += 8) {
-            // VRAM starts at 0x2400, y and x expressions are offset
-            std::size_t vRamLoc = static_cast<std::size_t>(0x2400 + (y * 32) + (x / 8));
-            uint8_t byte = memory[vRamLoc];
-            // a single byte determines the next 8 pixels, (does mean the next 7 bytes are wasted)
-            for (int shift = 0; shift != 8; shift++) {
-                bool bit = (byte >> shift) & 1;
-                if (bit) {
-                    changePainterColor(x, y, painter); // uncomment this line for no color
-
-                   // painter.drawRect((x+shift) * reFac, y * reFac + yOffset, reFac, reFac); <- original drawRect without rotation
-                   // because screen is rotated x becomes y, y becomes x, screen is also off the screen on the top of the window because of this
-                   // x paramater then must subtract y's total height
-                   // The - 60 is made from observation
-                   painter.drawRect( (x+shift) * reFac - (height * reFac) - yOffset - 60, y * reFac + yOffset, reFac, reFac);
-                }
-            }
+    painter.fillRect(0, 0, 256 * reFac, 256 * reFac + yOffset, Qt::black);
 
-        }
-    }
-}
+    frame.convert(machine.state, overlay);
+    const QImage image(reinterpret_cast<const uchar*>(frame.pixels.data()), FrameBuffer::width, FrameBuffer::height, QImage::Format_RGB32);
 
-// Returns the time since epoch in miliseconds
-inline int64_t MainWindow::getTime() const noexcept {
-    return std::chrono::duration_cast<std::chrono::milliseconds>(
-                std::chrono::system_clock::now().time_since_epoch()
-           ).count();
+    // The screen is rotated, x becomes y and y becomes x, pixel x = 0 is the bottom of the window
+    // The + 100 (yOffset and 60) is made from observation
+    painter.translate(yOffset, height * reFac + yOffset + 60);
+    painter.rotate(-90);
+    painter.scale(reFac, reFac);
+    painter.drawImage(0, 0, image);
 }
 
 void MainWindow::paintEvent(QPaintEvent*) {
     paint();
 }
 
+void MainWindow::setOverlay(const ColorOverlay& newOverlay) {
+    overlay = newOverlay;
+}
+
 // Loads the invader file from qtresource
+// The resource is compiled into the executable, so its data is copied straight into memory without touching the disk
 void MainWindow::loadFile(const QString& qtRscFile) {
-    // std streams cannot be used on qt resources, so first copy the file
-    // and use the streams from there
     try {
-        QTemporaryDir tempDir;
-        QString tempFile;
-        if (tempDir.isValid())
-            tempFile = tempDir.path() + "/TempRom";
-        else
-            throw std::runtime_error("Temporary directory cannot be created");
-
-        if (!QFile::copy(qtRscFile, tempFile))
-            throw std::runtime_error("Unable to copy resource file into temporary");
-
-        if (!QFileInfo::exists(tempFile))
-            throw std::runtime_error("Unable to copy resource file to storage");
+        QResource resource(qtRscFile);
+        if (!resource.isValid())
+            throw std::runtime_error("Resource not found, given path:" + qtRscFile.toStdString());
+
+        const RomInfo* rom = nullptr;
+        if (resource.isCompressed()) { // only when built without -no-compress, the data has to be inflated first
+            QFile file(qtRscFile);
+            if (!file.open(QIODevice::ReadOnly))
+                throw std::runtime_error("Unable to open resource");
+            QByteArray bytes = file.readAll();
+            rom = loadRom(machine.state, reinterpret_cast<const uint8_t*>(bytes.constData()), static_cast<std::size_t>(bytes.size()), 0);
+        }
+        else {
+            rom = loadRom(machine.state, resource.data(), static_cast<std::size_t>(resource.size()), 0);
+        }
 
-        state = stateFromFile(tempFile.toStdString(), 0); // use standard streams
+        if (rom == nullptr)
+            std::cerr << "Warning: " << qtRscFile.toStdString() << " does not match any known rom" << std::endl;
     } catch (std::exception& e) {
         std::cerr << "Error loading rom into emulator, " << e.what() << std::endl;
     }
 }
+
+// Replaces the embedded rom with a rom set, assembled from its chips or taken from the cache
+void MainWindow::loadRomSet(const std::string& descriptor) {
+    try {
+        RomSet set = RomSet::fromFile(descriptor);
+        bool cached = set.load(machine.state);
+        std::cout << "Loaded " << set.name << (cached ? " from the rom cache" : "") << std::endl;
+    } catch (std::exception& e) {
+        std::cerr << "Error loading rom set, " << e.what() << std::endl;
+    }
+}
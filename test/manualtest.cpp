@@ -11,6 +11,7 @@
 #include "State8080.hpp"
 #include "Disassembler8080.hpp"
 #include "ConditionFlags.hpp"
+#include "OpcodeInfo.hpp"
 
 template<typename RT>
 RT check(const std::string& error_message) {
@@ -126,12 +127,12 @@ int main() {
         }
         auto s = copyStack(state, 40);
 
-        std::cout << "a\tb\tc\td\te\th\tl\tpc\tsp\tflags\ttot\n" << std::hex;
+        std::cout << "a\tb\tc\td\te\th\tl\tpc\tsp\tflags\ttot\tnext\n" << std::hex;
         // C style cast is bad but ok here.
         std::cout << (int)state.a << "\t" << (int)state.b << "\t" << (int)state.c << "\t" << (int)state.d
                 << "\t" << (int) state.e << "\t" << (int)state.h << "\t" << (int)state.l << "\t"
                 << (int)state.programCounter << "\t" <<(int)state.stackPointer << "\t" << flags(state)
-                << "\t" << std::dec << sum << std::hex << "\n";
+                << "\t" << std::dec << sum << std::hex << "\t" << disassemble(state, state.programCounter) << "\n";
     }
     return 0;
 }
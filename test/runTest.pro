@@ -1,22 +1,86 @@
 TEMPLATE = app
-CONFIG += console c++14
+CONFIG += console c++14 thread
 CONFIG -= app_bundle
 CONFIG -= qt
+# the heatmap tests count the accesses of the cpu
+DEFINES += MEMORY_STATS
 
 SOURCES += \
+    ../src/AluVerifier.cpp \
+    ../src/Assembler.cpp \
+    ../src/AudioMixer.cpp \
+    ../src/BranchState.cpp \
+    ../src/CallGraph.cpp \
+    ../src/ColorOverlay.cpp \
     ../src/ConditionFlags.cpp \
+    ../src/ControlFlowGraph.cpp \
+    ../src/Coverage.cpp \
+    ../src/CpmBdos.cpp \
+    ../src/CpmMachine.cpp \
     ../src/Disassembler8080.cpp \
+    ../src/DiskImage.cpp \
+    ../src/FrameHash.cpp \
+    ../src/InputLatch.cpp \
+    ../src/InvadersObserver.cpp \
+    ../src/KernelGenerator.cpp \
+    ../src/MachinePool.cpp \
+    ../src/MemoryHeatmap.cpp \
+    ../src/MemorySearch.cpp \
+    ../src/Movie.cpp \
+    ../src/OpcodeInfo.cpp \
+    ../src/OpcodeStats.cpp \
+    ../src/Profiler.cpp \
+    ../src/RewindBuffer.cpp \
+    ../src/RomLoader.cpp \
+    ../src/RomSet.cpp \
+    ../src/Snapshot.cpp \
+    ../src/SpaceInvaders.cpp \
     ../src/State8080.cpp \
+    ../src/Symbols.cpp \
+    ../src/Trace.cpp \
+    ../src/Traps.cpp \
     tests.cpp
 
 HEADERS += \
+    ../include/AluVerifier.hpp \
+    ../include/Assembler.hpp \
+    ../include/AudioMixer.hpp \
+    ../include/BranchState.hpp \
+    ../include/CallGraph.hpp \
+    ../include/ColorOverlay.hpp \
     ../include/ConditionFlags.hpp \
+    ../include/ControlFlowGraph.hpp \
+    ../include/Coverage.hpp \
+    ../include/CpmBdos.hpp \
+    ../include/CpmMachine.hpp \
     ../include/Disassembler8080.hpp \
+    ../include/DiskImage.hpp \
+    ../include/FrameHash.hpp \
+    ../include/InputLatch.hpp \
+    ../include/InvadersObserver.hpp \
+    ../include/KernelGenerator.hpp \
+    ../include/MachinePool.hpp \
+    ../include/MemoryHeatmap.hpp \
+    ../include/MemorySearch.hpp \
+    ../include/Movie.hpp \
+    ../include/OpcodeInfo.hpp \
+    ../include/OpcodeStats.hpp \
+    ../include/Profiler.hpp \
+    ../include/RewindBuffer.hpp \
+    ../include/RomLoader.hpp \
+    ../include/RomSet.hpp \
+    ../include/Snapshot.hpp \
+    ../include/SpaceInvaders.hpp \
     ../include/State8080.hpp \
+    ../include/Symbols.hpp \
+    ../include/Trace.hpp \
+    ../include/Traps.hpp \
     ../include/tester.h
 
 INCLUDEPATH += \
     ../include
 
 DISTFILES += \
-    allowRunTests.py
+    allowRunTests.py \
+    golden/invaders.hashes \
+    golden/invaders.mov
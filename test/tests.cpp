@@ -5,63 +5,78 @@
 #define BOOST_TEST_MODULE opcodeTests_&_cpuDiagTests
 #include <boost/test/included/unit_test.hpp>
 #include <regex>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <functional>
+#include <map>
+#include <tuple>
 
 #include "State8080.hpp"
 #include "Disassembler8080.hpp"
+#include "ColorOverlay.hpp"
+#include "AudioMixer.hpp"
+#include "RomLoader.hpp"
+#include "RomSet.hpp"
+#include "SpaceInvaders.hpp"
+#include "Snapshot.hpp"
+#include "RewindBuffer.hpp"
+#include "MachinePool.hpp"
+#include "BranchState.hpp"
+#include "Movie.hpp"
+#include "FrameHash.hpp"
+#include "OpcodeInfo.hpp"
+#include "AluVerifier.hpp"
+#include "Profiler.hpp"
+#include "CallGraph.hpp"
+#include "Trace.hpp"
+#include "MemoryHeatmap.hpp"
+#include "MemorySearch.hpp"
+#include "InvadersObserver.hpp"
+#include "Coverage.hpp"
+#include "ControlFlowGraph.hpp"
+#include "Traps.hpp"
+#include "CpmBdos.hpp"
+#include "CpmMachine.hpp"
+#include "DiskImage.hpp"
+#include "Symbols.hpp"
+#include "Assembler.hpp"
+#include "KernelGenerator.hpp"
 
 static std::string message;
 static constexpr bool verbose = false;
 
 void runTest(const std::string& filename) {
 
-    State8080 state = stateFromFile(filename, 0x100);
+    State8080 state = stateFromFile(filename, CpmBdos::tpa);
 
     auto slash = std::find(filename.rbegin(), filename.rend(), '/').base();
     std::string file(slash, filename.end());
 
     std::cout << "**** Test running " << file << "\n";
 
-    // 8080pre test will fail regardless of correctness if the stack pointer is not set
-    if (file == "8080PRE.COM")
-        state.stackPointer = 0xFFF5;
-
-
-    // Set PC to start where ROM starts
-    state.programCounter = 0x100;
-
-    // Make 0x5 a RET to return back from a call to 0x5
-    state.memory[0x5] = 0xC9;
+    // BDOS prints the test's messages, it ends by going back to CP/M at 0
+    Traps traps;
+    CpmBdos bdos(traps);
+    bdos.prepare(state);
     Disassembler8080 dis;
-    for (std::size_t count = 0 ;; count++) {
-
-        // call to location 5 if the tests require BDOS to print
-        if (state.programCounter == 0x5) {
-            // BDOS wants to print characters stored in memory @ DE, until the character $ in ASCII is found
-            // Character $ is 0x24 in hex
-            if (state.c == 9) {
-                uint16_t DE = static_cast<uint16_t>((static_cast<uint16_t>(state.d) << 8) | state.e);
-                for (uint16_t loc = DE; state.memory[loc] != 0x24; loc++) {
-                    message.push_back(static_cast<char>(state.memory[loc]));
-                    if (verbose)
-                        std::cout << static_cast<char>(state.memory[loc]);
-                }
-            }
-            // BDOS wants to print a single character in register E
-            else if (state.c == 2) {
-                message.push_back(static_cast<char>(state.e));
-                if (verbose)
-                    std::cout << static_cast<char>(state.e);
-            }
-        }
-
+    dis.traps = &traps;
+    while (!bdos.finished())
         dis.runCycle(state);
 
-        // call to location 0 if the test is done
-        if (state.programCounter == 0) {
-            std::cout << "\n";
-            break;
-        }
-    }
+    message += bdos.output();
+    if (verbose)
+        std::cout << bdos.output();
+    std::cout << "\n";
+}
+
+// a machine about to run code put at 0x100, with the stack at 0x4000 out of its way
+State8080 programState(const std::vector<uint8_t>& code) {
+    State8080 state;
+    std::copy(code.begin(), code.end(), state.memory.begin() + 0x100);
+    state.programCounter = 0x100;
+    state.stackPointer = 0x4000;
+    return state;
 }
 
 BOOST_AUTO_TEST_CASE(cpudiagtests) {
@@ -391,6 +406,66 @@ BOOST_AUTO_TEST_CASE( logical_tests) {
 
 }
 
+BOOST_AUTO_TEST_CASE( alu_verification_tests ) {
+    // the reference model agrees with the examples in Intel's manual
+    const AluVerifier::Outcome sub = AluVerifier::reference(0x97, 0x3E, 0x3E, 0x02); // SUB A
+    if (sub.a != 0x00)
+        BOOST_ERROR("SUB A in the reference model leaves a=" + std::to_string(sub.a));
+    if (sub.psw != 0x56)
+        BOOST_ERROR("SUB A in the reference model leaves psw=" + std::to_string(sub.psw));
+    const AluVerifier::Outcome add = AluVerifier::reference(0x81, 0x6C, 0x2E, 0x02); // ADD C
+    if (add.a != 0x9A)
+        BOOST_ERROR("ADD C in the reference model leaves a=" + std::to_string(add.a));
+    if (add.psw != 0x96)
+        BOOST_ERROR("ADD C in the reference model leaves psw=" + std::to_string(add.psw));
+    const AluVerifier::Outcome daa = AluVerifier::reference(0x27, 0x9B, 0x00, 0x02);
+    if (daa.a != 0x01)
+        BOOST_ERROR("DAA in the reference model leaves a=" + std::to_string(daa.a));
+    if (daa.psw != 0x13)
+        BOOST_ERROR("DAA in the reference model leaves psw=" + std::to_string(daa.psw));
+    const AluVerifier::Outcome inr = AluVerifier::reference(0x0C, 0x00, 0x99, 0x03); // INR C keeps carry
+    if (inr.value != 0x9A)
+        BOOST_ERROR("INR C in the reference model leaves c=" + std::to_string(inr.value));
+    if (inr.a != 0x00)
+        BOOST_ERROR("INR C in the reference model changes a");
+    if (inr.psw != 0x87)
+        BOOST_ERROR("INR C in the reference model leaves psw=" + std::to_string(inr.psw));
+
+    AluVerifier verifier;
+    verifier.run();
+    if (verifier.results()[0x80].cases != 4 * 256 * 256)
+        BOOST_ERROR("ADD B is not verified for every A, B and carries");
+    if (verifier.results()[0x87].cases != 4 * 256)
+        BOOST_ERROR("ADD A is not verified once for every A and carries");
+    if (verifier.cases() != 20523008)
+        BOOST_ERROR("The verifier does not run the number of cases its comment gives");
+    if (verifier.mismatches() != 0) {
+        std::ostringstream report;
+        verifier.report(report);
+        BOOST_ERROR("The ALU differs from the reference model\n" + report.str());
+    }
+
+    // an engine that loses RLC's carry is caught on exactly the cases that set it
+    AluVerifier broken([]() {
+        const std::shared_ptr<Disassembler8080> cpu = std::make_shared<Disassembler8080>();
+        return AluVerifier::Step([cpu](State8080& state) {
+            const bool rotate = state.memory[state.programCounter] == 0x07;
+            cpu->runCycle(state);
+            if (rotate)
+                state.condFlags.carry = 0;
+        });
+    });
+    broken.run(2);
+    if (broken.mismatches() != 128 * 8 * 4)
+        BOOST_ERROR("A lost RLC carry is caught " + std::to_string(broken.mismatches()) + " times, not on every A with bit 7 set");
+    if (broken.results()[0x07].fields != AluVerifier::Carry)
+        BOOST_ERROR("A lost RLC carry is reported in fields other than the carry");
+    if (broken.results()[0x07].first.a != 0x80)
+        BOOST_ERROR("The first lost RLC carry is not reported for a=0x80");
+    if (broken.results()[0x07].first.expected.psw != 0x03)
+        BOOST_ERROR("The first lost RLC carry does not expect psw=0x03");
+}
+
 BOOST_AUTO_TEST_CASE( stack_tests ) {
     State8080 state;
     std::array<uint8_t, State8080::RAM>& memory = state.memory;
@@ -644,4 +719,1452 @@ BOOST_AUTO_TEST_CASE( other_tests ) {
 }
 
 
+BOOST_AUTO_TEST_CASE( overlay_tests ) {
+    try {
+        // the data file of the original layout must match the overlay built at compile time
+        ColorOverlay builtIn;
+        ColorOverlay fromFile = ColorOverlay::fromFile("../rsc/overlays/midway.txt");
+        for (std::size_t i = 0; i != ColorOverlay::size; i++) {
+            if (builtIn.colorAt(i) != fromFile.colorAt(i)) {
+                BOOST_ERROR("midway.txt differs from the built in overlay at VRAM offset " + std::to_string(i));
+                break;
+            }
+        }
+        ColorOverlay mono = ColorOverlay::fromFile("../rsc/overlays/monochrome.txt");
+        if (mono.colorAt(0) != 0xFFFFFFFF || mono.colorAt(ColorOverlay::size - 1) != 0xFFFFFFFF)
+            BOOST_ERROR("monochrome.txt is not white");
+
+        // the colours follow edits to the indices and the palette
+        builtIn.setPaletteColor(3, 0xFF123456);
+        builtIn.setIndex(5, 3);
+        if (builtIn.indexAt(5) != 3)
+            BOOST_ERROR("setIndex did not change the index at VRAM offset 5");
+        if (builtIn.colorAt(5) != 0xFF123456)
+            BOOST_ERROR("The colour at VRAM offset 5 does not follow its new index");
+        builtIn.setPaletteColor(3, 0xFF654321);
+        if (builtIn.paletteColor(3) != 0xFF654321)
+            BOOST_ERROR("setPaletteColor did not change palette entry 3");
+        if (builtIn.colorAt(5) != 0xFF654321)
+            BOOST_ERROR("The colour at VRAM offset 5 does not follow its palette entry");
+        BOOST_CHECK_THROW(builtIn.setIndex(ColorOverlay::size, 0), std::runtime_error);
+        BOOST_CHECK_THROW(builtIn.setIndex(0, 8), std::runtime_error);
+        BOOST_CHECK_THROW(builtIn.setPaletteColor(8, 0), std::runtime_error);
+    } catch (const std::exception& err) {
+        BOOST_ERROR(std::string("Failure loading overlays : ") + err.what());
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE( audio_mixer_tests ) {
+    try {
+        AudioMixer mixer;
+        mixer.loadSamples("../rsc/audio");
+        PcmBuffer shot = wavFromFile("../rsc/audio/Shot.wav");
+
+        // a shot half a second in must start on the exact sample and be mixed unchanged
+        PcmBuffer out;
+        mixer.portWrite(3, 0x2, AudioMixer::cpuClock / 2);
+        mixer.renderUntil(AudioMixer::cpuClock, out);
+        const std::size_t start = AudioMixer::sampleRate / 2;
+        if (out.size() != AudioMixer::sampleRate)
+            BOOST_ERROR("Mixer rendered " + std::to_string(out.size()) + " samples for one second");
+        else if (!std::all_of(out.begin(), out.begin() + start, [](int16_t sample) { return sample == 0; }))
+            BOOST_ERROR("Mixer played a sound before it was triggered");
+        else if (!std::equal(shot.begin(), shot.end(), out.begin() + start))
+            BOOST_ERROR("Shot sound is not at its trigger position");
+
+        // held bits do not retrigger
+        mixer.portWrite(3, 0x2, AudioMixer::cpuClock);
+        mixer.renderUntil(AudioMixer::cpuClock * 2, out);
+        if (!std::all_of(out.begin() + AudioMixer::sampleRate, out.end(), [](int16_t sample) { return sample == 0; }))
+            BOOST_ERROR("Mixer retriggered a held sound");
+
+        // rendering to a file and back is lossless
+        wavToFile("mixer_test.wav", out);
+        PcmBuffer reread = wavFromFile("mixer_test.wav");
+        std::remove("mixer_test.wav");
+        if (reread != out)
+            BOOST_ERROR("Rendered wav file does not read back the same");
+    } catch (const std::exception& err) {
+        BOOST_ERROR(std::string("Failure mixing audio : ") + err.what());
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE( rom_loader_tests ) {
+    const std::string check = "123456789";
+    if (crc32(reinterpret_cast<const uint8_t*>(check.data()), check.size()) != 0xCBF43926)
+        BOOST_ERROR("crc32 check value failure");
+
+    try {
+        State8080 state;
+        const RomInfo* rom = loadRomFile(state, "../rsc/invaders", 0);
+        if (rom == nullptr || rom->size != 0x2000)
+            BOOST_ERROR("invaders rom was not identified");
+        // the first instructions are NOP NOP NOP JMP 18D4
+        bool loaded = state.memory[0] == 0 && state.memory[3] == 0xC3 && state.memory[4] == 0xD4 && state.memory[5] == 0x18;
+        if (!loaded)
+            BOOST_ERROR("invaders rom was not copied into memory");
+    } catch (const std::exception& err) {
+        BOOST_ERROR(std::string("Failure loading rom : ") + err.what());
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE( rom_set_tests ) {
+    try {
+        // split the bundled rom into the four chips of the board next to a copy of the descriptor
+        std::ifstream blob("../rsc/invaders", std::ios_base::binary);
+        std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(blob)), std::istreambuf_iterator<char>());
+        const std::array<std::string, 4> chipNames = {{"invaders.h", "invaders.g", "invaders.f", "invaders.e"}};
+        for (std::size_t i = 0; i != chipNames.size(); i++) {
+            std::ofstream chip(chipNames[i], std::ios_base::binary);
+            chip.write(reinterpret_cast<const char*>(bytes.data()) + i * 0x800, 0x800);
+        }
+        {
+            std::ifstream descriptor("../rsc/invaders.romset");
+            std::ofstream copy("invaders.romset");
+            copy << descriptor.rdbuf();
+        }
+        const std::string cacheDir = "romset_test_cache";
+        RomSet set = RomSet::fromFile("invaders.romset");
+        std::remove((cacheDir + "/" + set.cacheKey() + ".rom").c_str());
+
+        State8080 assembled;
+        if (set.load(assembled, cacheDir))
+            BOOST_ERROR("rom set was loaded from the cache before it was assembled");
+        if (!std::equal(bytes.begin(), bytes.end(), assembled.memory.begin()))
+            BOOST_ERROR("assembled rom set differs from the bundled rom");
+
+        State8080 cached;
+        if (!set.load(cached, cacheDir))
+            BOOST_ERROR("rom set was not loaded from the cache the second time");
+        if (!std::equal(bytes.begin(), bytes.end(), cached.memory.begin()))
+            BOOST_ERROR("cached rom set differs from the bundled rom");
+
+        // a damaged cache is assembled again and replaced
+        {
+            std::fstream image(cacheDir + "/" + set.cacheKey() + ".rom", std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+            image.seekp(0x1000);
+            image.put(static_cast<char>(bytes[0x1000] ^ 0x01));
+        }
+        State8080 damaged;
+        if (set.load(damaged, cacheDir))
+            BOOST_ERROR("rom set was loaded from a damaged cache");
+        if (!std::equal(bytes.begin(), bytes.end(), damaged.memory.begin()) || !set.load(damaged, cacheDir))
+            BOOST_ERROR("damaged rom set cache was not replaced");
+
+        // a modified chip must be rejected
+        std::remove((cacheDir + "/" + set.cacheKey() + ".rom").c_str());
+        {
+            std::fstream chip("invaders.e", std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+            chip.put(0x55);
+        }
+        bool rejected = false;
+        try {
+            set.assemble();
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        if (!rejected)
+            BOOST_ERROR("rom set accepted a modified chip");
+
+        for (const std::string& chip : chipNames)
+            std::remove(chip.c_str());
+        std::remove("invaders.romset");
+        std::remove(cacheDir.c_str());
+    } catch (const std::exception& err) {
+        BOOST_ERROR(std::string("Failure loading rom set : ") + err.what());
+    }
+}
+
+
+
+BOOST_AUTO_TEST_CASE( snapshot_tests ) {
+    try {
+        SpaceInvaders machine;
+        loadRomFile(machine.state, "../rsc/invaders", 0);
+        for (int i = 0; i != 100; i++)
+            machine.runFrame();
+        const Snapshot snapshot(machine);
+        snapshot.toFile("snapshot_test.snap");
+
+        // both machines must run identically from the snapshot, one restored from memory and one from the file
+        for (int i = 0; i != 30; i++)
+            machine.runFrame();
+        SpaceInvaders copied, mapped;
+        snapshot.restore(copied);
+        Snapshot::fromFile("snapshot_test.snap").restore(mapped);
+        if (copied.frameCount() != 100 || mapped.frameCount() != 100)
+            BOOST_ERROR("snapshot restored the wrong frame");
+        for (int i = 0; i != 30; i++) {
+            copied.runFrame();
+            mapped.runFrame();
+        }
+        bool same = copied.state.memory == machine.state.memory && mapped.state.memory == machine.state.memory
+                && copied.state.cycleCount == machine.state.cycleCount && mapped.state.programCounter == machine.state.programCounter;
+        if (!same)
+            BOOST_ERROR("restored machines diverged from the original");
+
+        // a damaged snapshot must be rejected
+        std::vector<uint8_t> damaged(snapshot.data(), snapshot.data() + Snapshot::size);
+        damaged[Snapshot::pageSize + 0x2000] ^= 1;
+        bool rejected = false;
+        try {
+            Snapshot::fromData(damaged.data(), damaged.size());
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        if (!rejected)
+            BOOST_ERROR("snapshot with a bad checksum was accepted");
+
+        // the header is in the saving host's byte order, one from the other order must be refused as such
+        std::vector<uint8_t> foreign(snapshot.data(), snapshot.data() + Snapshot::size);
+        std::reverse(foreign.begin() + offsetof(SnapshotHeader, version), foreign.begin() + offsetof(SnapshotHeader, version) + 4);
+        rejected = false;
+        try {
+            Snapshot::fromData(foreign.data(), foreign.size());
+        } catch (const std::runtime_error& e) {
+            rejected = std::string(e.what()).find("byte order") != std::string::npos;
+        }
+        if (!rejected)
+            BOOST_ERROR("snapshot from a host of the other byte order was not refused");
+        std::remove("snapshot_test.snap");
+    } catch (const std::exception& err) {
+        BOOST_ERROR(std::string("Failure with snapshots : ") + err.what());
+    }
+}
+
+
+
+BOOST_AUTO_TEST_CASE( machine_pool_tests ) {
+    try {
+        SpaceInvaders warm;
+        loadRomFile(warm.state, "../rsc/invaders", 0);
+        for (int i = 0; i != 100; i++)
+            warm.runFrame();
+        const Snapshot baseline(warm);
+        MachinePool pool(baseline, 2);
+        if (pool.size() != 2)
+            BOOST_ERROR("The pool did not make its 2 machines up front");
+        if (pool.available() != 2)
+            BOOST_ERROR("The machines made up front are not available");
+
+        // an episode with the player moving, every episode from the pool must run the same
+        auto episode = [](SpaceInvaders& machine) {
+            machine.input.set(InputLatch::P1Right, true);
+            for (int i = 0; i != 60; i++)
+                machine.runFrame();
+            machine.input.set(InputLatch::P1Right, false);
+        };
+        SpaceInvaders* first = pool.acquire();
+        if (first->frameCount() != 100)
+            BOOST_ERROR("A pooled machine does not start at the baseline's frame");
+        if (first->state.memory != warm.state.memory)
+            BOOST_ERROR("A pooled machine does not start with the baseline's memory");
+        episode(*first);
+        const std::array<uint8_t, State8080::RAM> after = first->state.memory;
+        const uint64_t cycles = first->state.cycleCount;
+        Profiler profiler;
+        first->profiler = &profiler;
+#ifdef MEMORY_STATS
+        MemoryHeatmap heatmap(MemoryHeatmap::Page);
+        first->state.heatmap = &heatmap;
+#endif
+        pool.release(first);
+        if (first->profiler != nullptr) // the hooks belong to whoever had it
+            BOOST_ERROR("A released machine keeps its profiler");
+#ifdef MEMORY_STATS
+        if (first->state.heatmap != nullptr)
+            BOOST_ERROR("A released machine keeps its heatmap");
+#endif
+        if (pool.resets() != 1)
+            BOOST_ERROR("A release did not reset the machine");
+        // the game only writes its RAM, at most 32 pages
+        if (pool.meanPagesRestored() <= 0 || pool.meanPagesRestored() > 32)
+            BOOST_ERROR("A reset restored " + std::to_string(pool.meanPagesRestored()) + " pages, not the few the game wrote");
+
+        for (int i = 0; i != 3; i++) {
+            SpaceInvaders* machine = pool.acquire();
+            if (machine->state.memory != warm.state.memory)
+                BOOST_ERROR("A reused machine does not have the baseline's memory");
+            if (machine->state.cycleCount != warm.state.cycleCount)
+                BOOST_ERROR("A reused machine does not have the baseline's cycle count");
+            if (machine->state.programCounter != warm.state.programCounter)
+                BOOST_ERROR("A reused machine does not have the baseline's program counter");
+            if (machine->frameCount() != 100)
+                BOOST_ERROR("A reused machine does not have the baseline's frame");
+            episode(*machine);
+            if (machine->state.memory != after)
+                BOOST_ERROR("An episode on a reused machine ends with other memory than the first");
+            if (machine->state.cycleCount != cycles)
+                BOOST_ERROR("An episode on a reused machine ends on another cycle than the first");
+            pool.release(machine);
+        }
+        if (pool.size() != 2)
+            BOOST_ERROR("The pool made machines while it had some available");
+
+        // more machines than were made up front, and releases of machines that are not out
+        SpaceInvaders* a = pool.acquire();
+        SpaceInvaders* b = pool.acquire();
+        SpaceInvaders* c = pool.acquire();
+        if (pool.size() != 3)
+            BOOST_ERROR("The pool did not make a machine when all were out");
+        if (pool.available() != 0)
+            BOOST_ERROR("The pool has machines available when all are out");
+        if (c->state.memory != warm.state.memory)
+            BOOST_ERROR("A machine made on demand does not have the baseline's memory");
+        pool.release(a);
+        BOOST_CHECK_THROW(pool.release(a), std::runtime_error);
+        BOOST_CHECK_THROW(pool.release(&warm), std::runtime_error);
+        pool.release(b);
+        pool.release(c);
+        if (pool.available() != 3)
+            BOOST_ERROR("Not every released machine is available");
+    } catch (const std::exception& err) {
+        BOOST_ERROR(std::string("Failure with the machine pool : ") + err.what());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( branch_state_tests ) {
+    try {
+        SpaceInvaders warm;
+        loadRomFile(warm.state, "../rsc/invaders", 0);
+        for (int i = 0; i != 100; i++)
+            warm.runFrame();
+        const BranchState root(warm);
+        if (root.empty())
+            BOOST_ERROR("A branch of a machine is empty");
+        if (root.frameCount() != 100)
+            BOOST_ERROR("A branch of a machine does not have its frame");
+        if (root.read(0x2000) != warm.state.memory[0x2000])
+            BOOST_ERROR("A branch of a machine does not read its memory");
+
+        // a frame with one of the buttons held, run on branches and on copies of the machine
+        const InputLatch::Button buttons[] = {InputLatch::P1Left, InputLatch::P1Right, InputLatch::P1Shoot};
+        auto frame = [](InputLatch::Button button) {
+            return [button](SpaceInvaders& machine) {
+                machine.input.set(button, true);
+                machine.runFrame();
+                machine.input.set(button, false);
+            };
+        };
+        auto same = [](const BranchState& state, const SpaceInvaders& machine) {
+            for (std::size_t address = 0; address != State8080::RAM; address++) {
+                if (state.read(static_cast<uint16_t>(address)) != machine.state.memory[address])
+                    return false;
+            }
+            return state.registers().programCounter == machine.state.programCounter && state.registers().cycleCount == machine.state.cycleCount;
+        };
+        Brancher brancher;
+        BranchSet seen;
+        if (!seen.insert(root))
+            BOOST_ERROR("The first branch was already in the set");
+        if (seen.insert(root.fork()))
+            BOOST_ERROR("A fork is a new state to the set");
+        for (const InputLatch::Button& button : buttons) {
+            BranchState child = brancher.step(root, frame(button));
+            BranchState grandchild = brancher.step(child, frame(button));
+            SpaceInvaders direct = warm;
+            frame(button)(direct);
+            if (!same(child, direct))
+                BOOST_ERROR("A branched frame differs from the frame run on the machine");
+            if (child.frameCount() != 101)
+                BOOST_ERROR("A branched frame does not count a frame");
+            frame(button)(direct);
+            if (!same(grandchild, direct))
+                BOOST_ERROR("A branch of a branch differs from two frames run on the machine");
+            if (grandchild.frameCount() != 102)
+                BOOST_ERROR("A branch of a branch does not count two frames");
+            // a frame writes a few pages of RAM, the rest is shared
+            if (child.sharedPages(root) < State8080::pageCount - 32)
+                BOOST_ERROR("A branch shares only " + std::to_string(child.sharedPages(root)) + " pages with its parent");
+            if (grandchild.sharedPages(child) < State8080::pageCount - 32)
+                BOOST_ERROR("A branch of a branch shares only " + std::to_string(grandchild.sharedPages(child)) + " pages with its parent");
+            if (!seen.insert(child))
+                BOOST_ERROR("A branched frame was already in the set");
+            if (!seen.insert(grandchild))
+                BOOST_ERROR("A branch of a branch was already in the set");
+
+            // the same input from the same state is the same state
+            const BranchState again = brancher.step(root, frame(button));
+            if (again != child)
+                BOOST_ERROR("The same frame from the same branch is another state");
+            if (again.hash() != child.hash())
+                BOOST_ERROR("The same frame from the same branch has another hash");
+            if (seen.insert(again))
+                BOOST_ERROR("The same frame from the same branch is a new state to the set");
+            child.discard();
+            if (!child.empty())
+                BOOST_ERROR("A discarded branch is not empty");
+            if (again == child)
+                BOOST_ERROR("A discarded branch equals the state it had");
+        }
+        if (seen.size() != 7)
+            BOOST_ERROR("The set holds " + std::to_string(seen.size()) + " states, not the root and two for every button");
+        if (!seen.contains(root))
+            BOOST_ERROR("The set lost the root");
+        // loads after the first copy only what differs from the branch before
+        const uint64_t copied = brancher.pagesCopied();
+        brancher.step(root, frame(InputLatch::P1Left));
+        if (brancher.pagesCopied() - copied > 32)
+            BOOST_ERROR("A step copied " + std::to_string(brancher.pagesCopied() - copied) + " pages, more than a frame writes");
+        BOOST_CHECK_THROW(brancher.load(BranchState()), std::runtime_error);
+        if (root.frameCount() != 100 || !same(root, warm))
+            BOOST_ERROR("Stepping from the root changed it");
+    } catch (const std::exception& err) {
+        BOOST_ERROR(std::string("Failure branching states : ") + err.what());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( rewind_tests ) {
+    try {
+        SpaceInvaders machine;
+        loadRomFile(machine.state, "../rsc/invaders", 0);
+        // a small buffer so old frames are folded into keyframes while running
+        RewindBuffer rewind(40, 8);
+        std::vector<Snapshot> full;
+        for (int i = 0; i != 150; i++) {
+            machine.runFrame();
+            rewind.capture(machine);
+            full.emplace_back(machine);
+        }
+        if (rewind.size() != 40)
+            BOOST_ERROR("rewind buffer did not stay at its capacity");
+
+        // every frame stepped back to must match the full snapshot taken of it
+        for (std::size_t frame = full.size() - 2; rewind.stepBack(machine); frame--) {
+            SpaceInvaders expected;
+            full[frame].restore(expected);
+            if (machine.state.memory != expected.state.memory || machine.state.programCounter != expected.state.programCounter
+                    || machine.frameCount() != expected.frameCount()) {
+                BOOST_ERROR("rewound frame " + std::to_string(frame) + " differs from its snapshot");
+                break;
+            }
+        }
+        if (rewind.size() != 1)
+            BOOST_ERROR("rewind buffer did not step back through every frame");
+    } catch (const std::exception& err) {
+        BOOST_ERROR(std::string("Failure rewinding : ") + err.what());
+    }
+}
+
+
+
+BOOST_AUTO_TEST_CASE( movie_tests ) {
+    try {
+        // coin, start and then move and shoot in a pattern
+        auto press = [](InputLatch& input, int frame) {
+            input.set(InputLatch::Coin, frame >= 60 && frame < 66);
+            input.set(InputLatch::P1Start, frame >= 120 && frame < 126);
+            input.set(InputLatch::P1Left, frame > 200 && frame % 90 < 40);
+            input.set(InputLatch::P1Right, frame > 200 && frame % 90 >= 50);
+            input.set(InputLatch::P1Shoot, frame > 200 && frame % 30 < 3);
+        };
+        SpaceInvaders recorded;
+        loadRomFile(recorded.state, "../rsc/invaders", 0);
+        Movie movie = Movie::record(recorded);
+        recorded.movie = &movie;
+        for (int frame = 0; frame != 900; frame++) {
+            press(recorded.input, frame);
+            recorded.runFrame();
+        }
+        movie.toFile("movie_test.mov");
+
+        SpaceInvaders played;
+        loadRomFile(played.state, "../rsc/invaders", 0);
+        Movie replay = Movie::fromFile("movie_test.mov");
+        if (!replay.matches(played) || replay.frames().size() != 900)
+            BOOST_ERROR("movie did not read back");
+        played.movie = &replay;
+        for (int frame = 0; frame != 900; frame++)
+            played.runFrame();
+        if (played.state.memory != recorded.state.memory || played.state.cycleCount != recorded.state.cycleCount)
+            BOOST_ERROR("played movie differs from the recorded run");
+        std::ifstream file("movie_test.mov", std::ios_base::binary | std::ios_base::ate);
+        if (file.tellg() > 1024)
+            BOOST_ERROR("movie file is not compact");
+        file.close();
+        std::remove("movie_test.mov");
+    } catch (const std::exception& err) {
+        BOOST_ERROR(std::string("Failure with movies : ") + err.what());
+    }
+}
+
+
+
+// The golden run plays test/golden/invaders.mov through the game and hashes work and video RAM after every frame.
+// Each mode drives the machine a different way and must give the same hashes, the first mode is the reference.
+// Regenerate the hashes with the headless runner when the emulation is meant to change.
+using FrameCheck = std::function<bool(const SpaceInvaders&)>; // after every frame, false stops the run
+
+struct GoldenMode {
+    const char* name;
+    void (*run)(SpaceInvaders&, std::size_t frames, const FrameCheck&);
+};
+
+void goldenFrames(SpaceInvaders& machine, std::size_t frames, const FrameCheck& check) {
+    while (machine.frameCount() != frames) {
+        machine.runFrame();
+        if (!check(machine))
+            return;
+    }
+}
+
+// moved into a new machine through a snapshot every 500 frames
+void goldenSnapshots(SpaceInvaders& machine, std::size_t frames, const FrameCheck& check) {
+    while (machine.frameCount() != frames) {
+        machine.runFrame();
+        if (!check(machine))
+            return;
+        if (machine.frameCount() % 500 == 0) {
+            const Snapshot snapshot(machine);
+            Movie* movie = machine.movie;
+            machine = SpaceInvaders();
+            Snapshot::fromData(snapshot.data(), Snapshot::size).restore(machine);
+            machine.movie = movie;
+        }
+    }
+}
+
+// steps back 20 frames every 250 and runs them again
+void goldenRewind(SpaceInvaders& machine, std::size_t frames, const FrameCheck& check) {
+    RewindBuffer rewind(60, 15);
+    uint64_t rewound = 0;
+    while (machine.frameCount() != frames) {
+        machine.runFrame();
+        rewind.capture(machine);
+        if (!check(machine))
+            return;
+        if (machine.frameCount() % 250 == 0 && machine.frameCount() != rewound) {
+            rewound = machine.frameCount();
+            for (int i = 0; i != 20; i++)
+                rewind.stepBack(machine);
+        }
+    }
+}
+
+const std::array<GoldenMode, 3> goldenModes = {{
+    {"frames", goldenFrames},
+    {"snapshots", goldenSnapshots},
+    {"rewind", goldenRewind}
+}};
+
+struct GoldenResult {
+    bool diverged = false;
+    SpaceInvaders machine; // at the first frame that differs
+};
+
+GoldenResult runGolden(const GoldenMode& mode, const Movie& recording, const std::vector<uint64_t>& golden, std::size_t stopFrame) {
+    GoldenResult result;
+    Movie movie = recording;
+    SpaceInvaders machine;
+    loadRomFile(machine.state, "../rsc/invaders", 0);
+    machine.movie = &movie;
+    mode.run(machine, stopFrame, [&](const SpaceInvaders& m) {
+        if (frameHash(m.state) == golden[m.frameCount() - 1])
+            return true;
+        result.diverged = true;
+        result.machine = m;
+        return false;
+    });
+    if (!result.diverged)
+        result.machine = machine;
+    result.machine.movie = nullptr;
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE( golden_frame_tests ) {
+    try {
+        const Movie movie = Movie::fromFile("golden/invaders.mov");
+        const std::vector<uint64_t> golden = frameHashesFromFile("golden/invaders.hashes");
+        if (golden.size() != movie.frames().size())
+            BOOST_ERROR("golden hashes do not cover the golden movie");
+
+        std::vector<GoldenResult> results(goldenModes.size());
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i != goldenModes.size(); i++) {
+            threads.emplace_back([&, i]() {
+                results[i] = runGolden(goldenModes[i], movie, golden, golden.size());
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+
+        for (std::size_t i = 0; i != goldenModes.size(); i++) {
+            if (!results[i].diverged)
+                continue;
+            const SpaceInvaders& diverged = results[i].machine;
+            const uint64_t frame = diverged.frameCount();
+            std::ostringstream oss;
+            oss << "golden run " << goldenModes[i].name << " diverged at frame " << frame;
+            // the reference, run to the same frame, shows where memory differs, unless it is the reference that diverged
+            const GoldenResult reference = i != 0 ? runGolden(goldenModes[0], movie, golden, frame) : GoldenResult();
+            if (i != 0 && !reference.diverged) {
+                for (std::size_t address = frameHashStart; address != frameHashStart + frameHashSize; address++) {
+                    if (diverged.state.memory[address] != reference.machine.state.memory[address]) {
+                        oss << std::hex << std::uppercase << ", first at 0x" << address << " is 0x" << static_cast<int>(diverged.state.memory[address])
+                            << ", expected 0x" << static_cast<int>(reference.machine.state.memory[address]);
+                        break;
+                    }
+                }
+            }
+            else if (i == 0) {
+                // the golden file holds hashes only, but the frame before still matched it, so the bytes this frame
+                // wrote are where the wrong one is
+                const GoldenResult before = runGolden(goldenModes[0], movie, golden, frame - 1);
+                std::size_t changed = 0;
+                oss << std::hex << std::uppercase;
+                for (std::size_t address = frameHashStart; address != frameHashStart + frameHashSize; address++) {
+                    const int was = before.machine.state.memory[address];
+                    const int is = diverged.state.memory[address];
+                    if (was != is && changed++ < 16)
+                        oss << (changed == 1 ? ", the frame changed 0x" : ", 0x") << address << " from 0x" << was << " to 0x" << is;
+                }
+                oss << std::dec << (changed > 16 ? " and " + std::to_string(changed - 16) + " more bytes" : "");
+            }
+            BOOST_ERROR(oss.str());
+        }
+    } catch (const std::exception& err) {
+        BOOST_ERROR(std::string("Failure with the golden run : ") + err.what());
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE( opcode_info_tests ) {
+    // the sizes in the table are what the cpu steps over for every opcode that does not branch
+    for (int opcode = 0; opcode != 256; opcode++) {
+        if (opcodeInfo[opcode].branch != OpcodeInfo::None)
+            continue;
+        State8080 state = programState({static_cast<uint8_t>(opcode)});
+        Disassembler8080 cpu;
+        cpu.runCycle(state);
+        if (state.programCounter != 0x100 + opcodeInfo[opcode].size) {
+            std::ostringstream oss;
+            oss << opcodeInfo[opcode].mnemonic << " moved the program counter " << state.programCounter - 0x100
+                << " bytes, its size is " << static_cast<int>(opcodeInfo[opcode].size);
+            BOOST_ERROR(oss.str());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( profiler_tests ) {
+    Disassembler8080 cpu;
+    State8080 state = programState({
+        0xCD, 0x10, 0x01,                   // 0100 CALL 0110
+        0xC3, 0x00, 0x01,                   // 0103 JMP 0100
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0x06, 0x03,                         // 0110 MVI B,3
+        0x05,                               // 0112 DCR B
+        0xC2, 0x12, 0x01,                   // 0113 JNZ 0112
+        0xC9                                // 0116 RET
+    });
+    Symbols symbols;
+    symbols.add(0x110, "Countdown");
+
+    Profiler profiler;
+    for (int i = 0; i != 10 * 10; i++) { // 10 times round the loop of 10 instructions
+        profiler.sample(state);
+        cpu.runCycle(state);
+    }
+    if (profiler.samples() != 100)
+        BOOST_ERROR("The profiler counted " + std::to_string(profiler.samples()) + " of 100 instructions");
+    const std::vector<Profiler::Routine> routines = profiler.routines(state, symbols);
+    if (routines.size() != 2)
+        BOOST_FAIL("The profiler found " + std::to_string(routines.size()) + " routines, not the called one and the rest");
+    if (routines[0].entry != 0x110)
+        BOOST_ERROR("The hottest routine is not the called one");
+    if (routines[0].name != "Countdown")
+        BOOST_ERROR("The called routine is not named from the symbols");
+    if (routines[0].samples != 80)
+        BOOST_ERROR("The called routine has " + std::to_string(routines[0].samples) + " samples, not 80");
+    if (routines[1].entry != 0x000)
+        BOOST_ERROR("Code outside any call is not put in a routine at 0");
+    if (routines[1].samples != 20)
+        BOOST_ERROR("Code outside any call has " + std::to_string(routines[1].samples) + " samples, not 20");
+    const std::vector<Profiler::Block> blocks = profiler.blocks(state, symbols);
+    if (blocks.size() != 5)
+        BOOST_FAIL("The profiler found " + std::to_string(blocks.size()) + " basic blocks, not 5");
+    if (blocks[0].start != 0x112 || blocks[0].end != 0x116)
+        BOOST_ERROR("The hottest block is not the countdown loop");
+    if (blocks[0].samples != 60)
+        BOOST_ERROR("The countdown loop has " + std::to_string(blocks[0].samples) + " samples, not 60");
+    if (blocks[0].entered != 30)
+        BOOST_ERROR("The countdown loop was entered " + std::to_string(blocks[0].entered) + " times, not 30");
+    if (symbols.describe(0x113) != "Countdown+0x3")
+        BOOST_ERROR("An address inside a symbol is described as " + symbols.describe(0x113));
+    if (symbols.describe(0x10) != "0x0010")
+        BOOST_ERROR("An address before every symbol is described as " + symbols.describe(0x10));
+    if (disassemble(state, 0x113) != "JNZ 0x0112")
+        BOOST_ERROR("JNZ is disassembled as " + disassemble(state, 0x113));
+    if (disassemble(state, 0x110) != "MVI B,0x03")
+        BOOST_ERROR("MVI is disassembled as " + disassemble(state, 0x110));
+
+    // sampling takes the instruction running every period cycles
+    Profiler sampled(100);
+    const uint64_t startCycle = state.cycleCount;
+    while (state.cycleCount - startCycle < 100000) {
+        sampled.sample(state);
+        cpu.runCycle(state);
+    }
+    if (sampled.samples() < 999 || sampled.samples() > 1001)
+        BOOST_ERROR("Sampling every 100 of 100000 cycles took " + std::to_string(sampled.samples()) + " samples");
+}
+
+BOOST_AUTO_TEST_CASE( call_graph_tests ) {
+    Disassembler8080 cpu;
+    State8080 state = programState({
+        0xCD, 0x10, 0x01,                   // 0100 CALL 0110
+        0xC3, 0x00, 0x01,                   // 0103 JMP 0100
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0xCD, 0x20, 0x01,                   // 0110 CALL 0120
+        0xC9,                               // 0113 RET
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0xE1,                               // 0120 POP H, drops its return address
+        0xC3, 0x13, 0x01                    // 0121 JMP 0113
+    });
+    Symbols symbols;
+    symbols.add(0x120, "Discard");
+
+    CallGraph graph;
+    for (int i = 0; i != 6 * 3; i++) { // 3 times round the loop
+        const uint16_t pc = state.programCounter;
+        const uint16_t sp = state.stackPointer;
+        const uint64_t startCycle = state.cycleCount;
+        cpu.runCycle(state);
+        graph.executed(state, pc, sp, startCycle);
+    }
+    // the return 0120 jumped to is its own, it also closes the call to 0110 whose return address it pops
+    if (graph.depth() != 0)
+        BOOST_ERROR("The call graph is left " + std::to_string(graph.depth()) + " calls deep");
+    const std::vector<CallGraph::Routine> routines = graph.routines(symbols);
+    if (routines.size() != 3)
+        BOOST_FAIL("The call graph has " + std::to_string(routines.size()) + " routines, not 3");
+    if (routines[0].entry != 0x100)
+        BOOST_ERROR("The outermost routine does not start at 0x100");
+    if (routines[0].inclusive != 3 * 80)
+        BOOST_ERROR("The outermost routine has " + std::to_string(routines[0].inclusive) + " inclusive cycles");
+    if (routines[0].exclusive != 3 * 27)
+        BOOST_ERROR("The outermost routine has " + std::to_string(routines[0].exclusive) + " exclusive cycles");
+    if (routines[1].entry != 0x110)
+        BOOST_ERROR("The second routine does not start at 0x110");
+    if (routines[1].calls != 3)
+        BOOST_ERROR("The routine at 0x110 was called " + std::to_string(routines[1].calls) + " times, not 3");
+    if (routines[1].inclusive != 3 * 53)
+        BOOST_ERROR("The routine at 0x110 has " + std::to_string(routines[1].inclusive) + " inclusive cycles");
+    if (routines[1].exclusive != 3 * 17)
+        BOOST_ERROR("The routine at 0x110 has " + std::to_string(routines[1].exclusive) + " exclusive cycles");
+    if (routines[2].name != "Discard")
+        BOOST_ERROR("The innermost routine is not named from the symbols");
+    if (routines[2].calls != 3)
+        BOOST_ERROR("Discard was called " + std::to_string(routines[2].calls) + " times, not 3");
+    if (routines[2].inclusive != 3 * 36)
+        BOOST_ERROR("Discard has " + std::to_string(routines[2].inclusive) + " inclusive cycles");
+
+    std::ostringstream folded;
+    graph.writeFolded(folded, symbols);
+    if (folded.str() != "sub_0100 81\nsub_0100;sub_0110 51\nsub_0100;sub_0110;Discard 108\n")
+        BOOST_ERROR("The folded stacks are\n" + folded.str());
+}
+
+BOOST_AUTO_TEST_CASE( memory_heatmap_tests ) {
+    Disassembler8080 cpu;
+    State8080 state = programState({
+        0x31, 0x00, 0x24,                   // 0100 LXI SP,2400
+        0x3E, 0x05,                         // 0103 MVI A,5
+        0x32, 0x00, 0x20,                   // 0105 STA 2000
+        0x3A, 0x01, 0x21,                   // 0108 LDA 2101
+        0xC5,                               // 010B PUSH B
+        0xCD, 0x20, 0x01,                   // 010C CALL 0120
+        0xC3, 0x00, 0x01                    // 010F JMP 0100
+    });
+    state.memory[0x120] = 0xC9;             // 0120 RET
+
+    MemoryHeatmap heatmap;
+    state.heatmap = &heatmap;
+    for (int i = 0; i != 7; i++) {
+        cpu.runCycle(state);
+    }
+    heatmap.endFrame();
+    cpu.runCycle(state);
+    heatmap.endFrame();
+    state.heatmap = nullptr;
+    cpu.runCycle(state);
+
+    // every access is on the page it was made to, none were counted once the heatmap was unset
+    if (heatmap.total(MemoryHeatmap::Fetch) != 19)
+        BOOST_ERROR("The heatmap counted " + std::to_string(heatmap.total(MemoryHeatmap::Fetch)) + " fetches, not 19");
+    if (heatmap.total(MemoryHeatmap::Fetch, 0x100, 0x1FF) != 19)
+        BOOST_ERROR("The fetches are not counted on the page of the code");
+    if (heatmap.total(MemoryHeatmap::Write) != 1)
+        BOOST_ERROR("The heatmap counted " + std::to_string(heatmap.total(MemoryHeatmap::Write)) + " writes, not STA's");
+    if (heatmap.total(MemoryHeatmap::Write, 0x2000, 0x20FF) != 1)
+        BOOST_ERROR("STA's write is not counted on page 0x20");
+    if (heatmap.total(MemoryHeatmap::Read) != 1)
+        BOOST_ERROR("The heatmap counted " + std::to_string(heatmap.total(MemoryHeatmap::Read)) + " reads, not LDA's");
+    if (heatmap.total(MemoryHeatmap::Read, 0x2100, 0x21FF) != 1)
+        BOOST_ERROR("LDA's read is not counted on page 0x21");
+    if (heatmap.total(MemoryHeatmap::Stack) != 6)
+        BOOST_ERROR("The heatmap counted " + std::to_string(heatmap.total(MemoryHeatmap::Stack)) + " stack accesses, not 6");
+    if (heatmap.total(MemoryHeatmap::Stack, 0x2300, 0x23FF) != 6)
+        BOOST_ERROR("The stack accesses are not counted on page 0x23");
+    if (heatmap.frames() != 2)
+        BOOST_FAIL("The heatmap kept " + std::to_string(heatmap.frames()) + " frames, not 2");
+    if (heatmap.frameCount(0, MemoryHeatmap::Fetch, 0x01) != 16)
+        BOOST_ERROR("The first frame has " + std::to_string(heatmap.frameCount(0, MemoryHeatmap::Fetch, 0x01)) + " fetches, not 16");
+    if (heatmap.frameCount(1, MemoryHeatmap::Fetch, 0x01) != 3)
+        BOOST_ERROR("The second frame has " + std::to_string(heatmap.frameCount(1, MemoryHeatmap::Fetch, 0x01)) + " fetches, not 3");
+    if (heatmap.frameCount(0, MemoryHeatmap::Stack, 0x23) != 6)
+        BOOST_ERROR("The first frame does not have every stack access");
+    if (heatmap.frameCount(1, MemoryHeatmap::Stack, 0x23) != 0)
+        BOOST_ERROR("The second frame has stack accesses of the first");
+
+    std::ostringstream csv;
+    heatmap.writeFramesCsv(csv);
+    if (csv.str().find("0,32,0,0,1,0\n") == std::string::npos)
+        BOOST_ERROR("The frames csv does not have the first frame's write to page 0x20");
+
+    MemoryHeatmap bytes(MemoryHeatmap::Byte);
+    bytes.count(MemoryHeatmap::Write, 0x2000);
+    bytes.count(MemoryHeatmap::Fetch, 0xFFFF, 3); // wraps around to 0000 and 0001
+    if (bytes.total(MemoryHeatmap::Write, 0x2000, 0x2000) != 1)
+        BOOST_ERROR("A byte heatmap does not count the write on its byte");
+    if (bytes.total(MemoryHeatmap::Write, 0x2001, 0x20FF) != 0)
+        BOOST_ERROR("A byte heatmap counts the write on the bytes after it");
+    if (bytes.total(MemoryHeatmap::Fetch, 0x0000, 0x0001) != 2)
+        BOOST_ERROR("A count past 0xFFFF does not wrap around to 0");
+    if (bytes.total(MemoryHeatmap::Fetch) != 3)
+        BOOST_ERROR("A count of 3 bytes is not 3 fetches");
+}
+
+BOOST_AUTO_TEST_CASE( coverage_tests ) {
+    Disassembler8080 cpu;
+    State8080 state = programState({
+        0xCD, 0x10, 0x01,                   // 0100 CALL 0110
+        0xC3, 0x00, 0x01,                   // 0103 JMP 0100
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0x06, 0x03,                         // 0110 MVI B,3
+        0x05,                               // 0112 DCR B
+        0xC2, 0x12, 0x01,                   // 0113 JNZ 0112
+        0x3A, 0x40, 0x01,                   // 0116 LDA 0140
+        0xC9                                // 0119 RET
+    });
+
+    Coverage coverage;
+    for (int i = 0; i != 2 * 11; i++) { // twice round the loop of 11 instructions
+        coverage.sample(state);
+        cpu.runCycle(state);
+    }
+    coverage.sample(state); // the jump back is known when the next instruction comes
+    if (coverage.use(0x100) != Coverage::Opcode)
+        BOOST_ERROR("The CALL at 0x100 is not marked as an opcode");
+    if (coverage.use(0x101) != Coverage::Operand)
+        BOOST_ERROR("The CALL's address is not marked as an operand");
+    if (coverage.use(0x106) != 0)
+        BOOST_ERROR("The bytes never run are marked");
+    if (coverage.use(0x140) != Coverage::Read)
+        BOOST_ERROR("The byte LDA loads is not marked as read");
+    if (coverage.use(0x3FFE) != (Coverage::Read | Coverage::Write) || coverage.use(0x3FFF) != (Coverage::Read | Coverage::Write))
+        BOOST_ERROR("The return address is not marked as written and read");
+    if (coverage.executions(0x112) != 6)
+        BOOST_ERROR("DCR B ran " + std::to_string(coverage.executions(0x112)) + " times, not 6");
+    if (coverage.executions(0x100) != 3)
+        BOOST_ERROR("The CALL ran " + std::to_string(coverage.executions(0x100)) + " times, not 3");
+    if (coverage.transfers().at(0x01130112) != 4)
+        BOOST_ERROR("The JNZ is not taken 4 times");
+    if (coverage.transfers().at(0x01130116) != 2)
+        BOOST_ERROR("The JNZ does not fall through twice");
+    if (coverage.transfers().at(0x01190103) != 2)
+        BOOST_ERROR("The RET does not return twice");
+    if (coverage.entries().size() != 1 || coverage.entries().at(0x100) != 1)
+        BOOST_ERROR("The start of the program is not its only entry");
+
+    const ControlFlowGraph graph(coverage);
+    if (graph.blocks().size() != 5)
+        BOOST_FAIL("The control flow graph has " + std::to_string(graph.blocks().size()) + " blocks, not 5");
+    if (graph.blocks()[3].start != 0x112 || graph.blocks()[3].end != 0x116)
+        BOOST_ERROR("The countdown loop is not block 3");
+    if (graph.blocks()[3].instructions != 2)
+        BOOST_ERROR("The countdown loop has " + std::to_string(graph.blocks()[3].instructions) + " instructions, not 2");
+    if (graph.find(0x117) != 4)
+        BOOST_ERROR("An operand of LDA is not found in its block");
+    if (graph.find(0x106) != ControlFlowGraph::none)
+        BOOST_ERROR("A byte never run is found in a block");
+    std::map<std::tuple<uint32_t, uint32_t, ControlFlowGraph::Kind>, uint64_t> edges;
+    for (const ControlFlowGraph::Edge& edge : graph.edges()) {
+        edges[std::make_tuple(edge.from, edge.to, edge.kind)] = edge.count;
+    }
+    const std::map<std::tuple<uint32_t, uint32_t, ControlFlowGraph::Kind>, uint64_t> expected = {
+        {std::make_tuple(0, 2, ControlFlowGraph::Call), 2}, {std::make_tuple(0, 1, ControlFlowGraph::Fallthrough), 2},
+        {std::make_tuple(1, 0, ControlFlowGraph::Jump), 2}, {std::make_tuple(2, 3, ControlFlowGraph::Fallthrough), 2},
+        {std::make_tuple(3, 3, ControlFlowGraph::Jump), 4}, {std::make_tuple(3, 4, ControlFlowGraph::Fallthrough), 2},
+        {std::make_tuple(4, 1, ControlFlowGraph::Return), 2}
+    };
+    if (edges != expected)
+        BOOST_ERROR("The control flow graph does not have the edges the program took");
+    Symbols symbols;
+    symbols.add(0x110, "Countdown");
+    std::ostringstream dot;
+    graph.writeDot(dot, symbols);
+    if (dot.str().find("b0110 [label=\"Countdown\\l0x0110-0x0111") == std::string::npos)
+        BOOST_ERROR("The dot graph does not label the routine's first block with its symbol");
+    if (dot.str().find("b0112 -> b0112 [label=\"4\"]") == std::string::npos)
+        BOOST_ERROR("The dot graph does not have the loop taken 4 times");
+    std::ostringstream json;
+    graph.writeJson(json, symbols, 0x100, 0x11F);
+    if (json.str().find("\"code\": \"3A4001C9\", \"instructions\": [\"LDA 0x0140\", \"RET\"]") == std::string::npos)
+        BOOST_ERROR("The json does not have the code and disassembly of the last block");
+    if (json.str().find("{\"start\": 262, \"end\": 271, \"use\": []}") == std::string::npos)
+        BOOST_ERROR("The json does not have the range never run");
+
+    // an interrupt enters its vector and pushes the return address
+    coverage.interrupted(state, 0xCF);
+    if (coverage.entries().count(0x08) == 0 || coverage.entries().at(0x08) != 1)
+        BOOST_ERROR("An interrupt does not enter its vector");
+    if (coverage.use(0x3FFE) != (Coverage::Read | Coverage::Write))
+        BOOST_ERROR("An interrupt's return address is not marked as written");
+
+    try {
+        coverage.toFile("coverage_test.cov");
+        Coverage merged = Coverage::fromFile("coverage_test.cov");
+        merged.merge(coverage);
+        if (merged.executions(0x112) != 12)
+            BOOST_ERROR("Merged coverage does not add the executions");
+        if (merged.transfers().at(0x01130112) != 8)
+            BOOST_ERROR("Merged coverage does not add the transfers");
+        if (merged.use(0x140) != Coverage::Read)
+            BOOST_ERROR("Merged coverage does not keep the uses");
+        Coverage other;
+        state.memory[0x100] = 0x00;
+        state.programCounter = 0x100;
+        other.sample(state);
+        BOOST_CHECK_THROW(merged.merge(other), std::runtime_error);
+    } catch (const std::exception& err) {
+        BOOST_ERROR(std::string("Failure saving coverage : ") + err.what());
+    }
+    std::remove("coverage_test.cov");
+}
+
+BOOST_AUTO_TEST_CASE( memory_search_tests ) {
+    try {
+        State8080 state;
+        MemorySearch search;
+        BOOST_CHECK_THROW(search.filter(state, MemorySearch::Test::Changed), std::runtime_error);
+        state.memory[0x2000] = 5;
+        state.memory[0x2041] = 5;
+        state.memory[0x3FFF] = 200;
+        search.reset(state);
+        if (search.count() != 0x2000)
+            BOOST_ERROR("A reset search does not start from every byte of RAM");
+        if (search.run("unchanged", state) != 0x2000)
+            BOOST_ERROR("unchanged dropped bytes that did not change");
+        state.memory[0x2000] = 6;
+        state.memory[0x2041] = 4;
+        state.memory[0x3FFF] = 199;
+        if (search.run("changed", state) != 3)
+            BOOST_ERROR("changed did not keep just the 3 bytes written");
+        if (!search.candidate(0x2000) || !search.candidate(0x2041) || !search.candidate(0x3FFF))
+            BOOST_ERROR("changed dropped a byte that was written");
+        if (search.candidate(0x2001))
+            BOOST_ERROR("changed kept a byte that was not written");
+        state.memory[0x2000] = 7;
+        state.memory[0x2041] = 3;
+        state.memory[0x3FFF] = 198;
+        if (search.run("dec-by 1", state) != 2)
+            BOOST_ERROR("dec-by 1 did not keep the 2 bytes that went down by one");
+        if (search.run("range 3 0xC6", state) != 2)
+            BOOST_ERROR("range did not take its bounds as inclusive, in decimal and hex");
+        if (search.filter(state, MemorySearch::Test::Less, 100) != 1)
+            BOOST_ERROR("Less did not keep the one byte under 100");
+        if (search.candidates() != std::vector<uint16_t>{0x2041})
+            BOOST_ERROR("The candidate left is not 0x2041");
+        BOOST_CHECK_THROW(search.run("inc-by", state), std::runtime_error);
+        BOOST_CHECK_THROW(search.run("eq 256", state), std::runtime_error);
+        BOOST_CHECK_THROW(search.run("bigger", state), std::runtime_error);
+        if (search.run("reset", state) != 0x2000)
+            BOOST_ERROR("reset does not go back to every byte of RAM");
+        BOOST_CHECK_THROW(MemorySearch(0x2000, 100), std::runtime_error);
+
+        // the game's credits go up by one when a coin goes in and stay put otherwise
+        SpaceInvaders machine;
+        loadRomFile(machine.state, "../rsc/invaders", 0);
+        for (int i = 0; i != 100; i++)
+            machine.runFrame();
+        search.reset(machine.state);
+        for (int i = 0; i != 10; i++) {
+            machine.runFrame();
+            search.run("unchanged", machine.state);
+        }
+        machine.input.set(InputLatch::Coin, true);
+        for (int i = 0; i != 5; i++)
+            machine.runFrame();
+        machine.input.set(InputLatch::Coin, false);
+        for (int i = 0; i != 10; i++)
+            machine.runFrame();
+        search.run("inc-by 1", machine.state);
+        if (!search.candidate(0x20EB))
+            BOOST_ERROR("The search lost the credits at 0x20EB");
+        if (search.count() >= 10)
+            BOOST_ERROR("The search left " + std::to_string(search.count()) + " candidates for the credits");
+    } catch (const std::exception& err) {
+        BOOST_ERROR(std::string("Failure searching memory : ") + err.what());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( invaders_observer_tests ) {
+    try {
+        BOOST_CHECK_THROW(InvadersObserver({4, 0, 64, 64, 2}), std::runtime_error);
+        BOOST_CHECK_THROW(InvadersObserver({0, 0, 64, 64, 3}), std::runtime_error);
+        BOOST_CHECK_THROW(InvadersObserver({0, 200, 64, 32, 1}), std::runtime_error);
+
+        SpaceInvaders machine;
+        loadRomFile(machine.state, "../rsc/invaders", 0);
+        InvadersObserver observer(InvadersObserver::fullScreen(2));
+        if (observer.screenWidth() != 128 || observer.screenHeight() != 112)
+            BOOST_ERROR("The screen shrunk by 2 is not 128x112");
+        for (int i = 0; i != 100; i++)
+            machine.runFrame();
+        InvadersObserver::Observation seen = observer.observe(machine);
+        if (seen.frame != 100)
+            BOOST_ERROR("An observation is not of the machine's frame");
+        if (seen.game.playing())
+            BOOST_ERROR("The game is playing in the attract mode");
+        if (seen.game.credits() != 0)
+            BOOST_ERROR("The game has credits before a coin");
+
+        // a coin, a start and a wait for the fleet to come down
+        machine.input.set(InputLatch::Coin, true);
+        for (int i = 0; i != 5; i++)
+            machine.runFrame();
+        machine.input.set(InputLatch::Coin, false);
+        for (int i = 0; i != 30; i++)
+            machine.runFrame();
+        if (observer.observe(machine).game.credits() != 1)
+            BOOST_ERROR("A coin did not give a credit");
+        machine.input.set(InputLatch::P1Start, true);
+        for (int i = 0; i != 5; i++)
+            machine.runFrame();
+        machine.input.set(InputLatch::P1Start, false);
+        for (int i = 0; i != 400; i++)
+            machine.runFrame();
+        seen = observer.observe(machine);
+        const InvadersView& game = seen.game;
+        if (!game.playing())
+            BOOST_ERROR("The game is not playing after a start");
+        if (game.player() != 1)
+            BOOST_ERROR("Player " + std::to_string(game.player()) + " is up after a one player start");
+        if (game.credits() != 0)
+            BOOST_ERROR("The start did not take the credit");
+        if (game.ships() != 2)
+            BOOST_ERROR("The player has " + std::to_string(game.ships()) + " ships in reserve, not 2");
+        if (!game.playerAlive())
+            BOOST_ERROR("The player is not alive after a start");
+        if (game.aliensLeft() != 55)
+            BOOST_ERROR(std::to_string(game.aliensLeft()) + " aliens are left before a shot");
+        if (!game.alien(0, 0) || !game.alien(4, 10))
+            BOOST_ERROR("The corners of the fleet are not alive");
+        if (game.score() != 0)
+            BOOST_ERROR("The score is " + std::to_string(game.score()) + " after a start");
+        if (game.aliens() != machine.state.memory.data() + 0x2100) // a view, not a copy
+            BOOST_ERROR("The aliens are not read from the player's page");
+        if (game.score(2) != 0)
+            BOOST_ERROR("player 2's score is " + std::to_string(game.score(2)) + " after a start");
+        machine.state.memory[0x20FC] = 0x50;
+        machine.state.memory[0x20FD] = 0x12;
+        if (game.score(2) != 1250)
+            BOOST_ERROR("player 2's score was not read from 0x20FC");
+        if (game.score(1) != 0)
+            BOOST_ERROR("player 1's score changed with player 2's");
+        machine.state.memory[0x20FC] = 0x00;
+        machine.state.memory[0x20FD] = 0x00;
+        const uint8_t x = game.playerX();
+        machine.input.set(InputLatch::P1Right, true);
+        for (int i = 0; i != 20; i++)
+            machine.runFrame();
+        machine.input.set(InputLatch::P1Right, false);
+        if (game.playerX() <= x)
+            BOOST_ERROR("The player did not move right, the view does not follow the machine");
+
+        // every 2 by 2 square of the screen against the pixels one by one
+        seen = observer.observe(machine);
+        bool same = true;
+        int lit = 0;
+        for (int row = 0; row != 112; row++) {
+            for (int column = 0; column != 128; column++) {
+                bool any = false;
+                for (int pixel = 0; pixel != 4; pixel++) {
+                    const int line = row * 2 + pixel / 2;
+                    const int bit = column * 2 + pixel % 2;
+                    any = any || (machine.state.memory[0x2400 + line * 32 + bit / 8] >> (bit % 8) & 1) != 0;
+                }
+                same = same && seen.screen[row * 128 + column] == (any ? 1 : 0);
+                lit += seen.screen[row * 128 + column];
+            }
+        }
+        if (!same)
+            BOOST_ERROR("The screen shrunk by 2 differs from the or of its squares");
+        if (lit <= 100)
+            BOOST_ERROR("The screen shrunk by 2 has only " + std::to_string(lit) + " pixels lit");
+        same = true;
+
+        // a crop of the player's line, unshrunk, is its sprite
+        InvadersObserver player({0, game.playerX(), 32, 16, 1});
+        const uint8_t* pixels = player.observe(machine).screen;
+        for (int line = 0; line != 16; line++) {
+            for (int bit = 0; bit != 32; bit++) {
+                same = same && pixels[line * 32 + bit] == (machine.state.memory[0x2400 + (game.playerX() + line) * 32 + bit / 8] >> (bit % 8) & 1);
+            }
+        }
+        if (!same)
+            BOOST_ERROR("The crop of the player's line differs from its sprite");
+        if (InvadersObserver().observe(machine).screen != nullptr)
+            BOOST_ERROR("An observer without a screen gives one");
+    } catch (const std::exception& err) {
+        BOOST_ERROR(std::string("Failure observing the game : ") + err.what());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( trap_tests ) {
+    Disassembler8080 cpu;
+    Traps traps;
+    cpu.traps = &traps;
+    int trapped = 0;
+    traps.add(0x200, [&trapped](State8080& state) {
+        ++trapped;
+        state.b = 0x42;
+        Traps::ret(state);
+    });
+    State8080 state = programState({
+        0xCD, 0x00, 0x02,                   // 0100 CALL 0200
+        0x00                                // 0103 NOP
+    });
+    state.memory[0x1FF] = 0x00;             // 01FF NOP, falls into 0200 without a trap
+    cpu.runCycle(state);
+    if (trapped != 1)
+        BOOST_ERROR("A call to a trap did not run it once");
+    if (state.b != 0x42)
+        BOOST_ERROR("The trap's change to b=" + std::to_string(state.b) + " was lost");
+    if (state.programCounter != 0x103 || state.stackPointer != 0x4000)
+        BOOST_ERROR("A trap ending in Traps::ret did not return to its caller");
+    state.programCounter = 0x1FF;
+    cpu.runCycle(state);
+    if (trapped != 1)
+        BOOST_ERROR("Falling into a trap's address ran it");
+    if (state.programCounter != 0x200)
+        BOOST_ERROR("The NOP before a trap did not fall through to it");
+    traps.remove(0x200);
+    if (!traps.empty())
+        BOOST_ERROR("A removed trap is still set");
+
+    // a CP/M program printing, reading a key and asking for the version
+    const std::vector<uint8_t> program = {
+        0x0E, 0x09,                         // 0100 MVI C,9
+        0x11, 0x30, 0x01,                   // 0102 LXI D,0130
+        0xCD, 0x05, 0x00,                   // 0105 CALL 5
+        0x0E, 0x02,                         // 0108 MVI C,2
+        0x1E, '!',                          // 010A MVI E,'!'
+        0xCD, 0x05, 0x00,                   // 010C CALL 5
+        0x0E, 0x01,                         // 010F MVI C,1
+        0xCD, 0x05, 0x00,                   // 0111 CALL 5
+        0x32, 0x40, 0x01,                   // 0114 STA 0140
+        0x0E, 0x0C,                         // 0117 MVI C,12
+        0xCD, 0x05, 0x00,                   // 0119 CALL 5
+        0xC3, 0x00, 0x00                    // 011C JMP 0
+    };
+    State8080 cpm;
+    std::copy(program.begin(), program.end(), cpm.memory.begin() + CpmBdos::tpa);
+    const std::string text = "Hi$";
+    std::copy(text.begin(), text.end(), cpm.memory.begin() + 0x130);
+    CpmBdos bdos(traps);
+    bdos.prepare(cpm);
+    bdos.type("x");
+    if (cpm.memory[6] != (CpmBdos::top & 0xFF) || cpm.memory[7] != CpmBdos::top >> 8)
+        BOOST_ERROR("The address at 6 is not the top of the TPA");
+    for (int i = 0; i != 100 && !bdos.finished(); i++) {
+        cpu.runCycle(cpm);
+    }
+    if (!bdos.finished())
+        BOOST_ERROR("The jump to 0 did not finish the program");
+    if (bdos.output() != "Hi!x")
+        BOOST_ERROR("The console output is " + bdos.output());
+    if (cpm.memory[0x140] != 'x')
+        BOOST_ERROR("The key typed was not read");
+    if (cpm.l != 0x22 || cpm.h != 0x00)
+        BOOST_ERROR("The version is not CP/M 2.2");
+}
+
+BOOST_AUTO_TEST_CASE( cpm_machine_tests ) {
+    const std::string image = "cpm_test.img";
+    try {
+        DiskImage::create(image, diskFormats[0]);
+        std::string text = "Hello$";
+        text.resize(300, 'x');
+        const std::vector<uint8_t> hello(text.begin(), text.end());
+        std::vector<uint8_t> big(20000);
+        for (std::size_t i = 0; i != big.size(); i++) {
+            big[i] = static_cast<uint8_t>(i * 7);
+        }
+        // types its argument's first record, copies it to OUT.TXT and prints through the BIOS
+        const std::vector<uint8_t> program = {
+            0x0E, 0x0F,                     // 0100 MVI C,15
+            0x11, 0x5C, 0x00,               // 0102 LXI D,005C
+            0xCD, 0x05, 0x00,               // 0105 CALL 5
+            0x0E, 0x14,                     // 0108 MVI C,20
+            0x11, 0x5C, 0x00,               // 010A LXI D,005C
+            0xCD, 0x05, 0x00,               // 010D CALL 5
+            0x0E, 0x09,                     // 0110 MVI C,9
+            0x11, 0x80, 0x00,               // 0112 LXI D,0080
+            0xCD, 0x05, 0x00,               // 0115 CALL 5
+            0x0E, 0x16,                     // 0118 MVI C,22
+            0x11, 0x00, 0x02,               // 011A LXI D,0200
+            0xCD, 0x05, 0x00,               // 011D CALL 5
+            0x0E, 0x15,                     // 0120 MVI C,21
+            0x11, 0x00, 0x02,               // 0122 LXI D,0200
+            0xCD, 0x05, 0x00,               // 0125 CALL 5
+            0x0E, 0x10,                     // 0128 MVI C,16
+            0x11, 0x00, 0x02,               // 012A LXI D,0200
+            0xCD, 0x05, 0x00,               // 012D CALL 5
+            0x2A, 0x01, 0x00,               // 0130 LHLD 0001, the BIOS's warm boot
+            0x11, 0x09, 0x00,               // 0133 LXI D,0009
+            0x19,                           // 0136 DAD D, CONOUT
+            0x11, 0x3E, 0x01,               // 0137 LXI D,013E
+            0xD5,                           // 013A PUSH D
+            0x0E, '!',                      // 013B MVI C,'!'
+            0xE9,                           // 013D PCHL
+            0xC3, 0x00, 0x00                // 013E JMP 0
+        };
+        {
+            CpmMachine machine;
+            machine.mount(0, image);
+            if (!machine.bdos.writeFile(0, "HELLO.TXT", hello))
+                BOOST_ERROR("HELLO.TXT could not be written");
+            if (!machine.bdos.writeFile(0, "BIG.DAT", big)) // over an extent and many blocks
+                BOOST_ERROR("BIG.DAT could not be written");
+            std::vector<uint8_t> code(program);
+            code.resize(0x124, 0x00);
+            const std::string out("\0OUT     TXT", 12);
+            std::copy(out.begin(), out.end(), code.begin() + 0x100); // the FCB at 0200
+            machine.load(code, {"hello.txt"});
+            if (machine.state.memory[0x80] != 10 || machine.state.memory[0x81] != ' ' || machine.state.memory[0x82] != 'H')
+                BOOST_ERROR("The command tail at 0x80 is not the argument");
+            if (machine.state.memory[0x5D] != 'H' || machine.state.memory[0x65] != 'T')
+                BOOST_ERROR("The FCB at 0x5C is not the argument");
+            if (machine.state.memory[0x6D] != ' ')
+                BOOST_ERROR("The second FCB at 0x6C is not blank");
+            const CpmMachine::Result result = machine.run(1000);
+            if (!result.finished || result.instructions >= 1000)
+                BOOST_ERROR("The program did not finish");
+            if (machine.bdos.output() != "Hello!")
+                BOOST_ERROR("The console output is " + machine.bdos.output());
+        }
+        // the image was written as the program ran
+        CpmMachine machine;
+        machine.mount(0, image);
+        std::vector<uint8_t> read;
+        if (!machine.bdos.readFile(0, "OUT.TXT", read))
+            BOOST_ERROR("OUT.TXT was not written to the image");
+        if (read.size() != 128)
+            BOOST_ERROR("OUT.TXT has " + std::to_string(read.size()) + " bytes, not the record written");
+        else if (!std::equal(read.begin(), read.end(), hello.begin()))
+            BOOST_ERROR("OUT.TXT is not the first record of HELLO.TXT");
+        if (!machine.bdos.readFile(0, "BIG.DAT", read))
+            BOOST_ERROR("BIG.DAT was not kept in the image");
+        if (read.size() != 20096)
+            BOOST_ERROR("BIG.DAT has " + std::to_string(read.size()) + " bytes, not whole records of 20000");
+        else if (!std::equal(big.begin(), big.end(), read.begin()))
+            BOOST_ERROR("BIG.DAT differs from what was written");
+        if (machine.bdos.readFile(0, "NONE.TXT", read))
+            BOOST_ERROR("A file that does not exist was read");
+        BOOST_CHECK_THROW(machine.load(std::vector<uint8_t>(0xE400)), std::runtime_error);
+
+        // a record buffer at the end of memory fails the search instead of writing past it
+        const std::vector<uint8_t> search = {
+            0x0E, 0x1A,                     // 0100 MVI C,26
+            0x11, 0xF0, 0xFF,               // 0102 LXI D,FFF0
+            0xCD, 0x05, 0x00,               // 0105 CALL 5
+            0x0E, 0x11,                     // 0108 MVI C,17
+            0x11, 0x5C, 0x00,               // 010A LXI D,005C
+            0xCD, 0x05, 0x00,               // 010D CALL 5
+            0x32, 0x00, 0x02,               // 0110 STA 0200
+            0xC3, 0x00, 0x00                // 0113 JMP 0
+        };
+        machine.load(search, {"*.*"});
+        const uint64_t cycles = machine.state.cycleCount;
+        if (!machine.run(1000).finished)
+            BOOST_ERROR("The search with a buffer at the end of memory did not finish");
+        if (machine.state.memory[0x200] != 0xFF)
+            BOOST_ERROR("The search with a buffer at the end of memory did not fail");
+        if (machine.state.cycleCount - cycles >= 1000)
+            BOOST_ERROR("The search with a buffer at the end of memory ran " + std::to_string(machine.state.cycleCount - cycles) + " cycles");
+    } catch (const std::exception& err) {
+        BOOST_ERROR(std::string("Failure running the CP/M machine : ") + err.what());
+    }
+    std::remove(image.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( assembler_tests ) {
+    try {
+        // the sources of the diagnostics assemble to their binaries, TST8080.COM is padded to a whole record
+        for (const char* name : {"8080PRE", "TST8080"}) {
+            const std::string base = std::string("../rsc/") + name;
+            const Assembly assembly = Assembly::fromFile(base + (name[0] == '8' ? ".MAC" : ".ASM"));
+            State8080 com = stateFromFile(base + ".COM", 0x100);
+            if (assembly.origin() != 0x100 || assembly.start() != 0x100)
+                BOOST_ERROR(base + " does not start at 0x100");
+            if (!std::equal(assembly.bytes().begin(), assembly.bytes().end(), com.memory.begin() + 0x100))
+                BOOST_ERROR(base + " does not assemble to its .COM file");
+            std::ifstream file(base + ".COM", std::ios_base::binary | std::ios_base::ate);
+            const std::size_t records = (assembly.bytes().size() + 127) / 128;
+            if (assembly.bytes().empty() || records * 128 != static_cast<std::size_t>(file.tellg()))
+                BOOST_ERROR(base + " assembles to " + std::to_string(assembly.bytes().size()) + " bytes, not the records of its .COM file");
+        }
+
+        const Assembly assembly = Assembly::fromSource(
+            "size    equ     (end - begin) / 2\n"
+            "        org     200h\n"
+            "begin:  lxi     sp,begin\n"
+            "        mvi     a,low 1234h\n"
+            "        mvi     b,high 1234h\n"
+            "count   set     0\n"
+            "        rept    3\n"
+            "count   set     count + 1\n"
+            "        db      count shl 4 or 1, 'A' + count\n"
+            "        endm\n"
+            "load    macro   reg, val\n"
+            "        mvi     reg&, val&0h\n"
+            "        endm\n"
+            "        load    c, 2\n"
+            "        if      count eq 3\n"
+            "        dw      $, 'hi', -1\n"
+            "        else\n"
+            "        db      0ffh\n"
+            "        endif\n"
+            "        ds      2, 'x'\n"
+            "end:    end     begin\n", 0x100);
+        const std::vector<uint8_t> expected = {
+            0x31, 0x00, 0x02, 0x3E, 0x34, 0x06, 0x12, 0x11, 0x42, 0x21, 0x43, 0x31, 0x44, 0x0E, 0x20,
+            0x0F, 0x02, 0x69, 0x68, 0xFF, 0xFF, 'x', 'x'
+        };
+        if (assembly.origin() != 0x200)
+            BOOST_ERROR("org did not move the origin to 0x200");
+        if (assembly.start() != 0x200)
+            BOOST_ERROR("end did not set the start to its label");
+        if (assembly.bytes() != expected)
+            BOOST_ERROR("The directives and macros assemble to other bytes");
+        if (assembly.symbol("size") != expected.size() / 2)
+            BOOST_ERROR("equ did not resolve a symbol defined after it");
+        if (assembly.symbol("END") != 0x217)
+            BOOST_ERROR("The label on end is not after ds");
+        if (assembly.labels().find(0x200) == nullptr || assembly.labels().find(0x200)->compare("BEGIN") != 0)
+            BOOST_ERROR("The label at 0x200 is not BEGIN");
+        BOOST_CHECK_THROW(assembly.symbol("nowhere"), std::runtime_error);
+
+        // errors are on the line they are about
+        auto error = [](const std::string& source) {
+            try {
+                Assembly::fromSource(source);
+            } catch (const std::runtime_error& err) {
+                return std::string(err.what());
+            }
+            return std::string();
+        };
+        const std::vector<std::pair<std::string, std::string>> errors = {
+            {" nop\n jmp nowhere\n", "source:2: undefined symbol NOWHERE"},
+            {" mvi a,256\n", "source:1: value 256 does not fit in a byte"},
+            {"x: nop\nx: nop\n", "source:2: duplicate symbol x"},
+            {" mov m,m\n", "source:1: MOV M,M is HLT"},
+            {" lxi psw,0\n", "source:1: expected a register pair, given psw"},
+            {" frob a\n", "source:1: unknown instruction FROB"},
+            {"n equ x\n ds n\nx: nop\n", "source:2: symbols in n must be defined before it"}
+        };
+        for (const std::pair<std::string, std::string>& source : errors) {
+            const std::string message = error(source.first);
+            if (message != source.second)
+                BOOST_ERROR("Assembling \"" + source.first + "\" failed with \"" + message + "\", not \"" + source.second + "\"");
+        }
+
+        // the generated kernels loop forever with the stack where it was
+        for (const std::string& mix : KernelGenerator::mixes()) {
+            const std::string source = KernelGenerator::source(mix, 100, 7);
+            if (source != KernelGenerator::source(mix, 100, 7))
+                BOOST_ERROR("The " + mix + " kernel differs between two runs with the same seed");
+            const Assembly kernel = Assembly::fromSource(source, 0x100, mix);
+            State8080 state;
+            kernel.load(state);
+            state.programCounter = kernel.start();
+            Disassembler8080 cpu;
+            int passes = 0;
+            bool balanced = true;
+            for (int i = 0; i != 200000; i++) {
+                if (state.programCounter == kernel.symbol("LOOP")) {
+                    balanced = balanced && (passes == 0 || state.stackPointer == 0x4000);
+                    ++passes;
+                }
+                cpu.runCycle(state);
+            }
+            if (!balanced)
+                BOOST_ERROR("The " + mix + " kernel does not keep the stack where it was");
+            if (passes <= 100)
+                BOOST_ERROR("The " + mix + " kernel looped " + std::to_string(passes) + " times");
+        }
+        BOOST_CHECK_THROW(KernelGenerator::source("float"), std::runtime_error);
+    } catch (const std::exception& err) {
+        BOOST_ERROR(std::string("Failure assembling : ") + err.what());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( trace_tests ) {
+    try {
+        SpaceInvaders machine;
+        loadRomFile(machine.state, "../rsc/invaders", 0);
+        std::vector<TraceRecord> expected;
+        {
+            TraceRecorder recorder("trace_test.trace");
+            machine.trace = &recorder;
+            // the game enables interrupts after about 10 frames
+            while (machine.state.cycleCount < 20 * SpaceInvaders::cyclesPerFrame) {
+                const State8080 before = machine.state;
+                machine.step();
+                if (expected.size() < 8)
+                    expected.push_back({before.cycleCount, before.programCounter, before.stackPointer, before.memory[before.programCounter],
+                                        {before.memory[before.programCounter + 1], before.memory[before.programCounter + 2]},
+                                        before.a, before.b, before.c, before.d, before.e, before.h, before.l,
+                                        before.condFlags.makePSW(), TraceRecord::Instruction});
+            }
+            machine.trace = nullptr;
+            recorder.close();
+
+            const TraceFile trace = TraceFile::fromFile("trace_test.trace");
+            if (trace.size() != recorder.recorded())
+                BOOST_FAIL("The trace file has " + std::to_string(trace.size()) + " of " + std::to_string(recorder.recorded()) + " records");
+            for (std::size_t i = 0; i != expected.size(); i++) {
+                if (std::memcmp(&trace[i], &expected[i], sizeof(TraceRecord)) != 0)
+                    BOOST_ERROR("Trace record " + std::to_string(i) + " is not the state before its instruction");
+            }
+            std::size_t interrupts = 0;
+            bool ordered = true;
+            bool vectored = true;
+            for (std::size_t i = 1; i != trace.size(); i++) {
+                ordered = ordered && trace[i].cycle > trace[i - 1].cycle;
+                if (trace[i].kind == TraceRecord::Interrupt) {
+                    ++interrupts;
+                    vectored = vectored && (i + 1 == trace.size() || trace[i + 1].programCounter == (trace[i].opcode & 0x38));
+                }
+            }
+            if (!ordered)
+                BOOST_ERROR("The trace records are not in cycle order");
+            if (!vectored)
+                BOOST_ERROR("An interrupt record is not followed by its restart's vector");
+            if (interrupts < 4)
+                BOOST_ERROR("The trace has " + std::to_string(interrupts) + " interrupts in 20 frames");
+            if (disassemble(trace[3].opcode, trace[3].operands[0], trace[3].operands[1]) != "JMP 0x18D4")
+                BOOST_ERROR("The fourth record is not the jump to the game's initialisation");
+        }
+        std::remove("trace_test.trace");
+    } catch (const std::exception& err) {
+        BOOST_ERROR(std::string("Failure tracing : ") + err.what());
+    }
+}
+
+
 #endif
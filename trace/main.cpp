@@ -0,0 +1,138 @@
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdio>
+
+#include "Trace.hpp"
+#include "OpcodeInfo.hpp"
+#include "Symbols.hpp"
+
+// Lists the instructions of a trace recorded with 8080-headless --trace, only the records shown are read
+
+namespace {
+
+struct Options {
+    std::string trace;
+    std::string symbols;
+    uint64_t from = 0;
+    uint64_t count = 40;
+    int pc = -1; // only records at this address
+    bool summary = false;
+};
+
+void usage() {
+    std::cout << "Usage: 8080-trace <file> [options]\n"
+              << "  --from <n>          first record to list, default 0\n"
+              << "  --count <n>         records to list, default 40\n"
+              << "  --pc <address>      only list records at a hex address, e.g. 1A32\n"
+              << "  --symbols <file>    name the addresses from a symbol file, e.g. ../rsc/invaders.sym\n"
+              << "  --summary           the number of records, cycles and interrupts instead of a listing\n";
+}
+
+Options parseOptions(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc)
+                throw std::runtime_error(arg + " requires a value");
+            return argv[++i];
+        };
+        if (arg == "--from") options.from = std::stoull(value());
+        else if (arg == "--count") options.count = std::stoull(value());
+        else if (arg == "--pc") options.pc = static_cast<int>(std::stoul(value(), nullptr, 16) & 0xFFFF);
+        else if (arg == "--symbols") options.symbols = value();
+        else if (arg == "--summary") options.summary = true;
+        else if (arg == "--help") {
+            usage();
+            std::exit(0);
+        }
+        else if (!arg.empty() && arg[0] != '-' && options.trace.empty()) options.trace = arg;
+        else throw std::runtime_error("unknown option " + arg);
+    }
+    if (options.trace.empty())
+        throw std::runtime_error("no trace given");
+    return options;
+}
+
+std::string flags(const uint8_t& psw) {
+    std::string text = "szapc";
+    const uint8_t bits[] = {0x80, 0x40, 0x10, 0x04, 0x01};
+    for (std::size_t i = 0; i != text.size(); i++) {
+        if ((psw & bits[i]) == 0)
+            text[i] = '.';
+    }
+    return text;
+}
+
+void list(const TraceRecord& record, const uint64_t& index, const Symbols& symbols) {
+    const uint8_t size = opcodeInfo[record.opcode].size;
+    std::string bytes;
+    char hex[4];
+    for (uint8_t i = 0; i != size; i++) {
+        std::snprintf(hex, sizeof hex, "%02X ", i == 0 ? record.opcode : record.operands[i - 1]);
+        bytes += hex;
+    }
+    std::string text = disassemble(record.opcode, record.operands[0], record.operands[1]);
+    if (record.kind == TraceRecord::Interrupt) {
+        bytes = "";
+        text = "interrupt " + text;
+    }
+    char line[160];
+    std::snprintf(line, sizeof line, "%10llu %12llu  %04X  %-9s %-16s a=%02X b=%02X c=%02X d=%02X e=%02X h=%02X l=%02X sp=%04X %s",
+                  static_cast<unsigned long long>(index), static_cast<unsigned long long>(record.cycle), record.programCounter,
+                  bytes.c_str(), text.c_str(), record.a, record.b, record.c, record.d, record.e, record.h, record.l,
+                  record.stackPointer, flags(record.flags).c_str());
+    std::cout << line;
+    if (!symbols.empty())
+        std::cout << "  " << symbols.describe(record.programCounter);
+    std::cout << '\n';
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        usage();
+        return 1;
+    }
+
+    TraceFile trace;
+    Symbols symbols;
+    try {
+        trace = TraceFile::fromFile(options.trace);
+        if (!options.symbols.empty())
+            symbols = Symbols::fromFile(options.symbols);
+    } catch (std::exception& e) {
+        std::cerr << "Error loading, " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (options.summary) {
+        uint64_t interrupts = 0;
+        for (std::size_t i = 0; i != trace.size(); i++) {
+            interrupts += trace[i].kind == TraceRecord::Interrupt;
+        }
+        std::cout << options.trace << ": " << trace.size() << " records, " << interrupts << " interrupts";
+        if (trace.size() != 0)
+            std::cout << ", cycles " << trace[0].cycle << " to " << trace[trace.size() - 1].cycle;
+        std::cout << std::endl;
+        return 0;
+    }
+
+    std::cout << "    record        cycle    pc  bytes     instruction\n";
+    uint64_t listed = 0;
+    for (uint64_t i = options.from; i < trace.size() && listed != options.count; i++) {
+        if (options.pc != -1 && trace[i].programCounter != options.pc)
+            continue;
+        list(trace[i], i, symbols);
+        ++listed;
+    }
+    std::cout << std::flush;
+    return 0;
+}
@@ -0,0 +1,25 @@
+TEMPLATE = app
+TARGET = 8080-trace
+CONFIG += console c++14 thread
+CONFIG -= app_bundle
+CONFIG -= qt
+
+SOURCES += \
+    ../src/ConditionFlags.cpp \
+    ../src/OpcodeInfo.cpp \
+    ../src/RomLoader.cpp \
+    ../src/Symbols.cpp \
+    ../src/Trace.cpp \
+    main.cpp
+
+HEADERS += \
+    ../include/ConditionFlags.hpp \
+    ../include/MemoryHeatmap.hpp \
+    ../include/OpcodeInfo.hpp \
+    ../include/RomLoader.hpp \
+    ../include/State8080.hpp \
+    ../include/Symbols.hpp \
+    ../include/Trace.hpp
+
+INCLUDEPATH += \
+    ../include